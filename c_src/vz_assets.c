@@ -0,0 +1,450 @@
+#include "vz_helpers.h"
+#include "vz_assets.h"
+#include "vz_pixels.h"
+#include "vz_textures.h"
+
+#include "stb_image.h"
+
+#include <erl_nif.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef VZ_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+
+bool vz_asset_cache_init(VZasset_cache *cache) {
+  cache->assets = NULL;
+  return (cache->lock = enif_mutex_create("vz_asset_cache_mutex")) != NULL;
+}
+
+#ifndef VZ_PLATFORM_WINDOWS
+static unsigned char* vz_read_file(int fd, size_t size) {
+  unsigned char *data = (unsigned char*)enif_alloc(size);
+  size_t done = 0;
+  ssize_t n;
+
+  while(done < size) {
+    if((n = read(fd, data + done, size - done)) < 0 && errno == EINTR)
+      continue;
+    if(n <= 0) {
+      enif_free(data);
+      return NULL;
+    }
+    done += (size_t)n;
+  }
+
+  return data;
+}
+#endif
+
+/*
+  Maps a file read-only into memory, pages are read on demand and shared by
+  everything that maps the same file. A mapped file that is truncated makes
+  reading the lost pages raise SIGBUS, which would take down the BEAM, so only
+  files on read-only file systems are mapped, others are read into the heap.
+  Windows doesn't allow mapped files to be truncated, they are always mapped.
+*/
+static unsigned char* vz_map_file(const char *path, size_t *size, bool *mapped) {
+  void *data;
+#ifdef VZ_PLATFORM_WINDOWS
+  HANDLE file, mapping;
+  LARGE_INTEGER file_size;
+
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return NULL;
+  if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+    CloseHandle(file);
+    return NULL;
+  }
+
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if(!mapping)
+    return NULL;
+  // the view keeps the mapping alive
+  data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if(!data)
+    return NULL;
+  *size = (size_t)file_size.QuadPart;
+  *mapped = true;
+#else
+  struct stat st;
+  struct statvfs vfs;
+  int fd;
+
+  if((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    return NULL;
+  if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+  *size = (size_t)st.st_size;
+
+  if(fstatvfs(fd, &vfs) != 0 || !(vfs.f_flag & ST_RDONLY)) {
+    data = vz_read_file(fd, *size);
+    close(fd);
+    *mapped = false;
+    return (unsigned char*)data;
+  }
+
+  data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED)
+    return NULL;
+  *mapped = true;
+#endif
+
+  return (unsigned char*)data;
+}
+
+static void vz_unmap_file(unsigned char *data, size_t size) {
+#ifdef VZ_PLATFORM_WINDOWS
+  __UNUSED(size);
+  UnmapViewOfFile(data);
+#else
+  munmap(data, size);
+#endif
+}
+
+static void vz_asset_free_data(VZasset *asset) {
+  if(asset->mapped_data)
+    vz_unmap_file(asset->data, asset->size);
+  else if(asset->stbi_data)
+    stbi_image_free(asset->data);
+  else
+    enif_free(asset->data);
+  asset->data = NULL;
+  asset->stbi_data = false;
+  asset->mapped_data = false;
+}
+
+static void vz_asset_free(VZasset *asset) {
+  vz_asset_free_data(asset);
+  if(asset->source)
+    enif_free(asset->source);
+  enif_free(asset);
+}
+
+void vz_asset_cache_free(VZasset_cache *cache) {
+  VZasset *asset = cache->assets, *next;
+
+  while(asset) {
+    next = asset->next;
+    vz_asset_free(asset);
+    asset = next;
+  }
+  cache->assets = NULL;
+
+  if(cache->lock)
+    enif_mutex_destroy(cache->lock);
+}
+
+static bool vz_canonical_path(const char *file_path, char *path, time_t *mtime) {
+  struct stat st;
+#ifdef VZ_PLATFORM_WINDOWS
+  if(!_fullpath(path, file_path, VZ_ASSET_PATH_LENGTH))
+    return false;
+#else
+  char *real_path;
+
+  if(!(real_path = realpath(file_path, NULL)))
+    return false;
+  strncpy(path, real_path, VZ_ASSET_PATH_LENGTH - 1);
+  path[VZ_ASSET_PATH_LENGTH - 1] = '\0';
+  free(real_path);
+#endif
+
+  if(stat(path, &st) != 0)
+    return false;
+  *mtime = st.st_mtime;
+
+  return true;
+}
+
+/*
+  Downscales decoded pixels to the maximum size of the image and builds its
+  mip chain, taking over the pixels.
+*/
+static void vz_asset_prepare_image(VZasset *asset, unsigned char *pixels, int width, int height) {
+  const VZimage_opts *opts = &asset->opts;
+  int fit_width, fit_height;
+
+  vz_pixels_fit(width, height, opts->max_width, opts->max_height, &fit_width, &fit_height);
+  asset->width = fit_width;
+  asset->height = fit_height;
+  asset->levels = opts->mipmaps ? vz_pixels_mip_levels(fit_width, fit_height) : 1;
+  asset->size = vz_pixels_mip_chain_size(fit_width, fit_height, asset->levels);
+
+  if(fit_width == width && fit_height == height && asset->levels == 1) {
+    asset->data = pixels;
+    asset->stbi_data = true;
+    return;
+  }
+
+  asset->data = (unsigned char*)enif_alloc(asset->size);
+  if(fit_width == width && fit_height == height)
+    memcpy(asset->data, pixels, (size_t)width * height * 4);
+  else
+    vz_pixels_resize(pixels, width, height, asset->data, fit_width, fit_height);
+  stbi_image_free(pixels);
+
+  vz_pixels_mip_chain(asset->data, fit_width, fit_height, asset->levels);
+}
+
+static bool vz_asset_load(VZasset *asset, const unsigned char *src, size_t src_size) {
+  int width, height, num_channels;
+  unsigned char *pixels;
+
+  if(asset->type == VZ_ASSET_IMAGE) {
+    // stb_image is set up like nvgCreateImage does when the NIF is loaded
+    if(src)
+      pixels = stbi_load_from_memory(src, (int)src_size, &width, &height, &num_channels, 4);
+    else
+      pixels = stbi_load(asset->path, &width, &height, &num_channels, 4);
+    if(!pixels)
+      return false;
+    vz_asset_prepare_image(asset, pixels, width, height);
+    return true;
+  }
+
+  // fonts on read-only file systems are mapped rather than read, NanoVG and
+  // stb_truetype only touch the tables and glyphs they use
+  if(!(asset->data = vz_map_file(asset->path, &asset->size, &asset->mapped_data)))
+    return false;
+
+  return true;
+}
+
+static VZasset* vz_asset_find(VZasset_cache *cache, const VZasset *key) {
+  for(VZasset *asset = cache->assets; asset; asset = asset->next) {
+    if(asset->type == key->type && asset->mtime == key->mtime && asset->hash == key->hash &&
+       asset->opts.max_width == key->opts.max_width && asset->opts.max_height == key->opts.max_height &&
+       asset->opts.mipmaps == key->opts.mipmaps && strcmp(asset->path, key->path) == 0 &&
+       asset->source_size == key->source_size &&
+       (!key->source || memcmp(asset->source, key->source, key->source_size) == 0))
+      return asset;
+  }
+
+  return NULL;
+}
+
+/*
+  Decodes the pixels of an image again when they were released since nothing
+  pinned them anymore, from its file or its encoded bytes. Called with a pin
+  on the asset, which is dropped together with the reference on failure.
+*/
+static bool vz_asset_ensure_data(VZasset *asset) {
+  VZasset_cache *cache = asset->cache;
+  VZasset loaded;
+  bool ok;
+
+  enif_mutex_lock(cache->lock);
+  ok = asset->data != NULL;
+  if(!ok) {
+    memcpy(&loaded, asset, sizeof(VZasset));
+    loaded.data = NULL;
+    loaded.stbi_data = false;
+  }
+  enif_mutex_unlock(cache->lock);
+
+  if(ok)
+    return true;
+
+  // the file may have been replaced with the same modification time
+  if(vz_asset_load(&loaded, loaded.source, loaded.source_size) &&
+     loaded.width == asset->width && loaded.height == asset->height) {
+    enif_mutex_lock(cache->lock);
+    if(!asset->data) {
+      asset->data = loaded.data;
+      asset->stbi_data = loaded.stbi_data;
+      loaded.data = NULL;
+    }
+    enif_mutex_unlock(cache->lock);
+    ok = true;
+  }
+
+  if(loaded.data)
+    vz_asset_free_data(&loaded);
+  if(!ok) {
+    vz_asset_unpin(asset);
+    vz_asset_release(asset);
+  }
+
+  return ok;
+}
+
+/*
+  Returns the cached asset matching `key`, loading it when there is none yet.
+  Assets are loaded without holding the cache lock, so an asset loaded
+  concurrently by two callers is kept only once. The reference pins the data.
+*/
+static VZasset* vz_asset_lookup(VZasset_cache *cache, const VZasset *key, const unsigned char *src, size_t src_size) {
+  VZasset *asset, *found;
+
+  enif_mutex_lock(cache->lock);
+  if((asset = vz_asset_find(cache, key))) {
+    ++asset->refs;
+    ++asset->pins;
+  }
+  enif_mutex_unlock(cache->lock);
+
+  if(asset)
+    return vz_asset_ensure_data(asset) ? asset : NULL;
+
+  asset = (VZasset*)enif_alloc(sizeof(VZasset));
+  memcpy(asset, key, sizeof(VZasset));
+  asset->cache = cache;
+  asset->refs = 1;
+  asset->pins = 1;
+  asset->source = NULL;
+
+  if(!vz_asset_load(asset, src, src_size)) {
+    enif_free(asset);
+    return NULL;
+  }
+
+  // the key only borrows the encoded bytes of the caller
+  if(key->source) {
+    asset->source = (unsigned char*)enif_alloc(key->source_size);
+    memcpy(asset->source, key->source, key->source_size);
+  }
+
+  enif_mutex_lock(cache->lock);
+  if((found = vz_asset_find(cache, key))) {
+    ++found->refs;
+    ++found->pins;
+    enif_mutex_unlock(cache->lock);
+    vz_asset_free(asset);
+    return vz_asset_ensure_data(found) ? found : NULL;
+  }
+  asset->next = cache->assets;
+  cache->assets = asset;
+  enif_mutex_unlock(cache->lock);
+
+  return asset;
+}
+
+/*
+  Returns a reference to the decoded image or the contents of the font file at
+  `file_path`, loading it when no view did yet or the file changed since.
+*/
+VZasset* vz_asset_acquire(VZasset_cache *cache, enum VZasset_type type, const char *file_path, const VZimage_opts *opts) {
+  VZasset key;
+
+  memset(&key, 0, sizeof(VZasset));
+  key.type = type;
+  if(opts)
+    key.opts = *opts;
+
+  if(!vz_canonical_path(file_path, key.path, &key.mtime))
+    return NULL;
+
+  return vz_asset_lookup(cache, &key, NULL, 0);
+}
+
+/*
+  Returns a reference to the decoded image of an encoded image in memory,
+  decoding it when there is no image with the same contents and options yet.
+  Hash collisions are told apart by comparing the encoded bytes.
+*/
+VZasset* vz_asset_acquire_memory(VZasset_cache *cache, const unsigned char *data, size_t size, const VZimage_opts *opts) {
+  VZasset key;
+
+  memset(&key, 0, sizeof(VZasset));
+  key.type = VZ_ASSET_IMAGE;
+  key.opts = *opts;
+  key.hash = vz_texture_hash(data, size) ^ size;
+  key.source = (unsigned char*)data;
+  key.source_size = size;
+
+  return vz_asset_lookup(cache, &key, data, size);
+}
+
+/*
+  Takes another reference that pins the data, the asset must already be pinned.
+*/
+void vz_asset_pin(VZasset *asset) {
+  enif_mutex_lock(asset->cache->lock);
+  ++asset->refs;
+  ++asset->pins;
+  enif_mutex_unlock(asset->cache->lock);
+}
+
+/*
+  Unpins the data of an asset, keeping the reference. The pixels of an image
+  that nothing pins anymore are released, the asset keeps its key and decodes
+  them again when it is acquired again. Font data is never released, NanoVG
+  uses it for as long as the font exists.
+*/
+void vz_asset_unpin(VZasset *asset) {
+  VZasset_cache *cache = asset->cache;
+  VZasset released;
+
+  released.data = NULL;
+
+  enif_mutex_lock(cache->lock);
+  if(--asset->pins == 0 && asset->type == VZ_ASSET_IMAGE && asset->data) {
+    released.data = asset->data;
+    released.size = asset->size;
+    released.stbi_data = asset->stbi_data;
+    released.mapped_data = false;
+    asset->data = NULL;
+    asset->stbi_data = false;
+  }
+  enif_mutex_unlock(cache->lock);
+
+  if(released.data)
+    vz_asset_free_data(&released);
+}
+
+void vz_asset_release(VZasset *asset) {
+  VZasset_cache *cache = asset->cache;
+  VZasset **a;
+
+  enif_mutex_lock(cache->lock);
+  if(--asset->refs == 0) {
+    for(a = &cache->assets; *a; a = &(*a)->next) {
+      if(*a == asset) {
+        *a = asset->next;
+        break;
+      }
+    }
+  }
+  else asset = NULL;
+  enif_mutex_unlock(cache->lock);
+
+  if(asset)
+    vz_asset_free(asset);
+}
+
+void vz_asset_ref_push(VZasset_ref **refs, VZasset *asset) {
+  VZasset_ref *ref = (VZasset_ref*)enif_alloc(sizeof(VZasset_ref));
+
+  ref->asset = asset;
+  ref->next = *refs;
+  *refs = ref;
+}
+
+void vz_asset_ref_release_all(VZasset_ref **refs) {
+  VZasset_ref *ref = *refs, *next;
+
+  while(ref) {
+    next = ref->next;
+    vz_asset_release(ref->asset);
+    enif_free(ref);
+    ref = next;
+  }
+  *refs = NULL;
+}
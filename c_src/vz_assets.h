@@ -0,0 +1,113 @@
+#ifndef VZ_ASSETS_H_INCLUDED
+#define VZ_ASSETS_H_INCLUDED
+
+#include <erl_nif.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define VZ_ASSET_PATH_LENGTH 1024
+
+enum VZasset_type {
+  VZ_ASSET_IMAGE,
+  VZ_ASSET_FONT
+};
+
+struct VZasset_cache;
+
+/*
+  Load options of an image: the maximum size to downscale it to, keeping its
+  aspect ratio, and whether to build its mip chain on the CPU. A maximum of 0
+  means no limit.
+*/
+typedef struct VZimage_opts {
+  int max_width;
+  int max_height;
+  bool mipmaps;
+} VZimage_opts;
+
+/*
+  Asset cache
+
+  Image files are decoded and font files are mapped once, no matter how many
+  views use them. Assets are shared by all views of the BEAM, keyed by their
+  canonical path and modification time, and reference counted: an image holds
+  a reference for as long as it exists and a view holds one on every font it
+  created, since NanoVG keeps using the font data until its context is deleted.
+  Views in the GL share group draw an image from one texture owned by its
+  asset, see vz_share.h.
+
+  Images are also keyed by their load options, encoded images in memory by
+  their contents: the encoded bytes are kept in `source` and compared when the
+  hash matches. Images are decoded, downscaled and given their mip
+  chain by the caller, so on a dirty scheduler instead of a render thread. The
+  levels of the mip chain follow each other in `data`.
+
+  References that still need the pixels pin them: asset handles, images
+  waiting to be uploaded and textures of views with a texture budget, which
+  may upload them again. Once nothing pins them, the pixels are released and
+  the asset only keeps its key, so textures are still shared. Acquiring it
+  again decodes the file or the encoded bytes again.
+
+  Fonts on read-only file systems are memory mapped instead of copied to the
+  heap, creating a font costs no read I/O up front and its pages are shared
+  with the page cache and with other processes using the same file. Fonts on
+  writable file systems are read, a mapped file that is truncated would crash
+  the BEAM.
+*/
+/*
+  A GL texture of an image asset in the share group of all views, uploaded with
+  the given NanoVG image flags and referenced by the textures of the views
+  wrapping it. Deleted by the view releasing the last reference.
+*/
+typedef struct VZasset_texture {
+  int flags;
+  unsigned gl_texture;
+  unsigned refs;
+  struct VZasset_texture *next;
+} VZasset_texture;
+
+typedef struct VZasset {
+  enum VZasset_type type;
+  char path[VZ_ASSET_PATH_LENGTH];
+  time_t mtime;
+  uint64_t hash;
+  unsigned char *source;
+  size_t source_size;
+  VZimage_opts opts;
+  unsigned char *data;
+  size_t size;
+  int width;
+  int height;
+  int levels;
+  bool stbi_data;
+  bool mapped_data;
+  unsigned refs;
+  unsigned pins;
+  VZasset_texture *textures;
+  struct VZasset_cache *cache;
+  struct VZasset *next;
+} VZasset;
+
+typedef struct VZasset_cache {
+  ErlNifMutex *lock;
+  VZasset *assets;
+} VZasset_cache;
+
+typedef struct VZasset_ref {
+  VZasset *asset;
+  struct VZasset_ref *next;
+} VZasset_ref;
+
+bool vz_asset_cache_init(VZasset_cache *cache);
+void vz_asset_cache_free(VZasset_cache *cache);
+VZasset* vz_asset_acquire(VZasset_cache *cache, enum VZasset_type type, const char *file_path, const VZimage_opts *opts);
+VZasset* vz_asset_acquire_memory(VZasset_cache *cache, const unsigned char *data, size_t size, const VZimage_opts *opts);
+void vz_asset_pin(VZasset *asset);
+void vz_asset_unpin(VZasset *asset);
+void vz_asset_release(VZasset *asset);
+void vz_asset_ref_push(VZasset_ref **refs, VZasset *asset);
+void vz_asset_ref_release_all(VZasset_ref **refs);
+
+#endif
@@ -15,11 +15,28 @@ void vz_make_atoms(ErlNifEnv* env) {
   ATOM_REDRAW_MODE = enif_make_atom(env, "redraw_mode");
   ATOM_RM_INTERVAL = enif_make_atom(env, "interval");
   ATOM_RM_MANUAL = enif_make_atom(env, "manual");
+  ATOM_RM_AUTO = enif_make_atom(env, "auto");
   ATOM_FRAME_RATE = enif_make_atom(env, "frame_rate");
   ATOM_TITLE = enif_make_atom(env, "title");
-  ATOM_COLOR_STRUCT = enif_make_atom(env, "Elixir.Vizi.Color");
   ATOM_BACKGROUND_COLOR = enif_make_atom(env, "background_color");
   ATOM_PIXEL_RATIO = enif_make_atom(env, "pixel_ratio");
+  ATOM_LAYER_BUDGET = enif_make_atom(env, "layer_budget");
+  ATOM_PARTIAL_REDRAW = enif_make_atom(env, "partial_redraw");
+  ATOM_SHARED_RENDERER = enif_make_atom(env, "shared_renderer");
+  ATOM_FRAMES = enif_make_atom(env, "frames");
+  ATOM_CPU_TIME = enif_make_atom(env, "cpu_time");
+  ATOM_REFRESH_RATE = enif_make_atom(env, "refresh_rate");
+  ATOM_FRAME_INTERVAL = enif_make_atom(env, "frame_interval");
+  ATOM_TEXTURE_BUDGET = enif_make_atom(env, "texture_budget");
+  ATOM_TEXTURE_BYTES = enif_make_atom(env, "texture_bytes");
+  ATOM_TEXTURE_EVICTIONS = enif_make_atom(env, "texture_evictions");
+  ATOM_TEXTURE_RELOADS = enif_make_atom(env, "texture_reloads");
+  ATOM_GLYPH_ATLAS_SIZE = enif_make_atom(env, "glyph_atlas_size");
+  ATOM_GLYPH_ATLAS_MAX_SIZE = enif_make_atom(env, "glyph_atlas_max_size");
+  ATOM_GLYPH_ATLAS_BYTES = enif_make_atom(env, "glyph_atlas_bytes");
+  ATOM_GLYPH_ATLAS_OCCUPANCY = enif_make_atom(env, "glyph_atlas_occupancy");
+  ATOM_GLYPH_RASTERIZATIONS = enif_make_atom(env, "glyph_rasterizations");
+  ATOM_GLYPH_EVICTIONS = enif_make_atom(env, "glyph_evictions");
   ATOM_SHUTDOWN = enif_make_atom(env, "vz_shutdown");
   ATOM_REPLY = enif_make_atom(env, "vz_reply");
   ATOM_UPDATE = enif_make_atom(env, "vz_update");
@@ -169,4 +186,38 @@ void vz_make_atoms(ErlNifEnv* env) {
   ATOM_FLIP_Y = enif_make_atom(env, "flip_y");
   ATOM_PREMULTIPLIED = enif_make_atom(env, "premultiplied");
   ATOM_NEAREST = enif_make_atom(env, "nearest");
+
+  ATOM_MAX_SIZE = enif_make_atom(env, "max_size");
+  ATOM_MIPMAPS = enif_make_atom(env, "mipmaps");
+  ATOM_CPU = enif_make_atom(env, "cpu");
+
+  ATOM_I420 = enif_make_atom(env, "i420");
+  ATOM_NV12 = enif_make_atom(env, "nv12");
+  ATOM_BT601 = enif_make_atom(env, "bt601");
+  ATOM_BT709 = enif_make_atom(env, "bt709");
+
+  ATOM_GRAYSCALE = enif_make_atom(env, "grayscale");
+  ATOM_VIRIDIS = enif_make_atom(env, "viridis");
+  ATOM_INFERNO = enif_make_atom(env, "inferno");
+  ATOM_ORIGIN = enif_make_atom(env, "origin");
+  ATOM_SIZE = enif_make_atom(env, "size");
+  ATOM_RANGE = enif_make_atom(env, "range");
+
+  ATOM_MOVE_TO = enif_make_atom(env, "move_to");
+  ATOM_LINE_TO = enif_make_atom(env, "line_to");
+  ATOM_BEZIER_TO = enif_make_atom(env, "bezier_to");
+  ATOM_QUAD_TO = enif_make_atom(env, "quad_to");
+  ATOM_ARC_TO = enif_make_atom(env, "arc_to");
+  ATOM_ARC = enif_make_atom(env, "arc");
+  ATOM_RECT = enif_make_atom(env, "rect");
+  ATOM_ROUNDED_RECT = enif_make_atom(env, "rounded_rect");
+  ATOM_ROUNDED_RECT_VARYING = enif_make_atom(env, "rounded_rect_varying");
+  ATOM_ELLIPSE = enif_make_atom(env, "ellipse");
+  ATOM_CIRCLE = enif_make_atom(env, "circle");
+  ATOM_CLOSE_PATH = enif_make_atom(env, "close_path");
+  ATOM_PATH_WINDING = enif_make_atom(env, "path_winding");
+  ATOM_CURRENT_COLOR = enif_make_atom(env, "current_color");
+  ATOM_SDF = enif_make_atom(env, "sdf");
+  ATOM_PREWARM = enif_make_atom(env, "prewarm");
+  ATOM_SIZES = enif_make_atom(env, "sizes");
 }
\ No newline at end of file
@@ -20,11 +20,28 @@ ERL_NIF_TERM ATOM_RESIZABLE;
 ERL_NIF_TERM ATOM_REDRAW_MODE;
 ERL_NIF_TERM ATOM_RM_INTERVAL;
 ERL_NIF_TERM ATOM_RM_MANUAL;
+ERL_NIF_TERM ATOM_RM_AUTO;
 ERL_NIF_TERM ATOM_FRAME_RATE;
 ERL_NIF_TERM ATOM_TITLE;
-ERL_NIF_TERM ATOM_COLOR_STRUCT;
 ERL_NIF_TERM ATOM_BACKGROUND_COLOR;
 ERL_NIF_TERM ATOM_PIXEL_RATIO;
+ERL_NIF_TERM ATOM_LAYER_BUDGET;
+ERL_NIF_TERM ATOM_PARTIAL_REDRAW;
+ERL_NIF_TERM ATOM_SHARED_RENDERER;
+ERL_NIF_TERM ATOM_FRAMES;
+ERL_NIF_TERM ATOM_CPU_TIME;
+ERL_NIF_TERM ATOM_REFRESH_RATE;
+ERL_NIF_TERM ATOM_FRAME_INTERVAL;
+ERL_NIF_TERM ATOM_TEXTURE_BUDGET;
+ERL_NIF_TERM ATOM_TEXTURE_BYTES;
+ERL_NIF_TERM ATOM_TEXTURE_EVICTIONS;
+ERL_NIF_TERM ATOM_TEXTURE_RELOADS;
+ERL_NIF_TERM ATOM_GLYPH_ATLAS_SIZE;
+ERL_NIF_TERM ATOM_GLYPH_ATLAS_MAX_SIZE;
+ERL_NIF_TERM ATOM_GLYPH_ATLAS_BYTES;
+ERL_NIF_TERM ATOM_GLYPH_ATLAS_OCCUPANCY;
+ERL_NIF_TERM ATOM_GLYPH_RASTERIZATIONS;
+ERL_NIF_TERM ATOM_GLYPH_EVICTIONS;
 ERL_NIF_TERM ATOM_SHUTDOWN;
 ERL_NIF_TERM ATOM_REPLY;
 ERL_NIF_TERM ATOM_UPDATE;
@@ -176,6 +193,40 @@ ERL_NIF_TERM ATOM_FLIP_Y;
 ERL_NIF_TERM ATOM_PREMULTIPLIED;
 ERL_NIF_TERM ATOM_NEAREST;
 
+ERL_NIF_TERM ATOM_MAX_SIZE;
+ERL_NIF_TERM ATOM_MIPMAPS;
+ERL_NIF_TERM ATOM_CPU;
+
+ERL_NIF_TERM ATOM_I420;
+ERL_NIF_TERM ATOM_NV12;
+ERL_NIF_TERM ATOM_BT601;
+ERL_NIF_TERM ATOM_BT709;
+
+ERL_NIF_TERM ATOM_GRAYSCALE;
+ERL_NIF_TERM ATOM_VIRIDIS;
+ERL_NIF_TERM ATOM_INFERNO;
+ERL_NIF_TERM ATOM_ORIGIN;
+ERL_NIF_TERM ATOM_SIZE;
+ERL_NIF_TERM ATOM_RANGE;
+
+ERL_NIF_TERM ATOM_MOVE_TO;
+ERL_NIF_TERM ATOM_LINE_TO;
+ERL_NIF_TERM ATOM_BEZIER_TO;
+ERL_NIF_TERM ATOM_QUAD_TO;
+ERL_NIF_TERM ATOM_ARC_TO;
+ERL_NIF_TERM ATOM_ARC;
+ERL_NIF_TERM ATOM_RECT;
+ERL_NIF_TERM ATOM_ROUNDED_RECT;
+ERL_NIF_TERM ATOM_ROUNDED_RECT_VARYING;
+ERL_NIF_TERM ATOM_ELLIPSE;
+ERL_NIF_TERM ATOM_CIRCLE;
+ERL_NIF_TERM ATOM_CLOSE_PATH;
+ERL_NIF_TERM ATOM_PATH_WINDING;
+ERL_NIF_TERM ATOM_CURRENT_COLOR;
+ERL_NIF_TERM ATOM_SDF;
+ERL_NIF_TERM ATOM_PREWARM;
+ERL_NIF_TERM ATOM_SIZES;
+
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_damage.h"
+
+#include "GL/glew.h"
+#ifdef VZ_PLATFORM_X11
+#include "GL/glxew.h"
+#endif
+#include "nanovg.h"
+#include "nanovg_gl_utils.h"
+
+#include <erl_nif.h>
+#include <string.h>
+#include <math.h>
+
+
+struct vz_damage_clear_args {
+  float clip[4];
+  bool partial;
+};
+
+static void vz_damage_clear_handler(VZview *vz_view, void *void_args) {
+  struct vz_damage_clear_args *args = (struct vz_damage_clear_args*)void_args;
+  const float *clip = args->clip;
+  NVGcolor bg = vz_view->bg;
+
+  if(args->partial) {
+    if(clip[2] <= clip[0] || clip[3] <= clip[1])
+      return;
+
+    // GL window coordinates start at the bottom left
+    glEnable(GL_SCISSOR_TEST);
+    glScissor((GLint)clip[0], vz_view->height - (GLint)clip[3],
+              (GLsizei)(clip[2] - clip[0]), (GLsizei)(clip[3] - clip[1]));
+  }
+
+  glClearColor(bg.r, bg.g, bg.b, bg.a);
+  glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+  glDisable(GL_SCISSOR_TEST);
+}
+
+void vz_damage_init(VZdamage *damage) {
+  memset(damage, 0, sizeof(VZdamage));
+  damage->full = true;
+}
+
+/*
+  Checks which swap strategy is available, must be called on the view thread
+  after GLEW is initialized.
+*/
+void vz_damage_setup(VZview *vz_view) {
+  VZdamage *damage = &vz_view->damage;
+
+#ifdef VZ_PLATFORM_X11
+  damage->buffer_age = GLXEW_EXT_buffer_age;
+#endif
+
+  if(damage->enabled && !damage->buffer_age && !(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object))
+    damage->enabled = false;
+}
+
+void vz_damage_free(VZview *vz_view) {
+  if(vz_view->damage.fb) {
+    nvgluDeleteFramebuffer(vz_view->damage.fb);
+    vz_view->damage.fb = NULL;
+  }
+}
+
+/*
+  Forces the next frame to be redrawn completely.
+*/
+void vz_damage_invalidate(VZview *vz_view) {
+  vz_view->damage.full = true;
+}
+
+/*
+  Determines the age of the back buffer and binds the render target of the frame.
+*/
+void vz_damage_begin_frame(VZview *vz_view) {
+  VZdamage *damage = &vz_view->damage;
+  int width, height;
+
+  if(!damage->enabled)
+    return;
+
+  if(damage->buffer_age) {
+#ifdef VZ_PLATFORM_X11
+    unsigned age = 0;
+    glXQueryDrawable(glXGetCurrentDisplay(), glXGetCurrentDrawable(), GLX_BACK_BUFFER_AGE_EXT, &age);
+    damage->age = (int)age;
+#endif
+    return;
+  }
+
+  if(damage->fb) {
+    nvgImageSize(vz_view->ctx, damage->fb->image, &width, &height);
+    if(width != vz_view->width || height != vz_view->height)
+      vz_damage_free(vz_view);
+  }
+
+  if(!damage->fb) {
+    if(!(damage->fb = nvgluCreateFramebuffer(vz_view->ctx, vz_view->width, vz_view->height, 0))) {
+      damage->enabled = false;
+      return;
+    }
+    damage->age = 0;
+  }
+  else damage->age = 1;
+
+  nvgluBindFramebuffer(damage->fb);
+}
+
+/*
+  Copies the persistent framebuffer to the window.
+*/
+void vz_damage_end_frame(VZview *vz_view) {
+  VZdamage *damage = &vz_view->damage;
+  int width = vz_view->width, height = vz_view->height;
+
+  if(!(damage->enabled && damage->fb))
+    return;
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, damage->fb->fbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  nvgluBindFramebuffer(NULL);
+}
+
+void vz_damage_bind_target(VZview *vz_view) {
+  nvgluBindFramebuffer(vz_view->damage.enabled ? vz_view->damage.fb : NULL);
+}
+
+/*
+  Computes the region that is redrawn in the current frame from the damage box
+  collected by the node store and queues the clear of that region. Called with
+  the view lock held, after the frame has begun.
+*/
+void vz_damage_update(VZview *vz_view, const float *box) {
+  VZdamage *damage = &vz_view->damage;
+  float *clip = damage->clip;
+  float width = (float)vz_view->width, height = (float)vz_view->height;
+  struct vz_damage_clear_args *args;
+  float view_box[4];
+  VZop vz_op;
+  bool full;
+
+  if(!damage->enabled) {
+    clip[0] = 0.f; clip[1] = 0.f; clip[2] = width; clip[3] = height;
+    damage->partial = false;
+    return;
+  }
+
+  // an invalidated frame changes the whole view, a back buffer of unknown
+  // age or older than the history needs to be redrawn completely
+  if(damage->full) {
+    view_box[0] = 0.f; view_box[1] = 0.f; view_box[2] = width; view_box[3] = height;
+    box = view_box;
+  }
+  full = damage->full || damage->age <= 0 || damage->age > (int)damage->frames + 1;
+  memcpy(clip, box, sizeof(float) * 4);
+
+  if(!full) {
+    for(int i = 0; i < damage->age - 1; ++i) {
+      const float *b = &damage->history[i * 4];
+      clip[0] = MIN(clip[0], b[0]);
+      clip[1] = MIN(clip[1], b[1]);
+      clip[2] = MAX(clip[2], b[2]);
+      clip[3] = MAX(clip[3], b[3]);
+    }
+  }
+
+  memmove(&damage->history[4], damage->history, sizeof(float) * 4 * (VZ_DAMAGE_HISTORY - 1));
+  memcpy(damage->history, box, sizeof(float) * 4);
+  if(damage->frames < VZ_DAMAGE_HISTORY)
+    ++damage->frames;
+  damage->full = false;
+
+  if(full) {
+    clip[0] = 0.f; clip[1] = 0.f; clip[2] = width; clip[3] = height;
+    damage->partial = false;
+  }
+  else {
+    vz_node_store_expand_damage(vz_view->nodes, clip);
+    clip[0] = MAX(floorf(clip[0]), 0.f);
+    clip[1] = MAX(floorf(clip[1]), 0.f);
+    clip[2] = MIN(ceilf(clip[2]), width);
+    clip[3] = MIN(ceilf(clip[3]), height);
+    if(!(clip[2] > clip[0] && clip[3] > clip[1]))
+      clip[0] = clip[1] = clip[2] = clip[3] = 0.f;
+    damage->partial = true;
+  }
+
+  args = (struct vz_damage_clear_args*)enif_alloc(sizeof(struct vz_damage_clear_args));
+  memcpy(args->clip, clip, sizeof(float) * 4);
+  args->partial = damage->partial;
+  vz_op.handler = vz_damage_clear_handler;
+  vz_op.args = args;
+  VZop_array_push(vz_view->op_array, vz_op);
+}
+
+/*
+  Sets up the transform and scissor of a node drawn to the window. Nodes
+  are clipped to their bounds and, when only part of the view is redrawn,
+  to the damaged region.
+*/
+void vz_damage_transform(VZview *vz_view, const float *t, float width, float height) {
+  NVGcontext *ctx = vz_view->ctx;
+  const float *clip = vz_view->damage.clip;
+
+  float identity[6];
+
+  nvgReset(ctx);
+  vz_sdf_reset(&vz_view->sdf);
+
+  if(vz_view->damage.partial) {
+    nvgTransformIdentity(identity);
+    nvgScissor(ctx, clip[0], clip[1], clip[2] - clip[0], clip[3] - clip[1]);
+    vz_sdf_scissor(&vz_view->sdf, identity, clip[0], clip[1], clip[2] - clip[0], clip[3] - clip[1]);
+    nvgTransform(ctx, t[0], t[1], t[2], t[3], t[4], t[5]);
+    nvgIntersectScissor(ctx, 0.f, 0.f, width, height);
+    vz_sdf_intersect_scissor(&vz_view->sdf, t, 0.f, 0.f, width, height);
+  }
+  else {
+    nvgTransform(ctx, t[0], t[1], t[2], t[3], t[4], t[5]);
+    nvgScissor(ctx, 0.f, 0.f, width, height);
+    vz_sdf_scissor(&vz_view->sdf, t, 0.f, 0.f, width, height);
+  }
+}
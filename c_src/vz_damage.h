@@ -0,0 +1,44 @@
+#ifndef VZ_DAMAGE_H_INCLUDED
+#define VZ_DAMAGE_H_INCLUDED
+
+#include <stdbool.h>
+
+#define VZ_DAMAGE_HISTORY 4
+
+struct VZview;
+struct NVGLUframebuffer;
+
+/*
+  Partial redraw
+
+  When enabled, only the part of the view covered by the damage of the current
+  frame is cleared and redrawn, nodes outside of it are culled and drawing is
+  scissored to it. The back buffer still contains an older frame after a swap,
+  so the damage of as many previous frames as the buffer is old is redrawn too.
+  The age is queried with GLX_EXT_buffer_age, without it frames are rendered to
+  a persistent framebuffer that is copied to the window after every frame.
+*/
+typedef struct VZdamage {
+  bool enabled;
+  bool full;
+  bool partial;
+  bool buffer_age;
+  int age;
+  unsigned frames;
+  float history[VZ_DAMAGE_HISTORY * 4];
+  float clip[4];
+  struct NVGLUframebuffer *fb;
+} VZdamage;
+
+void vz_damage_init(VZdamage *damage);
+void vz_damage_setup(struct VZview *vz_view);
+void vz_damage_free(struct VZview *vz_view);
+void vz_damage_invalidate(struct VZview *vz_view);
+void vz_damage_begin_frame(struct VZview *vz_view);
+void vz_damage_end_frame(struct VZview *vz_view);
+void vz_damage_bind_target(struct VZview *vz_view);
+void vz_damage_update(struct VZview *vz_view, const float *box);
+void vz_damage_clear(struct VZview *vz_view, void *args);
+void vz_damage_transform(struct VZview *vz_view, const float *t, float width, float height);
+
+#endif
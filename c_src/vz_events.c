@@ -117,11 +117,10 @@ static ERL_NIF_TERM vz_make_button_event_struct(ErlNifEnv* env, const PuglEventB
 
 static ERL_NIF_TERM vz_make_configure_event_struct(ErlNifEnv* env, const float *xform, const PuglEventConfigure* event) {
   ERL_NIF_TERM map = enif_make_new_map(env);
-  float *xform_res = vz_alloc_matrix_copy(xform);
 
   enif_make_map_put(env, map, ATOM__STRUCT__, ATOM_CONFIGURE_EVENT, &map);
   enif_make_map_put(env, map, ATOM_TYPE, ATOM_CONFIGURE_EVENT_TYPE, &map);
-  enif_make_map_put(env, map, ATOM_XFORM, vz_make_resource(env, xform_res), &map);
+  enif_make_map_put(env, map, ATOM_XFORM, vz_make_matrix(env, xform), &map);
   enif_make_map_put(env, map, ATOM_X, enif_make_double(env, event->x), &map);
   enif_make_map_put(env, map, ATOM_Y, enif_make_double(env, event->y), &map);
   enif_make_map_put(env, map, ATOM_WIDTH, enif_make_double(env, event->width), &map);
@@ -289,6 +288,8 @@ void vz_on_event(PuglView* view, const PuglEvent* event) {
         vz_view->width_factor = configure->width / (double)vz_view->init_width;
         vz_view->height_factor = configure->height / (double)vz_view->init_height;
         nvgTransformScale(vz_view->xform, vz_view->width_factor, vz_view->height_factor);
+        vz_damage_invalidate(vz_view);
+        vz_update_refresh_rate(vz_view);
         ERL_NIF_TERM configure_struct = vz_make_configure_event_struct(vz_view->ev_env, vz_view->xform, configure);
         VZev_array_push(vz_view->ev_array, configure_struct);
         vz_update(vz_view);
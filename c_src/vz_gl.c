@@ -0,0 +1,95 @@
+#include "vz_gl.h"
+
+
+static const float vz_quad[8] = {0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f};
+
+void vz_gl_state_save(VZgl_state *state) {
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &state->fbo);
+  glGetIntegerv(GL_VIEWPORT, state->viewport);
+  state->scissor = glIsEnabled(GL_SCISSOR_TEST);
+}
+
+void vz_gl_state_restore(const VZgl_state *state) {
+  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)state->fbo);
+  glViewport(state->viewport[0], state->viewport[1], state->viewport[2], state->viewport[3]);
+  if(state->scissor)
+    glEnable(GL_SCISSOR_TEST);
+}
+
+static GLuint vz_gl_shader(GLenum type, const char *source) {
+  GLuint shader = glCreateShader(type);
+  GLint status;
+
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if(status != GL_TRUE) {
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+
+/*
+  Compiles and links a program whose vertex shader takes the corners of the
+  unit quad as attribute `vertex`. Returns 0 on failure.
+*/
+GLuint vz_gl_program(const char *vertex_source, const char *fragment_source) {
+  GLuint vert, frag, program;
+  GLint status;
+
+  if(!(vert = vz_gl_shader(GL_VERTEX_SHADER, vertex_source)))
+    return 0;
+  if(!(frag = vz_gl_shader(GL_FRAGMENT_SHADER, fragment_source))) {
+    glDeleteShader(vert);
+    return 0;
+  }
+
+  program = glCreateProgram();
+  glAttachShader(program, vert);
+  glAttachShader(program, frag);
+  glBindAttribLocation(program, 0, "vertex");
+  glLinkProgram(program);
+  glDeleteShader(vert);
+  glDeleteShader(frag);
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if(status != GL_TRUE) {
+    glDeleteProgram(program);
+    return 0;
+  }
+
+  return program;
+}
+
+/*
+  Sets up a pass writing every pixel of a framebuffer, the caller binds its
+  textures and sets its uniforms before drawing the quad.
+*/
+void vz_gl_begin_pass(GLuint fbo, int width, int height, GLuint program) {
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glViewport(0, 0, width, height);
+  glDisable(GL_SCISSOR_TEST);
+  glDisable(GL_BLEND);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_STENCIL_TEST);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glUseProgram(program);
+}
+
+void vz_gl_draw_quad(void) {
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, vz_quad);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glDisableVertexAttribArray(0);
+}
+
+void vz_gl_end_pass(int texture_units) {
+  // NanoVG only uses the first texture unit and expects texture 0 to be bound
+  for(int i = texture_units - 1; i >= 0; --i) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  glUseProgram(0);
+}
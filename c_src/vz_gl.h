@@ -0,0 +1,28 @@
+#ifndef VZ_GL_H_INCLUDED
+#define VZ_GL_H_INCLUDED
+
+#include "GL/glew.h"
+
+/*
+  Helpers for the passes that render into framebuffers of their own while
+  NanoVG records a frame, like video and heatmap conversions.
+*/
+
+/*
+  GL state changed by uploads and conversions, which NanoVG doesn't set up
+  itself when it flushes a frame.
+*/
+typedef struct VZgl_state {
+  GLint fbo;
+  GLint viewport[4];
+  GLboolean scissor;
+} VZgl_state;
+
+void vz_gl_state_save(VZgl_state *state);
+void vz_gl_state_restore(const VZgl_state *state);
+GLuint vz_gl_program(const char *vertex_source, const char *fragment_source);
+void vz_gl_begin_pass(GLuint fbo, int width, int height, GLuint program);
+void vz_gl_draw_quad(void);
+void vz_gl_end_pass(int texture_units);
+
+#endif
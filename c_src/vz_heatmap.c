@@ -0,0 +1,190 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_heatmap.h"
+#include "vz_gl.h"
+
+#include "nanovg.h"
+#include "nanovg_gl_utils.h"
+
+#include <erl_nif.h>
+#include <string.h>
+
+
+static const char *vz_heatmap_vertex_shader =
+  "#version 110\n"
+  "attribute vec2 vertex;\n"
+  "varying vec2 tcoord;\n"
+  "void main() {\n"
+  // the framebuffer is drawn flipped, its first row is the last row of the grid
+  "  tcoord = vec2(vertex.x, 1.0 - vertex.y);\n"
+  "  gl_Position = vec4(vertex * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+static const char *vz_heatmap_fragment_shader =
+  "#version 110\n"
+  "uniform sampler2D values;\n"
+  "uniform sampler2D colormap;\n"
+  "varying vec2 tcoord;\n"
+  "void main() {\n"
+  // the center of the colormap texel of the value
+  "  float index = (texture2D(values, tcoord).r * 255.0 + 0.5) / 256.0;\n"
+  "  vec4 color = texture2D(colormap, vec2(index, 0.5));\n"
+  // NanoVG framebuffer images are premultiplied
+  "  gl_FragColor = vec4(color.rgb * color.a, color.a);\n"
+  "}\n";
+
+// colors at 9 evenly spaced stops of the presets
+static const unsigned char vz_colormap_stops[][9][3] = {
+  {{0, 0, 0}, {32, 32, 32}, {64, 64, 64}, {96, 96, 96}, {128, 128, 128},
+   {160, 160, 160}, {192, 192, 192}, {224, 224, 224}, {255, 255, 255}},
+  {{68, 1, 84}, {71, 44, 122}, {59, 81, 139}, {44, 113, 142}, {33, 144, 141},
+   {39, 173, 129}, {92, 200, 99}, {170, 220, 50}, {253, 231, 37}},
+  {{0, 0, 4}, {31, 12, 72}, {85, 15, 109}, {136, 34, 106}, {186, 54, 85},
+   {227, 89, 51}, {249, 140, 10}, {249, 201, 50}, {252, 255, 164}}
+};
+
+/*
+  Fills an opaque colormap interpolating the stops of a preset.
+*/
+void vz_heatmap_preset(enum VZcolormap preset, unsigned char colormap[VZ_COLORMAP_SIZE]) {
+  const unsigned char (*stops)[3] = vz_colormap_stops[preset];
+
+  for(int i = 0; i < 256; ++i) {
+    int stop = MIN(i / 32, 7);
+    float t = (i - stop * 32) / 32.f;
+    for(int c = 0; c < 3; ++c)
+      colormap[i * 4 + c] = (unsigned char)(stops[stop][c] + (stops[stop + 1][c] - stops[stop][c]) * t + 0.5f);
+    colormap[i * 4 + 3] = 255;
+  }
+  // the last index is exactly the last stop
+  memcpy(colormap + 255 * 4, stops[8], 3);
+}
+
+/*
+  Compiles the lookup shader the first time a view creates a heatmap.
+*/
+static bool vz_heatmap_shader_init(VZheatmap_shader *shader) {
+  GLuint program;
+
+  if(shader->program)
+    return true;
+
+  if(!(program = vz_gl_program(vz_heatmap_vertex_shader, vz_heatmap_fragment_shader)))
+    return false;
+
+  shader->program = program;
+  shader->values = glGetUniformLocation(program, "values");
+  shader->colormap = glGetUniformLocation(program, "colormap");
+
+  return true;
+}
+
+void vz_heatmap_shader_free(VZheatmap_shader *shader) {
+  if(shader->program)
+    glDeleteProgram(shader->program);
+  shader->program = 0;
+}
+
+static void vz_heatmap_texture(GLuint texture, GLenum format, int width, int height, const unsigned char *data) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+static void vz_heatmap_convert(VZview *vz_view, VZheatmap *heatmap) {
+  VZheatmap_shader *shader = &vz_view->heatmap_shader;
+  VZgl_state state;
+
+  vz_gl_state_save(&state);
+  vz_gl_begin_pass(heatmap->fb->fbo, heatmap->cols, heatmap->rows, shader->program);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, heatmap->values);
+  glUniform1i(shader->values, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, heatmap->colormap);
+  glUniform1i(shader->colormap, 1);
+  vz_gl_draw_quad();
+  vz_gl_end_pass(2);
+  vz_gl_state_restore(&state);
+}
+
+/*
+  Creates a heatmap with all cells at 0, called from a draw op.
+*/
+VZheatmap* vz_heatmap_create(VZview *vz_view, int cols, int rows, const unsigned char *colormap, int flags) {
+  VZheatmap *heatmap;
+  VZgl_state state;
+  unsigned char *zeros;
+
+  if(!vz_heatmap_shader_init(&vz_view->heatmap_shader))
+    return NULL;
+
+  heatmap = (VZheatmap*)enif_alloc(sizeof(VZheatmap));
+  memset(heatmap, 0, sizeof(VZheatmap));
+  heatmap->cols = cols;
+  heatmap->rows = rows;
+
+  vz_gl_state_save(&state);
+  heatmap->fb = nvgluCreateFramebuffer(vz_view->ctx, cols, rows, flags & ~NVG_IMAGE_GENERATE_MIPMAPS);
+  vz_gl_state_restore(&state);
+  if(!heatmap->fb) {
+    enif_free(heatmap);
+    return NULL;
+  }
+
+  zeros = (unsigned char*)enif_alloc((size_t)cols * rows);
+  memset(zeros, 0, (size_t)cols * rows);
+  glGenTextures(1, &heatmap->values);
+  vz_heatmap_texture(heatmap->values, GL_LUMINANCE, cols, rows, zeros);
+  enif_free(zeros);
+  glGenTextures(1, &heatmap->colormap);
+  vz_heatmap_texture(heatmap->colormap, GL_RGBA, 256, 1, colormap);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  vz_heatmap_convert(vz_view, heatmap);
+
+  return heatmap;
+}
+
+/*
+  Replaces a block of cells, `values` holds a byte per cell of the block, row
+  by row. The block must lie within the grid.
+*/
+void vz_heatmap_update(VZview *vz_view, VZheatmap *heatmap, int col, int row, int cols, int rows, const unsigned char *values) {
+  glBindTexture(GL_TEXTURE_2D, heatmap->values);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, col, row, cols, rows, GL_LUMINANCE, GL_UNSIGNED_BYTE, values);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  vz_heatmap_convert(vz_view, heatmap);
+}
+
+void vz_heatmap_set_colormap(VZview *vz_view, VZheatmap *heatmap, const unsigned char *colormap) {
+  glBindTexture(GL_TEXTURE_2D, heatmap->colormap);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, colormap);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  vz_heatmap_convert(vz_view, heatmap);
+}
+
+int vz_heatmap_image(VZheatmap *heatmap) {
+  return heatmap->fb->image;
+}
+
+size_t vz_heatmap_bytes(VZheatmap *heatmap) {
+  // framebuffer with stencil buffer, cells and colormap
+  return (size_t)heatmap->cols * heatmap->rows * 6 + VZ_COLORMAP_SIZE;
+}
+
+void vz_heatmap_free(VZheatmap *heatmap) {
+  glDeleteTextures(1, &heatmap->values);
+  glDeleteTextures(1, &heatmap->colormap);
+  nvgluDeleteFramebuffer(heatmap->fb);
+  enif_free(heatmap);
+}
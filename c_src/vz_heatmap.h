@@ -0,0 +1,53 @@
+#ifndef VZ_HEATMAP_H_INCLUDED
+#define VZ_HEATMAP_H_INCLUDED
+
+#include <stddef.h>
+
+#define VZ_COLORMAP_SIZE 1024
+
+struct VZview;
+struct NVGLUframebuffer;
+
+enum VZcolormap {
+  VZ_COLORMAP_GRAYSCALE,
+  VZ_COLORMAP_VIRIDIS,
+  VZ_COLORMAP_INFERNO
+};
+
+/*
+  Heatmap images
+
+  A grid of cells, each holding one byte that indexes a colormap of 256 RGBA
+  colors. The cells are a luminance texture of one texel per cell, the
+  colormap a texture of 256 x 1 texels. A shader looks every cell up in the
+  colormap into a framebuffer of one pixel per cell, which is the texture
+  NanoVG draws, so heatmaps are scaled to their destination like any other
+  image.
+  Updating a block of cells uploads only these cells, changing the colormap
+  uploads only the colormap, the lookup then runs again over the whole grid,
+  before NanoVG flushes the frame it is drawn in.
+*/
+typedef struct VZheatmap {
+  int cols;
+  int rows;
+  unsigned values;
+  unsigned colormap;
+  struct NVGLUframebuffer *fb;
+} VZheatmap;
+
+typedef struct VZheatmap_shader {
+  unsigned program;
+  int values;
+  int colormap;
+} VZheatmap_shader;
+
+void vz_heatmap_preset(enum VZcolormap preset, unsigned char colormap[VZ_COLORMAP_SIZE]);
+VZheatmap* vz_heatmap_create(struct VZview *vz_view, int cols, int rows, const unsigned char *colormap, int flags);
+void vz_heatmap_update(struct VZview *vz_view, VZheatmap *heatmap, int col, int row, int cols, int rows, const unsigned char *values);
+void vz_heatmap_set_colormap(struct VZview *vz_view, VZheatmap *heatmap, const unsigned char *colormap);
+int vz_heatmap_image(VZheatmap *heatmap);
+size_t vz_heatmap_bytes(VZheatmap *heatmap);
+void vz_heatmap_free(VZheatmap *heatmap);
+void vz_heatmap_shader_free(VZheatmap_shader *shader);
+
+#endif
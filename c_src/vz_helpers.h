@@ -40,6 +40,8 @@
     VZop_array_push(vz_view->op_array, vz_op);                                                    \
     if(execute) {                                                                                 \
       enif_cond_signal(vz_view->execute_cv);                                                      \
+      if(vz_view->renderer)                                                                       \
+        vz_wake(vz_view);                                                                         \
       enif_mutex_unlock(vz_view->lock);                                                           \
       return ATOM_OK;                                                                             \
     }                                                                                             \
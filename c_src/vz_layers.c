@@ -0,0 +1,239 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_layers.h"
+
+#include "GL/glew.h"
+#include "nanovg.h"
+#include "nanovg_gl_utils.h"
+
+#include <erl_nif.h>
+#include <string.h>
+#include <math.h>
+
+
+static VZlayer* vz_layer_find(VZlayer_cache *cache, int id) {
+  for(VZlayer *layer = cache->layers; layer; layer = layer->next)
+    if(layer->id == id) return layer;
+
+  return NULL;
+}
+
+static void vz_layer_delete(VZlayer_cache *cache, VZlayer *layer) {
+  VZlayer **p = &cache->layers;
+
+  while(*p != layer) p = &(*p)->next;
+  *p = layer->next;
+
+  if(layer->fb)
+    nvgluDeleteFramebuffer(layer->fb);
+  cache->bytes -= layer->bytes;
+  enif_free(layer);
+}
+
+/*
+  The layer covers the node's bounds at the scale of its world transform.
+*/
+static bool vz_layer_size(VZview *vz_view, int id, int *width, int *height) {
+  VZnode_store *nodes = vz_view->nodes;
+  const float *t;
+  float sx, sy;
+
+  if(id < 0 || (unsigned)id >= nodes->count || !(nodes->flags[id] & VZ_NODE_USED))
+    return false;
+
+  t = &nodes->world[id * 6];
+  sx = sqrtf(t[0] * t[0] + t[1] * t[1]);
+  sy = sqrtf(t[2] * t[2] + t[3] * t[3]);
+  *width = (int)ceilf(nodes->width[id] * sx);
+  *height = (int)ceilf(nodes->height[id] * sy);
+
+  return *width > 0 && *height > 0 && *width <= VZ_LAYER_MAX_SIZE && *height <= VZ_LAYER_MAX_SIZE;
+}
+
+static bool vz_layers_evict(VZlayer_cache *cache, size_t bytes) {
+  while(cache->bytes + bytes > cache->budget) {
+    VZlayer *lru = NULL;
+
+    for(VZlayer *layer = cache->layers; layer; layer = layer->next)
+      if(layer->fb && layer->last_used != cache->frame && (!lru || layer->last_used < lru->last_used))
+        lru = layer;
+
+    if(!lru) return false;
+    vz_layer_delete(cache, lru);
+  }
+
+  return true;
+}
+
+void vz_layers_init(VZlayer_cache *cache) {
+  cache->layers = NULL;
+  cache->bytes = 0;
+  cache->budget = (size_t)VZ_LAYER_DEFAULT_BUDGET * 1024 * 1024;
+  cache->frame = 0;
+  cache->active = -1;
+}
+
+/*
+  Deletes all layers, must be called on the view thread while the GL context is current.
+*/
+void vz_layers_free(VZview *vz_view) {
+  while(vz_view->layers.layers)
+    vz_layer_delete(&vz_view->layers, vz_view->layers.layers);
+}
+
+/*
+  Deletes layers of nodes that were garbage collected and advances the LRU clock.
+*/
+void vz_layers_sweep(VZview *vz_view) {
+  VZlayer_cache *cache = &vz_view->layers;
+  VZlayer *layer = cache->layers, *next;
+
+  while(layer) {
+    next = layer->next;
+    if(layer->id < 0)
+      vz_layer_delete(cache, layer);
+    layer = next;
+  }
+
+  ++cache->frame;
+}
+
+bool vz_layers_is_valid(VZview *vz_view, int id) {
+  VZlayer *layer = vz_layer_find(&vz_view->layers, id);
+  int width, height;
+
+  return layer && layer->valid && layer->fb &&
+         layer->pixel_ratio == vz_view->pixel_ratio &&
+         vz_layer_size(vz_view, id, &width, &height) &&
+         layer->width == width && layer->height == height;
+}
+
+void vz_layers_invalidate(VZview *vz_view, int id) {
+  VZlayer *layer = vz_layer_find(&vz_view->layers, id);
+
+  if(layer) layer->valid = false;
+}
+
+void vz_layers_orphan(VZview *vz_view, int id) {
+  VZlayer *layer = vz_layer_find(&vz_view->layers, id);
+
+  if(layer) {
+    layer->id = -1;
+    layer->valid = false;
+  }
+}
+
+/*
+  Flushes the current frame and starts a new one targeting the node's layer.
+  When no layer can be allocated, the subtree is drawn directly instead.
+*/
+bool vz_layers_begin(VZview *vz_view, int id) {
+  VZlayer_cache *cache = &vz_view->layers;
+  VZnode_store *nodes = vz_view->nodes;
+  NVGcontext *ctx = vz_view->ctx;
+  VZlayer *layer;
+  float base[6];
+  int width, height;
+  size_t bytes;
+
+  if(cache->active >= 0 || !vz_layer_size(vz_view, id, &width, &height))
+    return false;
+
+  if(!(layer = vz_layer_find(cache, id))) {
+    layer = (VZlayer*)enif_alloc(sizeof(VZlayer));
+    memset(layer, 0, sizeof(VZlayer));
+    layer->id = id;
+    layer->next = cache->layers;
+    cache->layers = layer;
+  }
+
+  layer->last_used = cache->frame;
+  layer->valid = false;
+
+  if(!layer->fb || layer->width != width || layer->height != height) {
+    if(layer->fb) {
+      nvgluDeleteFramebuffer(layer->fb);
+      layer->fb = NULL;
+      cache->bytes -= layer->bytes;
+      layer->bytes = 0;
+    }
+
+    // RGBA color attachment and 8 bit stencil buffer, NanoVG renders
+    // bottom-up with premultiplied alpha
+    bytes = (size_t)width * height * 5;
+
+    if(!vz_layers_evict(cache, bytes) ||
+       !(layer->fb = nvgluCreateFramebuffer(ctx, width, height, NVG_IMAGE_FLIPY | NVG_IMAGE_PREMULTIPLIED))) {
+      vz_layer_delete(cache, layer);
+      return false;
+    }
+
+    // creating a framebuffer binds the window's framebuffer
+    vz_damage_bind_target(vz_view);
+    layer->width = width;
+    layer->height = height;
+    layer->bytes = bytes;
+    cache->bytes += bytes;
+  }
+
+  layer->pixel_ratio = vz_view->pixel_ratio;
+
+  nvgEndFrame(ctx);
+  nvgluBindFramebuffer(layer->fb);
+  glViewport(0, 0, width, height);
+  glClearColor(0.f, 0.f, 0.f, 0.f);
+  glClear(GL_COLOR_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+  nvgBeginFrame(ctx, width, height, vz_view->pixel_ratio);
+  vz_sdf_begin_frame(&vz_view->sdf);
+
+  // nodes in the subtree are drawn relative to the layer node's local space
+  nvgTransformInverse(cache->xform, &nodes->world[id * 6]);
+  nvgTransformScale(base, width / nodes->width[id], height / nodes->height[id]);
+  nvgTransformMultiply(cache->xform, base);
+  cache->active = id;
+
+  return true;
+}
+
+void vz_layers_end(VZview *vz_view) {
+  VZlayer_cache *cache = &vz_view->layers;
+  NVGcontext *ctx = vz_view->ctx;
+  VZlayer *layer;
+
+  if(cache->active < 0)
+    return;
+
+  if((layer = vz_layer_find(cache, cache->active)))
+    layer->valid = true;
+  cache->active = -1;
+
+  nvgEndFrame(ctx);
+  vz_damage_bind_target(vz_view);
+  glViewport(0, 0, vz_view->width, vz_view->height);
+  nvgBeginFrame(ctx, vz_view->width, vz_view->height, vz_view->pixel_ratio);
+  vz_sdf_begin_frame(&vz_view->sdf);
+}
+
+void vz_layers_draw(VZview *vz_view, int id) {
+  VZnode_store *nodes = vz_view->nodes;
+  NVGcontext *ctx = vz_view->ctx;
+  VZlayer *layer = vz_layer_find(&vz_view->layers, id);
+  const float *t;
+  float w, h;
+  NVGpaint paint;
+
+  if(!(layer && layer->valid && layer->fb))
+    return;
+
+  layer->last_used = vz_view->layers.frame;
+  t = &nodes->world[id * 6];
+  w = nodes->width[id];
+  h = nodes->height[id];
+
+  vz_damage_transform(vz_view, t, w, h);
+  paint = nvgImagePattern(ctx, 0.f, 0.f, w, h, 0.f, layer->fb->image, 1.f);
+  nvgBeginPath(ctx);
+  nvgRect(ctx, 0.f, 0.f, w, h);
+  nvgFillPaint(ctx, paint);
+  nvgFill(ctx);
+}
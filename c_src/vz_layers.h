@@ -0,0 +1,51 @@
+#ifndef VZ_LAYERS_H_INCLUDED
+#define VZ_LAYERS_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define VZ_LAYER_MAX_SIZE 4096
+#define VZ_LAYER_DEFAULT_BUDGET 64
+
+struct VZview;
+struct NVGLUframebuffer;
+
+/*
+  Layer cache
+
+  A node with `cache: :layer` renders its subtree into an offscreen framebuffer,
+  which is composited with a single textured quad until the layer is invalidated.
+  Layers are evicted least recently used first when the memory budget is exceeded.
+*/
+typedef struct VZlayer {
+  int id;
+  struct NVGLUframebuffer *fb;
+  int width;
+  int height;
+  double pixel_ratio;
+  size_t bytes;
+  unsigned last_used;
+  bool valid;
+  struct VZlayer *next;
+} VZlayer;
+
+typedef struct VZlayer_cache {
+  VZlayer *layers;
+  size_t bytes;
+  size_t budget;
+  unsigned frame;
+  int active;
+  float xform[6];
+} VZlayer_cache;
+
+void vz_layers_init(VZlayer_cache *cache);
+void vz_layers_free(struct VZview *vz_view);
+void vz_layers_sweep(struct VZview *vz_view);
+bool vz_layers_is_valid(struct VZview *vz_view, int id);
+void vz_layers_invalidate(struct VZview *vz_view, int id);
+void vz_layers_orphan(struct VZview *vz_view, int id);
+bool vz_layers_begin(struct VZview *vz_view, int id);
+void vz_layers_end(struct VZview *vz_view);
+void vz_layers_draw(struct VZview *vz_view, int id);
+
+#endif
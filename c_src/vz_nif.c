@@ -2,20 +2,16 @@
 #include "vz_resources.h"
 #include "vz_atoms.h"
 #include "vz_view_thread.h"
+#include "vz_pixels.h"
 
 #include "pugl/pugl.h"
 #include "nanovg.h"
 #include "stb_image.h"
 
 #include <erl_nif.h>
+#include <stdio.h>
 #include <string.h>
 
-#ifdef VZ_PLATFORM_X11
-#include <X11/Xlib.h>
-#elif VZ_PLATFORM_WINDOWS
-#include <windows.h>
-#endif
-
 /*
 Helpers
 */
@@ -43,14 +39,23 @@ static bool vz_get_number(ErlNifEnv *env, ERL_NIF_TERM term, double *value) {
   return true;
 }
 
-static bool vz_get_color(ErlNifEnv *env, ERL_NIF_TERM map, NVGcolor *color) {
+/*
+  Colors are either packed as 0xRRGGBBAA in an integer, or a %Vizi.Canvas.Color{} map.
+*/
+static bool vz_get_color(ErlNifEnv *env, ERL_NIF_TERM term, NVGcolor *color) {
   ERL_NIF_TERM r_term, g_term, b_term, a_term;
   double r, g, b, a;
+  unsigned packed;
+
+  if(enif_get_uint(env, term, &packed)) {
+    *color = nvgRGBA(packed >> 24, (packed >> 16) & 0xff, (packed >> 8) & 0xff, packed & 0xff);
+    return true;
+  }
 
-  if(!(enif_get_map_value(env, map, ATOM_R, &r_term) &&
-       enif_get_map_value(env, map, ATOM_G, &g_term) &&
-       enif_get_map_value(env, map, ATOM_B, &b_term) &&
-       enif_get_map_value(env, map, ATOM_A, &a_term)))
+  if(!(enif_get_map_value(env, term, ATOM_R, &r_term) &&
+       enif_get_map_value(env, term, ATOM_G, &g_term) &&
+       enif_get_map_value(env, term, ATOM_B, &b_term) &&
+       enif_get_map_value(env, term, ATOM_A, &a_term)))
     return false;
 
   if(!(enif_get_double(env, r_term, &r) &&
@@ -67,16 +72,17 @@ static bool vz_get_color(ErlNifEnv *env, ERL_NIF_TERM map, NVGcolor *color) {
   return true;
 }
 
-static ERL_NIF_TERM vz_make_color(ErlNifEnv *env, NVGcolor *color) {
-  ERL_NIF_TERM map = enif_make_new_map(env);
+static inline unsigned vz_pack_component(float c) {
+  return (unsigned)(MIN(MAX(c, 0.f), 1.f) * 255.f + 0.5f);
+}
 
-  enif_make_map_put(env, map, ATOM__STRUCT__, ATOM_COLOR_STRUCT, &map);
-  enif_make_map_put(env, map, ATOM_R, enif_make_double(env, color->r), &map);
-  enif_make_map_put(env, map, ATOM_G, enif_make_double(env, color->g), &map);
-  enif_make_map_put(env, map, ATOM_B, enif_make_double(env, color->b), &map);
-  enif_make_map_put(env, map, ATOM_A, enif_make_double(env, color->a), &map);
+static ERL_NIF_TERM vz_make_color(ErlNifEnv *env, NVGcolor *color) {
+  unsigned packed = vz_pack_component(color->r) << 24 |
+                    vz_pack_component(color->g) << 16 |
+                    vz_pack_component(color->b) << 8 |
+                    vz_pack_component(color->a);
 
-  return map;
+  return enif_make_uint(env, packed);
 }
 
 static bool vz_get_blend_factor(ERL_NIF_TERM atom, int *factor) {
@@ -241,6 +247,8 @@ static int vz_handle_create_view_opts(ErlNifEnv *env, ERL_NIF_TERM opts, VZview*
             vz_view->redraw_mode = VZ_MANUAL;
           else if(enif_is_identical(tup_array[1], ATOM_RM_INTERVAL))
             vz_view->redraw_mode = VZ_INTERVAL;
+          else if(enif_is_identical(tup_array[1], ATOM_RM_AUTO))
+            vz_view->redraw_mode = VZ_AUTO;
           else return 0;
         }
 
@@ -260,6 +268,42 @@ static int vz_handle_create_view_opts(ErlNifEnv *env, ERL_NIF_TERM opts, VZview*
            !enif_get_double(env, tup_array[1], &vz_view->pixel_ratio))
           return 0;
 
+        if(enif_is_identical(tup_array[0], ATOM_LAYER_BUDGET)) {
+          unsigned budget;
+          if(!enif_get_uint(env, tup_array[1], &budget))
+            return 0;
+          vz_view->layers.budget = (size_t)budget * 1024 * 1024;
+        }
+
+        if(enif_is_identical(tup_array[0], ATOM_TEXTURE_BUDGET)) {
+          unsigned budget;
+          if(!enif_get_uint(env, tup_array[1], &budget))
+            return 0;
+          vz_view->textures.budget = (size_t)budget * 1024 * 1024;
+        }
+
+        if(enif_is_identical(tup_array[0], ATOM_GLYPH_ATLAS_SIZE)) {
+          int size;
+          if(!(enif_get_int(env, tup_array[1], &size) && size >= 128))
+            return 0;
+          vz_sdf_init(&vz_view->sdf, size, vz_view->sdf.max_size);
+        }
+
+        if(enif_is_identical(tup_array[0], ATOM_GLYPH_ATLAS_MAX_SIZE)) {
+          int size;
+          if(!(enif_get_int(env, tup_array[1], &size) && size >= 128))
+            return 0;
+          vz_sdf_init(&vz_view->sdf, vz_view->sdf.init_size, size);
+        }
+
+        if(enif_is_identical(tup_array[0], ATOM_PARTIAL_REDRAW) &&
+           enif_is_identical(tup_array[1], ATOM_TRUE))
+          vz_view->damage.enabled = true;
+
+        if(enif_is_identical(tup_array[0], ATOM_SHARED_RENDERER) &&
+           enif_is_identical(tup_array[1], ATOM_TRUE))
+          vz_view->shared_renderer = true;
+
       } else return 0;
     }
     else return 0;
@@ -276,6 +320,19 @@ static int vz_handle_create_view_opts(ErlNifEnv *env, ERL_NIF_TERM opts, VZview*
   return 1;
 }
 
+/*
+  Image patterns refer to an image slot, which is resolved to the texture of
+  the image when the paint is used.
+*/
+static NVGpaint vz_resolve_paint(VZview *vz_view, const NVGpaint *paint) {
+  NVGpaint resolved = *paint;
+
+  if(resolved.image)
+    resolved.image = vz_texture_handle(vz_view, resolved.image);
+
+  return resolved;
+}
+
 static bool vz_handle_image_flags(ErlNifEnv *env, ERL_NIF_TERM list, int *flags) {
   ERL_NIF_TERM head, tail;
   *flags = 0;
@@ -301,6 +358,38 @@ static bool vz_handle_image_flags(ErlNifEnv *env, ERL_NIF_TERM list, int *flags)
   return true;
 }
 
+static bool vz_handle_image_opts(ErlNifEnv *env, ERL_NIF_TERM list, VZimage_opts *opts) {
+  ERL_NIF_TERM head, tail;
+  const ERL_NIF_TERM *tup_array, *size_array;
+  int tup_arity, size_arity;
+  memset(opts, 0, sizeof(VZimage_opts));
+
+  while(enif_get_list_cell(env, list, &head, &tail)) {
+    list = tail;
+
+    if(!(enif_get_tuple(env, head, &tup_arity, &tup_array) && tup_arity == 2))
+      return false;
+
+    if(enif_is_identical(tup_array[0], ATOM_MAX_SIZE)) {
+      if(!(enif_get_tuple(env, tup_array[1], &size_arity, &size_array) && size_arity == 2 &&
+           enif_get_int(env, size_array[0], &opts->max_width) &&
+           enif_get_int(env, size_array[1], &opts->max_height) &&
+           opts->max_width >= 0 && opts->max_height >= 0))
+        return false;
+    }
+    else if(enif_is_identical(tup_array[0], ATOM_MIPMAPS)) {
+      if(enif_is_identical(tup_array[1], ATOM_CPU))
+        opts->mipmaps = true;
+      else if(enif_is_identical(tup_array[1], ATOM_FALSE))
+        opts->mipmaps = false;
+      else return false;
+    }
+    else return false;
+  }
+
+  return true;
+}
+
 static bool vz_handle_text_align_flags(ErlNifEnv *env, ERL_NIF_TERM list, int *flags) {
   ERL_NIF_TERM head, tail;
   *flags = 0;
@@ -345,7 +434,11 @@ static ERL_NIF_TERM vz_create_view(ErlNifEnv* env, int argc, const ERL_NIF_TERM
   if(!vz_handle_create_view_opts(env, argv[0], vz_view))
     goto err;
 
-  if(enif_thread_create("vz_view_thread", &vz_view->view_tid, vz_view_thread, vz_view, NULL) != 0)
+  if(vz_view->shared_renderer) {
+    if(!vz_renderer_attach(&((VZpriv*)enif_priv_data(env))->renderers, vz_view))
+      goto err;
+  }
+  else if(enif_thread_create("vz_view_thread", &vz_view->view_tid, vz_view_thread, vz_view, NULL) != 0)
     goto err;
 
   return OK(vz_make_resource(env, vz_view));
@@ -369,6 +462,7 @@ static ERL_NIF_TERM vz_shutdown(ErlNifEnv* env, int argc, const ERL_NIF_TERM arg
   vz_view->shutdown = true;
   enif_cond_signal(vz_view->suspended_cv);
   enif_cond_signal(vz_view->execute_cv);
+  vz_wake(vz_view);
   enif_mutex_unlock(vz_view->lock);
 
   return ATOM_OK;
@@ -384,6 +478,7 @@ static ERL_NIF_TERM vz_suspend(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv
 
   enif_mutex_lock(vz_view->lock);
   vz_view->suspend = true;
+  vz_wake(vz_view);
   enif_mutex_unlock(vz_view->lock);
 
   return ATOM_OK;
@@ -400,6 +495,7 @@ static ERL_NIF_TERM vz_resume(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
   enif_mutex_lock(vz_view->lock);
   vz_view->suspend = false;
   enif_cond_signal(vz_view->suspended_cv);
+  vz_wake(vz_view);
   enif_mutex_unlock(vz_view->lock);
 
   return ATOM_OK;
@@ -416,6 +512,9 @@ static ERL_NIF_TERM vz_ready(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]
   enif_mutex_lock(vz_view->lock);
   vz_view->busy = false;
   enif_cond_signal(vz_view->execute_cv);
+  // a shared render thread ends the frame when it services the view
+  if(vz_view->renderer)
+    vz_wake(vz_view);
   enif_mutex_unlock(vz_view->lock);
 
   return ATOM_OK;
@@ -429,28 +528,8 @@ static ERL_NIF_TERM vz_redraw(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[
     return BADARG;
   }
   enif_mutex_lock(vz_view->lock);
-
-#ifdef VZ_PLATFORM_X11
-  Display *display = XOpenDisplay(0);
-  Window window = puglGetNativeWindow(vz_view->view);
-  XExposeEvent event;
-
-  event.type = Expose;
-  event.display = display;
-  event.window = window;
-  event.x = 0;
-  event.y = 0;
-  event.width = vz_view->width;
-  event.height = vz_view->height;
-  event.count = 0;
-
-  XSendEvent(display, window, False, ExposureMask, (XEvent*)&event);
-  XFlush(display);
-#elif defined(VZ_PLATFORM_WINDOWS)
-  HWND hwnd = (HWND)puglGetNativeWindow(vz_view->view);
-  InvalidateRect(hwnd, NULL, FALSE);
-#endif
-
+  vz_view->redraw = true;
+  vz_wake(vz_view);
   enif_mutex_unlock(vz_view->lock);
 
   return ATOM_OK;
@@ -472,6 +551,57 @@ static ERL_NIF_TERM vz_get_frame_rate(ErlNifEnv* env, int argc, const ERL_NIF_TE
   return enif_make_int(env, frame_rate);
 }
 
+/*
+  Returns the number of frames drawn, the CPU time in microseconds used by the view thread,
+  the refresh rate of the display and the measured time between frames in microseconds.
+*/
+static ERL_NIF_TERM vz_get_stats(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  unsigned long frames;
+  ErlNifTime cpu_time;
+  double refresh_rate, frame_interval;
+  size_t texture_bytes;
+  unsigned long texture_evictions, texture_reloads;
+  size_t glyph_atlas_bytes;
+  double glyph_atlas_occupancy;
+  unsigned long glyph_rasterizations, glyph_evictions;
+  ERL_NIF_TERM map;
+
+  if(!(argc == 1 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view))) {
+    return BADARG;
+  }
+
+  enif_mutex_lock(vz_view->lock);
+  frames = vz_view->frames;
+  cpu_time = vz_view->cpu_time;
+  refresh_rate = vz_view->refresh_rate;
+  frame_interval = vz_view->frame_interval;
+  texture_bytes = vz_view->textures.bytes;
+  texture_evictions = vz_view->textures.evictions;
+  texture_reloads = vz_view->textures.reloads;
+  glyph_atlas_bytes = vz_view->sdf.texture ? (size_t)vz_view->sdf.width * vz_view->sdf.height : 0;
+  glyph_atlas_occupancy = glyph_atlas_bytes ? (double)vz_view->sdf.used / glyph_atlas_bytes : 0.0;
+  glyph_rasterizations = vz_view->sdf.rasterized;
+  glyph_evictions = vz_view->sdf.evictions;
+  enif_mutex_unlock(vz_view->lock);
+
+  map = enif_make_new_map(env);
+  enif_make_map_put(env, map, ATOM_FRAMES, enif_make_uint64(env, frames), &map);
+  enif_make_map_put(env, map, ATOM_CPU_TIME, enif_make_int64(env, cpu_time), &map);
+  enif_make_map_put(env, map, ATOM_REFRESH_RATE, enif_make_double(env, refresh_rate), &map);
+  enif_make_map_put(env, map, ATOM_FRAME_INTERVAL, enif_make_double(env, frame_interval), &map);
+  enif_make_map_put(env, map, ATOM_TEXTURE_BYTES, enif_make_uint64(env, texture_bytes), &map);
+  enif_make_map_put(env, map, ATOM_TEXTURE_EVICTIONS, enif_make_uint64(env, texture_evictions), &map);
+  enif_make_map_put(env, map, ATOM_TEXTURE_RELOADS, enif_make_uint64(env, texture_reloads), &map);
+  enif_make_map_put(env, map, ATOM_GLYPH_ATLAS_BYTES, enif_make_uint64(env, glyph_atlas_bytes), &map);
+  enif_make_map_put(env, map, ATOM_GLYPH_ATLAS_OCCUPANCY, enif_make_double(env, glyph_atlas_occupancy), &map);
+  enif_make_map_put(env, map, ATOM_GLYPH_RASTERIZATIONS, enif_make_uint64(env, glyph_rasterizations), &map);
+  enif_make_map_put(env, map, ATOM_GLYPH_EVICTIONS, enif_make_uint64(env, glyph_evictions), &map);
+
+  return map;
+}
+
 static ERL_NIF_TERM vz_force_send_events(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
   VZview *vz_view;
 
@@ -482,83 +612,292 @@ static ERL_NIF_TERM vz_force_send_events(ErlNifEnv* env, int argc, const ERL_NIF
 
   enif_mutex_lock(vz_view->lock);
   vz_view->force_send_events = true;
+  vz_wake(vz_view);
+  enif_mutex_unlock(vz_view->lock);
+
+  return ATOM_OK;
+}
+
+
+/*
+Node NIF functions
+*/
+
+static ERL_NIF_TERM vz_create_node(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  VZnode *node;
+
+  if(!(argc == 1 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view))) {
+    return BADARG;
+  }
+
+  enif_mutex_lock(vz_view->lock);
+  node = vz_alloc_node(vz_view);
+  enif_mutex_unlock(vz_view->lock);
+
+  if(node == NULL)
+    return BADARG;
+
+  return enif_make_tuple2(env, enif_make_int(env, node->id), vz_make_resource(env, node));
+}
+
+static ERL_NIF_TERM vz_sync_node(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  VZnode *node;
+  const ERL_NIF_TERM *attrs;
+  float values[VZ_NODE_ATTRS];
+  int arity, parent;
+  double value;
+
+  if(!(argc == 3 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view) &&
+       enif_get_resource(env, argv[1], vz_node_res, (void**)&node) &&
+       enif_get_tuple(env, argv[2], &arity, &attrs) &&
+       arity == VZ_NODE_ATTRS + 1 &&
+       enif_get_int(env, attrs[0], &parent))) {
+    return BADARG;
+  }
+
+  for(int i = 0; i < VZ_NODE_ATTRS; ++i) {
+    if(!vz_get_number(env, attrs[i + 1], &value))
+      return BADARG;
+    values[i] = value;
+  }
+
+  enif_mutex_lock(vz_view->lock);
+  vz_node_store_set(vz_view->nodes, node->id, parent, values);
   enif_mutex_unlock(vz_view->lock);
 
   return ATOM_OK;
 }
 
+/*
+  Computes all world transforms and returns a binary with the visibility flags
+  of every node, indexed by node id. With partial redraws, only nodes that
+  overlap the damaged region of the view are visible.
+*/
+static ERL_NIF_TERM vz_update_transforms(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  ERL_NIF_TERM visibility;
+  unsigned char *data;
+  float damage[4];
+
+  if(!(argc == 1 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view))) {
+    return BADARG;
+  }
+
+  enif_mutex_lock(vz_view->lock);
+  vz_node_store_update(vz_view->nodes, vz_view->xform);
+  vz_node_store_take_damage(vz_view->nodes, damage);
+  vz_damage_update(vz_view, damage);
+  data = enif_make_new_binary(env, vz_view->nodes->count, &visibility);
+  vz_node_store_cull(vz_view->nodes, vz_view->damage.clip, data);
+
+  for(VZlayer *layer = vz_view->layers.layers; layer; layer = layer->next) {
+    if(layer->id >= 0 && (data[layer->id] & VZ_NODE_VISIBLE) && vz_layers_is_valid(vz_view, layer->id))
+      data[layer->id] |= VZ_NODE_LAYER_VALID;
+  }
+  enif_mutex_unlock(vz_view->lock);
+
+  return visibility;
+}
+
+static ERL_NIF_TERM vz_hit_test(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  VZnode_store *nodes;
+  ERL_NIF_TERM map, key, value;
+  double x, y;
+  unsigned n;
+
+  if(!(argc == 3 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view) &&
+       vz_get_number(env, argv[1], &x) &&
+       vz_get_number(env, argv[2], &y))) {
+    return BADARG;
+  }
+
+  map = enif_make_new_map(env);
+
+  enif_mutex_lock(vz_view->lock);
+  nodes = vz_view->nodes;
+  n = vz_node_store_hit_test(nodes, x, y);
+
+  for(unsigned i = 0; i < n; ++i) {
+    value = enif_make_tuple2(env,
+                             enif_make_double(env, nodes->hit_pos[i * 2]),
+                             enif_make_double(env, nodes->hit_pos[i * 2 + 1]));
+    enif_make_map_put(env, map, enif_make_int(env, nodes->hit_ids[i]), value, &map);
+  }
+
+  // Ancestors of hit nodes are added without a position, so that event
+  // dispatch knows which subtrees to descend into.
+  for(unsigned i = 0; i < n; ++i) {
+    for(int id = nodes->parent[nodes->hit_ids[i]];
+        id >= 0 && (unsigned)id < nodes->count && (nodes->flags[id] & VZ_NODE_USED);
+        id = nodes->parent[id]) {
+      key = enif_make_int(env, id);
+      if(enif_get_map_value(env, map, key, &value))
+        break;
+      enif_make_map_put(env, map, key, ATOM_NIL, &map);
+    }
+  }
+  enif_mutex_unlock(vz_view->lock);
+
+  return map;
+}
 
 VZ_ASYNC_DECL(
   vz_setup_node,
   {
-    float *xform;
-    float *parent_xform;
-    double x;
-    double y;
-    double width;
-    double height;
-    double scale_x;
-    double scale_y;
-    double skew_x;
-    double skew_y;
-    double rotate;
-    double alpha;
-  },
-  {
-    nvgReset(ctx);
-    nvgTransform(ctx, args->parent_xform[0], args->parent_xform[1], args->parent_xform[2], args->parent_xform[3], args->parent_xform[4], args->parent_xform[5]);
-    nvgScale(ctx, args->scale_x, args->scale_y);
-    nvgTranslate(ctx, args->x + args->width / 2.f, args->y + args->height / 2.f);
-    nvgRotate(ctx, args->rotate);
-    nvgTranslate(ctx, -args->width / 2.f, -args->height / 2.f);
-    nvgSkewX(ctx, args->skew_x);
-    nvgSkewY(ctx, args->skew_y);
-    nvgCurrentTransform(ctx, args->xform);
-    nvgGlobalAlpha(ctx, args->alpha);
-    nvgScissor(ctx, 0.f, 0.f, args->width, args->height);
+    int id;
+  },
+  {
+    VZnode_store *nodes = vz_view->nodes;
+    const float *t = &nodes->world[args->id * 6];
+    float w = nodes->width[args->id];
+    float h = nodes->height[args->id];
+    float rel[6];
+    if(vz_view->layers.active >= 0) {
+      vz_xform_multiply(rel, t, vz_view->layers.xform);
+      nvgReset(ctx);
+      nvgTransform(ctx, rel[0], rel[1], rel[2], rel[3], rel[4], rel[5]);
+      nvgScissor(ctx, 0.f, 0.f, w, h);
+      vz_sdf_reset(&vz_view->sdf);
+      vz_sdf_scissor(&vz_view->sdf, rel, 0.f, 0.f, w, h);
+    }
+    else {
+      vz_damage_transform(vz_view, t, w, h);
+    }
+    nvgGlobalAlpha(ctx, nodes->alpha[args->id]);
+    vz_sdf_state(&vz_view->sdf)->alpha = nodes->alpha[args->id];
+    vz_view->drawing_node = args->id;
   },
   {
-    if(!(argc == 3 &&
-        enif_get_resource(env, argv[1], vz_matrix_res, (void**)&args->parent_xform) &&
-        enif_is_map(env, argv[2]))) {
-      return BADARG;
+    VZnode *node;
+    if(!(argc == 2 &&
+        enif_get_resource(env, argv[1], vz_node_res, (void**)&node))) {
+      goto err;
     }
+    args->id = node->id;
+  }
+);
+
+
+static ERL_NIF_TERM vz_damage_node(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  VZnode *node;
+
+  if(!(argc == 2 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view) &&
+       enif_get_resource(env, argv[1], vz_node_res, (void**)&node))) {
+    return BADARG;
+  }
+
+  enif_mutex_lock(vz_view->lock);
+  vz_node_store_damage(vz_view->nodes, node->id);
+  enif_mutex_unlock(vz_view->lock);
+
+  return ATOM_OK;
+}
 
-    ERL_NIF_TERM map = argv[2];
-    ERL_NIF_TERM value;
+static ERL_NIF_TERM vz_damage_subtrees(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  ERL_NIF_TERM list, head;
+  unsigned length, n = 0;
+  int *ids;
 
-    enif_get_map_value(env, map, ATOM_X, &value);
-    VZ_GET_NUMBER(env, value, args->x);
+  if(!(argc == 2 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view) &&
+       enif_get_list_length(env, argv[1], &length))) {
+    return BADARG;
+  }
 
-    enif_get_map_value(env, map, ATOM_Y, &value);
-    VZ_GET_NUMBER(env, value, args->y);
+  ids = (int*)enif_alloc(sizeof(int) * (length + 1));
+  list = argv[1];
+  while(enif_get_list_cell(env, list, &head, &list)) {
+    if(!enif_get_int(env, head, &ids[n++])) {
+      enif_free(ids);
+      return BADARG;
+    }
+  }
 
-    enif_get_map_value(env, map, ATOM_WIDTH, &value);
-    VZ_GET_NUMBER(env, value, args->width);
+  enif_mutex_lock(vz_view->lock);
+  vz_node_store_damage_subtrees(vz_view->nodes, ids, n);
+  enif_mutex_unlock(vz_view->lock);
+  enif_free(ids);
 
-    enif_get_map_value(env, map, ATOM_HEIGHT, &value);
-    VZ_GET_NUMBER(env, value, args->height);
+  return ATOM_OK;
+}
 
-    enif_get_map_value(env, map, ATOM_SCALE_X, &value);
-    VZ_GET_NUMBER(env, value, args->scale_x);
+static ERL_NIF_TERM vz_layer_invalidate(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZview *vz_view;
+  VZnode *node;
 
-    enif_get_map_value(env, map, ATOM_SCALE_Y, &value);
-    VZ_GET_NUMBER(env, value, args->scale_y);
+  if(!(argc == 2 &&
+       enif_get_resource(env, argv[0], vz_view_res, (void**)&vz_view) &&
+       enif_get_resource(env, argv[1], vz_node_res, (void**)&node))) {
+    return BADARG;
+  }
 
-    enif_get_map_value(env, map, ATOM_SKEW_X, &value);
-    VZ_GET_NUMBER(env, value, args->skew_x);
+  enif_mutex_lock(vz_view->lock);
+  vz_layers_invalidate(vz_view, node->id);
+  enif_mutex_unlock(vz_view->lock);
 
-    enif_get_map_value(env, map, ATOM_SKEW_Y, &value);
-    VZ_GET_NUMBER(env, value, args->skew_y);
+  return ATOM_OK;
+}
 
-    enif_get_map_value(env, map, ATOM_ROTATE, &value);
-    VZ_GET_NUMBER(env, value, args->rotate);
+VZ_ASYNC_DECL(
+  vz_layer_begin,
+  {
+    int id;
+  },
+  {
+    __UNUSED(ctx);
+    vz_layers_begin(vz_view, args->id);
+  },
+  {
+    VZnode *node;
+    if(!(argc == 2 &&
+        enif_get_resource(env, argv[1], vz_node_res, (void**)&node))) {
+      goto err;
+    }
+    args->id = node->id;
+  }
+);
 
-    enif_get_map_value(env, map, ATOM_ALPHA, &value);
-    VZ_GET_NUMBER(env, value, args->alpha);
+VZ_ASYNC_DECL(
+  vz_layer_end,
+  {
+    __EMPTY_STRUCT
+  },
+  {
+    __UNUSED(ctx);
+    __UNUSED(args);
+    vz_layers_end(vz_view);
+  },
+  {
+    // no caller block
+  }
+);
 
-    enif_get_map_value(env, map, ATOM_XFORM, &value);
-    enif_get_resource(env, value, vz_matrix_res, (void**)&args->xform);
+VZ_ASYNC_DECL(
+  vz_layer_draw,
+  {
+    int id;
+  },
+  {
+    __UNUSED(ctx);
+    vz_layers_draw(vz_view, args->id);
+  },
+  {
+    VZnode *node;
+    if(!(argc == 2 &&
+        enif_get_resource(env, argv[1], vz_node_res, (void**)&node))) {
+      goto err;
+    }
+    args->id = node->id;
   }
 );
 
@@ -686,6 +1025,7 @@ VZ_ASYNC_DECL(
   {
     __UNUSED(args);
     nvgSave(ctx);
+    vz_sdf_save(&vz_view->sdf);
   },
   {
     // no caller block
@@ -700,6 +1040,7 @@ VZ_ASYNC_DECL(
   {
     __UNUSED(args);
     nvgRestore(ctx);
+    vz_sdf_restore(&vz_view->sdf);
   },
   {
     // no caller block
@@ -714,6 +1055,7 @@ VZ_ASYNC_DECL(
   {
     __UNUSED(args);
     nvgReset(ctx);
+    vz_sdf_reset(&vz_view->sdf);
   },
   {
     // no caller block
@@ -760,7 +1102,7 @@ VZ_ASYNC_DECL(
     NVGpaint *paint;
   },
   {
-    nvgStrokePaint(ctx, *args->paint);
+    nvgStrokePaint(ctx, vz_resolve_paint(vz_view, args->paint));
   },
   {
     if(!(argc == 2 &&
@@ -777,6 +1119,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgFillColor(ctx, args->color);
+    vz_sdf_state(&vz_view->sdf)->color = args->color;
   },
   {
     if(!(argc == 2 &&
@@ -792,7 +1135,10 @@ VZ_ASYNC_DECL(
     NVGpaint *paint;
   },
   {
-    nvgFillPaint(ctx, *args->paint);
+    NVGpaint paint = vz_resolve_paint(vz_view, args->paint);
+    nvgFillPaint(ctx, paint);
+    // SDF text is drawn with the inner color of gradients
+    vz_sdf_state(&vz_view->sdf)->color = paint.innerColor;
   },
   {
     if(!(argc == 2 &&
@@ -810,16 +1156,19 @@ VZ_ASYNC_DECL(
     double width;
     double height;
     double alpha;
-    int handle;
+    int image;
     int mode;
   },
   {
     int img_width;
     int img_height;
+    int handle;
     double width = args->width;
     double height = args->height;
+    if(!(handle = vz_texture_handle(vz_view, args->image)))
+      return;
     nvgSave(ctx);
-    nvgImageSize(ctx, args->handle, &img_width, &img_height);
+    nvgImageSize(ctx, handle, &img_width, &img_height);
     if(width == (double)img_width && height == (double)img_height) {
       nvgTranslate(ctx, args->x, args->y);
     }
@@ -841,7 +1190,7 @@ VZ_ASYNC_DECL(
     }
     nvgBeginPath(ctx);
     nvgRect(ctx, 0, 0, img_width, img_height);
-    nvgFillPaint(ctx, nvgImagePattern(ctx, 0, 0, img_width, img_height, 0, args->handle, args->alpha));
+    nvgFillPaint(ctx, nvgImagePattern(ctx, 0, 0, img_width, img_height, 0, handle, args->alpha));
     nvgFill(ctx);
     nvgRestore(ctx);
   },
@@ -854,7 +1203,7 @@ VZ_ASYNC_DECL(
       return BADARG;
     }
 
-    args->handle = image->handle;
+    args->image = image->id;
     VZ_GET_NUMBER(env, argv[1], args->x);
     VZ_GET_NUMBER(env, argv[2], args->y);
     VZ_GET_NUMBER(env, argv[3], args->width);
@@ -932,6 +1281,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgGlobalAlpha(ctx, args->alpha);
+    vz_sdf_state(&vz_view->sdf)->alpha = (float)args->alpha;
   },
   {
 
@@ -964,13 +1314,10 @@ VZ_ASYNC_DECL(
     nvgTransform(ctx, args->matrix[0], args->matrix[1], args->matrix[2], args->matrix[3], args->matrix[4], args->matrix[5]);
   },
   {
-    float *matrix;
-
     if(!(argc == 2 &&
-         enif_get_resource(env, argv[1], vz_matrix_res, (void**)&matrix))) {
+         vz_get_matrix(env, argv[1], args->matrix))) {
       goto err;
     }
-    memcpy(args->matrix, matrix, sizeof(float) * 6);
   }
 );
 
@@ -1060,10 +1407,9 @@ VZ_ASYNC_DECL(
   },
   {
     __UNUSED(args);
-    float *matrix;
-    matrix = vz_alloc_matrix();
+    float matrix[6];
     nvgCurrentTransform(ctx, matrix);
-    VZ_HANDLER_SEND(vz_make_resource(vz_view->msg_env, matrix));
+    VZ_HANDLER_SEND(vz_make_matrix(vz_view->msg_env, matrix));
   },
   {
     execute = true;
@@ -1237,6 +1583,43 @@ static ERL_NIF_TERM vz_transform_point(ErlNifEnv* env, int argc, const ERL_NIF_T
   return BADARG;
 }
 
+/*
+  Multiplies in double precision and in the same order as
+  Vizi.Canvas.Transform.multiply/2, so both give the same result.
+*/
+static ERL_NIF_TERM vz_transform_compose(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ERL_NIF_TERM list, head, tail;
+  double t[6] = {1.0, 0.0, 0.0, 1.0, 0.0, 0.0}, s[6], r[6];
+
+  if(!(argc == 1 && enif_is_list(env, argv[0])))
+    return BADARG;
+
+  list = argv[0];
+
+  while(enif_get_list_cell(env, list, &head, &tail)) {
+    list = tail;
+
+    if(!vz_get_matrix_double(env, head, s))
+      return BADARG;
+
+    r[0] = t[0] * s[0] + t[1] * s[2];
+    r[1] = t[0] * s[1] + t[1] * s[3];
+    r[2] = t[2] * s[0] + t[3] * s[2];
+    r[3] = t[2] * s[1] + t[3] * s[3];
+    r[4] = t[4] * s[0] + t[5] * s[2] + s[4];
+    r[5] = t[4] * s[1] + t[5] * s[3] + s[5];
+    memcpy(t, r, sizeof(r));
+  }
+
+  return enif_make_tuple6(env,
+                          enif_make_double(env, t[0]),
+                          enif_make_double(env, t[1]),
+                          enif_make_double(env, t[2]),
+                          enif_make_double(env, t[3]),
+                          enif_make_double(env, t[4]),
+                          enif_make_double(env, t[5]));
+}
+
 static ERL_NIF_TERM vz_matrix_to_list(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
   float *matrix;
 
@@ -1288,129 +1671,780 @@ static ERL_NIF_TERM vz_rad_to_deg(ErlNifEnv* env, int argc, const ERL_NIF_TERM a
   return BADARG;
 }
 
+/*
+  Returns decoded pixels as binary, downscaled to the maximum size of the load options.
+*/
+static ERL_NIF_TERM vz_make_decoded_image(ErlNifEnv* env, unsigned char *data, int width, int height, const VZimage_opts *opts) {
+  ErlNifBinary bin;
+  int fit_width, fit_height;
+
+  vz_pixels_fit(width, height, opts->max_width, opts->max_height, &fit_width, &fit_height);
+  enif_alloc_binary((size_t)fit_width * fit_height * 4, &bin);
+  if(fit_width == width && fit_height == height)
+    memcpy(bin.data, data, bin.size);
+  else
+    vz_pixels_resize(data, width, height, bin.data, fit_width, fit_height);
+  stbi_image_free(data);
+
+  return enif_make_tuple3(env, enif_make_binary(env, &bin), enif_make_int(env, fit_width), enif_make_int(env, fit_height));
+}
+
 static ERL_NIF_TERM vz_image_file_to_binary(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
   int width, height, num_channels;
   unsigned char *data;
   char file_path[VZ_MAX_STRING_LENGTH];
-  ErlNifBinary bin;
+  VZimage_opts opts;
 
-  if(!(argc == 1 &&
-       vz_copy_string(env, argv[0], file_path, VZ_MAX_STRING_LENGTH))) {
+  if(!(argc == 2 &&
+       vz_copy_string(env, argv[0], file_path, VZ_MAX_STRING_LENGTH) &&
+       vz_handle_image_opts(env, argv[1], &opts))) {
     return BADARG;
   }
 
-	stbi_set_unpremultiply_on_load(1);
-	stbi_convert_iphone_png_to_rgb(1);
   if(!(data = stbi_load(file_path, &width, &height, &num_channels, 4)))
     return BADARG;
 
-  enif_alloc_binary(width * height * 4, &bin);
-  memcpy(bin.data, data, width * height * 4);
-  stbi_image_free(data);
-
-  return enif_make_tuple3(env, enif_make_binary(env, &bin), enif_make_int(env, width), enif_make_int(env, height));
+  return vz_make_decoded_image(env, data, width, height, &opts);
 }
 
-VZ_ASYNC_DECL(
-  vz_image_from_file,
-  {
-    char file_path[VZ_MAX_STRING_LENGTH];
-    int flags;
-  },
-  {
-    int handle;
-    VZimage *image;
-
-    handle = nvgCreateImage(ctx, args->file_path, args->flags);
-    if(handle == 0) VZ_HANDLER_SEND_BADARG;
-    image = vz_alloc_image(vz_view, handle);
-    VZ_HANDLER_SEND(vz_make_resource(vz_view->msg_env, image));
+/*
+  Decodes an encoded image in memory to RGBA pixels, runs on a dirty CPU scheduler.
+*/
+static ERL_NIF_TERM vz_image_decode(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  int width, height, num_channels;
+  unsigned char *data;
+  ErlNifBinary bin;
+  VZimage_opts opts;
+
+  if(!(argc == 2 &&
+       enif_inspect_binary(env, argv[0], &bin) &&
+       vz_handle_image_opts(env, argv[1], &opts))) {
+    return BADARG;
+  }
+
+  if(!(data = stbi_load_from_memory(bin.data, (int)bin.size, &width, &height, &num_channels, 4)))
+    return BADARG;
+
+  return vz_make_decoded_image(env, data, width, height, &opts);
+}
+
+static ERL_NIF_TERM vz_make_asset(ErlNifEnv* env, VZasset *asset) {
+  VZasset_handle *handle;
+
+  if(!asset)
+    return BADARG;
+
+  if(!(handle = vz_alloc_asset_handle(asset))) {
+    vz_asset_unpin(asset);
+    vz_asset_release(asset);
+    return BADARG;
+  }
+
+  return vz_make_resource(env, handle);
+}
+
+/*
+  Decodes an image file with its load options to an asset shared by all views,
+  runs on a dirty IO scheduler.
+*/
+static ERL_NIF_TERM vz_image_load(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZpriv *priv = (VZpriv*)enif_priv_data(env);
+  char file_path[VZ_MAX_STRING_LENGTH];
+  VZimage_opts opts;
+
+  if(!(argc == 2 &&
+       vz_copy_string(env, argv[0], file_path, VZ_MAX_STRING_LENGTH) &&
+       vz_handle_image_opts(env, argv[1], &opts))) {
+    return BADARG;
+  }
+
+  return vz_make_asset(env, vz_asset_acquire(&priv->assets, VZ_ASSET_IMAGE, file_path, &opts));
+}
+
+/*
+  Decodes an encoded image in memory with its load options to an asset shared
+  by all views, runs on a dirty CPU scheduler.
+*/
+static ERL_NIF_TERM vz_image_load_binary(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZpriv *priv = (VZpriv*)enif_priv_data(env);
+  ErlNifBinary bin;
+  VZimage_opts opts;
+
+  if(!(argc == 2 &&
+       enif_inspect_binary(env, argv[0], &bin) &&
+       vz_handle_image_opts(env, argv[1], &opts))) {
+    return BADARG;
+  }
+
+  return vz_make_asset(env, vz_asset_acquire_memory(&priv->assets, bin.data, bin.size, &opts));
+}
+
+/*
+  Pixel conversions of image binaries, all run on a dirty CPU scheduler and
+  return a new binary.
+*/
+static bool vz_inspect_pixels(ErlNifEnv* env, ERL_NIF_TERM term, size_t pixel_size, ErlNifBinary *bin, size_t *count) {
+  if(!(enif_inspect_binary(env, term, bin) && bin->size % pixel_size == 0))
+    return false;
+
+  *count = bin->size / pixel_size;
+  return true;
+}
+
+static ERL_NIF_TERM vz_image_premultiply(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ErlNifBinary bin, out;
+  size_t count;
+
+  if(!(argc == 1 &&
+       vz_inspect_pixels(env, argv[0], 4, &bin, &count))) {
+    return BADARG;
+  }
+
+  enif_alloc_binary(bin.size, &out);
+  vz_pixels_premultiply(bin.data, out.data, count);
+
+  return enif_make_binary(env, &out);
+}
+
+static ERL_NIF_TERM vz_image_unpremultiply(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ErlNifBinary bin, out;
+  size_t count;
+
+  if(!(argc == 1 &&
+       vz_inspect_pixels(env, argv[0], 4, &bin, &count))) {
+    return BADARG;
+  }
+
+  enif_alloc_binary(bin.size, &out);
+  vz_pixels_unpremultiply(bin.data, out.data, count);
+
+  return enif_make_binary(env, &out);
+}
+
+static ERL_NIF_TERM vz_image_swizzle(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ErlNifBinary bin, out;
+  ERL_NIF_TERM head, list;
+  unsigned char order[4];
+  unsigned length;
+  size_t count;
+  int c;
+
+  if(!(argc == 2 &&
+       vz_inspect_pixels(env, argv[0], 4, &bin, &count) &&
+       enif_get_list_length(env, argv[1], &length) && length == 4)) {
+    return BADARG;
+  }
+
+  list = argv[1];
+  for(int i = 0; i < 4; ++i) {
+    if(!(enif_get_list_cell(env, list, &head, &list) &&
+         enif_get_int(env, head, &c) && c >= 0 && c < 4))
+      return BADARG;
+    order[i] = (unsigned char)c;
+  }
+
+  enif_alloc_binary(bin.size, &out);
+  vz_pixels_swizzle(bin.data, out.data, count, order);
+
+  return enif_make_binary(env, &out);
+}
+
+static ERL_NIF_TERM vz_image_rgb_to_rgba(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ErlNifBinary bin, out;
+  size_t count;
+
+  if(!(argc == 1 &&
+       vz_inspect_pixels(env, argv[0], 3, &bin, &count))) {
+    return BADARG;
+  }
+
+  enif_alloc_binary(count * 4, &out);
+  vz_pixels_rgb_to_rgba(bin.data, out.data, count);
+
+  return enif_make_binary(env, &out);
+}
+
+static ERL_NIF_TERM vz_image_grayscale(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ErlNifBinary bin, out;
+  size_t count;
+
+  if(!(argc == 1 &&
+       vz_inspect_pixels(env, argv[0], 4, &bin, &count))) {
+    return BADARG;
+  }
+
+  enif_alloc_binary(bin.size, &out);
+  vz_pixels_grayscale(bin.data, out.data, count);
+
+  return enif_make_binary(env, &out);
+}
+
+/*
+  The lookup table is either one table of 256 bytes for the color channels,
+  leaving alpha as is, or a table per channel of 1024 bytes.
+*/
+static ERL_NIF_TERM vz_image_lut(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ErlNifBinary bin, lut_bin, out;
+  unsigned char lut[4][256];
+  size_t count;
+
+  if(!(argc == 2 &&
+       vz_inspect_pixels(env, argv[0], 4, &bin, &count) &&
+       enif_inspect_binary(env, argv[1], &lut_bin) &&
+       (lut_bin.size == 256 || lut_bin.size == 1024))) {
+    return BADARG;
+  }
+
+  if(lut_bin.size == 1024)
+    memcpy(lut, lut_bin.data, 1024);
+  else {
+    for(int c = 0; c < 3; ++c)
+      memcpy(lut[c], lut_bin.data, 256);
+    for(int i = 0; i < 256; ++i)
+      lut[3][i] = (unsigned char)i;
+  }
+
+  enif_alloc_binary(bin.size, &out);
+  vz_pixels_lut(bin.data, out.data, count, (const unsigned char (*)[256])lut);
+
+  return enif_make_binary(env, &out);
+}
+
+static ERL_NIF_TERM vz_image_pixel_isa(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  __UNUSED(argv);
+  if(argc != 0)
+    return BADARG;
+
+  return enif_make_atom(env, vz_pixels_isa());
+}
+
+VZ_ASYNC_DECL(
+  vz_image_from_asset,
+  {
+    VZasset *asset;
+    int flags;
+  },
+  {
+    int id;
+    VZimage *image;
+    __UNUSED(ctx);
+
+    if((id = vz_texture_from_asset(vz_view, args->asset, args->flags)) == 0)
+      VZ_HANDLER_SEND_BADARG;
+    image = vz_alloc_image(vz_view, id);
+    VZ_HANDLER_SEND(vz_make_resource(vz_view->msg_env, image));
+  },
+  {
+    VZasset_handle *handle;
+
+    if(!(argc == 3 &&
+        enif_get_resource(env, argv[1], vz_asset_res, (void**)&handle) &&
+        vz_handle_image_flags(env, argv[2], &args->flags))) {
+      goto err;
+    }
+    // pinned until the image is uploaded, the handle may be collected first
+    vz_asset_pin(handle->asset);
+    args->asset = handle->asset;
+    execute = true;
+  }
+);
+
+VZ_ASYNC_DECL(
+  vz_image_from_binary,
+  {
+    ErlNifEnv *env;
+    ErlNifBinary bin;
+    uint64_t hash;
+    int flags;
+    int w;
+    int h;
+  },
+  {
+    int id;
+    VZimage *image;
+    __UNUSED(ctx);
+
+    id = vz_texture_from_pixels(vz_view, args->env, args->bin.data, args->w, args->h, args->flags, args->hash);
+    if(id == 0) VZ_HANDLER_SEND_BADARG;
+    image = vz_alloc_image(vz_view, id);
+    VZ_HANDLER_SEND(vz_make_managed_resource(vz_view->msg_env, image, vz_view));
+  },
+  {
+    ERL_NIF_TERM bin_copy;
+
+    if(!(argc == 5 &&
+        enif_is_binary(env, argv[1]) &&
+        enif_get_int(env, argv[2], &args->w) &&
+        enif_get_int(env, argv[3], &args->h) &&
+        vz_handle_image_flags(env, argv[4], &args->flags))) {
+      goto err;
+    }
+    args->env = enif_alloc_env();
+    bin_copy = enif_make_copy(args->env, argv[1]);
+    enif_inspect_binary(args->env, bin_copy, &args->bin);
+    if(args->bin.size < (size_t)args->w * args->h * 4) {
+      enif_free_env(args->env);
+      goto err;
+    }
+    args->hash = vz_texture_hash(args->bin.data, (size_t)args->w * args->h * 4);
+
+    execute = true;
+  }
+);
+
+/*
+  Copies image data to a free slot of the upload stream of a streaming or
+  video image, in the calling process. Returns the slot, or -1 when the image
+  has no stream, the data is too small or all slots are busy.
+*/
+static int vz_stream_write(VZview *vz_view, int image, const ErlNifBinary *bin, VZstream **stream) {
+  VZtexture *texture;
+  unsigned char *data;
+  int slot = -1;
+
+  enif_mutex_lock(vz_view->lock);
+  if(!vz_view->shutdown && (texture = vz_texture_get(vz_view, image)) &&
+     (*stream = vz_texture_stream_of(texture)) && bin->size >= (*stream)->size)
+    slot = vz_stream_claim(*stream, &data);
+  enif_mutex_unlock(vz_view->lock);
+
+  if(slot < 0)
+    return -1;
+
+  memcpy(data, bin->data, (*stream)->size);
+
+  enif_mutex_lock(vz_view->lock);
+  vz_stream_written(*stream, slot);
+  enif_mutex_unlock(vz_view->lock);
+
+  return slot;
+}
+
+/*
+  Returns the size of the data that replaces the contents of an image, 0 when
+  the image was deleted. Shorter data is rejected before anything is queued,
+  streams and uploads read this many bytes.
+*/
+static size_t vz_image_data_size(VZview *vz_view, int image) {
+  VZtexture *texture;
+  size_t size = 0;
+
+  enif_mutex_lock(vz_view->lock);
+  if((texture = vz_texture_get(vz_view, image))) {
+    if(texture->video)
+      size = vz_video_frame_size(texture->video->format, texture->video->width, texture->video->height);
+    else
+      size = (size_t)texture->width * texture->height * 4;
+  }
+  enif_mutex_unlock(vz_view->lock);
+
+  return size;
+}
+
+VZ_ASYNC_DECL(
+  vz_image_stream,
+  {
+    int flags;
+    int w;
+    int h;
+  },
+  {
+    int id;
+    VZimage *image;
+    __UNUSED(ctx);
+
+    if((id = vz_texture_stream(vz_view, args->w, args->h, args->flags)) == 0)
+      VZ_HANDLER_SEND_BADARG;
+    image = vz_alloc_image(vz_view, id);
+    VZ_HANDLER_SEND(vz_make_managed_resource(vz_view->msg_env, image, vz_view));
+  },
+  {
+    if(!(argc == 4 &&
+        enif_get_int(env, argv[1], &args->w) &&
+        enif_get_int(env, argv[2], &args->h) &&
+        args->w > 0 && args->h > 0 &&
+        vz_handle_image_flags(env, argv[3], &args->flags))) {
+      goto err;
+    }
+    execute = true;
+  }
+);
+
+/*
+  With partial redraws, the nodes that drew an image are redrawn in the frame
+  that shows its new contents, or the whole view when that isn't known. In
+  auto redraw mode the change also requests that frame.
+*/
+static void vz_image_changed(VZview *vz_view, int image) {
+  enif_mutex_lock(vz_view->lock);
+  if(!vz_texture_damage(vz_view, image))
+    vz_damage_invalidate(vz_view);
+  if(vz_view->redraw_mode == VZ_AUTO) {
+    vz_view->redraw = true;
+    vz_wake(vz_view);
+  }
+  enif_mutex_unlock(vz_view->lock);
+}
+
+VZ_ASYNC_DECL(
+  vz_image_update_from_binary,
+  {
+    ErlNifEnv *env;
+    ErlNifBinary bin;
+    VZstream *stream;
+    int slot;
+    int image;
+  },
+  {
+    __UNUSED(ctx);
+    if(args->slot >= 0)
+      vz_texture_update_stream(vz_view, args->image, args->stream, args->slot);
+    else
+      vz_texture_update(vz_view, args->image, args->env, args->bin.data);
+  },
+  {
+    VZimage *image;
+    ErlNifBinary bin;
+    ERL_NIF_TERM bin_copy;
+
+    if(!(argc == 3 &&
+        enif_get_resource(env, argv[1], vz_image_res, (void**)&image) &&
+        enif_inspect_binary(env, argv[2], &bin) &&
+        bin.size >= vz_image_data_size(vz_view, image->id))) {
+      goto err;
+    }
+    args->image = image->id;
+    vz_image_changed(vz_view, image->id);
+    if((args->slot = vz_stream_write(vz_view, image->id, &bin, &args->stream)) < 0) {
+      args->env = enif_alloc_env();
+      bin_copy = enif_make_copy(args->env, argv[2]);
+      enif_inspect_binary(args->env, bin_copy, &args->bin);
+    }
+  }
+);
+
+/*
+  Video flags select the frame format and color space, all other flags are
+  image flags of the converted frames.
+*/
+static bool vz_handle_video_flags(ErlNifEnv *env, ERL_NIF_TERM list, enum VZvideo_format *format, bool *bt709, int *flags) {
+  ERL_NIF_TERM head, tail, image_flags = enif_make_list(env, 0);
+  *format = VZ_VIDEO_I420;
+  *bt709 = false;
+
+  while(enif_get_list_cell(env, list, &head, &tail)) {
+    list = tail;
+
+    if(enif_is_identical(head, ATOM_I420))
+      *format = VZ_VIDEO_I420;
+    else if(enif_is_identical(head, ATOM_NV12))
+      *format = VZ_VIDEO_NV12;
+    else if(enif_is_identical(head, ATOM_BT601))
+      *bt709 = false;
+    else if(enif_is_identical(head, ATOM_BT709))
+      *bt709 = true;
+    else
+      image_flags = enif_make_list_cell(env, head, image_flags);
+  }
+
+  return vz_handle_image_flags(env, image_flags, flags);
+}
+
+VZ_ASYNC_DECL(
+  vz_image_video,
+  {
+    enum VZvideo_format format;
+    bool bt709;
+    int flags;
+    int w;
+    int h;
+  },
+  {
+    int id;
+    VZimage *image;
+    VZvideo *video;
+    __UNUSED(ctx);
+
+    if(!(video = vz_video_create(vz_view, args->format, args->bt709, args->w, args->h, args->flags)))
+      VZ_HANDLER_SEND_BADARG;
+    id = vz_texture_from_video(vz_view, video);
+    image = vz_alloc_image(vz_view, id);
+    VZ_HANDLER_SEND(vz_make_managed_resource(vz_view->msg_env, image, vz_view));
+  },
+  {
+    if(!(argc == 4 &&
+        enif_get_int(env, argv[1], &args->w) &&
+        enif_get_int(env, argv[2], &args->h) &&
+        args->w > 0 && args->h > 0 &&
+        vz_handle_video_flags(env, argv[3], &args->format, &args->bt709, &args->flags))) {
+      goto err;
+    }
+    execute = true;
+  }
+);
+
+VZ_ASYNC_DECL(
+  vz_image_update_video,
+  {
+    ErlNifEnv *env;
+    ErlNifBinary bin;
+    VZstream *stream;
+    int slot;
+    int image;
+  },
+  {
+    __UNUSED(ctx);
+    if(args->slot >= 0)
+      vz_texture_update_stream(vz_view, args->image, args->stream, args->slot);
+    else {
+      vz_texture_update_video(vz_view, args->image, args->bin.data, args->bin.size);
+      enif_free_env(args->env);
+    }
+  },
+  {
+    VZimage *image;
+    ErlNifBinary bin;
+    ERL_NIF_TERM bin_copy;
+
+    if(!(argc == 3 &&
+        enif_get_resource(env, argv[1], vz_image_res, (void**)&image) &&
+        enif_inspect_binary(env, argv[2], &bin) &&
+        bin.size >= vz_image_data_size(vz_view, image->id))) {
+      goto err;
+    }
+    args->image = image->id;
+    vz_image_changed(vz_view, image->id);
+    if((args->slot = vz_stream_write(vz_view, image->id, &bin, &args->stream)) < 0) {
+      args->env = enif_alloc_env();
+      bin_copy = enif_make_copy(args->env, argv[2]);
+      enif_inspect_binary(args->env, bin_copy, &args->bin);
+    }
+  }
+);
+
+/*
+  Reads a colormap: the name of a preset, or a binary of 256 RGBA or RGB
+  colors.
+*/
+static bool vz_get_colormap(ErlNifEnv *env, ERL_NIF_TERM term, unsigned char colormap[VZ_COLORMAP_SIZE]) {
+  ErlNifBinary bin;
+
+  if(enif_is_identical(term, ATOM_GRAYSCALE))
+    vz_heatmap_preset(VZ_COLORMAP_GRAYSCALE, colormap);
+  else if(enif_is_identical(term, ATOM_VIRIDIS))
+    vz_heatmap_preset(VZ_COLORMAP_VIRIDIS, colormap);
+  else if(enif_is_identical(term, ATOM_INFERNO))
+    vz_heatmap_preset(VZ_COLORMAP_INFERNO, colormap);
+  else if(enif_inspect_binary(env, term, &bin) && bin.size == VZ_COLORMAP_SIZE)
+    memcpy(colormap, bin.data, VZ_COLORMAP_SIZE);
+  else if(enif_inspect_binary(env, term, &bin) && bin.size == 768)
+    vz_pixels_rgb_to_rgba(bin.data, colormap, 256);
+  else return false;
+
+  return true;
+}
+
+typedef struct VZheatmap_opts {
+  int col;
+  int row;
+  int cols;
+  int rows;
+  double min;
+  double max;
+} VZheatmap_opts;
+
+static bool vz_get_pair(ErlNifEnv *env, ERL_NIF_TERM term, int *a, int *b) {
+  const ERL_NIF_TERM *array;
+  int arity;
+
+  return enif_get_tuple(env, term, &arity, &array) && arity == 2 &&
+         enif_get_int(env, array[0], a) && enif_get_int(env, array[1], b);
+}
+
+/*
+  Reads the block of cells an update replaces and the range of float values,
+  `cols` and `rows` are -1 when the block extends to the end of the grid.
+*/
+static bool vz_handle_heatmap_opts(ErlNifEnv *env, ERL_NIF_TERM list, VZheatmap_opts *opts) {
+  ERL_NIF_TERM head, tail;
+  const ERL_NIF_TERM *tup_array, *range_array;
+  int tup_arity, range_arity;
+  opts->col = opts->row = 0;
+  opts->cols = opts->rows = -1;
+  opts->min = 0.0;
+  opts->max = 1.0;
+
+  while(enif_get_list_cell(env, list, &head, &tail)) {
+    list = tail;
+
+    if(!(enif_get_tuple(env, head, &tup_arity, &tup_array) && tup_arity == 2))
+      return false;
+
+    if(enif_is_identical(tup_array[0], ATOM_ORIGIN)) {
+      if(!(vz_get_pair(env, tup_array[1], &opts->col, &opts->row) && opts->col >= 0 && opts->row >= 0))
+        return false;
+    }
+    else if(enif_is_identical(tup_array[0], ATOM_SIZE)) {
+      if(!(vz_get_pair(env, tup_array[1], &opts->cols, &opts->rows) && opts->cols > 0 && opts->rows > 0))
+        return false;
+    }
+    else if(enif_is_identical(tup_array[0], ATOM_RANGE)) {
+      if(!(enif_get_tuple(env, tup_array[1], &range_arity, &range_array) && range_arity == 2))
+        return false;
+      VZ_GET_NUMBER(env, range_array[0], opts->min);
+      VZ_GET_NUMBER(env, range_array[1], opts->max);
+    }
+    else return false;
+  }
+
+  return true;
+
+  err:
+  return false;
+}
+
+VZ_ASYNC_DECL(
+  vz_image_heatmap,
+  {
+    unsigned char colormap[VZ_COLORMAP_SIZE];
+    int flags;
+    int cols;
+    int rows;
   },
   {
-    if(!(argc == 3 &&
-        vz_copy_string(env, argv[1], args->file_path, VZ_MAX_STRING_LENGTH) &&
-        vz_handle_image_flags(env, argv[2], &args->flags))) {
+    int id;
+    VZimage *image;
+    VZheatmap *heatmap;
+    __UNUSED(ctx);
+
+    if(!(heatmap = vz_heatmap_create(vz_view, args->cols, args->rows, args->colormap, args->flags)))
+      VZ_HANDLER_SEND_BADARG;
+    id = vz_texture_from_heatmap(vz_view, heatmap);
+    image = vz_alloc_image(vz_view, id);
+    VZ_HANDLER_SEND(vz_make_managed_resource(vz_view->msg_env, image, vz_view));
+  },
+  {
+    if(!(argc == 5 &&
+        enif_get_int(env, argv[1], &args->cols) &&
+        enif_get_int(env, argv[2], &args->rows) &&
+        args->cols > 0 && args->rows > 0 &&
+        vz_get_colormap(env, argv[3], args->colormap) &&
+        vz_handle_image_flags(env, argv[4], &args->flags))) {
       goto err;
     }
     execute = true;
   }
 );
 
+/*
+  Converts the values of a block of cells to bytes in the calling process:
+  bytes are taken as they are, floats are mapped from their range.
+*/
 VZ_ASYNC_DECL(
-  vz_image_from_binary,
+  vz_image_update_heatmap,
   {
     ErlNifEnv *env;
-    ErlNifBinary bin;
-    int flags;
-    int w;
-    int h;
+    const unsigned char *values;
+    int image;
+    int col;
+    int row;
+    int cols;
+    int rows;
   },
   {
-    int handle;
-    VZimage *image;
-
-    handle = nvgCreateImageRGBA(ctx, args->w, args->h, args->flags, args->bin.data);
-    if(handle == 0) VZ_HANDLER_SEND_BADARG;
-    image = vz_alloc_image(vz_view, handle);
+    __UNUSED(ctx);
+    vz_texture_update_heatmap(vz_view, args->image, args->col, args->row, args->cols, args->rows, args->values);
     enif_free_env(args->env);
-    VZ_HANDLER_SEND(vz_make_managed_resource(vz_view->msg_env, image, vz_view));
   },
   {
-    ERL_NIF_TERM bin_copy;
+    VZimage *image;
+    VZtexture *texture;
+    VZheatmap_opts opts;
+    ErlNifBinary bin;
+    ERL_NIF_TERM values;
+    unsigned char *bytes;
+    int grid_cols = 0;
+    int grid_rows = 0;
+    size_t count;
 
-    if(!(argc == 5 &&
-        enif_is_binary(env, argv[1]) &&
-        enif_get_int(env, argv[2], &args->w) &&
-        enif_get_int(env, argv[3], &args->h) &&
-        vz_handle_image_flags(env, argv[4], &args->flags))) {
+    if(!(argc == 4 &&
+        enif_get_resource(env, argv[1], vz_image_res, (void**)&image) &&
+        enif_inspect_binary(env, argv[2], &bin) &&
+        vz_handle_heatmap_opts(env, argv[3], &opts))) {
       goto err;
     }
-    args->env = enif_alloc_env();
-    bin_copy = enif_make_copy(args->env, argv[1]);
-    enif_inspect_binary(args->env, bin_copy, &args->bin);
 
-    execute = true;
+    enif_mutex_lock(vz_view->lock);
+    if((texture = vz_texture_get(vz_view, image->id)) && texture->heatmap) {
+      grid_cols = texture->heatmap->cols;
+      grid_rows = texture->heatmap->rows;
+    }
+    enif_mutex_unlock(vz_view->lock);
+
+    if(opts.cols < 0) opts.cols = grid_cols - opts.col;
+    if(opts.rows < 0) opts.rows = grid_rows - opts.row;
+    if(!(opts.cols > 0 && opts.rows > 0 &&
+         opts.col + opts.cols <= grid_cols && opts.row + opts.rows <= grid_rows))
+      goto err;
+
+    count = (size_t)opts.cols * opts.rows;
+    if(bin.size != count && bin.size != count * sizeof(float))
+      goto err;
+
+    args->image = image->id;
+    vz_image_changed(vz_view, image->id);
+    args->col = opts.col;
+    args->row = opts.row;
+    args->cols = opts.cols;
+    args->rows = opts.rows;
+    args->env = enif_alloc_env();
+    if(bin.size == count) {
+      values = enif_make_copy(args->env, argv[2]);
+      enif_inspect_binary(args->env, values, &bin);
+      args->values = bin.data;
+    }
+    else {
+      bytes = enif_make_new_binary(args->env, count, &values);
+      vz_pixels_quantize((const float*)bin.data, bytes, count, (float)opts.min, (float)opts.max);
+      args->values = bytes;
+    }
   }
 );
 
 VZ_ASYNC_DECL(
-  vz_image_update_from_binary,
+  vz_image_heatmap_colormap,
   {
-    ErlNifEnv *env;
-    ErlNifBinary bin;
-    int handle;
+    unsigned char colormap[VZ_COLORMAP_SIZE];
+    int image;
   },
   {
-    nvgUpdateImage(ctx, args->handle, args->bin.data);
-    enif_free_env(args->env);
+    __UNUSED(ctx);
+    vz_texture_heatmap_colormap(vz_view, args->image, args->colormap);
   },
   {
     VZimage *image;
-    ERL_NIF_TERM bin_copy;
 
     if(!(argc == 3 &&
         enif_get_resource(env, argv[1], vz_image_res, (void**)&image) &&
-        enif_is_binary(env, argv[2]))) {
+        vz_get_colormap(env, argv[2], args->colormap))) {
       goto err;
     }
-    args->handle = image->handle;
-    args->env = enif_alloc_env();
-    bin_copy = enif_make_copy(args->env, argv[2]);
-    enif_inspect_binary(args->env, bin_copy, &args->bin);
+    args->image = image->id;
+    vz_image_changed(vz_view, image->id);
   }
 );
 
 VZ_ASYNC_DECL(
   vz_image_size,
   {
-    int handle;
+    int image;
   },
   {
-    int w;
-    int h;
-    nvgImageSize(ctx, args->handle, &w, &h);
+    VZtexture *texture = vz_texture_get(vz_view, args->image);
+    __UNUSED(ctx);
+    if(!texture) VZ_HANDLER_SEND_BADARG;
     VZ_HANDLER_SEND(enif_make_tuple2(vz_view->msg_env,
-      enif_make_int(vz_view->msg_env, w), enif_make_int(vz_view->msg_env, h)));
+      enif_make_int(vz_view->msg_env, texture->width), enif_make_int(vz_view->msg_env, texture->height)));
   },
   {
     VZimage *image;
@@ -1419,7 +2453,7 @@ VZ_ASYNC_DECL(
         enif_get_resource(env, argv[1], vz_image_res, (void**)&image))) {
       goto err;
     }
-    args->handle = image->handle;
+    args->image = image->id;
     execute = true;
   }
 );
@@ -1427,10 +2461,11 @@ VZ_ASYNC_DECL(
 VZ_ASYNC_DECL(
   vz_image_delete,
   {
-    int handle;
+    int image;
   },
   {
-    nvgDeleteImage(ctx, args->handle);
+    __UNUSED(ctx);
+    vz_texture_delete(vz_view, args->image);
   },
   {
     VZimage *image;
@@ -1439,7 +2474,7 @@ VZ_ASYNC_DECL(
         enif_get_resource(env, argv[1], vz_image_res, (void**)&image))) {
       goto err;
     }
-    args->handle = image->handle;
+    args->image = image->id;
   }
 );
 
@@ -1543,7 +2578,8 @@ static ERL_NIF_TERM vz_image_pattern(ErlNifEnv* env, int argc, const ERL_NIF_TER
   VZ_GET_NUMBER(env, argv[5], angle);
   VZ_GET_NUMBER(env, argv[7], alpha);
 
-  paint = vz_alloc_paint(nvgImagePattern(vz_view->ctx, ox, oy, ex, ey, angle, image->handle, alpha));
+  // the image slot is resolved to a texture when the paint is used
+  paint = vz_alloc_paint(nvgImagePattern(vz_view->ctx, ox, oy, ex, ey, angle, image->id, alpha));
 
   return vz_make_managed_resource(env, paint, vz_view);
 
@@ -1560,7 +2596,10 @@ VZ_ASYNC_DECL(
     double h;
   },
   {
+    float xform[6];
     nvgScissor(ctx, args->x, args->y, args->w, args->h);
+    nvgCurrentTransform(ctx, xform);
+    vz_sdf_scissor(&vz_view->sdf, xform, args->x, args->y, args->w, args->h);
   },
   {
     if(argc != 5) goto err;
@@ -1581,6 +2620,9 @@ VZ_ASYNC_DECL(
     double h;
   },
   {
+    float xform[6];
+    nvgCurrentTransform(ctx, xform);
+    vz_sdf_intersect_scissor(&vz_view->sdf, xform, args->x, args->y, args->w, args->h);
     nvgIntersectScissor(ctx, args->x, args->y, args->w, args->h);
   },
   {
@@ -1601,6 +2643,7 @@ VZ_ASYNC_DECL(
   {
     __UNUSED(args);
     nvgResetScissor(ctx);
+    vz_sdf_reset_scissor(&vz_view->sdf);
   },
   {
     // no caller block
@@ -1895,6 +2938,311 @@ VZ_ASYNC_DECL(
   }
 );
 
+static bool vz_get_floats(ErlNifEnv *env, const ERL_NIF_TERM *terms, int count, float *values) {
+  double value;
+
+  for(int i = 0; i < count; ++i) {
+    if(!vz_get_number(env, terms[i], &value))
+      return false;
+    values[i] = (float)value;
+  }
+
+  return true;
+}
+
+/*
+  Appends a path command in the form of the canvas function it mirrors,
+  `{:move_to, x, y}` for `move_to/3`.
+*/
+static bool vz_handle_path_command(ErlNifEnv *env, ERL_NIF_TERM term, VZpath *path) {
+  const ERL_NIF_TERM *tup;
+  int arity, dir;
+  float a[8];
+
+  if(enif_is_identical(term, ATOM_CLOSE_PATH)) {
+    vz_path_close(path);
+    return true;
+  }
+
+  if(!(enif_get_tuple(env, term, &arity, &tup) && arity >= 2))
+    return false;
+
+  if(enif_is_identical(tup[0], ATOM_PATH_WINDING) && arity == 2 && vz_get_winding(tup[1], &dir))
+    vz_path_set_winding(path, dir);
+  else if(enif_is_identical(tup[0], ATOM_ARC) && arity == 7 &&
+          vz_get_floats(env, tup + 1, 5, a) && vz_get_winding(tup[6], &dir))
+    vz_path_arc(path, a[0], a[1], a[2], a[3], a[4], dir);
+  else if(!vz_get_floats(env, tup + 1, arity - 1, a) || arity > 9)
+    return false;
+  else if(enif_is_identical(tup[0], ATOM_MOVE_TO) && arity == 3)
+    vz_path_move_to(path, a[0], a[1]);
+  else if(enif_is_identical(tup[0], ATOM_LINE_TO) && arity == 3)
+    vz_path_line_to(path, a[0], a[1]);
+  else if(enif_is_identical(tup[0], ATOM_BEZIER_TO) && arity == 7)
+    vz_path_bezier_to(path, a[0], a[1], a[2], a[3], a[4], a[5]);
+  else if(enif_is_identical(tup[0], ATOM_QUAD_TO) && arity == 5)
+    vz_path_quad_to(path, a[0], a[1], a[2], a[3]);
+  else if(enif_is_identical(tup[0], ATOM_ARC_TO) && arity == 6)
+    vz_path_arc_to(path, a[0], a[1], a[2], a[3], a[4]);
+  else if(enif_is_identical(tup[0], ATOM_RECT) && arity == 5)
+    vz_path_rect(path, a[0], a[1], a[2], a[3]);
+  else if(enif_is_identical(tup[0], ATOM_ROUNDED_RECT) && arity == 6)
+    vz_path_rounded_rect_varying(path, a[0], a[1], a[2], a[3], a[4], a[4], a[4], a[4]);
+  else if(enif_is_identical(tup[0], ATOM_ROUNDED_RECT_VARYING) && arity == 9)
+    vz_path_rounded_rect_varying(path, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+  else if(enif_is_identical(tup[0], ATOM_ELLIPSE) && arity == 5)
+    vz_path_ellipse(path, a[0], a[1], a[2], a[3]);
+  else if(enif_is_identical(tup[0], ATOM_CIRCLE) && arity == 4)
+    vz_path_ellipse(path, a[0], a[1], a[2], a[2]);
+  else return false;
+
+  return true;
+}
+
+/*
+  Builds a path from a list of commands, or from a binary of native floats
+  holding opcodes followed by their arguments.
+*/
+static ERL_NIF_TERM vz_path_new(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  ERL_NIF_TERM list, head, tail;
+  ErlNifBinary bin;
+  VZpath *path;
+
+  if(argc != 1)
+    return BADARG;
+
+  if(!(path = vz_alloc_path()))
+    return BADARG;
+
+  if(enif_inspect_binary(env, argv[0], &bin)) {
+    if(bin.size % sizeof(float) != 0 ||
+       !vz_path_append_packed(path, (const float*)bin.data, bin.size / sizeof(float)))
+      goto err;
+  }
+  else if(enif_is_list(env, argv[0])) {
+    list = argv[0];
+    while(enif_get_list_cell(env, list, &head, &tail)) {
+      list = tail;
+      if(!vz_handle_path_command(env, head, path))
+        goto err;
+    }
+  }
+  else goto err;
+
+  return vz_make_resource(env, path);
+
+  err:
+  enif_release_resource(path);
+  return BADARG;
+}
+
+/*
+  Draw ops keep the path alive until they are executed.
+*/
+VZ_ASYNC_DECL(
+  vz_fill_path,
+  {
+    VZpath *path;
+  },
+  {
+    nvgBeginPath(ctx);
+    vz_path_draw(args->path, ctx, (float)vz_view->pixel_ratio);
+    nvgFill(ctx);
+    enif_release_resource(args->path);
+  },
+  {
+    if(!(argc == 2 &&
+        enif_get_resource(env, argv[1], vz_path_res, (void**)&args->path))) {
+      goto err;
+    }
+    enif_keep_resource(args->path);
+  }
+);
+
+VZ_ASYNC_DECL(
+  vz_stroke_path,
+  {
+    VZpath *path;
+  },
+  {
+    nvgBeginPath(ctx);
+    vz_path_draw(args->path, ctx, (float)vz_view->pixel_ratio);
+    nvgStroke(ctx);
+    enif_release_resource(args->path);
+  },
+  {
+    if(!(argc == 2 &&
+        enif_get_resource(env, argv[1], vz_path_res, (void**)&args->path))) {
+      goto err;
+    }
+    enif_keep_resource(args->path);
+  }
+);
+
+static bool vz_handle_svg_opts(ErlNifEnv *env, ERL_NIF_TERM opts, NVGcolor *current_color) {
+  ERL_NIF_TERM head, tail;
+  const ERL_NIF_TERM *tup_array;
+  int tup_arity = 0;
+
+  *current_color = nvgRGBA(0, 0, 0, 255);
+
+  while(enif_get_list_cell(env, opts, &head, &tail)) {
+    opts = tail;
+
+    if(!(enif_get_tuple(env, head, &tup_arity, &tup_array) && tup_arity == 2))
+      return false;
+
+    if(enif_is_identical(tup_array[0], ATOM_CURRENT_COLOR) &&
+       !vz_get_color(env, tup_array[1], current_color))
+      return false;
+  }
+  return true;
+}
+
+static ERL_NIF_TERM vz_make_svg(ErlNifEnv* env, char *data, NVGcolor current_color) {
+  VZsvg *svg;
+
+  if(!(svg = vz_alloc_svg()))
+    return BADARG;
+
+  if(!vz_svg_parse(svg, data, current_color)) {
+    enif_release_resource(svg);
+    return BADARG;
+  }
+
+  return vz_make_resource(env, svg);
+}
+
+/*
+  Imports an SVG file, runs on a dirty IO scheduler.
+*/
+static ERL_NIF_TERM vz_svg_load(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  char file_path[VZ_MAX_STRING_LENGTH];
+  NVGcolor current_color;
+  ERL_NIF_TERM ret;
+  char *data;
+  long size;
+  FILE *file;
+
+  if(!(argc == 2 &&
+       vz_copy_string(env, argv[0], file_path, VZ_MAX_STRING_LENGTH) &&
+       vz_handle_svg_opts(env, argv[1], &current_color))) {
+    return BADARG;
+  }
+
+  if(!(file = fopen(file_path, "rb")))
+    return BADARG;
+
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if(size < 0) {
+    fclose(file);
+    return BADARG;
+  }
+
+  data = (char*)enif_alloc((size_t)size + 1);
+  if(fread(data, 1, (size_t)size, file) != (size_t)size) {
+    fclose(file);
+    enif_free(data);
+    return BADARG;
+  }
+  fclose(file);
+  data[size] = '\0';
+
+  ret = vz_make_svg(env, data, current_color);
+  enif_free(data);
+
+  return ret;
+}
+
+/*
+  Imports an SVG document in memory, runs on a dirty CPU scheduler.
+*/
+static ERL_NIF_TERM vz_svg_load_binary(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  NVGcolor current_color;
+  ERL_NIF_TERM ret;
+  ErlNifBinary bin;
+  char *data;
+
+  if(!(argc == 2 &&
+       enif_inspect_binary(env, argv[0], &bin) &&
+       vz_handle_svg_opts(env, argv[1], &current_color))) {
+    return BADARG;
+  }
+
+  // the parser works in place on a nul terminated copy
+  data = (char*)enif_alloc(bin.size + 1);
+  memcpy(data, bin.data, bin.size);
+  data[bin.size] = '\0';
+
+  ret = vz_make_svg(env, data, current_color);
+  enif_free(data);
+
+  return ret;
+}
+
+static ERL_NIF_TERM vz_svg_size(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]) {
+  VZsvg *svg;
+
+  if(!(argc == 1 &&
+       enif_get_resource(env, argv[0], vz_svg_res, (void**)&svg))) {
+    return BADARG;
+  }
+
+  return enif_make_tuple2(env, enif_make_double(env, svg->view_box[2]), enif_make_double(env, svg->view_box[3]));
+}
+
+/*
+  Draws the view box of a document into a rectangle, like draw_image.
+*/
+VZ_ASYNC_DECL(
+  vz_draw_svg,
+  {
+    double x;
+    double y;
+    double width;
+    double height;
+    double alpha;
+    VZsvg *svg;
+    int mode;
+  },
+  {
+    const float *view_box = args->svg->view_box;
+    double sx = args->width / view_box[2];
+    double sy = args->height / view_box[3];
+    double f;
+    nvgSave(ctx);
+    if(args->mode == VZ_KEEP_ASPECT_RATIO) {
+      f = MIN(sx, sy);
+      nvgTranslate(ctx, args->x + (args->width - f * view_box[2]) / 2, args->y + (args->height - f * view_box[3]) / 2);
+      nvgScale(ctx, f, f);
+    }
+    else /* VZ_FILL */ {
+      nvgTranslate(ctx, args->x, args->y);
+      nvgScale(ctx, sx, sy);
+    }
+    nvgTranslate(ctx, -view_box[0], -view_box[1]);
+    vz_svg_draw(args->svg, ctx, (float)vz_view->pixel_ratio, (float)args->alpha);
+    nvgRestore(ctx);
+    enif_release_resource(args->svg);
+  },
+  {
+    if(!(argc == 7 &&
+       enif_get_resource(env, argv[5], vz_svg_res, (void**)&args->svg) &&
+       enif_is_list(env, argv[6]))) {
+      goto err;
+    }
+
+    VZ_GET_NUMBER(env, argv[1], args->x);
+    VZ_GET_NUMBER(env, argv[2], args->y);
+    VZ_GET_NUMBER(env, argv[3], args->width);
+    VZ_GET_NUMBER(env, argv[4], args->height);
+    vz_handle_draw_image_opts(env, argv[6], &args->alpha, &args->mode);
+    enif_keep_resource(args->svg);
+  }
+);
+
 VZ_ASYNC_DECL(
   vz_fill,
   {
@@ -1923,26 +3271,139 @@ VZ_ASYNC_DECL(
   }
 );
 
+#define VZ_MAX_PREWARM_SIZES 8
+
+typedef struct VZfont_opts {
+  bool sdf;
+  char *prewarm;
+  size_t prewarm_length;
+  double sizes[VZ_MAX_PREWARM_SIZES];
+  unsigned size_count;
+} VZfont_opts;
+
+static bool vz_handle_font_opts(ErlNifEnv *env, ERL_NIF_TERM opts, VZfont_opts *font_opts) {
+  ERL_NIF_TERM head, tail, list;
+  const ERL_NIF_TERM *tup_array;
+  int tup_arity = 0;
+  ErlNifBinary bin;
+
+  font_opts->sdf = false;
+  font_opts->prewarm = NULL;
+  font_opts->prewarm_length = 0;
+  font_opts->size_count = 0;
+
+  while(enif_get_list_cell(env, opts, &head, &tail)) {
+    opts = tail;
+
+    if(!(enif_get_tuple(env, head, &tup_arity, &tup_array) && tup_arity == 2))
+      goto err;
+
+    if(enif_is_identical(tup_array[0], ATOM_SDF))
+      font_opts->sdf = enif_is_identical(tup_array[1], ATOM_TRUE);
+
+    if(enif_is_identical(tup_array[0], ATOM_PREWARM)) {
+      if(!enif_inspect_binary(env, tup_array[1], &bin))
+        goto err;
+      if(font_opts->prewarm)
+        enif_free(font_opts->prewarm);
+      font_opts->prewarm = (char*)enif_alloc(bin.size + 1);
+      memcpy(font_opts->prewarm, bin.data, bin.size);
+      font_opts->prewarm[bin.size] = 0;
+      font_opts->prewarm_length = bin.size;
+    }
+
+    if(enif_is_identical(tup_array[0], ATOM_SIZES)) {
+      list = tup_array[1];
+      font_opts->size_count = 0;
+      while(enif_get_list_cell(env, list, &head, &list)) {
+        if(font_opts->size_count == VZ_MAX_PREWARM_SIZES)
+          goto err;
+        VZ_GET_NUMBER(env, head, font_opts->sizes[font_opts->size_count]);
+        ++font_opts->size_count;
+      }
+    }
+  }
+  return true;
+
+  err:
+  if(font_opts->prewarm)
+    enif_free(font_opts->prewarm);
+  return false;
+}
+
+/*
+  Rasterizes the glyphs of a string at the sizes they will be drawn, so the
+  first frames that draw it don't. SDF fonts rasterize glyphs once for all
+  sizes, other fonts are drawn invisibly at each size to fill the atlas of
+  NanoVG.
+*/
+static void vz_prewarm_font(VZview *vz_view, int handle, const VZfont_opts *font_opts) {
+  NVGcontext *ctx = vz_view->ctx;
+  const char *end = font_opts->prewarm + font_opts->prewarm_length;
+  VZsdf_font *font;
+
+  if((font = vz_sdf_find_font(&vz_view->sdf, handle))) {
+    vz_sdf_prewarm(&vz_view->sdf, font, font_opts->prewarm, end);
+    return;
+  }
+
+  nvgSave(ctx);
+  nvgResetTransform(ctx);
+  nvgResetScissor(ctx);
+  nvgGlobalAlpha(ctx, 0.0f);
+  nvgFontFaceId(ctx, handle);
+  if(font_opts->size_count) {
+    for(unsigned i = 0; i < font_opts->size_count; ++i) {
+      nvgFontSize(ctx, (float)font_opts->sizes[i]);
+      nvgText(ctx, 0.0f, 0.0f, font_opts->prewarm, end);
+    }
+  }
+  else nvgText(ctx, 0.0f, 0.0f, font_opts->prewarm, end);
+  nvgRestore(ctx);
+}
+
+/*
+  A font that is already loaded is returned as it is, unless it has to be
+  made an SDF font, which reads its data from the asset it was created from.
+*/
 VZ_ASYNC_DECL(
   vz_create_font,
   {
     char file_path[VZ_MAX_STRING_LENGTH];
+    VZfont_opts opts;
   },
   {
     VZfont *font;
+    VZasset *asset;
     int handle;
 
-    if((handle = nvgFindFont(ctx, args->file_path)) < 0) {
-      handle = nvgCreateFont(ctx, args->file_path, args->file_path);
+    handle = nvgFindFont(ctx, args->file_path);
+    if((handle < 0 || (args->opts.sdf && !vz_sdf_find_font(&vz_view->sdf, handle))) &&
+       (asset = vz_asset_acquire(vz_view->assets, VZ_ASSET_FONT, args->file_path, NULL))) {
+      // the font data is shared with other views, NanoVG must not free it
+      if(handle < 0)
+        handle = nvgCreateFontMem(ctx, args->file_path, asset->data, (int)asset->size, 0);
+      if(handle < 0)
+        vz_asset_release(asset);
+      else {
+        vz_asset_ref_push(&vz_view->font_assets, asset);
+        if(args->opts.sdf && !vz_sdf_add_font(&vz_view->sdf, handle, asset->data))
+          handle = -1;
+      }
     }
+    if(handle >= 0 && args->opts.prewarm)
+      vz_prewarm_font(vz_view, handle, &args->opts);
+    if(args->opts.prewarm)
+      enif_free(args->opts.prewarm);
     if(handle < 0) VZ_HANDLER_SEND_BADARG;
 
     font = vz_alloc_font(vz_view, handle, args->file_path);
     VZ_HANDLER_SEND(vz_make_resource(vz_view->msg_env, font));
   },
   {
-    if(!(argc == 2 &&
-        vz_copy_string(env, argv[1], args->file_path, VZ_MAX_STRING_LENGTH))) {
+    if(!(argc == 3 &&
+        vz_copy_string(env, argv[1], args->file_path, VZ_MAX_STRING_LENGTH) &&
+        vz_handle_font_opts(env, argv[2], &args->opts))) {
       goto err;
     }
     execute = true;
@@ -2006,6 +3467,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgFontSize(ctx, args->size);
+    vz_sdf_state(&vz_view->sdf)->size = (float)args->size;
   },
   {
     if(argc != 2) goto err;
@@ -2021,6 +3483,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgFontBlur(ctx, args->blur);
+    vz_sdf_state(&vz_view->sdf)->blur = (float)args->blur;
   },
   {
     if(argc != 2) goto err;
@@ -2036,6 +3499,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgTextLetterSpacing(ctx, args->spacing);
+    vz_sdf_state(&vz_view->sdf)->spacing = (float)args->spacing;
   },
   {
     if(argc != 2) goto err;
@@ -2051,6 +3515,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgTextLineHeight(ctx, args->line_height);
+    vz_sdf_state(&vz_view->sdf)->line_height = (float)args->line_height;
   },
   {
     if(argc != 2) goto err;
@@ -2066,6 +3531,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgTextAlign(ctx, args->align);
+    vz_sdf_state(&vz_view->sdf)->align = args->align;
   },
   {
     if(!(argc == 2 &&
@@ -2082,6 +3548,7 @@ VZ_ASYNC_DECL(
   },
   {
     nvgFontFaceId(ctx, args->handle);
+    vz_sdf_font_face(&vz_view->sdf, args->handle);
   },
   {
     VZfont *font;
@@ -2108,7 +3575,10 @@ VZ_ASYNC_DECL(
   {
     double ex;
 
-    ex = nvgText(ctx, args->x, args->y, args->string, args->end);
+    if(vz_sdf_state(&vz_view->sdf)->font)
+      ex = vz_sdf_text(vz_view, args->x, args->y, args->string, args->end);
+    else
+      ex = nvgText(ctx, args->x, args->y, args->string, args->end);
     enif_free(args->string);
     VZ_HANDLER_SEND(enif_make_double(vz_view->msg_env, ex));
   },
@@ -2141,7 +3611,10 @@ VZ_ASYNC_DECL(
     char *end;
   },
   {
-    nvgTextBox(ctx, args->x, args->y, args->break_row_width, args->string, args->end);
+    if(vz_sdf_state(&vz_view->sdf)->font)
+      vz_sdf_text_box(vz_view, args->x, args->y, args->break_row_width, args->string, args->end);
+    else
+      nvgTextBox(ctx, args->x, args->y, args->break_row_width, args->string, args->end);
     enif_free(args->string);
   },
   {
@@ -2382,19 +3855,31 @@ NIF boiler plate
 
 static int vz_load(ErlNifEnv* env, void** priv_data, ERL_NIF_TERM load_info)
 {
-  __UNUSED(load_info);
+  int render_threads;
+
+  if(!enif_get_int(env, load_info, &render_threads))
+    render_threads = 0;
 
-  VZpriv *priv = vz_alloc_priv();
+  VZpriv *priv = vz_alloc_priv(render_threads);
   *priv_data = priv;
 
   ErlNifResourceFlags flags = ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER;
   vz_view_res = enif_open_resource_type(env, NULL, "vz_view_res", vz_view_dtor, flags, NULL);
   vz_image_res = enif_open_resource_type(env, NULL, "vz_image_res", vz_image_dtor, flags, NULL);
+  vz_asset_res = enif_open_resource_type(env, NULL, "vz_asset_res", vz_asset_handle_dtor, flags, NULL);
   vz_font_res = enif_open_resource_type(env, NULL, "vz_font_res", NULL, flags, NULL);
+  vz_node_res = enif_open_resource_type(env, NULL, "vz_node_res", vz_node_dtor, flags, NULL);
   vz_paint_res = enif_open_resource_type(env, NULL, "vz_paint_res", NULL, flags, NULL);
   vz_matrix_res = enif_open_resource_type(env, NULL, "vz_matrix_res", NULL, flags, NULL);
+  vz_path_res = enif_open_resource_type(env, NULL, "vz_path_res", vz_path_dtor, flags, NULL);
+  vz_svg_res = enif_open_resource_type(env, NULL, "vz_svg_res", vz_svg_dtor, flags, NULL);
 
   vz_make_atoms(env);
+  vz_pixels_init();
+  // the stb_image settings are globals, images are decoded on dirty
+  // schedulers concurrently, so they are set once, as nvgCreateImage does
+  stbi_set_unpremultiply_on_load(1);
+  stbi_convert_iphone_png_to_rgb(1);
 
   return 0;
 }
@@ -2417,8 +3902,19 @@ static ErlNifFunc nif_funcs[] =
     {"ready", 1, vz_ready},
     {"redraw", 1, vz_redraw},
     {"get_frame_rate", 1, vz_get_frame_rate},
+    {"get_stats", 1, vz_get_stats},
     {"force_send_events", 1, vz_force_send_events},
-    {"setup_node", 3, vz_setup_node},
+    {"create_node", 1, vz_create_node},
+    {"sync_node", 3, vz_sync_node},
+    {"update_transforms", 1, vz_update_transforms},
+    {"hit_test", 3, vz_hit_test},
+    {"setup_node", 2, vz_setup_node},
+    {"damage_node", 2, vz_damage_node},
+    {"damage_subtrees", 2, vz_damage_subtrees},
+    {"layer_invalidate", 2, vz_layer_invalidate},
+    {"layer_begin", 2, vz_layer_begin},
+    {"layer_end", 1, vz_layer_end},
+    {"layer_draw", 2, vz_layer_draw},
     {"global_composite_operation", 2, vz_global_composite_operation},
     {"global_composite_blend_func", 3, vz_global_composite_blend_func},
     {"global_composite_blend_func_separate", 5, vz_global_composite_blend_func_separate},
@@ -2456,14 +3952,31 @@ static ErlNifFunc nif_funcs[] =
     {"transform_premultiply", 2, vz_transform_premultiply},
     {"transform_inverse", 1, vz_transform_inverse},
     {"transform_point", 3, vz_transform_point},
+    {"transform_compose", 1, vz_transform_compose},
     {"matrix_to_list", 1, vz_matrix_to_list},
     {"list_to_matrix", 1, vz_list_to_matrix},
     {"deg_to_rad", 1, vz_deg_to_rad},
     {"rad_to_deg", 1, vz_rad_to_deg},
-    {"image_file_to_binary", 1, vz_image_file_to_binary},
-    {"image_from_file", 3, vz_image_from_file},
-    {"image_from_binary", 5, vz_image_from_binary},
-    {"image_update_from_binary", 3, vz_image_update_from_binary},
+    {"image_file_to_binary", 2, vz_image_file_to_binary, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"image_decode", 2, vz_image_decode, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_load", 2, vz_image_load, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"image_load_binary", 2, vz_image_load_binary, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_from_asset", 3, vz_image_from_asset},
+    {"image_premultiply", 1, vz_image_premultiply, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_unpremultiply", 1, vz_image_unpremultiply, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_swizzle", 2, vz_image_swizzle, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_rgb_to_rgba", 1, vz_image_rgb_to_rgba, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_grayscale", 1, vz_image_grayscale, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_lut", 2, vz_image_lut, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_pixel_isa", 0, vz_image_pixel_isa},
+    {"image_from_binary", 5, vz_image_from_binary, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_stream", 4, vz_image_stream},
+    {"image_update_from_binary", 3, vz_image_update_from_binary, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_video", 4, vz_image_video},
+    {"image_update_video", 3, vz_image_update_video, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_heatmap", 5, vz_image_heatmap},
+    {"image_update_heatmap", 4, vz_image_update_heatmap, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"image_heatmap_colormap", 3, vz_image_heatmap_colormap},
     {"image_size", 2, vz_image_size},
     {"image_delete", 2, vz_image_delete},
     {"linear_gradient", 7, vz_linear_gradient},
@@ -2489,7 +4002,14 @@ static ErlNifFunc nif_funcs[] =
     {"circle", 4, vz_circle},
     {"fill", 1, vz_fill},
     {"stroke", 1, vz_stroke},
-    {"create_font", 2, vz_create_font},
+    {"path_new", 1, vz_path_new},
+    {"fill_path", 2, vz_fill_path},
+    {"stroke_path", 2, vz_stroke_path},
+    {"svg_load", 2, vz_svg_load, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"svg_load_binary", 2, vz_svg_load_binary, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"svg_size", 1, vz_svg_size},
+    {"draw_svg", 7, vz_draw_svg},
+    {"create_font", 3, vz_create_font},
     {"find_font", 2, vz_find_font},
     {"add_fallback_font", 3, vz_add_fallback_font},
     {"font_size", 2, vz_font_size},
@@ -0,0 +1,536 @@
+#include "vz_helpers.h"
+#include "vz_nodes.h"
+
+#include "nanovg.h"
+
+#include <erl_nif.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define VZ_SIMD_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VZ_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+
+/*
+  2x3 affine multiply: dst = a * b, meaning that a point is first transformed
+  by a and then by b. Same semantics as nvgTransformMultiply, dst may alias a or b.
+*/
+void vz_xform_multiply(float *dst, const float *a, const float *b) {
+#if defined(VZ_SIMD_SSE)
+  __m128 a03 = _mm_loadu_ps(a);
+  __m128 b03 = _mm_loadu_ps(b);
+  __m128 a45 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(a + 4));
+  __m128 b45 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(b + 4));
+  __m128 b01 = _mm_movelh_ps(b03, b03);
+  __m128 b23 = _mm_movehl_ps(b03, b03);
+  __m128 ae = _mm_shuffle_ps(a03, a03, _MM_SHUFFLE(2, 2, 0, 0));
+  __m128 ao = _mm_shuffle_ps(a03, a03, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128 a4 = _mm_shuffle_ps(a45, a45, _MM_SHUFFLE(0, 0, 0, 0));
+  __m128 a5 = _mm_shuffle_ps(a45, a45, _MM_SHUFFLE(1, 1, 1, 1));
+  __m128 r03 = _mm_add_ps(_mm_mul_ps(ae, b01), _mm_mul_ps(ao, b23));
+  __m128 r45 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a4, b01), _mm_mul_ps(a5, b23)), b45);
+  _mm_storeu_ps(dst, r03);
+  _mm_storel_pi((__m64*)(dst + 4), r45);
+#elif defined(VZ_SIMD_NEON)
+  float32x2_t b01 = vld1_f32(b);
+  float32x2_t b23 = vld1_f32(b + 2);
+  float32x2_t b45 = vld1_f32(b + 4);
+  float32x2_t r01 = vmla_n_f32(vmul_n_f32(b01, a[0]), b23, a[1]);
+  float32x2_t r23 = vmla_n_f32(vmul_n_f32(b01, a[2]), b23, a[3]);
+  float32x2_t r45 = vadd_f32(vmla_n_f32(vmul_n_f32(b01, a[4]), b23, a[5]), b45);
+  vst1_f32(dst, r01);
+  vst1_f32(dst + 2, r23);
+  vst1_f32(dst + 4, r45);
+#else
+  float t0 = a[0] * b[0] + a[1] * b[2];
+  float t1 = a[0] * b[1] + a[1] * b[3];
+  float t2 = a[2] * b[0] + a[3] * b[2];
+  float t3 = a[2] * b[1] + a[3] * b[3];
+  float t4 = a[4] * b[0] + a[5] * b[2] + b[4];
+  float t5 = a[4] * b[1] + a[5] * b[3] + b[5];
+  dst[0] = t0; dst[1] = t1; dst[2] = t2;
+  dst[3] = t3; dst[4] = t4; dst[5] = t5;
+#endif
+}
+
+#define VZ_GROW(field, type, size) \
+  store->field = (type*)enif_realloc(store->field, (size) * sizeof(type))
+
+static void vz_node_store_grow(VZnode_store *store, unsigned size) {
+  VZ_GROW(free_ids, int, size);
+  VZ_GROW(x, float, size);
+  VZ_GROW(y, float, size);
+  VZ_GROW(width, float, size);
+  VZ_GROW(height, float, size);
+  VZ_GROW(scale_x, float, size);
+  VZ_GROW(scale_y, float, size);
+  VZ_GROW(skew_x, float, size);
+  VZ_GROW(skew_y, float, size);
+  VZ_GROW(rotate, float, size);
+  VZ_GROW(alpha, float, size);
+  VZ_GROW(parent, int, size);
+  VZ_GROW(visited, unsigned, size);
+  VZ_GROW(updated, unsigned, size);
+  VZ_GROW(flags, unsigned char, size);
+  VZ_GROW(local, float, size * 6);
+  VZ_GROW(world, float, size * 6);
+  VZ_GROW(aabb, float, size * 4);
+  VZ_GROW(cells, int, size * 4);
+  VZ_GROW(hit_ids, int, size);
+  VZ_GROW(hit_pos, float, size * 2);
+  store->size = size;
+}
+
+static inline void vz_box_reset(float *box) {
+  box[0] = box[1] = FLT_MAX;
+  box[2] = box[3] = -FLT_MAX;
+}
+
+static inline bool vz_box_is_empty(const float *box) {
+  return !(box[2] > box[0] && box[3] > box[1]);
+}
+
+static inline void vz_box_union(float *dst, const float *box) {
+  dst[0] = MIN(dst[0], box[0]);
+  dst[1] = MIN(dst[1], box[1]);
+  dst[2] = MAX(dst[2], box[2]);
+  dst[3] = MAX(dst[3], box[3]);
+}
+
+static inline bool vz_box_overlaps(const float *a, const float *b) {
+  return a[2] > b[0] && a[3] > b[1] && a[0] < b[2] && a[1] < b[3];
+}
+
+static inline void vz_node_add_damage(VZnode_store *store, int id) {
+  const float *b = &store->aabb[id * 4];
+
+  if(!vz_box_is_empty(b) && isfinite(b[0]) && isfinite(b[1]) && isfinite(b[2]) && isfinite(b[3]))
+    vz_box_union(store->damage, b);
+}
+
+VZnode_store* vz_node_store_new(unsigned initial_size) {
+  VZnode_store *store = (VZnode_store*)enif_alloc(sizeof(VZnode_store));
+
+  memset(store, 0, sizeof(VZnode_store));
+  vz_node_store_grow(store, initial_size);
+  nvgTransformIdentity(store->root_xform);
+  vz_box_reset(store->damage);
+
+  return store;
+}
+
+void vz_node_store_free(VZnode_store *store) {
+  enif_free(store->free_ids);
+  enif_free(store->x);
+  enif_free(store->y);
+  enif_free(store->width);
+  enif_free(store->height);
+  enif_free(store->scale_x);
+  enif_free(store->scale_y);
+  enif_free(store->skew_x);
+  enif_free(store->skew_y);
+  enif_free(store->rotate);
+  enif_free(store->alpha);
+  enif_free(store->parent);
+  enif_free(store->visited);
+  enif_free(store->updated);
+  enif_free(store->flags);
+  enif_free(store->local);
+  enif_free(store->world);
+  enif_free(store->aabb);
+  enif_free(store->cells);
+  enif_free(store->hit_ids);
+  enif_free(store->hit_pos);
+  for(unsigned i = 0; i < VZ_GRID_BUCKETS; ++i)
+    enif_free(store->buckets[i].ids);
+  enif_free(store->large.ids);
+  enif_free(store);
+}
+
+static void vz_bucket_push(VZnode_bucket *bucket, int id) {
+  if(bucket->count == bucket->size) {
+    bucket->size = bucket->size ? bucket->size * 2 : 8;
+    bucket->ids = (int*)enif_realloc(bucket->ids, bucket->size * sizeof(int));
+  }
+  bucket->ids[bucket->count++] = id;
+}
+
+static void vz_bucket_remove(VZnode_bucket *bucket, int id) {
+  for(unsigned i = 0; i < bucket->count; ++i) {
+    if(bucket->ids[i] == id) {
+      bucket->ids[i] = bucket->ids[--bucket->count];
+      return;
+    }
+  }
+}
+
+static inline VZnode_bucket* vz_grid_bucket(VZnode_store *store, int cx, int cy) {
+  unsigned h = ((unsigned)cx * 73856093u) ^ ((unsigned)cy * 19349663u);
+  return &store->buckets[h & (VZ_GRID_BUCKETS - 1)];
+}
+
+static inline int vz_grid_coord(float v) {
+  return (int)floorf(v / VZ_GRID_CELL_SIZE);
+}
+
+static void vz_grid_remove(VZnode_store *store, int id) {
+  const int *c = &store->cells[id * 4];
+
+  if(!(store->flags[id] & VZ_NODE_IN_GRID))
+    return;
+
+  if(store->flags[id] & VZ_NODE_LARGE) {
+    vz_bucket_remove(&store->large, id);
+  }
+  else {
+    for(int cy = c[1]; cy <= c[3]; ++cy)
+      for(int cx = c[0]; cx <= c[2]; ++cx)
+        vz_bucket_remove(vz_grid_bucket(store, cx, cy), id);
+  }
+
+  store->flags[id] &= ~(VZ_NODE_IN_GRID | VZ_NODE_LARGE);
+}
+
+static void vz_grid_update(VZnode_store *store, int id) {
+  const float *b = &store->aabb[id * 4];
+  int *c = &store->cells[id * 4];
+  int c0, c1, c2, c3;
+
+  if(!(isfinite(b[0]) && isfinite(b[1]) && isfinite(b[2]) && isfinite(b[3]) &&
+       fabsf(b[0]) < 1e8f && fabsf(b[1]) < 1e8f && fabsf(b[2]) < 1e8f && fabsf(b[3]) < 1e8f)) {
+    vz_grid_remove(store, id);
+    return;
+  }
+
+  c0 = vz_grid_coord(b[0]);
+  c1 = vz_grid_coord(b[1]);
+  c2 = vz_grid_coord(b[2]);
+  c3 = vz_grid_coord(b[3]);
+
+  if((store->flags[id] & VZ_NODE_IN_GRID) &&
+     c[0] == c0 && c[1] == c1 && c[2] == c2 && c[3] == c3)
+    return;
+
+  vz_grid_remove(store, id);
+  c[0] = c0; c[1] = c1; c[2] = c2; c[3] = c3;
+
+  if((long)(c2 - c0 + 1) * (long)(c3 - c1 + 1) > VZ_GRID_MAX_CELLS) {
+    vz_bucket_push(&store->large, id);
+    store->flags[id] |= VZ_NODE_LARGE;
+  }
+  else {
+    for(int cy = c1; cy <= c3; ++cy)
+      for(int cx = c0; cx <= c2; ++cx)
+        vz_bucket_push(vz_grid_bucket(store, cx, cy), id);
+  }
+
+  store->flags[id] |= VZ_NODE_IN_GRID;
+}
+
+static void vz_node_compute_aabb(VZnode_store *store, int id) {
+  const float *t = &store->world[id * 6];
+  float *b = &store->aabb[id * 4];
+  float w = store->width[id], h = store->height[id];
+  float xs[4], ys[4];
+
+  xs[0] = t[4];                      ys[0] = t[5];
+  xs[1] = t[0] * w + t[4];           ys[1] = t[1] * w + t[5];
+  xs[2] = t[2] * h + t[4];           ys[2] = t[3] * h + t[5];
+  xs[3] = t[0] * w + t[2] * h + t[4]; ys[3] = t[1] * w + t[3] * h + t[5];
+
+  b[0] = MIN(MIN(xs[0], xs[1]), MIN(xs[2], xs[3]));
+  b[1] = MIN(MIN(ys[0], ys[1]), MIN(ys[2], ys[3]));
+  b[2] = MAX(MAX(xs[0], xs[1]), MAX(xs[2], xs[3]));
+  b[3] = MAX(MAX(ys[0], ys[1]), MAX(ys[2], ys[3]));
+}
+
+int vz_node_store_alloc(VZnode_store *store) {
+  int id;
+
+  if(store->free_count > 0) {
+    id = store->free_ids[--store->free_count];
+  }
+  else {
+    if(store->count == store->size)
+      vz_node_store_grow(store, store->size * 2);
+    id = store->count++;
+  }
+
+  store->flags[id] = VZ_NODE_USED | VZ_NODE_LOCAL_DIRTY;
+  store->parent[id] = VZ_NODE_ROOT;
+  store->visited[id] = 0;
+  store->updated[id] = 0;
+  store->x[id] = 0.f;
+  store->y[id] = 0.f;
+  store->width[id] = 0.f;
+  store->height[id] = 0.f;
+  store->scale_x[id] = 1.f;
+  store->scale_y[id] = 1.f;
+  store->skew_x[id] = 0.f;
+  store->skew_y[id] = 0.f;
+  store->rotate[id] = 0.f;
+  store->alpha[id] = 1.f;
+  nvgTransformIdentity(&store->local[id * 6]);
+  nvgTransformIdentity(&store->world[id * 6]);
+  memset(&store->aabb[id * 4], 0, sizeof(float) * 4);
+
+  return id;
+}
+
+void vz_node_store_release(VZnode_store *store, int id) {
+  if(id < 0 || (unsigned)id >= store->count || !(store->flags[id] & VZ_NODE_USED))
+    return;
+
+  vz_node_add_damage(store, id);
+  vz_grid_remove(store, id);
+  store->flags[id] = 0;
+  store->free_ids[store->free_count++] = id;
+}
+
+void vz_node_store_set(VZnode_store *store, int id, int parent, const float *attrs) {
+  store->parent[id] = parent;
+  store->x[id] = attrs[0];
+  store->y[id] = attrs[1];
+  store->width[id] = attrs[2];
+  store->height[id] = attrs[3];
+  store->scale_x[id] = attrs[4];
+  store->scale_y[id] = attrs[5];
+  store->skew_x[id] = attrs[6];
+  store->skew_y[id] = attrs[7];
+  store->rotate[id] = attrs[8];
+  store->alpha[id] = attrs[9];
+  store->flags[id] |= VZ_NODE_LOCAL_DIRTY;
+}
+
+/*
+  Same composition as the scale, translate, rotate, translate, skew sequence
+  that used to be applied to the NanoVG context for every node.
+*/
+static void vz_node_compute_local(VZnode_store *store, int id) {
+  float t[6];
+  float *local = &store->local[id * 6];
+  float w2 = store->width[id] / 2.f;
+  float h2 = store->height[id] / 2.f;
+
+  nvgTransformScale(local, store->scale_x[id], store->scale_y[id]);
+  nvgTransformTranslate(t, store->x[id] + w2, store->y[id] + h2);
+  nvgTransformPremultiply(local, t);
+  nvgTransformRotate(t, store->rotate[id]);
+  nvgTransformPremultiply(local, t);
+  nvgTransformTranslate(t, -w2, -h2);
+  nvgTransformPremultiply(local, t);
+  nvgTransformSkewX(t, store->skew_x[id]);
+  nvgTransformPremultiply(local, t);
+  nvgTransformSkewY(t, store->skew_y[id]);
+  nvgTransformPremultiply(local, t);
+}
+
+static inline bool vz_node_is_used(VZnode_store *store, int id) {
+  return id >= 0 && (unsigned)id < store->count && (store->flags[id] & VZ_NODE_USED);
+}
+
+static void vz_node_update_one(VZnode_store *store, int id, bool root_dirty) {
+  unsigned pass = store->pass;
+  int parent = store->parent[id];
+  bool dirty = false;
+  const float *parent_world;
+
+  store->visited[id] = pass;
+
+  if(store->flags[id] & VZ_NODE_LOCAL_DIRTY) {
+    vz_node_compute_local(store, id);
+    store->flags[id] &= ~VZ_NODE_LOCAL_DIRTY;
+    dirty = true;
+  }
+
+  if(vz_node_is_used(store, parent)) {
+    // Parents normally have a lower id than their children, re-parented
+    // nodes are the exception and get their parent resolved first.
+    if(store->visited[parent] != pass)
+      vz_node_update_one(store, parent, root_dirty);
+    parent_world = &store->world[parent * 6];
+    dirty = dirty || store->updated[parent] == pass;
+  }
+  else {
+    parent_world = store->root_xform;
+    dirty = dirty || root_dirty;
+  }
+
+  if(dirty) {
+    vz_node_add_damage(store, id);
+    vz_xform_multiply(&store->world[id * 6], &store->local[id * 6], parent_world);
+    vz_node_compute_aabb(store, id);
+    vz_node_add_damage(store, id);
+    vz_grid_update(store, id);
+    store->updated[id] = pass;
+  }
+}
+
+void vz_node_store_update(VZnode_store *store, const float *root_xform) {
+  bool root_dirty = memcmp(store->root_xform, root_xform, sizeof(float) * 6) != 0;
+
+  if(root_dirty)
+    memcpy(store->root_xform, root_xform, sizeof(float) * 6);
+
+  // pass 0 marks nodes that were never visited
+  if(++store->pass == 0)
+    ++store->pass;
+
+  for(unsigned id = 0; id < store->count; ++id) {
+    if((store->flags[id] & VZ_NODE_USED) && store->visited[id] != store->pass)
+      vz_node_update_one(store, id, root_dirty);
+  }
+}
+
+bool vz_node_store_to_local(VZnode_store *store, int id, float x, float y, float *lx, float *ly) {
+  float inv[6];
+
+  if(!vz_node_is_used(store, id) || !nvgTransformInverse(inv, &store->world[id * 6]))
+    return false;
+
+  nvgTransformPoint(lx, ly, inv, x, y);
+
+  return true;
+}
+
+static inline unsigned vz_node_hit(VZnode_store *store, int id, float x, float y, unsigned n) {
+  const float *b = &store->aabb[id * 4];
+  float lx, ly;
+
+  if(x < b[0] || x > b[2] || y < b[1] || y > b[3])
+    return n;
+
+  // a node can be binned more than once in the same bucket
+  for(unsigned i = 0; i < n; ++i)
+    if(store->hit_ids[i] == id) return n;
+
+  if(vz_node_store_to_local(store, id, x, y, &lx, &ly) &&
+     lx >= 0.f && lx <= store->width[id] && ly >= 0.f && ly <= store->height[id]) {
+    store->hit_ids[n] = id;
+    store->hit_pos[n * 2] = lx;
+    store->hit_pos[n * 2 + 1] = ly;
+    ++n;
+  }
+
+  return n;
+}
+
+/*
+  Collects all nodes that contain the given world space point in
+  store->hit_ids, with the point in node space in store->hit_pos.
+  Returns the number of hits.
+*/
+unsigned vz_node_store_hit_test(VZnode_store *store, float x, float y) {
+  VZnode_bucket *bucket;
+  unsigned n = 0;
+
+  if(!(isfinite(x) && isfinite(y)))
+    return 0;
+
+  bucket = vz_grid_bucket(store, vz_grid_coord(x), vz_grid_coord(y));
+
+  for(unsigned i = 0; i < bucket->count; ++i)
+    n = vz_node_hit(store, bucket->ids[i], x, y, n);
+
+  for(unsigned i = 0; i < store->large.count; ++i)
+    n = vz_node_hit(store, store->large.ids[i], x, y, n);
+
+  return n;
+}
+
+/*
+  Marks nodes whose world AABB overlaps the clip box as visible. Nodes only clip
+  to their own bounds, so a subtree is visible when the node itself or any of
+  its descendants is. Writes store->count visibility bytes.
+*/
+void vz_node_store_cull(VZnode_store *store, const float *clip, unsigned char *visibility) {
+  memset(visibility, 0, store->count);
+
+  for(unsigned id = 0; id < store->count; ++id) {
+    const float *b = &store->aabb[id * 4];
+
+    if(!(store->flags[id] & VZ_NODE_USED) || vz_box_is_empty(b) || !vz_box_overlaps(b, clip))
+      continue;
+
+    visibility[id] |= VZ_NODE_VISIBLE;
+
+    for(int p = id; vz_node_is_used(store, p) && !(visibility[p] & VZ_NODE_SUBTREE_VISIBLE); p = store->parent[p])
+      visibility[p] |= VZ_NODE_SUBTREE_VISIBLE;
+  }
+}
+
+/*
+  Damages the current bounds of a node whose content changed.
+*/
+void vz_node_store_damage(VZnode_store *store, int id) {
+  if(vz_node_is_used(store, id))
+    vz_node_add_damage(store, id);
+}
+
+/*
+  Damages the bounds of the given nodes and all their descendants, used when
+  subtrees are removed from the tree before their nodes are released.
+*/
+void vz_node_store_damage_subtrees(VZnode_store *store, const int *ids, unsigned count) {
+  for(unsigned i = 0; i < count; ++i)
+    if(vz_node_is_used(store, ids[i]))
+      store->flags[ids[i]] |= VZ_NODE_MARKED;
+
+  for(unsigned id = 0; id < store->count; ++id) {
+    for(int p = id; vz_node_is_used(store, p); p = store->parent[p]) {
+      if(store->flags[p] & VZ_NODE_MARKED) {
+        vz_node_add_damage(store, id);
+        break;
+      }
+    }
+  }
+
+  for(unsigned i = 0; i < count; ++i)
+    if(vz_node_is_used(store, ids[i]))
+      store->flags[ids[i]] &= ~VZ_NODE_MARKED;
+}
+
+/*
+  Copies the damage collected since the last call to box and resets it.
+  Returns false when nothing was damaged.
+*/
+bool vz_node_store_take_damage(VZnode_store *store, float *box) {
+  bool damaged = !vz_box_is_empty(store->damage);
+
+  memcpy(box, store->damage, sizeof(float) * 4);
+  vz_box_reset(store->damage);
+
+  return damaged;
+}
+
+/*
+  The scissor of a rotated or skewed node can only be intersected with the
+  damage box approximately, so such nodes are redrawn completely and the box
+  grows to contain them.
+*/
+void vz_node_store_expand_damage(VZnode_store *store, float *box) {
+  bool changed = !vz_box_is_empty(box);
+
+  while(changed) {
+    changed = false;
+
+    for(unsigned id = 0; id < store->count; ++id) {
+      const float *b = &store->aabb[id * 4];
+      const float *t = &store->world[id * 6];
+
+      if(!(store->flags[id] & VZ_NODE_USED) || (t[1] == 0.f && t[2] == 0.f) ||
+         vz_box_is_empty(b) || !vz_box_overlaps(b, box) ||
+         (b[0] >= box[0] && b[1] >= box[1] && b[2] <= box[2] && b[3] <= box[3]))
+        continue;
+
+      vz_box_union(box, b);
+      changed = true;
+    }
+  }
+}
@@ -0,0 +1,103 @@
+#ifndef VZ_NODES_H_INCLUDED
+#define VZ_NODES_H_INCLUDED
+
+#include <stdbool.h>
+
+#define VZ_NODE_ATTRS 10
+#define VZ_NODE_ROOT -1
+
+#define VZ_GRID_CELL_SIZE 64.f
+#define VZ_GRID_BUCKETS 1024
+#define VZ_GRID_MAX_CELLS 256
+
+enum VZnode_flags {
+  VZ_NODE_USED = 1,
+  VZ_NODE_LOCAL_DIRTY = 2,
+  VZ_NODE_IN_GRID = 4,
+  VZ_NODE_LARGE = 8,
+  VZ_NODE_MARKED = 16
+};
+
+/*
+  Visibility flags reported per node id by vz_node_store_cull.
+*/
+enum VZnode_visibility {
+  VZ_NODE_VISIBLE = 1,
+  VZ_NODE_SUBTREE_VISIBLE = 2,
+  VZ_NODE_LAYER_VALID = 4
+};
+
+/*
+  Spatial index
+
+  World space AABBs are binned into a uniform grid of VZ_GRID_CELL_SIZE
+  cells, hashed into a fixed number of buckets. Nodes that would cover more
+  than VZ_GRID_MAX_CELLS cells are kept in a separate list that is checked
+  for every query.
+*/
+typedef struct VZnode_bucket {
+  int *ids;
+  unsigned count;
+  unsigned size;
+} VZnode_bucket;
+
+/*
+  Node transform store
+
+  Node attributes are kept in a structure of arrays indexed by node id.
+  Attributes are only written when a node changes, after which
+  vz_node_store_update computes all local and world transforms in a
+  single pass, parents before children.
+
+  The world AABBs of nodes that moved, changed or were released are merged
+  into a damage box, which is taken once per frame for partial redraws.
+*/
+typedef struct VZnode_store {
+  unsigned size;
+  unsigned count;
+  unsigned pass;
+  int *free_ids;
+  unsigned free_count;
+  float *x;
+  float *y;
+  float *width;
+  float *height;
+  float *scale_x;
+  float *scale_y;
+  float *skew_x;
+  float *skew_y;
+  float *rotate;
+  float *alpha;
+  int *parent;
+  unsigned *visited;
+  unsigned *updated;
+  unsigned char *flags;
+  float *local;
+  float *world;
+  float *aabb;
+  int *cells;
+  float root_xform[6];
+  float damage[4];
+  VZnode_bucket buckets[VZ_GRID_BUCKETS];
+  VZnode_bucket large;
+  int *hit_ids;
+  float *hit_pos;
+} VZnode_store;
+
+VZnode_store* vz_node_store_new(unsigned initial_size);
+void vz_node_store_free(VZnode_store *store);
+int vz_node_store_alloc(VZnode_store *store);
+void vz_node_store_release(VZnode_store *store, int id);
+void vz_node_store_set(VZnode_store *store, int id, int parent, const float *attrs);
+void vz_node_store_update(VZnode_store *store, const float *root_xform);
+bool vz_node_store_to_local(VZnode_store *store, int id, float x, float y, float *lx, float *ly);
+unsigned vz_node_store_hit_test(VZnode_store *store, float x, float y);
+void vz_node_store_cull(VZnode_store *store, const float *clip, unsigned char *visibility);
+void vz_node_store_damage(VZnode_store *store, int id);
+void vz_node_store_damage_subtrees(VZnode_store *store, const int *ids, unsigned count);
+bool vz_node_store_take_damage(VZnode_store *store, float *box);
+void vz_node_store_expand_damage(VZnode_store *store, float *box);
+
+void vz_xform_multiply(float *dst, const float *a, const float *b);
+
+#endif
@@ -0,0 +1,549 @@
+#include "vz_helpers.h"
+#include "vz_paths.h"
+
+#include <erl_nif.h>
+#include <math.h>
+#include <string.h>
+
+#define VZ_DIST_TOL 0.01f
+
+
+static const int vz_path_arg_counts[] = {2, 2, 6, 0, 1};
+
+static float* vz_path_buffer_reserve(VZpath_buffer *buf, size_t count) {
+  if(buf->count + count > buf->size) {
+    buf->size = MAX(buf->size * 2, buf->count + count);
+    if(buf->size < 64) buf->size = 64;
+    buf->data = (float*)enif_realloc(buf->data, buf->size * sizeof(float));
+  }
+  buf->count += count;
+
+  return buf->data + buf->count - count;
+}
+
+static void vz_path_buffer_free(VZpath_buffer *buf) {
+  if(buf->data)
+    enif_free(buf->data);
+  memset(buf, 0, sizeof(VZpath_buffer));
+}
+
+void vz_path_init(VZpath *path) {
+  memset(path, 0, sizeof(VZpath));
+  path->lock = enif_mutex_create("vz_path_lock");
+}
+
+void vz_path_free(VZpath *path) {
+  vz_path_buffer_free(&path->commands);
+  vz_path_buffer_free(&path->flat);
+  if(path->lock)
+    enif_mutex_destroy(path->lock);
+  path->lock = NULL;
+}
+
+/*
+  Appends commands, the current point is the end point of the last one that
+  has one, like the command position of NanoVG.
+*/
+static void vz_path_append(VZpath *path, const float *vals, size_t count) {
+  float *dst = vz_path_buffer_reserve(&path->commands, count);
+  size_t i = 0;
+
+  memcpy(dst, vals, count * sizeof(float));
+
+  while(i < count) {
+    int op = (int)vals[i];
+    int n = vz_path_arg_counts[op];
+    if(op == VZ_PATH_MOVE_TO || op == VZ_PATH_LINE_TO || op == VZ_PATH_BEZIER_TO) {
+      path->x = vals[i + n - 1];
+      path->y = vals[i + n];
+    }
+    if(op == VZ_PATH_BEZIER_TO)
+      path->curves = true;
+    i += n + 1;
+  }
+  path->flat_valid = false;
+}
+
+void vz_path_move_to(VZpath *path, float x, float y) {
+  float vals[] = {VZ_PATH_MOVE_TO, x, y};
+  vz_path_append(path, vals, 3);
+}
+
+void vz_path_line_to(VZpath *path, float x, float y) {
+  float vals[] = {VZ_PATH_LINE_TO, x, y};
+  vz_path_append(path, vals, 3);
+}
+
+void vz_path_bezier_to(VZpath *path, float c1x, float c1y, float c2x, float c2y, float x, float y) {
+  float vals[] = {VZ_PATH_BEZIER_TO, c1x, c1y, c2x, c2y, x, y};
+  vz_path_append(path, vals, 7);
+}
+
+void vz_path_quad_to(VZpath *path, float cx, float cy, float x, float y) {
+  float x0 = path->x, y0 = path->y;
+  float vals[] = {VZ_PATH_BEZIER_TO,
+    x0 + 2.0f/3.0f*(cx - x0), y0 + 2.0f/3.0f*(cy - y0),
+    x + 2.0f/3.0f*(cx - x), y + 2.0f/3.0f*(cy - y),
+    x, y};
+  vz_path_append(path, vals, 7);
+}
+
+void vz_path_close(VZpath *path) {
+  float vals[] = {VZ_PATH_CLOSE};
+  vz_path_append(path, vals, 1);
+}
+
+void vz_path_set_winding(VZpath *path, int dir) {
+  float vals[] = {VZ_PATH_WINDING, (float)dir};
+  vz_path_append(path, vals, 2);
+}
+
+/*
+  Arcs and shapes are split into curves exactly like NanoVG does.
+*/
+void vz_path_arc(VZpath *path, float cx, float cy, float r, float a0, float a1, int dir) {
+  float vals[3 + 5*7];
+  float a, da, hda, kappa, dx, dy, x, y, tanx, tany;
+  float px = 0, py = 0, ptanx = 0, ptany = 0;
+  int ndivs, nvals = 0;
+  int move = path->commands.count > 0 ? VZ_PATH_LINE_TO : VZ_PATH_MOVE_TO;
+
+  da = a1 - a0;
+  if(dir == NVG_CW) {
+    if(fabsf(da) >= VZ_PI*2) da = VZ_PI*2;
+    else while(da < 0.0f) da += VZ_PI*2;
+  }
+  else {
+    if(fabsf(da) >= VZ_PI*2) da = -VZ_PI*2;
+    else while(da > 0.0f) da -= VZ_PI*2;
+  }
+
+  // segments of at most 90 degrees
+  ndivs = MAX(1, MIN((int)(fabsf(da) / (VZ_PI*0.5f) + 0.5f), 5));
+  hda = (da / (float)ndivs) / 2.0f;
+  kappa = fabsf(4.0f / 3.0f * (1.0f - cosf(hda)) / sinf(hda));
+  if(dir == NVG_CCW)
+    kappa = -kappa;
+
+  for(int i = 0; i <= ndivs; ++i) {
+    a = a0 + da * (i / (float)ndivs);
+    dx = cosf(a);
+    dy = sinf(a);
+    x = cx + dx*r;
+    y = cy + dy*r;
+    tanx = -dy*r*kappa;
+    tany = dx*r*kappa;
+
+    if(i == 0) {
+      vals[nvals++] = (float)move;
+      vals[nvals++] = x;
+      vals[nvals++] = y;
+    }
+    else {
+      vals[nvals++] = VZ_PATH_BEZIER_TO;
+      vals[nvals++] = px + ptanx;
+      vals[nvals++] = py + ptany;
+      vals[nvals++] = x - tanx;
+      vals[nvals++] = y - tany;
+      vals[nvals++] = x;
+      vals[nvals++] = y;
+    }
+    px = x; py = y; ptanx = tanx; ptany = tany;
+  }
+
+  vz_path_append(path, vals, (size_t)nvals);
+}
+
+static float vz_dist_pt_seg2(float x, float y, float px, float py, float qx, float qy) {
+  float pqx = qx - px, pqy = qy - py, dx = x - px, dy = y - py;
+  float d = pqx*pqx + pqy*pqy, t = pqx*dx + pqy*dy;
+
+  if(d > 0) t /= d;
+  if(t < 0) t = 0;
+  else if(t > 1) t = 1;
+  dx = px + t*pqx - x;
+  dy = py + t*pqy - y;
+
+  return dx*dx + dy*dy;
+}
+
+static void vz_normalize(float *x, float *y) {
+  float d = sqrtf((*x)*(*x) + (*y)*(*y));
+
+  if(d > 1e-6f) {
+    *x /= d;
+    *y /= d;
+  }
+}
+
+void vz_path_arc_to(VZpath *path, float x1, float y1, float x2, float y2, float radius) {
+  float x0 = path->x, y0 = path->y;
+  float dx0, dy0, dx1, dy1, a, d, cx, cy, a0, a1;
+  int dir;
+
+  if(path->commands.count == 0)
+    return;
+
+  // degenerate cases
+  if((fabsf(x1 - x0) < VZ_DIST_TOL && fabsf(y1 - y0) < VZ_DIST_TOL) ||
+     (fabsf(x2 - x1) < VZ_DIST_TOL && fabsf(y2 - y1) < VZ_DIST_TOL) ||
+     vz_dist_pt_seg2(x1, y1, x0, y0, x2, y2) < VZ_DIST_TOL*VZ_DIST_TOL ||
+     radius < VZ_DIST_TOL) {
+    vz_path_line_to(path, x1, y1);
+    return;
+  }
+
+  // circle tangent to the lines (x0,y0)-(x1,y1) and (x1,y1)-(x2,y2)
+  dx0 = x0 - x1;
+  dy0 = y0 - y1;
+  dx1 = x2 - x1;
+  dy1 = y2 - y1;
+  vz_normalize(&dx0, &dy0);
+  vz_normalize(&dx1, &dy1);
+  a = acosf(dx0*dx1 + dy0*dy1);
+  d = radius / tanf(a / 2.0f);
+
+  if(d > 10000.0f) {
+    vz_path_line_to(path, x1, y1);
+    return;
+  }
+
+  if(dy0*dx1 - dx0*dy1 > 0.0f) {
+    cx = x1 + dx0*d + dy0*radius;
+    cy = y1 + dy0*d + -dx0*radius;
+    a0 = atan2f(dx0, -dy0);
+    a1 = atan2f(-dx1, dy1);
+    dir = NVG_CW;
+  }
+  else {
+    cx = x1 + dx0*d + -dy0*radius;
+    cy = y1 + dy0*d + dx0*radius;
+    a0 = atan2f(-dx0, dy0);
+    a1 = atan2f(dx1, -dy1);
+    dir = NVG_CCW;
+  }
+
+  vz_path_arc(path, cx, cy, radius, a0, a1, dir);
+}
+
+void vz_path_rect(VZpath *path, float x, float y, float w, float h) {
+  float vals[] = {
+    VZ_PATH_MOVE_TO, x, y,
+    VZ_PATH_LINE_TO, x, y + h,
+    VZ_PATH_LINE_TO, x + w, y + h,
+    VZ_PATH_LINE_TO, x + w, y,
+    VZ_PATH_CLOSE
+  };
+  vz_path_append(path, vals, sizeof(vals) / sizeof(float));
+}
+
+static inline float vz_signf(float a) {
+  return a >= 0.0f ? 1.0f : -1.0f;
+}
+
+void vz_path_rounded_rect_varying(VZpath *path, float x, float y, float w, float h,
+                                  float rad_top_left, float rad_top_right, float rad_bottom_right, float rad_bottom_left) {
+  float halfw = fabsf(w)*0.5f, halfh = fabsf(h)*0.5f;
+  float rx_bl = MIN(rad_bottom_left, halfw) * vz_signf(w), ry_bl = MIN(rad_bottom_left, halfh) * vz_signf(h);
+  float rx_br = MIN(rad_bottom_right, halfw) * vz_signf(w), ry_br = MIN(rad_bottom_right, halfh) * vz_signf(h);
+  float rx_tr = MIN(rad_top_right, halfw) * vz_signf(w), ry_tr = MIN(rad_top_right, halfh) * vz_signf(h);
+  float rx_tl = MIN(rad_top_left, halfw) * vz_signf(w), ry_tl = MIN(rad_top_left, halfh) * vz_signf(h);
+  const float k = 1 - VZ_KAPPA90;
+
+  if(rad_top_left < 0.1f && rad_top_right < 0.1f && rad_bottom_right < 0.1f && rad_bottom_left < 0.1f) {
+    vz_path_rect(path, x, y, w, h);
+    return;
+  }
+
+  float vals[] = {
+    VZ_PATH_MOVE_TO, x, y + ry_tl,
+    VZ_PATH_LINE_TO, x, y + h - ry_bl,
+    VZ_PATH_BEZIER_TO, x, y + h - ry_bl*k, x + rx_bl*k, y + h, x + rx_bl, y + h,
+    VZ_PATH_LINE_TO, x + w - rx_br, y + h,
+    VZ_PATH_BEZIER_TO, x + w - rx_br*k, y + h, x + w, y + h - ry_br*k, x + w, y + h - ry_br,
+    VZ_PATH_LINE_TO, x + w, y + ry_tr,
+    VZ_PATH_BEZIER_TO, x + w, y + ry_tr*k, x + w - rx_tr*k, y, x + w - rx_tr, y,
+    VZ_PATH_LINE_TO, x + rx_tl, y,
+    VZ_PATH_BEZIER_TO, x + rx_tl*k, y, x, y + ry_tl*k, x, y + ry_tl,
+    VZ_PATH_CLOSE
+  };
+  vz_path_append(path, vals, sizeof(vals) / sizeof(float));
+}
+
+void vz_path_ellipse(VZpath *path, float cx, float cy, float rx, float ry) {
+  float vals[] = {
+    VZ_PATH_MOVE_TO, cx - rx, cy,
+    VZ_PATH_BEZIER_TO, cx - rx, cy + ry*VZ_KAPPA90, cx - rx*VZ_KAPPA90, cy + ry, cx, cy + ry,
+    VZ_PATH_BEZIER_TO, cx + rx*VZ_KAPPA90, cy + ry, cx + rx, cy + ry*VZ_KAPPA90, cx + rx, cy,
+    VZ_PATH_BEZIER_TO, cx + rx, cy - ry*VZ_KAPPA90, cx + rx*VZ_KAPPA90, cy - ry, cx, cy - ry,
+    VZ_PATH_BEZIER_TO, cx - rx*VZ_KAPPA90, cy - ry, cx - rx, cy - ry*VZ_KAPPA90, cx - rx, cy,
+    VZ_PATH_CLOSE
+  };
+  vz_path_append(path, vals, sizeof(vals) / sizeof(float));
+}
+
+/*
+  Appends packed commands, returns false without appending anything when an
+  opcode is unknown or misses arguments.
+*/
+bool vz_path_append_packed(VZpath *path, const float *commands, size_t count) {
+  size_t i = 0;
+
+  while(i < count) {
+    float op = commands[i];
+    if(!(op >= VZ_PATH_MOVE_TO && op <= VZ_PATH_WINDING && op == floorf(op)) ||
+       i + 1 + vz_path_arg_counts[(int)op] > count)
+      return false;
+    if(op == VZ_PATH_WINDING && !(commands[i + 1] == NVG_CCW || commands[i + 1] == NVG_CW))
+      return false;
+    i += 1 + vz_path_arg_counts[(int)op];
+  }
+
+  vz_path_append(path, commands, count);
+
+  return true;
+}
+
+/*
+  Transforms the points of a path, shapes with a transform of their own are
+  stored in the space of the path they're part of.
+*/
+void vz_path_transform(VZpath *path, const float *xform) {
+  float *cmd = path->commands.data;
+  size_t i = 0;
+
+  while(i < path->commands.count) {
+    int op = (int)cmd[i];
+    int n = vz_path_arg_counts[op];
+    if(op != VZ_PATH_WINDING)
+      for(int j = 1; j < n; j += 2)
+        nvgTransformPoint(&cmd[i + j], &cmd[i + j + 1], xform, cmd[i + j], cmd[i + j + 1]);
+    i += n + 1;
+  }
+  nvgTransformPoint(&path->x, &path->y, xform, path->x, path->y);
+  path->flat_valid = false;
+}
+
+/*
+  Twice the signed area of the polygon of the points of a sub-path, control
+  points included, which is enough to tell its orientation.
+*/
+static float vz_path_area(const float *cmd, size_t start, size_t end) {
+  float area = 0, x0 = 0, y0 = 0, px = 0, py = 0;
+  bool first = true;
+
+  for(size_t i = start; i < end; i += 1 + vz_path_arg_counts[(int)cmd[i]]) {
+    int op = (int)cmd[i];
+    if(op == VZ_PATH_CLOSE || op == VZ_PATH_WINDING)
+      continue;
+    for(int j = 1; j < vz_path_arg_counts[op]; j += 2) {
+      if(first) {
+        x0 = px = cmd[i + j];
+        y0 = py = cmd[i + j + 1];
+        first = false;
+        continue;
+      }
+      area += px * cmd[i + j + 1] - cmd[i + j] * py;
+      px = cmd[i + j];
+      py = cmd[i + j + 1];
+    }
+  }
+
+  return area + px * y0 - x0 * py;
+}
+
+/*
+  NanoVG fills every sub-path wound as solid unless told otherwise. For
+  shapes filled with the nonzero rule, sub-paths wound opposite to the first
+  one are marked as holes.
+*/
+void vz_path_wind_holes(VZpath *path) {
+  VZpath_buffer wound = {NULL, 0, 0};
+  const float *cmd = path->commands.data;
+  float first = 0, area, *dst;
+  size_t i = 0, end, n;
+  bool has_first = false;
+
+  while(i < path->commands.count) {
+    n = 1 + vz_path_arg_counts[(int)cmd[i]];
+    memcpy(vz_path_buffer_reserve(&wound, n), cmd + i, n * sizeof(float));
+
+    if((int)cmd[i] == VZ_PATH_MOVE_TO) {
+      for(end = i + n; end < path->commands.count && (int)cmd[end] != VZ_PATH_MOVE_TO;
+          end += 1 + vz_path_arg_counts[(int)cmd[end]]);
+      area = vz_path_area(cmd, i, end);
+      if(!has_first) {
+        first = area;
+        has_first = area != 0;
+      }
+      dst = vz_path_buffer_reserve(&wound, 2);
+      dst[0] = VZ_PATH_WINDING;
+      dst[1] = has_first && (area < 0) != (first < 0) && area != 0 ? NVG_HOLE : NVG_SOLID;
+    }
+    i += n;
+  }
+
+  vz_path_buffer_free(&path->commands);
+  path->commands = wound;
+  path->flat_valid = false;
+}
+
+/*
+  The bounding box of the points of a path, control points included, as
+  {min_x, min_y, max_x, max_y}. Returns false for a path without points.
+*/
+bool vz_path_bounds(VZpath *path, float *bounds) {
+  const float *cmd = path->commands.data;
+  bool found = false;
+
+  for(size_t i = 0; i < path->commands.count; i += 1 + vz_path_arg_counts[(int)cmd[i]]) {
+    int op = (int)cmd[i];
+    if(op == VZ_PATH_WINDING)
+      continue;
+    for(int j = 1; j < vz_path_arg_counts[op]; j += 2) {
+      if(!found) {
+        bounds[0] = bounds[2] = cmd[i + j];
+        bounds[1] = bounds[3] = cmd[i + j + 1];
+        found = true;
+      }
+      bounds[0] = MIN(bounds[0], cmd[i + j]);
+      bounds[1] = MIN(bounds[1], cmd[i + j + 1]);
+      bounds[2] = MAX(bounds[2], cmd[i + j]);
+      bounds[3] = MAX(bounds[3], cmd[i + j + 1]);
+    }
+  }
+
+  return found;
+}
+
+/*
+  Subdivides a curve until its control points are within the tolerance of
+  its chord, the flatness test of NanoVG.
+*/
+static void vz_path_flatten_bezier(VZpath_buffer *flat, float tol,
+                                   float x1, float y1, float x2, float y2,
+                                   float x3, float y3, float x4, float y4, int level) {
+  float x12, y12, x23, y23, x34, y34, x123, y123, x234, y234, x1234, y1234;
+  float dx, dy, d2, d3;
+  float *dst;
+
+  if(level > 10)
+    return;
+
+  dx = x4 - x1;
+  dy = y4 - y1;
+  d2 = fabsf((x2 - x4) * dy - (y2 - y4) * dx);
+  d3 = fabsf((x3 - x4) * dy - (y3 - y4) * dx);
+
+  if((d2 + d3)*(d2 + d3) < tol * (dx*dx + dy*dy)) {
+    dst = vz_path_buffer_reserve(flat, 3);
+    dst[0] = VZ_PATH_LINE_TO;
+    dst[1] = x4;
+    dst[2] = y4;
+    return;
+  }
+
+  x12 = (x1 + x2)*0.5f; y12 = (y1 + y2)*0.5f;
+  x23 = (x2 + x3)*0.5f; y23 = (y2 + y3)*0.5f;
+  x34 = (x3 + x4)*0.5f; y34 = (y3 + y4)*0.5f;
+  x123 = (x12 + x23)*0.5f; y123 = (y12 + y23)*0.5f;
+  x234 = (x23 + x34)*0.5f; y234 = (y23 + y34)*0.5f;
+  x1234 = (x123 + x234)*0.5f; y1234 = (y123 + y234)*0.5f;
+
+  vz_path_flatten_bezier(flat, tol, x1, y1, x12, y12, x123, y123, x1234, y1234, level + 1);
+  vz_path_flatten_bezier(flat, tol, x1234, y1234, x234, y234, x34, y34, x4, y4, level + 1);
+}
+
+/*
+  Replaces the curves of a path by lines for a transform and pixel ratio.
+  The flatness test of NanoVG compares squared distances, in path space its
+  tolerance is divided by the square of the largest scale of the transform.
+*/
+static void vz_path_flatten(VZpath *path, const float *xform, float pixel_ratio) {
+  VZpath_buffer *flat = &path->flat;
+  const float *cmd = path->commands.data;
+  float sx = sqrtf(xform[0]*xform[0] + xform[1]*xform[1]);
+  float sy = sqrtf(xform[2]*xform[2] + xform[3]*xform[3]);
+  float scale = MAX(sx, sy);
+  float tol = scale > 0.0f ? 0.25f / pixel_ratio / (scale * scale) : 0.0f;
+  float x = 0, y = 0, *dst;
+  bool has_point = false;
+  size_t i = 0, n;
+
+  flat->count = 0;
+
+  while(i < path->commands.count) {
+    int op = (int)cmd[i];
+    n = 1 + vz_path_arg_counts[op];
+    if(op == VZ_PATH_BEZIER_TO) {
+      if(has_point && tol > 0.0f)
+        vz_path_flatten_bezier(flat, tol, x, y, cmd[i+1], cmd[i+2], cmd[i+3], cmd[i+4], cmd[i+5], cmd[i+6], 0);
+      else if(has_point) {
+        dst = vz_path_buffer_reserve(flat, 3);
+        dst[0] = VZ_PATH_LINE_TO;
+        dst[1] = cmd[i+5];
+        dst[2] = cmd[i+6];
+      }
+    }
+    else memcpy(vz_path_buffer_reserve(flat, n), cmd + i, n * sizeof(float));
+
+    if(op == VZ_PATH_MOVE_TO || op == VZ_PATH_LINE_TO || op == VZ_PATH_BEZIER_TO) {
+      x = cmd[i + n - 2];
+      y = cmd[i + n - 1];
+      has_point = true;
+    }
+    i += n;
+  }
+
+  memcpy(path->flat_xform, xform, 4 * sizeof(float));
+  path->flat_ratio = pixel_ratio;
+  path->flat_valid = true;
+}
+
+static void vz_path_emit(NVGcontext *ctx, const VZpath_buffer *buf) {
+  const float *cmd = buf->data;
+  size_t i = 0;
+
+  while(i < buf->count) {
+    switch((int)cmd[i]) {
+      case VZ_PATH_MOVE_TO:
+        nvgMoveTo(ctx, cmd[i+1], cmd[i+2]);
+        break;
+      case VZ_PATH_LINE_TO:
+        nvgLineTo(ctx, cmd[i+1], cmd[i+2]);
+        break;
+      case VZ_PATH_BEZIER_TO:
+        nvgBezierTo(ctx, cmd[i+1], cmd[i+2], cmd[i+3], cmd[i+4], cmd[i+5], cmd[i+6]);
+        break;
+      case VZ_PATH_CLOSE:
+        nvgClosePath(ctx);
+        break;
+      case VZ_PATH_WINDING:
+        nvgPathWinding(ctx, (int)cmd[i+1]);
+        break;
+    }
+    i += 1 + vz_path_arg_counts[(int)cmd[i]];
+  }
+}
+
+/*
+  Adds the path to the current path of a NanoVG context, under its current
+  transform. Views drawing the same path share its flattened lines.
+*/
+void vz_path_draw(VZpath *path, NVGcontext *ctx, float pixel_ratio) {
+  float xform[6];
+
+  if(!path->curves) {
+    vz_path_emit(ctx, &path->commands);
+    return;
+  }
+
+  nvgCurrentTransform(ctx, xform);
+
+  enif_mutex_lock(path->lock);
+  if(!(path->flat_valid && path->flat_ratio == pixel_ratio &&
+       memcmp(path->flat_xform, xform, 4 * sizeof(float)) == 0))
+    vz_path_flatten(path, xform, pixel_ratio);
+  vz_path_emit(ctx, &path->flat);
+  enif_mutex_unlock(path->lock);
+}
@@ -0,0 +1,73 @@
+#ifndef VZ_PATHS_H_INCLUDED
+#define VZ_PATHS_H_INCLUDED
+
+#include "nanovg.h"
+
+#include <erl_nif.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define VZ_KAPPA90 0.5522847493f
+#define VZ_PI 3.14159265358979323846264338327f
+
+// opcodes of path commands, those of NanoVG
+enum VZpath_command {
+  VZ_PATH_MOVE_TO = 0,
+  VZ_PATH_LINE_TO = 1,
+  VZ_PATH_BEZIER_TO = 2,
+  VZ_PATH_CLOSE = 3,
+  VZ_PATH_WINDING = 4
+};
+
+typedef struct VZpath_buffer {
+  float *data;
+  size_t count;
+  size_t size;
+} VZpath_buffer;
+
+/*
+  Retained paths
+
+  A path is built once from commands and drawn any number of times by any
+  view. Shapes and arcs are stored as the moves, lines and bezier curves
+  NanoVG would make of them, so paths are a flat array of floats, each
+  opcode followed by its arguments.
+
+  Drawing a path flattens its curves to lines, in path space, with the
+  tolerance NanoVG would use under the current transform. The lines are kept
+  until the path is drawn with another scale, rotation, skew or pixel ratio,
+  so paths that only move skip curve flattening.
+*/
+typedef struct VZpath {
+  VZpath_buffer commands;
+  float x;
+  float y;
+  bool curves;
+  ErlNifMutex *lock;
+  VZpath_buffer flat;
+  float flat_xform[4];
+  float flat_ratio;
+  bool flat_valid;
+} VZpath;
+
+void vz_path_init(VZpath *path);
+void vz_path_free(VZpath *path);
+void vz_path_move_to(VZpath *path, float x, float y);
+void vz_path_line_to(VZpath *path, float x, float y);
+void vz_path_bezier_to(VZpath *path, float c1x, float c1y, float c2x, float c2y, float x, float y);
+void vz_path_quad_to(VZpath *path, float cx, float cy, float x, float y);
+void vz_path_arc_to(VZpath *path, float x1, float y1, float x2, float y2, float radius);
+void vz_path_arc(VZpath *path, float cx, float cy, float r, float a0, float a1, int dir);
+void vz_path_rect(VZpath *path, float x, float y, float w, float h);
+void vz_path_rounded_rect_varying(VZpath *path, float x, float y, float w, float h,
+                                  float rad_top_left, float rad_top_right, float rad_bottom_right, float rad_bottom_left);
+void vz_path_ellipse(VZpath *path, float cx, float cy, float rx, float ry);
+void vz_path_close(VZpath *path);
+void vz_path_set_winding(VZpath *path, int dir);
+bool vz_path_append_packed(VZpath *path, const float *commands, size_t count);
+void vz_path_transform(VZpath *path, const float *xform);
+void vz_path_wind_holes(VZpath *path);
+bool vz_path_bounds(VZpath *path, float *bounds);
+void vz_path_draw(VZpath *path, NVGcontext *ctx, float pixel_ratio);
+
+#endif
@@ -0,0 +1,724 @@
+#include "vz_helpers.h"
+#include "vz_pixels.h"
+
+#include <erl_nif.h>
+#include <math.h>
+#include <string.h>
+
+
+/*
+  Computes the size of an image scaled down to fit in max_width x max_height,
+  keeping its aspect ratio. Images are never scaled up, a maximum of 0 means
+  no limit.
+*/
+void vz_pixels_fit(int width, int height, int max_width, int max_height, int *fit_width, int *fit_height) {
+  double scale = 1.0;
+
+  if(max_width > 0 && width > max_width)
+    scale = (double)max_width / width;
+  if(max_height > 0 && height * scale > max_height)
+    scale = (double)max_height / height;
+
+  *fit_width = MAX((int)floor(width * scale + 0.5), 1);
+  *fit_height = MAX((int)floor(height * scale + 0.5), 1);
+}
+
+/*
+  Resamples one line of `src_count` pixels, `src_stride` floats apart, to
+  `dst_count` pixels. Every destination pixel is the average of the source
+  pixels it covers, weighted by coverage.
+*/
+static void vz_pixels_box_line(const float *src, int src_count, size_t src_stride,
+                               float *dst, int dst_count, size_t dst_stride) {
+  double step = (double)src_count / dst_count;
+
+  for(int d = 0; d < dst_count; ++d) {
+    double start = d * step, end = start + step;
+    float acc[4] = {0.f, 0.f, 0.f, 0.f};
+
+    for(int s = (int)start; s < src_count && s < end; ++s) {
+      float w = (float)(MIN(end, s + 1.0) - MAX(start, (double)s));
+      const float *p = src + s * src_stride;
+      acc[0] += p[0] * w;
+      acc[1] += p[1] * w;
+      acc[2] += p[2] * w;
+      acc[3] += p[3] * w;
+    }
+
+    float *q = dst + d * dst_stride;
+    q[0] = acc[0] / (float)step;
+    q[1] = acc[1] / (float)step;
+    q[2] = acc[2] / (float)step;
+    q[3] = acc[3] / (float)step;
+  }
+}
+
+/*
+  Box filter downscale in two separable passes over alpha premultiplied floats.
+*/
+void vz_pixels_resize(const unsigned char *src, int src_width, int src_height,
+                      unsigned char *dst, int dst_width, int dst_height) {
+  float *line = (float*)enif_alloc(sizeof(float) * 4 * src_width);
+  float *tmp = (float*)enif_alloc(sizeof(float) * 4 * dst_width * src_height);
+  float *column_in = (float*)enif_alloc(sizeof(float) * 4 * src_height);
+  float *column_out = (float*)enif_alloc(sizeof(float) * 4 * dst_height);
+
+  for(int y = 0; y < src_height; ++y) {
+    const unsigned char *p = src + (size_t)y * src_width * 4;
+    for(int x = 0; x < src_width; ++x, p += 4) {
+      float a = p[3] / 255.f;
+      line[x * 4 + 0] = p[0] * a;
+      line[x * 4 + 1] = p[1] * a;
+      line[x * 4 + 2] = p[2] * a;
+      line[x * 4 + 3] = p[3];
+    }
+    vz_pixels_box_line(line, src_width, 4, tmp + (size_t)y * dst_width * 4, dst_width, 4);
+  }
+
+  for(int x = 0; x < dst_width; ++x) {
+    for(int y = 0; y < src_height; ++y)
+      memcpy(column_in + y * 4, tmp + ((size_t)y * dst_width + x) * 4, sizeof(float) * 4);
+
+    vz_pixels_box_line(column_in, src_height, 4, column_out, dst_height, 4);
+
+    for(int y = 0; y < dst_height; ++y) {
+      const float *c = column_out + y * 4;
+      unsigned char *q = dst + ((size_t)y * dst_width + x) * 4;
+      float a = c[3];
+      float f = a > 0.f ? 255.f / a : 0.f;
+      q[0] = (unsigned char)MIN(c[0] * f + 0.5f, 255.f);
+      q[1] = (unsigned char)MIN(c[1] * f + 0.5f, 255.f);
+      q[2] = (unsigned char)MIN(c[2] * f + 0.5f, 255.f);
+      q[3] = (unsigned char)MIN(a + 0.5f, 255.f);
+    }
+  }
+
+  enif_free(line);
+  enif_free(tmp);
+  enif_free(column_in);
+  enif_free(column_out);
+}
+
+/*
+  Returns the number of levels of a full mip chain, down to 1x1.
+*/
+int vz_pixels_mip_levels(int width, int height) {
+  int levels = 1;
+
+  while(width > 1 || height > 1) {
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+    ++levels;
+  }
+
+  return levels;
+}
+
+size_t vz_pixels_mip_chain_size(int width, int height, int levels) {
+  size_t size = 0;
+
+  for(int i = 0; i < levels; ++i) {
+    size += (size_t)width * height * 4;
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+  }
+
+  return size;
+}
+
+/*
+  Fills in the levels following the first one of a mip chain, stored one
+  after the other in `data`, each level averaging 2x2 pixels of the previous.
+*/
+void vz_pixels_mip_chain(unsigned char *data, int width, int height, int levels) {
+  const unsigned char *src = data;
+  unsigned char *dst;
+  int dst_width, dst_height;
+
+  for(int i = 1; i < levels; ++i) {
+    dst = (unsigned char*)src + (size_t)width * height * 4;
+    dst_width = MAX(width / 2, 1);
+    dst_height = MAX(height / 2, 1);
+
+    for(int y = 0; y < dst_height; ++y) {
+      const unsigned char *r0 = src + (size_t)MIN(y * 2, height - 1) * width * 4;
+      const unsigned char *r1 = src + (size_t)MIN(y * 2 + 1, height - 1) * width * 4;
+
+      for(int x = 0; x < dst_width; ++x) {
+        int x0 = MIN(x * 2, width - 1) * 4, x1 = MIN(x * 2 + 1, width - 1) * 4;
+        const unsigned char *p[4] = {r0 + x0, r0 + x1, r1 + x0, r1 + x1};
+        unsigned a = p[0][3] + p[1][3] + p[2][3] + p[3][3];
+        unsigned char *q = dst + ((size_t)y * dst_width + x) * 4;
+
+        for(int c = 0; c < 3; ++c) {
+          unsigned sum = p[0][c] * p[0][3] + p[1][c] * p[1][3] + p[2][c] * p[2][3] + p[3][c] * p[3][3];
+          q[c] = a ? (unsigned char)((sum + a / 2) / a) : 0;
+        }
+        q[3] = (unsigned char)((a + 2) / 4);
+      }
+    }
+
+    src = dst;
+    width = dst_width;
+    height = dst_height;
+  }
+}
+
+
+/*
+  Conversion kernels
+
+  Every kernel has a scalar version, which also handles the pixels left over
+  by the vector versions. The fastest versions the CPU supports are selected
+  once by vz_pixels_init.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VZ_PIXELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define VZ_TARGET(isa)
+#else
+#define VZ_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VZ_PIXELS_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*VZpixels_fn)(const unsigned char*, unsigned char*, size_t);
+typedef void (*VZpixels_swizzle_fn)(const unsigned char*, unsigned char*, size_t, const unsigned char*);
+typedef void (*VZpixels_quantize_fn)(const float*, unsigned char*, size_t, float, float);
+
+static struct {
+  const char *isa;
+  VZpixels_fn premultiply;
+  VZpixels_fn unpremultiply;
+  VZpixels_swizzle_fn swizzle;
+  VZpixels_fn rgb_to_rgba;
+  VZpixels_fn grayscale;
+  VZpixels_quantize_fn quantize;
+} vz_kernels;
+
+static inline unsigned char vz_div255(unsigned x) {
+  x += 128;
+  return (unsigned char)((x + (x >> 8)) >> 8);
+}
+
+static void vz_premultiply_scalar(const unsigned char *src, unsigned char *dst, size_t count) {
+  for(size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+    unsigned a = src[3];
+    dst[0] = vz_div255(src[0] * a);
+    dst[1] = vz_div255(src[1] * a);
+    dst[2] = vz_div255(src[2] * a);
+    dst[3] = (unsigned char)a;
+  }
+}
+
+static void vz_unpremultiply_scalar(const unsigned char *src, unsigned char *dst, size_t count) {
+  for(size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+    unsigned char a = src[3];
+    float rcp = a ? 255.f / a : 0.f;
+    dst[0] = (unsigned char)MIN(src[0] * rcp + 0.5f, 255.f);
+    dst[1] = (unsigned char)MIN(src[1] * rcp + 0.5f, 255.f);
+    dst[2] = (unsigned char)MIN(src[2] * rcp + 0.5f, 255.f);
+    dst[3] = a;
+  }
+}
+
+static void vz_swizzle_scalar(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char *order) {
+  for(size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+    unsigned char p[4] = {src[0], src[1], src[2], src[3]};
+    dst[0] = p[order[0]];
+    dst[1] = p[order[1]];
+    dst[2] = p[order[2]];
+    dst[3] = p[order[3]];
+  }
+}
+
+static void vz_rgb_to_rgba_scalar(const unsigned char *src, unsigned char *dst, size_t count) {
+  for(size_t i = 0; i < count; ++i, src += 3, dst += 4) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+    dst[3] = 255;
+  }
+}
+
+// BT.601 luma in 8 bit fixed point, the weights add up to 256
+static void vz_grayscale_scalar(const unsigned char *src, unsigned char *dst, size_t count) {
+  for(size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+    unsigned char y = (unsigned char)((src[0] * 77 + src[1] * 150 + src[2] * 29 + 128) >> 8);
+    dst[0] = dst[1] = dst[2] = y;
+    dst[3] = src[3];
+  }
+}
+
+// NaN values fail both comparisons and map to 0
+static void vz_quantize_scalar(const float *src, unsigned char *dst, size_t count, float offset, float scale) {
+  for(size_t i = 0; i < count; ++i) {
+    float v = (src[i] - offset) * scale;
+    v = v > 0.f ? v : 0.f;
+    v = v < 255.f ? v : 255.f;
+    dst[i] = (unsigned char)(v + 0.5f);
+  }
+}
+
+#ifdef VZ_PIXELS_X86
+
+VZ_TARGET("sse2")
+static void vz_premultiply_sse2(const unsigned char *src, unsigned char *dst, size_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(128);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+    __m128i lo = _mm_unpacklo_epi8(px, zero);
+    __m128i hi = _mm_unpackhi_epi8(px, zero);
+    __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xff), 0xff);
+    __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xff), 0xff);
+
+    lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), bias);
+    hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), bias);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+    px = _mm_or_si128(_mm_andnot_si128(alpha, _mm_packus_epi16(lo, hi)), _mm_and_si128(alpha, px));
+    _mm_storeu_si128((__m128i*)(dst + i * 4), px);
+  }
+
+  vz_premultiply_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+VZ_TARGET("avx2")
+static void vz_premultiply_avx2(const unsigned char *src, unsigned char *dst, size_t count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i bias = _mm256_set1_epi16(128);
+  const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+  size_t i = 0;
+
+  for(; i + 8 <= count; i += 8) {
+    __m256i px = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+    __m256i lo = _mm256_unpacklo_epi8(px, zero);
+    __m256i hi = _mm256_unpackhi_epi8(px, zero);
+    __m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xff), 0xff);
+    __m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xff), 0xff);
+
+    lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alo), bias);
+    hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, ahi), bias);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+    px = _mm256_or_si256(_mm256_andnot_si256(alpha, _mm256_packus_epi16(lo, hi)), _mm256_and_si256(alpha, px));
+    _mm256_storeu_si256((__m256i*)(dst + i * 4), px);
+  }
+
+  vz_premultiply_sse2(src + i * 4, dst + i * 4, count - i);
+}
+
+VZ_TARGET("sse2")
+static void vz_unpremultiply_sse2(const unsigned char *src, unsigned char *dst, size_t count) {
+  const __m128i mask = _mm_set1_epi32(0xff);
+  const __m128 zero = _mm_setzero_ps(), half = _mm_set1_ps(0.5f), max = _mm_set1_ps(255.f);
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+    __m128 a = _mm_cvtepi32_ps(_mm_srli_epi32(px, 24));
+    __m128 rcp = _mm_and_ps(_mm_div_ps(max, a), _mm_cmpneq_ps(a, zero));
+    __m128i out = _mm_slli_epi32(_mm_srli_epi32(px, 24), 24);
+
+    for(int shift = 0; shift < 24; shift += 8) {
+      __m128 c = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, shift), mask));
+      c = _mm_min_ps(_mm_add_ps(_mm_mul_ps(c, rcp), half), max);
+      out = _mm_or_si128(out, _mm_slli_epi32(_mm_cvttps_epi32(c), shift));
+    }
+
+    _mm_storeu_si128((__m128i*)(dst + i * 4), out);
+  }
+
+  vz_unpremultiply_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+VZ_TARGET("avx2")
+static void vz_unpremultiply_avx2(const unsigned char *src, unsigned char *dst, size_t count) {
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  const __m256 zero = _mm256_setzero_ps(), half = _mm256_set1_ps(0.5f), max = _mm256_set1_ps(255.f);
+  size_t i = 0;
+
+  for(; i + 8 <= count; i += 8) {
+    __m256i px = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+    __m256 a = _mm256_cvtepi32_ps(_mm256_srli_epi32(px, 24));
+    __m256 rcp = _mm256_and_ps(_mm256_div_ps(max, a), _mm256_cmp_ps(a, zero, _CMP_NEQ_OQ));
+    __m256i out = _mm256_slli_epi32(_mm256_srli_epi32(px, 24), 24);
+
+    for(int shift = 0; shift < 24; shift += 8) {
+      __m256 c = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, shift), mask));
+      c = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(c, rcp), half), max);
+      out = _mm256_or_si256(out, _mm256_slli_epi32(_mm256_cvttps_epi32(c), shift));
+    }
+
+    _mm256_storeu_si256((__m256i*)(dst + i * 4), out);
+  }
+
+  vz_unpremultiply_sse2(src + i * 4, dst + i * 4, count - i);
+}
+
+VZ_TARGET("ssse3")
+static void vz_swizzle_ssse3(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char *order) {
+  __m128i shuffle = _mm_setr_epi8(
+    order[0], order[1], order[2], order[3], 4 + order[0], 4 + order[1], 4 + order[2], 4 + order[3],
+    8 + order[0], 8 + order[1], 8 + order[2], 8 + order[3], 12 + order[0], 12 + order[1], 12 + order[2], 12 + order[3]);
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+    _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(px, shuffle));
+  }
+
+  vz_swizzle_scalar(src + i * 4, dst + i * 4, count - i, order);
+}
+
+VZ_TARGET("avx2")
+static void vz_swizzle_avx2(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char *order) {
+  __m256i shuffle = _mm256_setr_epi8(
+    order[0], order[1], order[2], order[3], 4 + order[0], 4 + order[1], 4 + order[2], 4 + order[3],
+    8 + order[0], 8 + order[1], 8 + order[2], 8 + order[3], 12 + order[0], 12 + order[1], 12 + order[2], 12 + order[3],
+    order[0], order[1], order[2], order[3], 4 + order[0], 4 + order[1], 4 + order[2], 4 + order[3],
+    8 + order[0], 8 + order[1], 8 + order[2], 8 + order[3], 12 + order[0], 12 + order[1], 12 + order[2], 12 + order[3]);
+  size_t i = 0;
+
+  for(; i + 8 <= count; i += 8) {
+    __m256i px = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+    _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(px, shuffle));
+  }
+
+  vz_swizzle_ssse3(src + i * 4, dst + i * 4, count - i, order);
+}
+
+// loads 16 bytes for every 4 pixels of 12 bytes, the last 2 pixels are left to the scalar version
+VZ_TARGET("ssse3")
+static void vz_rgb_to_rgba_ssse3(const unsigned char *src, unsigned char *dst, size_t count) {
+  const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  size_t i = 0;
+
+  for(; i + 6 <= count; i += 4) {
+    __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 3));
+    _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(px, shuffle), alpha));
+  }
+
+  vz_rgb_to_rgba_scalar(src + i * 3, dst + i * 4, count - i);
+}
+
+VZ_TARGET("sse2")
+static void vz_grayscale_sse2(const unsigned char *src, unsigned char *dst, size_t count) {
+  const __m128i mask = _mm_set1_epi32(0xff);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  const __m128i wr = _mm_set1_epi32(77), wg = _mm_set1_epi32(150), wb = _mm_set1_epi32(29);
+  const __m128i bias = _mm_set1_epi32(128);
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+    __m128i r = _mm_and_si128(px, mask);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+    __m128i b = _mm_and_si128(_mm_srli_epi32(px, 16), mask);
+    // the weighted sum fits in the low 16 bits of every 32 bit lane
+    __m128i y = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, wr), _mm_mullo_epi16(g, wg)),
+                              _mm_add_epi16(_mm_mullo_epi16(b, wb), bias));
+    y = _mm_srli_epi32(y, 8);
+    y = _mm_or_si128(_mm_or_si128(y, _mm_slli_epi32(y, 8)), _mm_slli_epi32(y, 16));
+    _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(y, _mm_and_si128(px, alpha)));
+  }
+
+  vz_grayscale_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+// max returns its second operand when either is NaN, which maps NaN to 0
+VZ_TARGET("sse2")
+static void vz_quantize_sse2(const float *src, unsigned char *dst, size_t count, float offset, float scale) {
+  const __m128 off = _mm_set1_ps(offset), sc = _mm_set1_ps(scale);
+  const __m128 zero = _mm_setzero_ps(), top = _mm_set1_ps(255.f), half = _mm_set1_ps(0.5f);
+  __m128i q[4];
+  size_t i = 0;
+
+  for(; i + 16 <= count; i += 16) {
+    for(int j = 0; j < 4; ++j) {
+      __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(src + i + j * 4), off), sc);
+      v = _mm_min_ps(_mm_max_ps(v, zero), top);
+      q[j] = _mm_cvttps_epi32(_mm_add_ps(v, half));
+    }
+    _mm_storeu_si128((__m128i*)(dst + i),
+                     _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3])));
+  }
+
+  vz_quantize_scalar(src + i, dst + i, count - i, offset, scale);
+}
+
+VZ_TARGET("avx2")
+static void vz_grayscale_avx2(const unsigned char *src, unsigned char *dst, size_t count) {
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+  const __m256i wr = _mm256_set1_epi32(77), wg = _mm256_set1_epi32(150), wb = _mm256_set1_epi32(29);
+  const __m256i bias = _mm256_set1_epi32(128);
+  size_t i = 0;
+
+  for(; i + 8 <= count; i += 8) {
+    __m256i px = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+    __m256i r = _mm256_and_si256(px, mask);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+    __m256i b = _mm256_and_si256(_mm256_srli_epi32(px, 16), mask);
+    __m256i y = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, wr), _mm256_mullo_epi16(g, wg)),
+                                 _mm256_add_epi16(_mm256_mullo_epi16(b, wb), bias));
+    y = _mm256_srli_epi32(y, 8);
+    y = _mm256_or_si256(_mm256_or_si256(y, _mm256_slli_epi32(y, 8)), _mm256_slli_epi32(y, 16));
+    _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(y, _mm256_and_si256(px, alpha)));
+  }
+
+  vz_grayscale_sse2(src + i * 4, dst + i * 4, count - i);
+}
+
+static void vz_cpu_features(bool *sse2, bool *ssse3, bool *avx2) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+
+  __cpuid(info, 0);
+  if(info[0] < 1) {
+    *sse2 = *ssse3 = *avx2 = false;
+    return;
+  }
+  int max_leaf = info[0];
+
+  __cpuid(info, 1);
+  *sse2 = (info[3] & (1 << 26)) != 0;
+  *ssse3 = (info[2] & (1 << 9)) != 0;
+  // AVX2 also needs the OS to save the YMM registers
+  *avx2 = false;
+  if(max_leaf >= 7 && (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6) {
+    __cpuidex(info, 7, 0);
+    *avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  *sse2 = __builtin_cpu_supports("sse2");
+  *ssse3 = __builtin_cpu_supports("ssse3");
+  *avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+#ifdef VZ_PIXELS_NEON
+
+static inline uint8x16_t vz_div255_neon(uint8x16_t c, uint8x16_t a) {
+  uint16x8_t lo = vaddq_u16(vmull_u8(vget_low_u8(c), vget_low_u8(a)), vdupq_n_u16(128));
+  uint16x8_t hi = vaddq_u16(vmull_u8(vget_high_u8(c), vget_high_u8(a)), vdupq_n_u16(128));
+  return vcombine_u8(vaddhn_u16(lo, vshrq_n_u16(lo, 8)), vaddhn_u16(hi, vshrq_n_u16(hi, 8)));
+}
+
+static void vz_premultiply_neon(const unsigned char *src, unsigned char *dst, size_t count) {
+  size_t i = 0;
+
+  for(; i + 16 <= count; i += 16) {
+    uint8x16x4_t px = vld4q_u8(src + i * 4);
+    px.val[0] = vz_div255_neon(px.val[0], px.val[3]);
+    px.val[1] = vz_div255_neon(px.val[1], px.val[3]);
+    px.val[2] = vz_div255_neon(px.val[2], px.val[3]);
+    vst4q_u8(dst + i * 4, px);
+  }
+
+  vz_premultiply_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+static void vz_unpremultiply_neon(const unsigned char *src, unsigned char *dst, size_t count) {
+  const uint32x4_t mask = vdupq_n_u32(0xff);
+  const float32x4_t zero = vdupq_n_f32(0.f), half = vdupq_n_f32(0.5f), max = vdupq_n_f32(255.f);
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    uint32x4_t px = vld1q_u32((const uint32_t*)(src + i * 4));
+    float32x4_t a = vcvtq_f32_u32(vshrq_n_u32(px, 24));
+    float32x4_t rcp = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vdivq_f32(max, a)),
+                                                       vmvnq_u32(vceqq_f32(a, zero))));
+    uint32x4_t out = vshlq_n_u32(vshrq_n_u32(px, 24), 24);
+    float32x4_t c;
+
+    c = vminq_f32(vaddq_f32(vmulq_f32(vcvtq_f32_u32(vandq_u32(px, mask)), rcp), half), max);
+    out = vorrq_u32(out, vcvtq_u32_f32(c));
+    c = vminq_f32(vaddq_f32(vmulq_f32(vcvtq_f32_u32(vandq_u32(vshrq_n_u32(px, 8), mask)), rcp), half), max);
+    out = vorrq_u32(out, vshlq_n_u32(vcvtq_u32_f32(c), 8));
+    c = vminq_f32(vaddq_f32(vmulq_f32(vcvtq_f32_u32(vandq_u32(vshrq_n_u32(px, 16), mask)), rcp), half), max);
+    out = vorrq_u32(out, vshlq_n_u32(vcvtq_u32_f32(c), 16));
+
+    vst1q_u32((uint32_t*)(dst + i * 4), out);
+  }
+
+  vz_unpremultiply_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+static void vz_swizzle_neon(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char *order) {
+  unsigned char indices[16];
+  size_t i = 0;
+
+  for(int p = 0; p < 16; ++p)
+    indices[p] = (unsigned char)((p & ~3) + order[p & 3]);
+  uint8x16_t shuffle = vld1q_u8(indices);
+
+  for(; i + 4 <= count; i += 4)
+    vst1q_u8(dst + i * 4, vqtbl1q_u8(vld1q_u8(src + i * 4), shuffle));
+
+  vz_swizzle_scalar(src + i * 4, dst + i * 4, count - i, order);
+}
+
+static void vz_rgb_to_rgba_neon(const unsigned char *src, unsigned char *dst, size_t count) {
+  size_t i = 0;
+
+  for(; i + 16 <= count; i += 16) {
+    uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+    uint8x16x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u8(255)}};
+    vst4q_u8(dst + i * 4, rgba);
+  }
+
+  vz_rgb_to_rgba_scalar(src + i * 3, dst + i * 4, count - i);
+}
+
+static void vz_grayscale_neon(const unsigned char *src, unsigned char *dst, size_t count) {
+  const uint8x8_t wr = vdup_n_u8(77), wg = vdup_n_u8(150), wb = vdup_n_u8(29);
+  size_t i = 0;
+
+  for(; i + 16 <= count; i += 16) {
+    uint8x16x4_t px = vld4q_u8(src + i * 4);
+    uint16x8_t lo = vmull_u8(vget_low_u8(px.val[0]), wr);
+    uint16x8_t hi = vmull_u8(vget_high_u8(px.val[0]), wr);
+    lo = vmlal_u8(lo, vget_low_u8(px.val[1]), wg);
+    hi = vmlal_u8(hi, vget_high_u8(px.val[1]), wg);
+    lo = vmlal_u8(lo, vget_low_u8(px.val[2]), wb);
+    hi = vmlal_u8(hi, vget_high_u8(px.val[2]), wb);
+
+    uint8x16_t y = vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8));
+    px.val[0] = px.val[1] = px.val[2] = y;
+    vst4q_u8(dst + i * 4, px);
+  }
+
+  vz_grayscale_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+// maxnm returns the number when one operand is NaN, which maps NaN to 0
+static void vz_quantize_neon(const float *src, unsigned char *dst, size_t count, float offset, float scale) {
+  const float32x4_t off = vdupq_n_f32(offset), sc = vdupq_n_f32(scale);
+  const float32x4_t zero = vdupq_n_f32(0.f), top = vdupq_n_f32(255.f), half = vdupq_n_f32(0.5f);
+  uint16x4_t q[4];
+  size_t i = 0;
+
+  for(; i + 16 <= count; i += 16) {
+    for(int j = 0; j < 4; ++j) {
+      float32x4_t v = vmulq_f32(vsubq_f32(vld1q_f32(src + i + j * 4), off), sc);
+      v = vminq_f32(vmaxnmq_f32(v, zero), top);
+      q[j] = vmovn_u32(vcvtq_u32_f32(vaddq_f32(v, half)));
+    }
+    vst1q_u8(dst + i, vcombine_u8(vmovn_u16(vcombine_u16(q[0], q[1])), vmovn_u16(vcombine_u16(q[2], q[3]))));
+  }
+
+  vz_quantize_scalar(src + i, dst + i, count - i, offset, scale);
+}
+
+#endif
+
+/*
+  Selects the kernels for the CPU, called when the NIF library is loaded.
+*/
+void vz_pixels_init(void) {
+  vz_kernels.isa = "scalar";
+  vz_kernels.premultiply = vz_premultiply_scalar;
+  vz_kernels.unpremultiply = vz_unpremultiply_scalar;
+  vz_kernels.swizzle = vz_swizzle_scalar;
+  vz_kernels.rgb_to_rgba = vz_rgb_to_rgba_scalar;
+  vz_kernels.grayscale = vz_grayscale_scalar;
+  vz_kernels.quantize = vz_quantize_scalar;
+
+#if defined(VZ_PIXELS_X86)
+  bool sse2, ssse3, avx2;
+  vz_cpu_features(&sse2, &ssse3, &avx2);
+
+  if(sse2) {
+    vz_kernels.isa = "sse2";
+    vz_kernels.premultiply = vz_premultiply_sse2;
+    vz_kernels.unpremultiply = vz_unpremultiply_sse2;
+    vz_kernels.grayscale = vz_grayscale_sse2;
+    vz_kernels.quantize = vz_quantize_sse2;
+  }
+  if(ssse3) {
+    vz_kernels.isa = "ssse3";
+    vz_kernels.swizzle = vz_swizzle_ssse3;
+    vz_kernels.rgb_to_rgba = vz_rgb_to_rgba_ssse3;
+  }
+  if(avx2 && ssse3) {
+    vz_kernels.isa = "avx2";
+    vz_kernels.premultiply = vz_premultiply_avx2;
+    vz_kernels.unpremultiply = vz_unpremultiply_avx2;
+    vz_kernels.swizzle = vz_swizzle_avx2;
+    vz_kernels.grayscale = vz_grayscale_avx2;
+  }
+#elif defined(VZ_PIXELS_NEON)
+  vz_kernels.isa = "neon";
+  vz_kernels.premultiply = vz_premultiply_neon;
+  vz_kernels.unpremultiply = vz_unpremultiply_neon;
+  vz_kernels.swizzle = vz_swizzle_neon;
+  vz_kernels.rgb_to_rgba = vz_rgb_to_rgba_neon;
+  vz_kernels.grayscale = vz_grayscale_neon;
+  vz_kernels.quantize = vz_quantize_neon;
+#endif
+}
+
+const char* vz_pixels_isa(void) {
+  return vz_kernels.isa;
+}
+
+void vz_pixels_premultiply(const unsigned char *src, unsigned char *dst, size_t count) {
+  vz_kernels.premultiply(src, dst, count);
+}
+
+void vz_pixels_unpremultiply(const unsigned char *src, unsigned char *dst, size_t count) {
+  vz_kernels.unpremultiply(src, dst, count);
+}
+
+/*
+  Reorders the channels of every pixel, channel `c` of the result is channel
+  `order[c]` of the source.
+*/
+void vz_pixels_swizzle(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char order[4]) {
+  vz_kernels.swizzle(src, dst, count, order);
+}
+
+void vz_pixels_rgb_to_rgba(const unsigned char *src, unsigned char *dst, size_t count) {
+  vz_kernels.rgb_to_rgba(src, dst, count);
+}
+
+void vz_pixels_grayscale(const unsigned char *src, unsigned char *dst, size_t count) {
+  vz_kernels.grayscale(src, dst, count);
+}
+
+/*
+  Maps every channel through its lookup table, `lut` holds a table of 256
+  entries per channel. Table lookups don't vectorize without a gather, so
+  there is only a scalar version.
+*/
+void vz_pixels_lut(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char lut[4][256]) {
+  for(size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+    dst[0] = lut[0][src[0]];
+    dst[1] = lut[1][src[1]];
+    dst[2] = lut[2][src[2]];
+    dst[3] = lut[3][src[3]];
+  }
+}
+
+/*
+  Maps floats from [min, max] to bytes, clamping values outside the range.
+*/
+void vz_pixels_quantize(const float *src, unsigned char *dst, size_t count, float min, float max) {
+  vz_kernels.quantize(src, dst, count, min, max > min ? 255.f / (max - min) : 0.f);
+}
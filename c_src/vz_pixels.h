@@ -0,0 +1,31 @@
+#ifndef VZ_PIXELS_H_INCLUDED
+#define VZ_PIXELS_H_INCLUDED
+
+#include <stddef.h>
+
+/*
+  Pixel kernels
+
+  Operate on tightly packed 8 bit RGBA pixels with straight alpha. Filters
+  weight colors by alpha, so transparent pixels don't bleed into their
+  neighbours. Conversion kernels take a pixel count, the ones that keep the
+  pixel size may convert in place.
+*/
+void vz_pixels_fit(int width, int height, int max_width, int max_height, int *fit_width, int *fit_height);
+void vz_pixels_resize(const unsigned char *src, int src_width, int src_height,
+                      unsigned char *dst, int dst_width, int dst_height);
+int vz_pixels_mip_levels(int width, int height);
+size_t vz_pixels_mip_chain_size(int width, int height, int levels);
+void vz_pixels_mip_chain(unsigned char *data, int width, int height, int levels);
+
+void vz_pixels_init(void);
+const char* vz_pixels_isa(void);
+void vz_pixels_premultiply(const unsigned char *src, unsigned char *dst, size_t count);
+void vz_pixels_unpremultiply(const unsigned char *src, unsigned char *dst, size_t count);
+void vz_pixels_swizzle(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char order[4]);
+void vz_pixels_rgb_to_rgba(const unsigned char *src, unsigned char *dst, size_t count);
+void vz_pixels_grayscale(const unsigned char *src, unsigned char *dst, size_t count);
+void vz_pixels_lut(const unsigned char *src, unsigned char *dst, size_t count, const unsigned char lut[4][256]);
+void vz_pixels_quantize(const float *src, unsigned char *dst, size_t count, float min, float max);
+
+#endif
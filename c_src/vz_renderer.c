@@ -0,0 +1,409 @@
+#ifdef VZ_PLATFORM_X11
+#define _GNU_SOURCE
+#endif
+
+#include "vz_atoms.h"
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_view_thread.h"
+#include "vz_renderer.h"
+
+#include <erl_nif.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(VZ_PLATFORM_X11)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(VZ_PLATFORM_WINDOWS)
+#include <windows.h>
+#endif
+
+
+static void vz_renderer_wake(VZrenderer *renderer) {
+#if defined(VZ_PLATFORM_X11)
+  uint64_t value = 1;
+  if(write(renderer->wake_fd, &value, sizeof(value)) < 0) {
+    // the counter can only overflow when the thread is not reading it anyway
+  }
+#elif defined(VZ_PLATFORM_WINDOWS)
+  SetEvent((HANDLE)renderer->wake_event);
+#endif
+}
+
+static int vz_renderer_compare_deadlines(const void *a, const void *b) {
+  ErlNifTime da = (*(VZview* const*)a)->next_frame;
+  ErlNifTime db = (*(VZview* const*)b)->next_frame;
+  return (da > db) - (da < db);
+}
+
+static void vz_renderer_remove(VZrenderer *renderer, VZview *vz_view) {
+  enif_send(NULL, &vz_view->view_pid, NULL, ATOM_SHUTDOWN);
+
+  enif_mutex_lock(renderer->lock);
+  for(unsigned i = 0; i < renderer->count; ++i) {
+    if(renderer->views[i] == vz_view) {
+      renderer->views[i] = renderer->views[--renderer->count];
+      break;
+    }
+  }
+  // the view may be freed as soon as it is detached
+  vz_view->detached = true;
+  enif_cond_broadcast(renderer->detached_cv);
+  enif_mutex_unlock(renderer->lock);
+}
+
+/*
+  Services a view: opens its window when it was just attached, draws a frame
+  when one is due and dispatches its events. Returns false when the view was
+  shut down and has been detached from the renderer.
+*/
+static bool vz_renderer_service(VZrenderer *renderer, VZview *vz_view) {
+  ErlNifTime cpu_time = vz_thread_cpu_time();
+  ErlNifTime now = enif_monotonic_time(ERL_NIF_USEC);
+  ErlNifTime interval;
+  bool frame_due = false;
+
+  enif_mutex_lock(vz_view->lock);
+  renderer->current = vz_view;
+
+  if(!vz_view->shutdown && !vz_view->view) {
+    if(vz_view_open(vz_view))
+      enif_send(NULL, &vz_view->view_pid, NULL, ATOM_INITIALIZED);
+    else
+      vz_view->shutdown = true;
+  }
+
+  if(vz_view->shutdown) {
+    vz_frame_abort(vz_view);
+    vz_view_close(vz_view);
+    renderer->current = NULL;
+    enif_mutex_unlock(vz_view->lock);
+    vz_renderer_remove(renderer, vz_view);
+    return false;
+  }
+
+  // a frame that is being built is finished before the view suspends
+  if(vz_view->suspend && !vz_view->building) {
+    if(!vz_view->suspended) {
+      vz_view->suspended = true;
+      enif_send(NULL, &vz_view->view_pid, NULL, ATOM_SUSPENDED);
+    }
+    vz_view->next_frame = VZ_NO_DEADLINE;
+  }
+  else {
+    vz_view->suspended = false;
+
+    if(!vz_timed_frames(vz_view))
+      vz_view->next_frame = VZ_NO_DEADLINE;
+    else {
+      if(vz_view->next_frame == VZ_NO_DEADLINE)
+        vz_view->next_frame = now;
+
+      if(now >= vz_view->next_frame) {
+        frame_due = true;
+        interval = 1000000 / MAX(vz_view->frame_rate, 1);
+        vz_view->next_frame += interval;
+        // frames that were missed are dropped, not caught up with
+        if(vz_view->next_frame <= now)
+          vz_view->next_frame = now + interval;
+      }
+    }
+
+    vz_view_step(vz_view, frame_due);
+  }
+
+  vz_view->cpu_time += vz_thread_cpu_time() - cpu_time;
+  renderer->current = NULL;
+  enif_mutex_unlock(vz_view->lock);
+
+  return true;
+}
+
+#if defined(VZ_PLATFORM_X11)
+/*
+  Blocks until one of the views has X events or is woken up, a view is
+  attached or the deadline passes. The wake-up counters are polled at even
+  indices, the X connections of the views at odd ones.
+*/
+static void vz_renderer_wait(VZrenderer *renderer, VZview **views, unsigned count,
+                             ErlNifTime deadline, struct pollfd *fds) {
+  struct timespec timeout, *timeout_ptr = NULL;
+  ErlNifTime now;
+  unsigned nfds = 1;
+  uint64_t value;
+
+  fds[0].fd = renderer->wake_fd;
+  fds[0].events = POLLIN;
+
+  for(unsigned i = 0; i < count; ++i) {
+    if(!(views[i] && views[i]->view))
+      continue;
+
+    // also flushes requests, events already read by Xlib would not wake up poll
+    if(XPending(views[i]->display) > 0)
+      return;
+
+    fds[nfds].fd = ConnectionNumber(views[i]->display);
+    fds[nfds].events = POLLIN;
+    fds[nfds + 1].fd = views[i]->wake_fd;
+    fds[nfds + 1].events = POLLIN;
+    nfds += 2;
+  }
+
+  if(deadline != VZ_NO_DEADLINE) {
+    now = enif_monotonic_time(ERL_NIF_USEC);
+    if(deadline <= now)
+      return;
+    timeout.tv_sec = (time_t)((deadline - now) / 1000000);
+    timeout.tv_nsec = (long)((deadline - now) % 1000000) * 1000;
+    timeout_ptr = &timeout;
+  }
+
+  if(ppoll(fds, nfds, timeout_ptr, NULL) > 0) {
+    for(unsigned i = 0; i < nfds; i += 2) {
+      if((fds[i].revents & POLLIN) && read(fds[i].fd, &value, sizeof(value)) < 0) {
+        // EAGAIN, another wake-up was already consumed
+      }
+    }
+  }
+}
+#elif defined(VZ_PLATFORM_WINDOWS)
+/*
+  All windows of the views were created by this thread, so their messages
+  arrive in its message queue.
+*/
+static void vz_renderer_wait(VZrenderer *renderer, ErlNifTime deadline) {
+  DWORD timeout = INFINITE;
+  ErlNifTime now;
+
+  if(deadline != VZ_NO_DEADLINE) {
+    now = enif_monotonic_time(ERL_NIF_USEC);
+    if(deadline <= now)
+      return;
+    timeout = (DWORD)((deadline - now + 999) / 1000);
+  }
+
+  MsgWaitForMultipleObjectsEx(1, (HANDLE*)&renderer->wake_event, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+#else
+static void vz_renderer_wait(VZrenderer *renderer, ErlNifTime deadline) {
+  struct timespec ts;
+  ErlNifTime now = enif_monotonic_time(ERL_NIF_USEC);
+  ErlNifTime timeout = 10000;
+  __UNUSED(renderer);
+
+  if(deadline != VZ_NO_DEADLINE)
+    timeout = MIN(MAX(deadline - now, 0), timeout);
+
+  ts.tv_sec = 0;
+  ts.tv_nsec = (long)timeout * 1000;
+  nanosleep(&ts, NULL);
+}
+#endif
+
+static void* vz_renderer_thread(void *p) {
+  VZrenderer *renderer = (VZrenderer*)p;
+  VZview **views = NULL;
+  unsigned count, size = 0;
+  ErlNifTime deadline;
+#ifdef VZ_PLATFORM_X11
+  struct pollfd *fds = NULL;
+#endif
+
+  enif_mutex_lock(renderer->lock);
+  while(!renderer->shutdown) {
+    // views are only detached by this thread, so the copy stays valid
+    if(size < renderer->size) {
+      size = renderer->size;
+      views = (VZview**)enif_realloc(views, size * sizeof(VZview*));
+#ifdef VZ_PLATFORM_X11
+      fds = (struct pollfd*)enif_realloc(fds, (1 + size * 2) * sizeof(struct pollfd));
+#endif
+    }
+    count = renderer->count;
+    memcpy(views, renderer->views, count * sizeof(VZview*));
+    enif_mutex_unlock(renderer->lock);
+
+    qsort(views, count, sizeof(VZview*), vz_renderer_compare_deadlines);
+
+    deadline = VZ_NO_DEADLINE;
+    for(unsigned i = 0; i < count; ++i) {
+      if(!vz_renderer_service(renderer, views[i]))
+        views[i] = NULL;
+      else
+        deadline = MIN(deadline, views[i]->next_frame);
+    }
+
+#ifdef VZ_PLATFORM_X11
+    vz_renderer_wait(renderer, views, count, deadline, fds);
+#else
+    vz_renderer_wait(renderer, deadline);
+#endif
+    enif_mutex_lock(renderer->lock);
+  }
+  enif_mutex_unlock(renderer->lock);
+
+  enif_free(views);
+#ifdef VZ_PLATFORM_X11
+  enif_free(fds);
+#endif
+
+  return NULL;
+}
+
+static void vz_renderer_free(VZrenderer *renderer) {
+  if(renderer->lock)
+    enif_mutex_destroy(renderer->lock);
+  if(renderer->detached_cv)
+    enif_cond_destroy(renderer->detached_cv);
+#if defined(VZ_PLATFORM_X11)
+  if(renderer->wake_fd >= 0)
+    close(renderer->wake_fd);
+#elif defined(VZ_PLATFORM_WINDOWS)
+  if(renderer->wake_event)
+    CloseHandle((HANDLE)renderer->wake_event);
+#endif
+  enif_free(renderer->views);
+  enif_free(renderer);
+}
+
+static VZrenderer* vz_renderer_new() {
+  VZrenderer *renderer = (VZrenderer*)enif_alloc(sizeof(VZrenderer));
+
+  memset(renderer, 0, sizeof(VZrenderer));
+  renderer->size = 16;
+  renderer->views = (VZview**)enif_alloc(renderer->size * sizeof(VZview*));
+  renderer->lock = enif_mutex_create("vz_renderer_mutex");
+  renderer->detached_cv = enif_cond_create("vz_renderer_detached_cond");
+#if defined(VZ_PLATFORM_X11)
+  renderer->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(renderer->wake_fd < 0)
+    goto err;
+#elif defined(VZ_PLATFORM_WINDOWS)
+  if(!(renderer->wake_event = CreateEvent(NULL, FALSE, FALSE, NULL)))
+    goto err;
+#endif
+
+  if(!renderer->lock || !renderer->detached_cv ||
+     enif_thread_create("vz_renderer_thread", &renderer->tid, vz_renderer_thread, renderer, NULL) != 0)
+    goto err;
+
+  return renderer;
+
+  err:
+    vz_renderer_free(renderer);
+    return NULL;
+}
+
+/*
+  Sets up a pool of at most `threads` render threads, one per scheduler
+  thread when it is not positive. Threads are started when views are attached.
+*/
+bool vz_renderer_pool_init(VZrenderer_pool *pool, int threads) {
+  ErlNifSysInfo info;
+
+  if(threads <= 0) {
+    enif_system_info(&info, sizeof(ErlNifSysInfo));
+    threads = info.scheduler_threads;
+  }
+
+  pool->size = (unsigned)MAX(threads, 1);
+  pool->count = 0;
+  pool->renderers = (VZrenderer**)enif_alloc(pool->size * sizeof(VZrenderer*));
+  pool->lock = enif_mutex_create("vz_renderer_pool_mutex");
+
+  return pool->lock != NULL;
+}
+
+void vz_renderer_pool_free(VZrenderer_pool *pool) {
+  VZrenderer *renderer;
+
+  for(unsigned i = 0; i < pool->count; ++i) {
+    renderer = pool->renderers[i];
+    enif_mutex_lock(renderer->lock);
+    renderer->shutdown = true;
+    vz_renderer_wake(renderer);
+    enif_mutex_unlock(renderer->lock);
+    enif_thread_join(renderer->tid, NULL);
+    vz_renderer_free(renderer);
+  }
+
+  if(pool->lock)
+    enif_mutex_destroy(pool->lock);
+  enif_free(pool->renderers);
+}
+
+/*
+  Assigns a view to the render thread with the fewest views. A new thread is
+  started rather than sharing one, until the pool is full.
+*/
+bool vz_renderer_attach(VZrenderer_pool *pool, VZview *vz_view) {
+  VZrenderer *renderer = NULL, *r;
+  unsigned min_views = 0, views;
+
+  enif_mutex_lock(pool->lock);
+
+  for(unsigned i = 0; i < pool->count; ++i) {
+    r = pool->renderers[i];
+    enif_mutex_lock(r->lock);
+    views = r->count;
+    enif_mutex_unlock(r->lock);
+    if(!renderer || views < min_views) {
+      renderer = r;
+      min_views = views;
+    }
+  }
+
+  if((!renderer || min_views > 0) && pool->count < pool->size && (r = vz_renderer_new()) != NULL) {
+    pool->renderers[pool->count++] = r;
+    renderer = r;
+  }
+
+  if(!renderer) {
+    enif_mutex_unlock(pool->lock);
+    return false;
+  }
+
+  enif_mutex_lock(renderer->lock);
+  if(renderer->count == renderer->size) {
+    renderer->size *= 2;
+    renderer->views = (VZview**)enif_realloc(renderer->views, renderer->size * sizeof(VZview*));
+  }
+  vz_view->renderer = renderer;
+  renderer->views[renderer->count++] = vz_view;
+  vz_renderer_wake(renderer);
+  enif_mutex_unlock(renderer->lock);
+
+  enif_mutex_unlock(pool->lock);
+
+  return true;
+}
+
+/*
+  Shuts a view down and waits until its render thread has closed its window.
+  Called when the view resource is destroyed.
+*/
+void vz_renderer_detach(VZview *vz_view) {
+  VZrenderer *renderer = vz_view->renderer;
+
+  enif_mutex_lock(vz_view->lock);
+  vz_view->busy = false;
+  vz_view->suspend = false;
+  vz_view->shutdown = true;
+  enif_cond_signal(vz_view->execute_cv);
+  vz_wake(vz_view);
+  enif_mutex_unlock(vz_view->lock);
+
+  enif_mutex_lock(renderer->lock);
+  vz_renderer_wake(renderer);
+  while(!vz_view->detached)
+    enif_cond_wait(renderer->detached_cv, renderer->lock);
+  enif_mutex_unlock(renderer->lock);
+}
+
+bool vz_renderer_is_current(VZrenderer *renderer, VZview *vz_view) {
+  return enif_thread_self() == renderer->tid && renderer->current == vz_view;
+}
@@ -0,0 +1,53 @@
+#ifndef VZ_RENDERER_H_INCLUDED
+#define VZ_RENDERER_H_INCLUDED
+
+#include <erl_nif.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VZ_NO_DEADLINE ((ErlNifTime)INT64_MAX)
+
+struct VZview;
+
+/*
+  Shared renderer
+
+  Views created with `shared_renderer: true` don't get a render thread of
+  their own, but are assigned to the least busy thread of a fixed pool. Each
+  thread owns the windows and contexts of its views and services them in
+  order of their next frame deadline, switching GL contexts between them.
+  Swapping doesn't wait for the vertical blank, frames are paced by the
+  deadlines instead, at the refresh rate of the display in vsync mode.
+  Frames are built asynchronously, a thread never waits for the process of
+  one view to build its frame while the others are due.
+*/
+typedef struct VZrenderer {
+  ErlNifMutex *lock;
+  ErlNifCond *detached_cv;
+  ErlNifTid tid;
+  struct VZview **views;
+  unsigned count;
+  unsigned size;
+  struct VZview *current;
+  bool shutdown;
+#if defined(VZ_PLATFORM_X11)
+  int wake_fd;
+#elif defined(VZ_PLATFORM_WINDOWS)
+  void *wake_event;
+#endif
+} VZrenderer;
+
+typedef struct VZrenderer_pool {
+  ErlNifMutex *lock;
+  VZrenderer **renderers;
+  unsigned count;
+  unsigned size;
+} VZrenderer_pool;
+
+bool vz_renderer_pool_init(VZrenderer_pool *pool, int threads);
+void vz_renderer_pool_free(VZrenderer_pool *pool);
+bool vz_renderer_attach(VZrenderer_pool *pool, struct VZview *vz_view);
+void vz_renderer_detach(struct VZview *vz_view);
+bool vz_renderer_is_current(VZrenderer *renderer, struct VZview *vz_view);
+
+#endif
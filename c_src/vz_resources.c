@@ -1,10 +1,16 @@
 #include "vz_helpers.h"
 #include "vz_resources.h"
+#include "vz_view_thread.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef VZ_PLATFORM_X11
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 VZ_ARRAY_DEFINE(VZop)
 VZ_ARRAY_DEFINE(VZev)
 VZ_ARRAY_DEFINE(VZres)
@@ -36,6 +42,17 @@ VZview* vz_alloc_view(ErlNifEnv* env) {
     return NULL;
   }
 
+#ifdef VZ_PLATFORM_X11
+  if((vz_view->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+    enif_mutex_destroy(vz_view->lock);
+    enif_cond_destroy(vz_view->execute_cv);
+    enif_cond_destroy(vz_view->suspended_cv);
+    enif_release_resource(vz_view);
+    return NULL;
+  }
+  vz_view->display = NULL;
+#endif
+
   VZpriv *priv = (VZpriv*)enif_priv_data(env);
 
   enif_self(env, &vz_view->view_pid);
@@ -52,6 +69,21 @@ VZview* vz_alloc_view(ErlNifEnv* env) {
   vz_view->suspend = false;
   vz_view->resizable = false;
   vz_view->force_send_events = false;
+  vz_view->redraw = false;
+  vz_view->shared_renderer = false;
+  vz_view->suspended = false;
+  vz_view->detached = false;
+  vz_view->building = false;
+  vz_view->drawing_node = -1;
+  vz_view->exposed = false;
+  vz_view->next_frame = 0;
+  vz_view->renderer = NULL;
+  vz_view->view = NULL;
+  vz_view->frames = 0;
+  vz_view->cpu_time = 0;
+  vz_view->last_frame_time = 0;
+  vz_view->frame_interval = 0.0;
+  vz_view->refresh_rate = VZ_DEFAULT_REFRESH_RATE;
   vz_view->frame_rate = VZ_VSYNC;
   vz_view->vsync = true;
   vz_view->redraw_mode = VZ_INTERVAL;
@@ -67,6 +99,18 @@ VZview* vz_alloc_view(ErlNifEnv* env) {
   vz_view->ctx = NULL;
   vz_view->parent = 0;
   vz_view->bg = nvgRGBA(0,0,0,0);
+  vz_view->nodes = vz_node_store_new(256);
+  vz_layers_init(&vz_view->layers);
+  vz_damage_init(&vz_view->damage);
+  vz_view->assets = &priv->assets;
+  vz_view->font_assets = NULL;
+  vz_view->share_group = &priv->shares;
+  vz_view->share_context = NULL;
+  vz_textures_init(&vz_view->textures);
+  memset(&vz_view->video_shader, 0, sizeof(VZvideo_shader));
+  memset(&vz_view->heatmap_shader, 0, sizeof(VZheatmap_shader));
+  vz_sdf_init(&vz_view->sdf, VZ_SDF_ATLAS_SIZE, VZ_SDF_ATLAS_MAX_SIZE);
+  nvgTransformIdentity(vz_view->xform);
   memset(vz_view->title, 0, VZ_MAX_STRING_LENGTH);
 
   return vz_view;
@@ -75,15 +119,22 @@ VZview* vz_alloc_view(ErlNifEnv* env) {
 void vz_view_dtor(ErlNifEnv *env, void *resource) {
   __UNUSED(env);
   VZview *vz_view = (VZview*)resource;
-  if (!vz_view->shutdown) {
+  if(vz_view->renderer)
+    vz_renderer_detach(vz_view);
+  else if (!vz_view->shutdown) {
     enif_mutex_lock(vz_view->lock);
     vz_view->busy = false;
     vz_view->shutdown = true;
     enif_cond_signal(vz_view->execute_cv);
+    vz_wake(vz_view);
     enif_mutex_unlock(vz_view->lock);
     enif_thread_join(vz_view->view_tid, NULL);
   }
 
+#ifdef VZ_PLATFORM_X11
+  close(vz_view->wake_fd);
+#endif
+
   enif_mutex_destroy(vz_view->lock);
   enif_cond_destroy(vz_view->execute_cv);
   enif_cond_destroy(vz_view->suspended_cv);
@@ -95,16 +146,24 @@ void vz_view_dtor(ErlNifEnv *env, void *resource) {
   }
   VZop_array_free(vz_view->op_array);
   VZev_array_free(vz_view->ev_array);
+  vz_node_store_free(vz_view->nodes);
+  vz_textures_free(&vz_view->textures);
 }
 
-VZpriv* vz_alloc_priv() {
+VZpriv* vz_alloc_priv(int render_threads) {
   VZpriv *priv = enif_alloc(sizeof(VZpriv));
   priv->view_id_counter = 0;
+  vz_renderer_pool_init(&priv->renderers, render_threads);
+  vz_asset_cache_init(&priv->assets);
+  vz_share_group_init(&priv->shares);
 
   return priv;
 }
 
 void vz_free_priv(VZpriv *priv) {
+  vz_renderer_pool_free(&priv->renderers);
+  vz_asset_cache_free(&priv->assets);
+  vz_share_group_free(&priv->shares);
   enif_free(priv);
 }
 
@@ -133,25 +192,24 @@ VZcanvas* vz_alloc_canvas(VZview *view) {
 }
 
 ErlNifResourceType *vz_image_res;
-VZimage* vz_alloc_image(VZview *view, int handle) {
+VZimage* vz_alloc_image(VZview *view, int id) {
   VZimage *image;
 
   if((image = enif_alloc_resource(vz_image_res, sizeof(VZimage))) == NULL)
       return NULL;
 
   image->view = view;
-  image->handle = handle;
+  image->id = id;
 
   return image;
 }
 
   struct vz_image_dtor_args {
-    int handle;
+    int id;
   };
   static void vz_image_dtor_handler(VZview *vz_view, void *void_args) {
-    NVGcontext *ctx = vz_view->ctx;
     struct vz_image_dtor_args *args = (struct vz_image_dtor_args*)void_args;
-    nvgDeleteImage(ctx, args->handle);
+    vz_texture_release(vz_view, args->id);
   }
 
 
@@ -162,8 +220,8 @@ void vz_image_dtor(ErlNifEnv *env, void *resource) {
     VZop vz_op;
     vz_op.handler = vz_image_dtor_handler;
     vz_op.args = args;
-    args->handle = image->handle;
-    if(enif_thread_self() == image->view->view_tid) {
+    args->id = image->id;
+    if(vz_view_locked_by_self(image->view)) {
       VZop_array_push(image->view->op_array, vz_op);
     }
     else {
@@ -176,6 +234,27 @@ void vz_image_dtor(ErlNifEnv *env, void *resource) {
 
 
 
+ErlNifResourceType *vz_asset_res;
+VZasset_handle* vz_alloc_asset_handle(VZasset *asset) {
+  VZasset_handle *handle;
+
+  if((handle = enif_alloc_resource(vz_asset_res, sizeof(VZasset_handle))) == NULL)
+      return NULL;
+
+  handle->asset = asset;
+
+  return handle;
+}
+
+void vz_asset_handle_dtor(ErlNifEnv *env, void *resource) {
+  __UNUSED(env);
+  VZasset_handle *handle = (VZasset_handle*)resource;
+  vz_asset_unpin(handle->asset);
+  vz_asset_release(handle->asset);
+}
+
+
+
 ErlNifResourceType *vz_font_res;
 VZfont* vz_alloc_font(VZview *view, int handle, const char *file_path) {
   VZfont *font;
@@ -190,6 +269,36 @@ VZfont* vz_alloc_font(VZview *view, int handle, const char *file_path) {
   return font;
 }
 
+ErlNifResourceType *vz_node_res;
+VZnode* vz_alloc_node(VZview *view) {
+  VZnode *node;
+
+  if((node = enif_alloc_resource(vz_node_res, sizeof(VZnode))) == NULL)
+      return NULL;
+
+  enif_keep_resource(view);
+  node->view = view;
+  node->id = vz_node_store_alloc(view->nodes);
+
+  return node;
+}
+
+void vz_node_dtor(ErlNifEnv *env, void *resource) {
+  __UNUSED(env);
+  VZnode *node = (VZnode*)resource;
+  if(vz_view_locked_by_self(node->view)) {
+    vz_layers_orphan(node->view, node->id);
+    vz_node_store_release(node->view->nodes, node->id);
+  }
+  else {
+    enif_mutex_lock(node->view->lock);
+    vz_layers_orphan(node->view, node->id);
+    vz_node_store_release(node->view->nodes, node->id);
+    enif_mutex_unlock(node->view->lock);
+  }
+  enif_release_resource(node->view);
+}
+
 ErlNifResourceType *vz_paint_res;
 NVGpaint* vz_alloc_paint(NVGpaint src) {
   NVGpaint *dst;
@@ -202,6 +311,40 @@ NVGpaint* vz_alloc_paint(NVGpaint src) {
   return dst;
 }
 
+ErlNifResourceType *vz_path_res;
+VZpath* vz_alloc_path() {
+  VZpath *path;
+
+  if((path = enif_alloc_resource(vz_path_res, sizeof(VZpath))) == NULL)
+      return NULL;
+
+  vz_path_init(path);
+
+  return path;
+}
+
+void vz_path_dtor(ErlNifEnv *env, void *resource) {
+  __UNUSED(env);
+  vz_path_free((VZpath*)resource);
+}
+
+ErlNifResourceType *vz_svg_res;
+VZsvg* vz_alloc_svg() {
+  VZsvg *svg;
+
+  if((svg = enif_alloc_resource(vz_svg_res, sizeof(VZsvg))) == NULL)
+      return NULL;
+
+  memset(svg, 0, sizeof(VZsvg));
+
+  return svg;
+}
+
+void vz_svg_dtor(ErlNifEnv *env, void *resource) {
+  __UNUSED(env);
+  vz_svg_free((VZsvg*)resource);
+}
+
 ErlNifResourceType *vz_matrix_res;
 float* vz_alloc_matrix() {
   return enif_alloc_resource(vz_matrix_res, sizeof(float) * 6);
@@ -218,6 +361,65 @@ float* vz_alloc_matrix_copy(const float *src) {
   return dst;
 }
 
+/*
+  Transforms are passed around as 6-tuples of floats, so they live on the
+  process heap. Matrix resources are still accepted where a transform is read.
+*/
+ERL_NIF_TERM vz_make_matrix(ErlNifEnv* env, const float *matrix) {
+  return enif_make_tuple6(env,
+                          enif_make_double(env, matrix[0]),
+                          enif_make_double(env, matrix[1]),
+                          enif_make_double(env, matrix[2]),
+                          enif_make_double(env, matrix[3]),
+                          enif_make_double(env, matrix[4]),
+                          enif_make_double(env, matrix[5]));
+}
+
+/*
+  Reads a transform in double precision, the precision Vizi.Canvas.Transform
+  computes in.
+*/
+bool vz_get_matrix_double(ErlNifEnv* env, ERL_NIF_TERM term, double *matrix) {
+  const ERL_NIF_TERM *elems;
+  float *res;
+  int arity, valuei;
+
+  if(enif_get_tuple(env, term, &arity, &elems)) {
+    if(arity != 6)
+      return false;
+
+    for(int i = 0; i < 6; ++i) {
+      if(!enif_get_double(env, elems[i], &matrix[i])) {
+        if(enif_get_int(env, elems[i], &valuei))
+          matrix[i] = (double)valuei;
+        else return false;
+      }
+    }
+
+    return true;
+  }
+
+  if(enif_get_resource(env, term, vz_matrix_res, (void**)&res)) {
+    for(int i = 0; i < 6; ++i)
+      matrix[i] = (double)res[i];
+    return true;
+  }
+
+  return false;
+}
+
+bool vz_get_matrix(ErlNifEnv* env, ERL_NIF_TERM term, float *matrix) {
+  double value[6];
+
+  if(!vz_get_matrix_double(env, term, value))
+    return false;
+
+  for(int i = 0; i < 6; ++i)
+    matrix[i] = (float)value[i];
+
+  return true;
+}
+
 
 ERL_NIF_TERM vz_make_resource(ErlNifEnv* env, void* obj) {
   ERL_NIF_TERM res = enif_make_resource(env, obj);
@@ -3,6 +3,19 @@
 
 #include "vz_events.h"
 #include "vz_helpers.h"
+#include "vz_nodes.h"
+#include "vz_layers.h"
+#include "vz_damage.h"
+#include "vz_renderer.h"
+#include "vz_assets.h"
+#include "vz_textures.h"
+#include "vz_video.h"
+#include "vz_heatmap.h"
+#include "vz_streams.h"
+#include "vz_paths.h"
+#include "vz_svg.h"
+#include "vz_sdf.h"
+#include "vz_share.h"
 
 #include "pugl/pugl.h"
 #include "nanovg.h"
@@ -10,12 +23,18 @@
 #include <erl_nif.h>
 #include <time.h>
 
+#ifdef VZ_PLATFORM_X11
+#include <X11/Xlib.h>
+#endif
+
 #define VZ_MAX_STRING_LENGTH 255
 #define VZ_VSYNC -1
+#define VZ_DEFAULT_REFRESH_RATE 60.0
 
 enum VZredraw_mode {
   VZ_INTERVAL,
-  VZ_MANUAL
+  VZ_MANUAL,
+  VZ_AUTO
 };
 
 enum VZdraw_image_mode {
@@ -62,9 +81,32 @@ struct VZview {
   bool suspend;
   bool force_send_events;
   bool resizable;
+  bool redraw;
+  bool shared_renderer;
+  bool suspended;
+  bool detached;
+  bool building;
+  bool exposed;
+  ErlNifTime next_frame;
+  unsigned long frames;
+  ErlNifTime cpu_time;
+  ErlNifTime last_frame_time;
+  double frame_interval;
+  double refresh_rate;
   VZev_array *ev_array;
   ErlNifEnv *ev_env;
   float xform[6];
+  VZnode_store *nodes;
+  // node whose draw calls are executed, -1 outside of nodes
+  int drawing_node;
+  VZlayer_cache layers;
+  VZdamage damage;
+  VZasset_cache *assets;
+  VZasset_ref *font_assets;
+  VZtexture_cache textures;
+  VZvideo_shader video_shader;
+  VZheatmap_shader heatmap_shader;
+  VZsdf sdf;
   double width_factor;
   double height_factor;
   int min_width;
@@ -73,8 +115,17 @@ struct VZview {
   int init_height;
   ErlNifCond *suspended_cv;
   ErlNifTid view_tid;
+  VZrenderer *renderer;
   PuglView *view;
   PuglNativeWindow parent;
+  VZshare_group *share_group;
+  // context in the share group, NULL when the view keeps an unshared one
+  void *share_context;
+#ifdef VZ_PLATFORM_X11
+  Display *display;
+  Window share_drawable;
+  int wake_fd;
+#endif
   const char *id;
   char title[VZ_MAX_STRING_LENGTH];
 };
@@ -90,9 +141,12 @@ void vz_view_dtor(ErlNifEnv *env, void *resource);
 
 typedef struct VZpriv {
   unsigned view_id_counter;
+  VZrenderer_pool renderers;
+  VZasset_cache assets;
+  VZshare_group shares;
 } VZpriv;
 
-VZpriv* vz_alloc_priv();
+VZpriv* vz_alloc_priv(int render_threads);
 void vz_free_priv(VZpriv *priv);
 char* vz_priv_new_view_id(VZpriv *priv);
 
@@ -112,18 +166,30 @@ VZcanvas* vz_alloc_canvas(VZview *view);
 
 
 /*
-  Image resource
+  Image resource, refers to a texture slot of its view
 */
 typedef struct VZimage {
-  int handle;
+  int id;
   VZview *view;
 } VZimage;
 
 extern ErlNifResourceType *vz_image_res;
-VZimage* vz_alloc_image(VZview *view, int handle);
+VZimage* vz_alloc_image(VZview *view, int id);
 void vz_image_dtor(ErlNifEnv *env, void *resource);
 
 
+/*
+  Asset resource, a reference to a decoded image not uploaded to a view yet
+*/
+typedef struct VZasset_handle {
+  VZasset *asset;
+} VZasset_handle;
+
+extern ErlNifResourceType *vz_asset_res;
+VZasset_handle* vz_alloc_asset_handle(VZasset *asset);
+void vz_asset_handle_dtor(ErlNifEnv *env, void *resource);
+
+
 /*
   Font resource
 */
@@ -137,18 +203,48 @@ extern ErlNifResourceType *vz_font_res;
 VZfont* vz_alloc_font(VZview *view, int handle, const char *file_path);
 
 
+/*
+  Node resource
+*/
+typedef struct VZnode {
+  int id;
+  VZview *view;
+} VZnode;
+
+extern ErlNifResourceType *vz_node_res;
+VZnode* vz_alloc_node(VZview *view);
+void vz_node_dtor(ErlNifEnv *env, void *resource);
+
+
 /*
   Paint resource
 */
 extern ErlNifResourceType *vz_paint_res;
 NVGpaint* vz_alloc_paint(NVGpaint src);
 
+/*
+  Path resource, shared by all views
+*/
+extern ErlNifResourceType *vz_path_res;
+VZpath* vz_alloc_path();
+void vz_path_dtor(ErlNifEnv *env, void *resource);
+
+/*
+  SVG document resource, shared by all views
+*/
+extern ErlNifResourceType *vz_svg_res;
+VZsvg* vz_alloc_svg();
+void vz_svg_dtor(ErlNifEnv *env, void *resource);
+
 /*
   Matrix resource
 */
 extern ErlNifResourceType *vz_matrix_res;
 float* vz_alloc_matrix();
 float* vz_alloc_matrix_copy(const float *src);
+ERL_NIF_TERM vz_make_matrix(ErlNifEnv* env, const float *matrix);
+bool vz_get_matrix(ErlNifEnv* env, ERL_NIF_TERM term, float *matrix);
+bool vz_get_matrix_double(ErlNifEnv* env, ERL_NIF_TERM term, double *matrix);
 
 
 ERL_NIF_TERM vz_make_resource(ErlNifEnv* env, void* obj);
@@ -0,0 +1,879 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_sdf.h"
+#include "vz_gl.h"
+
+#include <erl_nif.h>
+#include <math.h>
+#include <string.h>
+
+// a private copy, the one of fontstash allocates from its scratch buffer
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STBTT_malloc(x, u) ((void)(u), enif_alloc(x))
+#define STBTT_free(x, u) ((void)(u), enif_free(x))
+#include "stb_truetype.h"
+
+// height in atlas pixels glyphs are rasterized at, and the distance in atlas
+// pixels the field spreads around their outline
+#define VZ_SDF_GLYPH_SIZE 48.0f
+#define VZ_SDF_SPREAD 6
+#define VZ_SDF_SUPERSAMPLE 4
+#define VZ_SDF_INF 1e20f
+
+
+static const char *vz_sdf_vertex_shader =
+  "#version 110\n"
+  "attribute vec4 vertex;\n"
+  "uniform vec2 view_size;\n"
+  "varying vec2 tcoord;\n"
+  "varying vec2 fpos;\n"
+  "void main() {\n"
+  "  tcoord = vertex.zw;\n"
+  "  fpos = vertex.xy;\n"
+  "  gl_Position = vec4(2.0 * vertex.x / view_size.x - 1.0, 1.0 - 2.0 * vertex.y / view_size.y, 0.0, 1.0);\n"
+  "}\n";
+
+static const char *vz_sdf_fragment_shader =
+  "#version 110\n"
+  "uniform sampler2D atlas;\n"
+  "uniform vec4 color;\n"
+  "uniform float blur;\n"
+  "uniform mat3 scissor_mat;\n"
+  "uniform vec2 scissor_ext;\n"
+  "uniform vec2 scissor_scale;\n"
+  "varying vec2 tcoord;\n"
+  "varying vec2 fpos;\n"
+  "void main() {\n"
+  "  float d = texture2D(atlas, tcoord).r;\n"
+  // antialiased over about a pixel, whatever the scale
+  "  float w = length(vec2(dFdx(d), dFdy(d))) * 0.7 + blur;\n"
+  "  float a = smoothstep(0.5 - w, 0.5 + w, d);\n"
+  // the scissor of NanoVG
+  "  vec2 sc = vec2(0.5, 0.5) - (abs((scissor_mat * vec3(fpos, 1.0)).xy) - scissor_ext) * scissor_scale;\n"
+  "  a *= clamp(sc.x, 0.0, 1.0) * clamp(sc.y, 0.0, 1.0);\n"
+  "  gl_FragColor = color * a;\n"
+  "}\n";
+
+void vz_sdf_init(VZsdf *sdf, int size, int max_size) {
+  memset(sdf, 0, sizeof(VZsdf));
+  sdf->width = size;
+  sdf->height = size;
+  sdf->init_size = size;
+  sdf->max_size = max_size < size ? size : max_size;
+  sdf->nstates = 1;
+  vz_sdf_reset(sdf);
+}
+
+void vz_sdf_free(VZsdf *sdf) {
+  if(sdf->texture)
+    glDeleteTextures(1, &sdf->texture);
+  if(sdf->program)
+    glDeleteProgram(sdf->program);
+
+  for(unsigned i = 0; i < sdf->font_count; ++i) {
+    enif_free(sdf->fonts[i]->info);
+    enif_free(sdf->fonts[i]);
+  }
+  if(sdf->fonts) enif_free(sdf->fonts);
+  if(sdf->glyphs) enif_free(sdf->glyphs);
+  if(sdf->table) enif_free(sdf->table);
+  if(sdf->shelves) enif_free(sdf->shelves);
+  if(sdf->pixels) enif_free(sdf->pixels);
+  if(sdf->vertices) enif_free(sdf->vertices);
+
+  vz_sdf_init(sdf, sdf->init_size, sdf->max_size);
+}
+
+VZsdf_font* vz_sdf_find_font(VZsdf *sdf, int handle) {
+  for(unsigned i = 0; i < sdf->font_count; ++i)
+    if(sdf->fonts[i]->handle == handle)
+      return sdf->fonts[i];
+  return NULL;
+}
+
+/*
+  Makes the NanoVG font `handle` an SDF font, `data` is the font file, which
+  must outlive the view.
+*/
+bool vz_sdf_add_font(VZsdf *sdf, int handle, const unsigned char *data) {
+  stbtt_fontinfo *info;
+  VZsdf_font *font;
+  int ascent, descent, line_gap;
+
+  if(vz_sdf_find_font(sdf, handle))
+    return true;
+
+  info = (stbtt_fontinfo*)enif_alloc(sizeof(stbtt_fontinfo));
+  if(!stbtt_InitFont(info, data, stbtt_GetFontOffsetForIndex(data, 0))) {
+    enif_free(info);
+    return false;
+  }
+
+  font = (VZsdf_font*)enif_alloc(sizeof(VZsdf_font));
+  font->id = (int)sdf->font_count;
+  font->handle = handle;
+  font->info = info;
+  // normalized to the line height, like fontstash does
+  stbtt_GetFontVMetrics(info, &ascent, &descent, &line_gap);
+  font->ascender = (float)ascent / (float)(ascent - descent);
+  font->descender = (float)descent / (float)(ascent - descent);
+
+  sdf->fonts = (VZsdf_font**)enif_realloc(sdf->fonts, (sdf->font_count + 1) * sizeof(VZsdf_font*));
+  sdf->fonts[sdf->font_count++] = font;
+
+  return true;
+}
+
+/*
+  Text style
+*/
+
+VZsdf_state* vz_sdf_state(VZsdf *sdf) {
+  return &sdf->states[sdf->nstates - 1];
+}
+
+void vz_sdf_save(VZsdf *sdf) {
+  if(sdf->nstates >= VZ_SDF_MAX_STATES)
+    return;
+  sdf->states[sdf->nstates] = sdf->states[sdf->nstates - 1];
+  ++sdf->nstates;
+}
+
+void vz_sdf_restore(VZsdf *sdf) {
+  if(sdf->nstates <= 1)
+    return;
+  --sdf->nstates;
+}
+
+void vz_sdf_reset(VZsdf *sdf) {
+  VZsdf_state *state = vz_sdf_state(sdf);
+
+  // the defaults of nvgReset, which selects the first font
+  state->font = vz_sdf_find_font(sdf, 0);
+  state->color = nvgRGBA(255, 255, 255, 255);
+  state->alpha = 1.0f;
+  state->size = 16.0f;
+  state->blur = 0.0f;
+  state->spacing = 0.0f;
+  state->line_height = 1.0f;
+  state->align = NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE;
+  vz_sdf_reset_scissor(sdf);
+}
+
+/*
+  Starts the state stack over, like nvgBeginFrame does.
+*/
+void vz_sdf_begin_frame(VZsdf *sdf) {
+  sdf->nstates = 1;
+  vz_sdf_reset(sdf);
+}
+
+void vz_sdf_font_face(VZsdf *sdf, int handle) {
+  vz_sdf_state(sdf)->font = vz_sdf_find_font(sdf, handle);
+}
+
+void vz_sdf_scissor(VZsdf *sdf, const float *xform, float x, float y, float w, float h) {
+  VZsdf_state *state = vz_sdf_state(sdf);
+
+  w = MAX(0.0f, w);
+  h = MAX(0.0f, h);
+  nvgTransformIdentity(state->scissor);
+  state->scissor[4] = x + w * 0.5f;
+  state->scissor[5] = y + h * 0.5f;
+  nvgTransformMultiply(state->scissor, xform);
+  state->scissor_extent[0] = w * 0.5f;
+  state->scissor_extent[1] = h * 0.5f;
+}
+
+void vz_sdf_intersect_scissor(VZsdf *sdf, const float *xform, float x, float y, float w, float h) {
+  VZsdf_state *state = vz_sdf_state(sdf);
+  float pxform[6], invxform[6], ex, ey, tex, tey, minx, miny, maxx, maxy;
+
+  if(state->scissor_extent[0] < 0) {
+    vz_sdf_scissor(sdf, xform, x, y, w, h);
+    return;
+  }
+
+  // the current scissor in the current space, as an axis aligned rectangle
+  memcpy(pxform, state->scissor, sizeof(float) * 6);
+  ex = state->scissor_extent[0];
+  ey = state->scissor_extent[1];
+  nvgTransformInverse(invxform, xform);
+  nvgTransformMultiply(pxform, invxform);
+  tex = ex * fabsf(pxform[0]) + ey * fabsf(pxform[2]);
+  tey = ex * fabsf(pxform[1]) + ey * fabsf(pxform[3]);
+
+  minx = MAX(pxform[4] - tex, x);
+  miny = MAX(pxform[5] - tey, y);
+  maxx = MIN(pxform[4] + tex, x + w);
+  maxy = MIN(pxform[5] + tey, y + h);
+  vz_sdf_scissor(sdf, xform, minx, miny, MAX(0.0f, maxx - minx), MAX(0.0f, maxy - miny));
+}
+
+void vz_sdf_reset_scissor(VZsdf *sdf) {
+  VZsdf_state *state = vz_sdf_state(sdf);
+
+  memset(state->scissor, 0, sizeof(state->scissor));
+  state->scissor_extent[0] = -1.0f;
+  state->scissor_extent[1] = -1.0f;
+}
+
+/*
+  Distance fields
+*/
+
+/*
+  Squared distance transform of a row, after Felzenszwalb and Huttenlocher.
+*/
+static void vz_sdf_edt_1d(float *grid, int offset, int stride, int n, float *f, int *v, float *z) {
+  int k = 0;
+  float s;
+
+  for(int q = 0; q < n; ++q)
+    f[q] = grid[offset + q * stride];
+
+  v[0] = 0;
+  z[0] = -VZ_SDF_INF;
+  z[1] = VZ_SDF_INF;
+  for(int q = 1; q < n; ++q) {
+    do {
+      int r = v[k];
+      s = (f[q] - f[r] + (float)(q * q - r * r)) / (float)(2 * (q - r));
+    } while(s <= z[k] && --k > -1);
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = VZ_SDF_INF;
+  }
+
+  k = 0;
+  for(int q = 0; q < n; ++q) {
+    while(z[k + 1] < (float)q) ++k;
+    grid[offset + q * stride] = f[v[k]] + (float)((q - v[k]) * (q - v[k]));
+  }
+}
+
+static void vz_sdf_edt(float *grid, int width, int height, float *f, int *v, float *z) {
+  for(int x = 0; x < width; ++x)
+    vz_sdf_edt_1d(grid, x, width, height, f, v, z);
+  for(int y = 0; y < height; ++y)
+    vz_sdf_edt_1d(grid, y * width, 1, width, f, v, z);
+}
+
+/*
+  Rasterizes the outline of a glyph supersampled and computes its distance
+  field, averaged down to the atlas resolution. Returns NULL for glyphs
+  without outline.
+*/
+static unsigned char* vz_sdf_rasterize(stbtt_fontinfo *info, int index, int *width, int *height, float *x_offset, float *y_offset) {
+  const int ss = VZ_SDF_SUPERSAMPLE;
+  const int pad = VZ_SDF_SPREAD * ss;
+  float scale = stbtt_ScaleForPixelHeight(info, VZ_SDF_GLYPH_SIZE * ss);
+  int x0, y0, x1, y1, w, h, hw, hh, n;
+  unsigned char *coverage, *field;
+  float *outer, *inner, *f, *z;
+  int *v;
+
+  stbtt_GetGlyphBitmapBox(info, index, scale, scale, &x0, &y0, &x1, &y1);
+  if(x1 <= x0 || y1 <= y0)
+    return NULL;
+
+  w = (x1 - x0 + 2 * pad + ss - 1) / ss;
+  h = (y1 - y0 + 2 * pad + ss - 1) / ss;
+  hw = w * ss;
+  hh = h * ss;
+  n = MAX(hw, hh);
+
+  coverage = (unsigned char*)enif_alloc((size_t)hw * hh);
+  memset(coverage, 0, (size_t)hw * hh);
+  stbtt_MakeGlyphBitmap(info, coverage + pad * hw + pad, x1 - x0, y1 - y0, hw, scale, scale, index);
+
+  // distances to the closest pixel inside the glyph and outside of it
+  outer = (float*)enif_alloc(sizeof(float) * hw * hh * 2);
+  inner = outer + hw * hh;
+  for(int i = 0; i < hw * hh; ++i) {
+    outer[i] = coverage[i] > 127 ? 0.0f : VZ_SDF_INF;
+    inner[i] = coverage[i] > 127 ? VZ_SDF_INF : 0.0f;
+  }
+  enif_free(coverage);
+
+  f = (float*)enif_alloc(sizeof(float) * (n * 2 + 1));
+  z = f + n;
+  v = (int*)enif_alloc(sizeof(int) * n);
+  vz_sdf_edt(outer, hw, hh, f, v, z);
+  vz_sdf_edt(inner, hw, hh, f, v, z);
+  enif_free(f);
+  enif_free(v);
+
+  // the outline runs between pixel centers, 0.5 is on it and inside is above
+  field = (unsigned char*)enif_alloc((size_t)w * h);
+  for(int y = 0; y < h; ++y) {
+    for(int x = 0; x < w; ++x) {
+      float sum = 0.0f, value;
+      for(int sy = 0; sy < ss; ++sy) {
+        for(int sx = 0; sx < ss; ++sx) {
+          int i = (y * ss + sy) * hw + x * ss + sx;
+          sum += outer[i] > 0.0f ? sqrtf(outer[i]) - 0.5f : 0.5f - sqrtf(inner[i]);
+        }
+      }
+      value = 0.5f - sum / (float)(ss * ss * ss) / (2.0f * VZ_SDF_SPREAD);
+      field[y * w + x] = (unsigned char)(MIN(MAX(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+  }
+  enif_free(outer);
+
+  *width = w;
+  *height = h;
+  *x_offset = (float)(x0 - pad) / ss;
+  *y_offset = (float)(y0 - pad) / ss;
+
+  return field;
+}
+
+/*
+  Atlas
+*/
+
+static inline unsigned vz_sdf_hash(int font, int index) {
+  return (unsigned)font * 2654435761u ^ (unsigned)index * 40503u;
+}
+
+static void vz_sdf_table_insert(VZsdf *sdf, int ndx) {
+  const VZsdf_glyph *glyph = &sdf->glyphs[ndx];
+  unsigned mask = sdf->table_size - 1;
+  unsigned i = vz_sdf_hash(glyph->font, glyph->index) & mask;
+
+  while(sdf->table[i] >= 0)
+    i = (i + 1) & mask;
+  sdf->table[i] = ndx;
+}
+
+static void vz_sdf_table_rebuild(VZsdf *sdf, unsigned size) {
+  sdf->table_size = size;
+  sdf->table = (int*)enif_realloc(sdf->table, sizeof(int) * size);
+  memset(sdf->table, 0xff, sizeof(int) * size);
+  for(unsigned i = 0; i < sdf->glyph_count; ++i)
+    vz_sdf_table_insert(sdf, (int)i);
+}
+
+static VZsdf_glyph* vz_sdf_lookup(VZsdf *sdf, int font, int index) {
+  unsigned mask = sdf->table_size - 1;
+  unsigned i = vz_sdf_hash(font, index) & mask;
+  VZsdf_glyph *glyph;
+
+  for(; sdf->table[i] >= 0; i = (i + 1) & mask) {
+    glyph = &sdf->glyphs[sdf->table[i]];
+    if(glyph->font == font && glyph->index == index)
+      return glyph;
+  }
+  return NULL;
+}
+
+static void vz_sdf_atlas_upload(VZsdf *sdf) {
+  if(!sdf->texture) {
+    glGenTextures(1, &sdf->texture);
+    glBindTexture(GL_TEXTURE_2D, sdf->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  else glBindTexture(GL_TEXTURE_2D, sdf->texture);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, sdf->width, sdf->height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, sdf->pixels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static bool vz_sdf_atlas_init(VZsdf *sdf) {
+  GLuint program;
+
+  if(sdf->texture)
+    return true;
+
+  if(!(program = vz_gl_program(vz_sdf_vertex_shader, vz_sdf_fragment_shader)))
+    return false;
+
+  sdf->program = program;
+  sdf->view_size = glGetUniformLocation(program, "view_size");
+  sdf->atlas = glGetUniformLocation(program, "atlas");
+  sdf->color = glGetUniformLocation(program, "color");
+  sdf->blur = glGetUniformLocation(program, "blur");
+  sdf->scissor_mat = glGetUniformLocation(program, "scissor_mat");
+  sdf->scissor_ext = glGetUniformLocation(program, "scissor_ext");
+  sdf->scissor_scale = glGetUniformLocation(program, "scissor_scale");
+
+  sdf->pixels = (unsigned char*)enif_alloc((size_t)sdf->width * sdf->height);
+  memset(sdf->pixels, 0, (size_t)sdf->width * sdf->height);
+  vz_sdf_atlas_upload(sdf);
+  vz_sdf_table_rebuild(sdf, 256);
+
+  return true;
+}
+
+/*
+  Forgets all glyphs, they are rasterized again when they are drawn.
+*/
+static void vz_sdf_atlas_reset(VZsdf *sdf) {
+  sdf->glyph_count = 0;
+  sdf->shelf_count = 0;
+  sdf->bottom = 0;
+  sdf->used = 0;
+  ++sdf->generation;
+  memset(sdf->table, 0xff, sizeof(int) * sdf->table_size);
+}
+
+/*
+  Doubles the shorter side of the atlas, keeping the glyphs where they are.
+*/
+static bool vz_sdf_atlas_grow(VZsdf *sdf) {
+  int width = sdf->width, height = sdf->height;
+  unsigned char *pixels;
+
+  if(height < width && height * 2 <= sdf->max_size)
+    height *= 2;
+  else if(width * 2 <= sdf->max_size)
+    width *= 2;
+  else if(height * 2 <= sdf->max_size)
+    height *= 2;
+  else return false;
+
+  pixels = (unsigned char*)enif_alloc((size_t)width * height);
+  memset(pixels, 0, (size_t)width * height);
+  for(int row = 0; row < sdf->height; ++row)
+    memcpy(pixels + (size_t)row * width, sdf->pixels + (size_t)row * sdf->width, (size_t)sdf->width);
+  enif_free(sdf->pixels);
+
+  sdf->pixels = pixels;
+  sdf->width = width;
+  sdf->height = height;
+  // texture coordinates of the glyphs change
+  ++sdf->generation;
+  vz_sdf_atlas_upload(sdf);
+
+  return true;
+}
+
+/*
+  Evicts the glyphs of the least recently used shelf at least `height` high
+  that no glyph of the current string is on. Returns the shelf or -1.
+*/
+static int vz_sdf_atlas_evict(VZsdf *sdf, int height) {
+  int shelf = -1;
+  unsigned count = 0;
+
+  for(unsigned i = 0; i < sdf->shelf_count; ++i) {
+    VZsdf_shelf *s = &sdf->shelves[i];
+    if(s->height >= height && s->last_used != sdf->use &&
+       (shelf < 0 || s->last_used < sdf->shelves[shelf].last_used))
+      shelf = (int)i;
+  }
+  if(shelf < 0)
+    return -1;
+
+  for(unsigned i = 0; i < sdf->glyph_count; ++i) {
+    VZsdf_glyph *glyph = &sdf->glyphs[i];
+    if(glyph->width && glyph->shelf == shelf) {
+      sdf->used -= (size_t)(glyph->width + 2) * (glyph->height + 2);
+      ++sdf->evictions;
+    }
+    else sdf->glyphs[count++] = *glyph;
+  }
+  sdf->glyph_count = count;
+  vz_sdf_table_rebuild(sdf, sdf->table_size);
+  sdf->shelves[shelf].x = 0;
+
+  return shelf;
+}
+
+/*
+  Finds room for a glyph on the shelf closest to its height, on a new shelf,
+  in a grown atlas or on the shelf of evicted glyphs, in that order.
+*/
+static int vz_sdf_atlas_pack(VZsdf *sdf, int width, int height, int *x, int *y) {
+  VZsdf_shelf *s;
+  int shelf;
+
+  if(width > sdf->max_size || height > sdf->max_size)
+    return -1;
+
+  for(;;) {
+    shelf = -1;
+    for(unsigned i = 0; i < sdf->shelf_count; ++i) {
+      s = &sdf->shelves[i];
+      if(s->height >= height && s->x + width <= sdf->width &&
+         (shelf < 0 || s->height < sdf->shelves[shelf].height))
+        shelf = (int)i;
+    }
+    // a new shelf rather than wasting most of a higher one
+    if(shelf >= 0 && sdf->shelves[shelf].height <= height * 2)
+      break;
+
+    if(sdf->bottom + height <= sdf->height && width <= sdf->width) {
+      if(sdf->shelf_count == sdf->shelf_size) {
+        sdf->shelf_size = sdf->shelf_size ? sdf->shelf_size * 2 : 32;
+        sdf->shelves = (VZsdf_shelf*)enif_realloc(sdf->shelves, sdf->shelf_size * sizeof(VZsdf_shelf));
+      }
+      shelf = (int)sdf->shelf_count++;
+      s = &sdf->shelves[shelf];
+      s->y = sdf->bottom;
+      s->height = height;
+      s->x = 0;
+      sdf->bottom += height;
+      break;
+    }
+
+    if(shelf >= 0 || !vz_sdf_atlas_grow(sdf))
+      break;
+  }
+
+  if(shelf < 0 && (width > sdf->width || (shelf = vz_sdf_atlas_evict(sdf, height)) < 0))
+    return -1;
+
+  s = &sdf->shelves[shelf];
+  *x = s->x;
+  *y = s->y;
+  s->x += width;
+
+  return shelf;
+}
+
+/*
+  Returns the glyph of a font, rasterizing it into the atlas when it isn't
+  there yet, or NULL when the atlas is full of glyphs of the current string.
+*/
+static VZsdf_glyph* vz_sdf_glyph(VZsdf *sdf, VZsdf_font *font, int index) {
+  VZsdf_glyph *glyph;
+  unsigned char *field, *dst;
+  int width = 0, height = 0, x = 0, y = 0, shelf = -1;
+  float x_offset = 0.0f, y_offset = 0.0f;
+
+  if((glyph = vz_sdf_lookup(sdf, font->id, index))) {
+    if(glyph->width)
+      sdf->shelves[glyph->shelf].last_used = sdf->use;
+    return glyph;
+  }
+
+  if((field = vz_sdf_rasterize((stbtt_fontinfo*)font->info, index, &width, &height, &x_offset, &y_offset))) {
+    // with a border of zeros, so neighbours don't bleed in when filtering
+    if((shelf = vz_sdf_atlas_pack(sdf, width + 2, height + 2, &x, &y)) < 0) {
+      enif_free(field);
+      return NULL;
+    }
+    sdf->shelves[shelf].last_used = sdf->use;
+    sdf->used += (size_t)(width + 2) * (height + 2);
+
+    for(int row = 0; row < height + 2; ++row) {
+      dst = sdf->pixels + (size_t)(y + row) * sdf->width + x;
+      memset(dst, 0, (size_t)width + 2);
+      if(row > 0 && row <= height)
+        memcpy(dst + 1, field + (row - 1) * width, (size_t)width);
+    }
+    enif_free(field);
+
+    glBindTexture(GL_TEXTURE_2D, sdf->texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, sdf->width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width + 2, height + 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
+                    sdf->pixels + (size_t)y * sdf->width + x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    ++x;
+    ++y;
+  }
+  ++sdf->rasterized;
+
+  if(sdf->glyph_count == sdf->glyph_size) {
+    sdf->glyph_size = sdf->glyph_size ? sdf->glyph_size * 2 : 256;
+    sdf->glyphs = (VZsdf_glyph*)enif_realloc(sdf->glyphs, sdf->glyph_size * sizeof(VZsdf_glyph));
+  }
+  glyph = &sdf->glyphs[sdf->glyph_count++];
+  glyph->font = font->id;
+  glyph->index = index;
+  glyph->shelf = shelf;
+  glyph->x = x;
+  glyph->y = y;
+  glyph->width = width;
+  glyph->height = height;
+  glyph->x_offset = x_offset;
+  glyph->y_offset = y_offset;
+
+  if(sdf->glyph_count * 2 > sdf->table_size)
+    vz_sdf_table_rebuild(sdf, sdf->table_size * 2);
+  else
+    vz_sdf_table_insert(sdf, (int)(sdf->glyph_count - 1));
+
+  return glyph;
+}
+
+/*
+  Text
+*/
+
+static unsigned vz_sdf_decode_utf8(const char **s, const char *end) {
+  const unsigned char *p = (const unsigned char*)*s;
+  unsigned cp;
+  int n;
+
+  if(p[0] < 0x80) { cp = p[0]; n = 1; }
+  else if((p[0] & 0xe0) == 0xc0) { cp = p[0] & 0x1f; n = 2; }
+  else if((p[0] & 0xf0) == 0xe0) { cp = p[0] & 0x0f; n = 3; }
+  else if((p[0] & 0xf8) == 0xf0) { cp = p[0] & 0x07; n = 4; }
+  else { *s += 1; return 0xfffd; }
+
+  if((const char*)p + n > end) {
+    *s = end;
+    return 0xfffd;
+  }
+  for(int i = 1; i < n; ++i) {
+    if((p[i] & 0xc0) != 0x80) {
+      *s += i;
+      return 0xfffd;
+    }
+    cp = (cp << 6) | (p[i] & 0x3f);
+  }
+
+  *s += n;
+  return cp;
+}
+
+/*
+  Rasterizes the glyphs of a string ahead of drawing it.
+*/
+void vz_sdf_prewarm(VZsdf *sdf, VZsdf_font *font, const char *string, const char *end) {
+  stbtt_fontinfo *info = (stbtt_fontinfo*)font->info;
+
+  if(!vz_sdf_atlas_init(sdf))
+    return;
+
+  ++sdf->use;
+  while(string < end)
+    if(!vz_sdf_glyph(sdf, font, stbtt_FindGlyphIndex(info, (int)vz_sdf_decode_utf8(&string, end))))
+      break;
+}
+
+static float* vz_sdf_reserve(VZsdf *sdf, size_t count) {
+  if(count > sdf->vertex_size) {
+    sdf->vertex_size = MAX(count, sdf->vertex_size * 2);
+    sdf->vertices = (float*)enif_realloc(sdf->vertices, sdf->vertex_size * sizeof(float));
+  }
+  return sdf->vertices;
+}
+
+static inline float* vz_sdf_vertex(float *v, const float *t, float x, float y, float u, float tv) {
+  v[0] = x * t[0] + y * t[2] + t[4];
+  v[1] = x * t[1] + y * t[3] + t[5];
+  v[2] = u;
+  v[3] = tv;
+  return v + 4;
+}
+
+/*
+  Advance of a string in local space, with kerning and letter spacing.
+*/
+static float vz_sdf_advance(VZsdf_font *font, const VZsdf_state *state, float scale, const char *string, const char *end) {
+  stbtt_fontinfo *info = (stbtt_fontinfo*)font->info;
+  int index, prev = -1, advance, lsb;
+  float width = 0.0f;
+
+  while(string < end) {
+    index = stbtt_FindGlyphIndex(info, (int)vz_sdf_decode_utf8(&string, end));
+    if(prev >= 0)
+      width += stbtt_GetGlyphKernAdvance(info, prev, index) * scale;
+    stbtt_GetGlyphHMetrics(info, index, &advance, &lsb);
+    width += advance * scale + state->spacing;
+    prev = index;
+  }
+
+  return width;
+}
+
+static void vz_sdf_draw(VZview *vz_view, int count) {
+  VZsdf *sdf = &vz_view->sdf;
+  VZsdf_state *state = vz_sdf_state(sdf);
+  float fringe = 1.0f / (float)vz_view->pixel_ratio;
+  float k = state->size / VZ_SDF_GLYPH_SIZE;
+  float inv[6], mat[9] = {0.0f}, ext[2] = {1.0f, 1.0f}, scale[2] = {1.0f, 1.0f};
+  NVGcolor color = state->color;
+  GLint viewport[4];
+
+  if(state->scissor_extent[0] >= -0.5f && state->scissor_extent[1] >= -0.5f) {
+    const float *s = state->scissor;
+    nvgTransformInverse(inv, s);
+    mat[0] = inv[0]; mat[1] = inv[1];
+    mat[3] = inv[2]; mat[4] = inv[3];
+    mat[6] = inv[4]; mat[7] = inv[5]; mat[8] = 1.0f;
+    ext[0] = state->scissor_extent[0];
+    ext[1] = state->scissor_extent[1];
+    scale[0] = sqrtf(s[0] * s[0] + s[2] * s[2]) / fringe;
+    scale[1] = sqrtf(s[1] * s[1] + s[3] * s[3]) / fringe;
+  }
+  color.a *= state->alpha;
+
+  // NanoVG draws what it recorded so far, SDF text goes over it
+  nvgEndFrame(vz_view->ctx);
+
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_STENCIL_TEST);
+  glDisable(GL_SCISSOR_TEST);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+  glUseProgram(sdf->program);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, sdf->texture);
+  glUniform1i(sdf->atlas, 0);
+  glUniform2f(sdf->view_size, (float)viewport[2], (float)viewport[3]);
+  glUniform4f(sdf->color, color.r * color.a, color.g * color.a, color.b * color.a, color.a);
+  glUniform1f(sdf->blur, MIN(state->blur / (2.0f * VZ_SDF_SPREAD * k), 0.5f));
+  glUniformMatrix3fv(sdf->scissor_mat, 1, GL_FALSE, mat);
+  glUniform2fv(sdf->scissor_ext, 1, ext);
+  glUniform2fv(sdf->scissor_scale, 1, scale);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, sdf->vertices);
+  glDrawArrays(GL_TRIANGLES, 0, count);
+  glDisableVertexAttribArray(0);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glUseProgram(0);
+}
+
+/*
+  Draws a string with the current SDF font like nvgText does, returns the
+  horizontal position where the next character should be drawn.
+*/
+float vz_sdf_text(VZview *vz_view, float x, float y, const char *string, const char *end) {
+  VZsdf *sdf = &vz_view->sdf;
+  VZsdf_state *state = vz_sdf_state(sdf);
+  VZsdf_font *font = state->font;
+  stbtt_fontinfo *info;
+  VZsdf_glyph *glyph;
+  float xform[6], scale, k, pen, iw, ih, x0, y0, x1, y1, u0, v0, u1, v1;
+  int index, prev, advance, lsb, count = 0;
+  unsigned generation;
+  bool reset = false;
+  const char *s;
+  float *v;
+
+  if(!end)
+    end = string + strlen(string);
+  if(!font || state->size <= 0.0f || !vz_sdf_atlas_init(sdf))
+    return x;
+
+  info = (stbtt_fontinfo*)font->info;
+  scale = stbtt_ScaleForPixelHeight(info, state->size);
+  k = state->size / VZ_SDF_GLYPH_SIZE;
+  nvgCurrentTransform(vz_view->ctx, xform);
+
+  if(state->align & NVG_ALIGN_RIGHT)
+    x -= vz_sdf_advance(font, state, scale, string, end);
+  else if(state->align & NVG_ALIGN_CENTER)
+    x -= vz_sdf_advance(font, state, scale, string, end) * 0.5f;
+
+  if(state->align & NVG_ALIGN_TOP)
+    y += font->ascender * state->size;
+  else if(state->align & NVG_ALIGN_MIDDLE)
+    y += (font->ascender + font->descender) * 0.5f * state->size;
+  else if(state->align & NVG_ALIGN_BOTTOM)
+    y += font->descender * state->size;
+
+  // glyphs of this string aren't evicted to make room for each other
+  ++sdf->use;
+
+  layout:
+  generation = sdf->generation;
+  iw = 1.0f / sdf->width;
+  ih = 1.0f / sdf->height;
+  s = string;
+  pen = x;
+  prev = -1;
+  count = 0;
+  while(s < end) {
+    index = stbtt_FindGlyphIndex(info, (int)vz_sdf_decode_utf8(&s, end));
+    if(prev >= 0)
+      pen += stbtt_GetGlyphKernAdvance(info, prev, index) * scale;
+
+    glyph = vz_sdf_glyph(sdf, font, index);
+    if(!glyph && !reset) {
+      // the atlas is full, start over with the glyphs of this string only
+      vz_sdf_atlas_reset(sdf);
+      reset = true;
+      goto layout;
+    }
+    // the atlas grew, texture coordinates laid out so far are stale
+    if(sdf->generation != generation)
+      goto layout;
+
+    if(glyph && glyph->width) {
+      x0 = pen + glyph->x_offset * k;
+      y0 = y + glyph->y_offset * k;
+      x1 = x0 + glyph->width * k;
+      y1 = y0 + glyph->height * k;
+      u0 = glyph->x * iw;
+      v0 = glyph->y * ih;
+      u1 = (glyph->x + glyph->width) * iw;
+      v1 = (glyph->y + glyph->height) * ih;
+
+      v = vz_sdf_reserve(sdf, (size_t)(count + 6) * 4) + count * 4;
+      v = vz_sdf_vertex(v, xform, x0, y0, u0, v0);
+      v = vz_sdf_vertex(v, xform, x1, y1, u1, v1);
+      v = vz_sdf_vertex(v, xform, x1, y0, u1, v0);
+      v = vz_sdf_vertex(v, xform, x0, y0, u0, v0);
+      v = vz_sdf_vertex(v, xform, x0, y1, u0, v1);
+      vz_sdf_vertex(v, xform, x1, y1, u1, v1);
+      count += 6;
+    }
+
+    stbtt_GetGlyphHMetrics(info, index, &advance, &lsb);
+    pen += advance * scale + state->spacing;
+    prev = index;
+  }
+
+  if(count)
+    vz_sdf_draw(vz_view, count);
+
+  return pen;
+}
+
+/*
+  Draws multi-line text like nvgTextBox does, the lines are broken by NanoVG.
+*/
+void vz_sdf_text_box(VZview *vz_view, float x, float y, float break_row_width, const char *string, const char *end) {
+  VZsdf_state *state = vz_sdf_state(&vz_view->sdf);
+  NVGcontext *ctx = vz_view->ctx;
+  int align = state->align;
+  int halign = align & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
+  int valign = align & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
+  NVGtextRow rows[2];
+  float lineh, row_x;
+  int nrows;
+
+  if(!end)
+    end = string + strlen(string);
+
+  nvgTextMetrics(ctx, NULL, NULL, &lineh);
+  state->align = NVG_ALIGN_LEFT | valign;
+
+  while((nrows = nvgTextBreakLines(ctx, string, end, break_row_width, rows, 2))) {
+    for(int i = 0; i < nrows; ++i) {
+      if(halign & NVG_ALIGN_CENTER)
+        row_x = x + break_row_width * 0.5f - rows[i].width * 0.5f;
+      else if(halign & NVG_ALIGN_RIGHT)
+        row_x = x + break_row_width - rows[i].width;
+      else
+        row_x = x;
+      vz_sdf_text(vz_view, row_x, y, rows[i].start, rows[i].end);
+      y += lineh * state->line_height;
+    }
+    string = rows[nrows - 1].next;
+  }
+
+  state->align = align;
+}
@@ -0,0 +1,141 @@
+#ifndef VZ_SDF_H_INCLUDED
+#define VZ_SDF_H_INCLUDED
+
+#include "nanovg.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define VZ_SDF_ATLAS_SIZE 512
+#define VZ_SDF_ATLAS_MAX_SIZE 2048
+#define VZ_SDF_MAX_STATES 32
+
+struct VZview;
+struct VZsdf_font;
+
+/*
+  Text style of NanoVG that SDF text is drawn with, NanoVG doesn't expose its
+  state so it's mirrored by the ops that change it.
+*/
+typedef struct VZsdf_state {
+  struct VZsdf_font *font;
+  NVGcolor color;
+  float alpha;
+  float size;
+  float blur;
+  float spacing;
+  float line_height;
+  int align;
+  float scissor[6];
+  float scissor_extent[2];
+} VZsdf_state;
+
+typedef struct VZsdf_glyph {
+  int font;
+  int index;
+  int shelf;
+  int x;
+  int y;
+  int width;
+  int height;
+  float x_offset;
+  float y_offset;
+} VZsdf_glyph;
+
+/*
+  A row of the atlas glyphs are packed into from the left, the glyphs of the
+  least recently drawn row are evicted when the atlas can't grow anymore.
+*/
+typedef struct VZsdf_shelf {
+  int y;
+  int height;
+  int x;
+  unsigned last_used;
+} VZsdf_shelf;
+
+/*
+  SDF text
+
+  Fonts created with `sdf: true` are drawn from signed distance fields
+  instead of the glyph bitmaps of fontstash. A glyph is rasterized once, at a
+  fixed size, into an atlas shared by the SDF fonts of a view, and drawn at
+  any size, scale or rotation by a shader that thresholds the distance, so
+  animating the font size or the transform of text costs no rasterization.
+  Font blur widens the threshold.
+
+  The fonts are registered with NanoVG as well, measuring functions and line
+  breaking work as with any other font. Text is drawn with the fill color,
+  gradients and fallback fonts don't apply. SDF text is drawn after
+  flushing what NanoVG recorded before it, consecutive SDF text only flushes
+  once.
+
+  The atlas starts small and doubles up to its maximum size as glyphs are
+  added, the glyphs are kept in memory to copy them over. A full atlas evicts
+  the row of glyphs drawn the longest ago, and is only cleared when a single
+  string doesn't fit in it.
+*/
+typedef struct VZsdf_font {
+  int id;
+  int handle;
+  void *info;
+  float ascender;
+  float descender;
+} VZsdf_font;
+
+typedef struct VZsdf {
+  VZsdf_font **fonts;
+  unsigned font_count;
+  VZsdf_glyph *glyphs;
+  unsigned glyph_count;
+  unsigned glyph_size;
+  int *table;
+  unsigned table_size;
+  unsigned texture;
+  unsigned char *pixels;
+  int width;
+  int height;
+  int init_size;
+  int max_size;
+  VZsdf_shelf *shelves;
+  unsigned shelf_count;
+  unsigned shelf_size;
+  int bottom;
+  size_t used;
+  unsigned use;
+  unsigned generation;
+  unsigned long rasterized;
+  unsigned long evictions;
+  unsigned program;
+  int view_size;
+  int atlas;
+  int color;
+  int blur;
+  int scissor_mat;
+  int scissor_ext;
+  int scissor_scale;
+  float *vertices;
+  size_t vertex_size;
+  VZsdf_state states[VZ_SDF_MAX_STATES];
+  int nstates;
+} VZsdf;
+
+void vz_sdf_init(VZsdf *sdf, int size, int max_size);
+void vz_sdf_free(VZsdf *sdf);
+VZsdf_font* vz_sdf_find_font(VZsdf *sdf, int handle);
+bool vz_sdf_add_font(VZsdf *sdf, int handle, const unsigned char *data);
+void vz_sdf_prewarm(VZsdf *sdf, VZsdf_font *font, const char *string, const char *end);
+
+VZsdf_state* vz_sdf_state(VZsdf *sdf);
+void vz_sdf_save(VZsdf *sdf);
+void vz_sdf_restore(VZsdf *sdf);
+void vz_sdf_reset(VZsdf *sdf);
+void vz_sdf_begin_frame(VZsdf *sdf);
+void vz_sdf_font_face(VZsdf *sdf, int handle);
+void vz_sdf_scissor(VZsdf *sdf, const float *xform, float x, float y, float w, float h);
+void vz_sdf_intersect_scissor(VZsdf *sdf, const float *xform, float x, float y, float w, float h);
+void vz_sdf_reset_scissor(VZsdf *sdf);
+
+float vz_sdf_text(struct VZview *vz_view, float x, float y, const char *string, const char *end);
+void vz_sdf_text_box(struct VZview *vz_view, float x, float y, float break_row_width, const char *string, const char *end);
+
+#endif
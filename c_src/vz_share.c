@@ -0,0 +1,161 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_share.h"
+
+#include <erl_nif.h>
+
+#if defined(VZ_PLATFORM_X11)
+#include "GL/glew.h"
+#include "GL/glxew.h"
+#include <X11/Xutil.h>
+#elif defined(VZ_PLATFORM_WINDOWS)
+#include <windows.h>
+#endif
+
+
+#if defined(VZ_PLATFORM_X11)
+static bool vz_share_error;
+
+static int vz_share_trap_error(Display *display, XErrorEvent *event) {
+  __UNUSED(display);
+  __UNUSED(event);
+  vz_share_error = true;
+  return 0;
+}
+#endif
+
+bool vz_share_group_init(VZshare_group *group) {
+  group->views = NULL;
+  group->count = group->size = 0;
+
+  return (group->lock = enif_mutex_create("vz_share_group_mutex")) != NULL;
+}
+
+void vz_share_group_free(VZshare_group *group) {
+  if(group->lock) {
+    enif_mutex_destroy(group->lock);
+    group->lock = NULL;
+  }
+  enif_free(group->views);
+  group->views = NULL;
+  group->count = group->size = 0;
+}
+
+static void vz_share_group_add(VZshare_group *group, VZview *vz_view) {
+  if(group->count == group->size) {
+    group->size = group->size ? group->size * 2 : 8;
+    group->views = (VZview**)enif_realloc(group->views, group->size * sizeof(VZview*));
+  }
+  group->views[group->count++] = vz_view;
+}
+
+/*
+  Makes the context of a view a member of the share group. Called with the
+  context of its window current, before anything is created in it. On X11 the
+  context of the view is current when it returns. Returns false when the view
+  keeps an unshared context.
+*/
+bool vz_share_attach(VZview *vz_view) {
+  VZshare_group *group = vz_view->share_group;
+  void *share;
+
+  vz_view->share_context = NULL;
+
+  enif_mutex_lock(group->lock);
+  share = group->count > 0 ? group->views[0]->share_context : NULL;
+
+#if defined(VZ_PLATFORM_X11)
+  {
+    Display *display = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    GLXContext own = glXGetCurrentContext();
+    XWindowAttributes attrs;
+    XVisualInfo info, *visual;
+    GLXContext context = NULL;
+    XErrorHandler handler;
+    int count;
+
+    if(XGetWindowAttributes(display, drawable, &attrs)) {
+      info.visualid = XVisualIDFromVisual(attrs.visual);
+      if((visual = XGetVisualInfo(display, VisualIDMask, &info, &count))) {
+        // a context that can't share with the group raises an X error, which
+        // would terminate the BEAM, the group lock serializes the handler
+        XSync(display, False);
+        vz_share_error = false;
+        handler = XSetErrorHandler(vz_share_trap_error);
+        context = glXCreateContext(display, visual, (GLXContext)share, True);
+        XSync(display, False);
+        XSetErrorHandler(handler);
+        XFree(visual);
+        if(context && vz_share_error) {
+          glXDestroyContext(display, context);
+          context = NULL;
+        }
+      }
+    }
+
+    if(context && glXMakeCurrent(display, drawable, context)) {
+      vz_view->share_context = context;
+      vz_view->share_drawable = drawable;
+    }
+    else if(context) {
+      glXDestroyContext(display, context);
+      glXMakeCurrent(display, drawable, own);
+    }
+  }
+#elif defined(VZ_PLATFORM_WINDOWS)
+  {
+    HGLRC context = wglGetCurrentContext();
+
+    if(!share || wglShareLists((HGLRC)share, context))
+      vz_view->share_context = context;
+  }
+#else
+  __UNUSED(share);
+#endif
+
+  if(vz_view->share_context)
+    vz_share_group_add(group, vz_view);
+  enif_mutex_unlock(group->lock);
+
+  return vz_view->share_context != NULL;
+}
+
+/*
+  Makes the context of a view current again after Pugl entered the context of
+  its window.
+*/
+void vz_share_bind(VZview *vz_view) {
+#if defined(VZ_PLATFORM_X11)
+  if(vz_view->share_context)
+    glXMakeCurrent(vz_view->display, vz_view->share_drawable, (GLXContext)vz_view->share_context);
+#else
+  __UNUSED(vz_view);
+#endif
+}
+
+/*
+  Removes the context of a view from the share group, after everything it
+  created was deleted. The context of its window must be entered.
+*/
+void vz_share_detach(VZview *vz_view) {
+  VZshare_group *group = vz_view->share_group;
+
+  if(!vz_view->share_context)
+    return;
+
+  enif_mutex_lock(group->lock);
+  for(unsigned i = 0; i < group->count; ++i) {
+    if(group->views[i] == vz_view) {
+      group->views[i] = group->views[--group->count];
+      break;
+    }
+  }
+#if defined(VZ_PLATFORM_X11)
+  if(glXGetCurrentContext() == (GLXContext)vz_view->share_context)
+    glXMakeCurrent(vz_view->display, None, NULL);
+  glXDestroyContext(vz_view->display, (GLXContext)vz_view->share_context);
+#endif
+  vz_view->share_context = NULL;
+  enif_mutex_unlock(group->lock);
+}
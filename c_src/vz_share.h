@@ -0,0 +1,40 @@
+#ifndef VZ_SHARE_H_INCLUDED
+#define VZ_SHARE_H_INCLUDED
+
+#include <erl_nif.h>
+#include <stdbool.h>
+
+struct VZview;
+
+/*
+  GL share group
+
+  The GL contexts of all views of the BEAM are created in one share group, so
+  a texture uploaded by one view can be drawn by all of them. Image assets are
+  uploaded once, into a texture owned by the asset, and views only create a
+  NanoVG image wrapping it.
+
+  Pugl creates the context of a window without a share context. On X11 a view
+  creates a second context for its window, sharing with a member of the
+  group, and makes it current after Pugl entered its own. On Windows the
+  context of the window joins the group with wglShareLists before anything is
+  created in it. A view whose context can't join the group keeps its own and
+  uploads its textures itself.
+
+  Font atlases are created by NanoVG in every context and are not shared, only
+  the font file data is.
+*/
+typedef struct VZshare_group {
+  ErlNifMutex *lock;
+  struct VZview **views;
+  unsigned count;
+  unsigned size;
+} VZshare_group;
+
+bool vz_share_group_init(VZshare_group *group);
+void vz_share_group_free(VZshare_group *group);
+bool vz_share_attach(struct VZview *vz_view);
+void vz_share_bind(struct VZview *vz_view);
+void vz_share_detach(struct VZview *vz_view);
+
+#endif
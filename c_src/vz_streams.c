@@ -0,0 +1,158 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_streams.h"
+
+#include "GL/glew.h"
+
+#include <erl_nif.h>
+#include <string.h>
+
+
+static void vz_stream_map(VZstream *stream, VZstream_slot *slot) {
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)stream->size, NULL, GL_STREAM_DRAW);
+  slot->data = (unsigned char*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+  slot->state = slot->data ? VZ_SLOT_FREE : VZ_SLOT_IN_FLIGHT;
+}
+
+/*
+  Creates a stream of buffers of `size` bytes, must be called on the render
+  thread while the GL context is current.
+*/
+VZstream* vz_stream_create(size_t size) {
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  VZstream *stream = (VZstream*)enif_alloc(sizeof(VZstream));
+  VZstream_slot *slot;
+
+  memset(stream, 0, sizeof(VZstream));
+  stream->size = size;
+  stream->persistent = GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+  if(!(stream->idle_cv = enif_cond_create("vz_stream_idle_cv"))) {
+    enif_free(stream);
+    return NULL;
+  }
+
+  for(int i = 0; i < VZ_STREAM_SLOT_COUNT; ++i) {
+    slot = &stream->slots[i];
+    glGenBuffers(1, &slot->buffer);
+
+    if(stream->persistent) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, flags);
+      slot->data = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, flags);
+      slot->state = slot->data ? VZ_SLOT_FREE : VZ_SLOT_IN_FLIGHT;
+    }
+    else vz_stream_map(stream, slot);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  return stream;
+}
+
+/*
+  Deletes the buffers once no process is copying into them anymore, called
+  on the render thread with the view lock held.
+*/
+void vz_stream_free(VZview *vz_view, VZstream *stream) {
+  VZstream_slot *slot;
+
+  while(stream->writers > 0)
+    enif_cond_wait(stream->idle_cv, vz_view->lock);
+
+  for(int i = 0; i < VZ_STREAM_SLOT_COUNT; ++i) {
+    slot = &stream->slots[i];
+    if(slot->fence)
+      glDeleteSync((GLsync)slot->fence);
+    if(slot->data) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    glDeleteBuffers(1, &slot->buffer);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  enif_cond_destroy(stream->idle_cv);
+  enif_free(stream);
+}
+
+/*
+  Claims a free slot for the caller to copy `size` bytes into, called with the
+  view lock held. Returns -1 when all slots are busy.
+*/
+int vz_stream_claim(VZstream *stream, unsigned char **data) {
+  for(int i = 0; i < VZ_STREAM_SLOT_COUNT; ++i) {
+    if(stream->slots[i].state == VZ_SLOT_FREE) {
+      stream->slots[i].state = VZ_SLOT_WRITING;
+      ++stream->writers;
+      *data = stream->slots[i].data;
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+void vz_stream_written(VZstream *stream, int slot) {
+  stream->slots[slot].state = VZ_SLOT_WRITTEN;
+  if(--stream->writers == 0)
+    enif_cond_broadcast(stream->idle_cv);
+}
+
+/*
+  Frees the slots of persistent buffers whose copies completed.
+*/
+void vz_stream_recycle(VZstream *stream) {
+  VZstream_slot *slot;
+  GLenum status;
+
+  if(!stream->persistent)
+    return;
+
+  for(int i = 0; i < VZ_STREAM_SLOT_COUNT; ++i) {
+    slot = &stream->slots[i];
+    if(slot->state != VZ_SLOT_IN_FLIGHT || !slot->fence)
+      continue;
+
+    status = glClientWaitSync((GLsync)slot->fence, 0, 0);
+    if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+      glDeleteSync((GLsync)slot->fence);
+      slot->fence = NULL;
+      slot->state = VZ_SLOT_FREE;
+    }
+  }
+}
+
+/*
+  Binds the buffer of a written slot as source of texture uploads, the data
+  starts at offset 0. Returns false when the slot wasn't written.
+*/
+bool vz_stream_bind(VZstream *stream, int slot) {
+  VZstream_slot *s = &stream->slots[slot];
+
+  if(s->state != VZ_SLOT_WRITTEN)
+    return false;
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s->buffer);
+  if(!stream->persistent) {
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    s->data = NULL;
+  }
+
+  return true;
+}
+
+/*
+  Hands the slot back to the ring after the uploads from it were issued, and
+  unbinds it, NanoVG uploads its textures from client memory.
+*/
+void vz_stream_unbind(VZstream *stream, int slot) {
+  VZstream_slot *s = &stream->slots[slot];
+
+  if(stream->persistent) {
+    s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s->state = VZ_SLOT_IN_FLIGHT;
+  }
+  else vz_stream_map(stream, s);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
@@ -0,0 +1,58 @@
+#ifndef VZ_STREAMS_H_INCLUDED
+#define VZ_STREAMS_H_INCLUDED
+
+#include <erl_nif.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define VZ_STREAM_SLOT_COUNT 3
+
+struct VZview;
+
+enum VZstream_slot_state {
+  VZ_SLOT_FREE,
+  VZ_SLOT_WRITING,
+  VZ_SLOT_WRITTEN,
+  VZ_SLOT_IN_FLIGHT
+};
+
+/*
+  Upload streams
+
+  A ring of pixel unpack buffers that stay mapped, so the process updating
+  an image copies its data straight into GL memory from a dirty scheduler,
+  without holding the view lock. The render thread only issues the copy from
+  the buffer to the texture, which the driver performs while it renders.
+
+  With ARB_buffer_storage the buffers are mapped persistently and a slot is
+  reused once the fence behind its last copy is signaled. Otherwise a slot is
+  mapped again right after its copy is issued, respecifying the storage of its
+  buffer so the driver hands out fresh memory instead of waiting.
+
+  Slots are claimed and released with the view lock held. When all slots are
+  busy, callers fall back to uploading from client memory.
+*/
+typedef struct VZstream_slot {
+  unsigned buffer;
+  unsigned char *data;
+  void *fence;
+  enum VZstream_slot_state state;
+} VZstream_slot;
+
+typedef struct VZstream {
+  size_t size;
+  bool persistent;
+  unsigned writers;
+  ErlNifCond *idle_cv;
+  VZstream_slot slots[VZ_STREAM_SLOT_COUNT];
+} VZstream;
+
+VZstream* vz_stream_create(size_t size);
+void vz_stream_free(struct VZview *vz_view, VZstream *stream);
+int vz_stream_claim(VZstream *stream, unsigned char **data);
+void vz_stream_written(VZstream *stream, int slot);
+void vz_stream_recycle(VZstream *stream);
+bool vz_stream_bind(VZstream *stream, int slot);
+void vz_stream_unbind(VZstream *stream, int slot);
+
+#endif
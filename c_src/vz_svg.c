@@ -0,0 +1,965 @@
+#include "vz_helpers.h"
+#include "vz_svg.h"
+
+#include <erl_nif.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VZ_SVG_MAX_DEPTH 64
+#define VZ_SVG_MAX_ATTRS 64
+
+
+/*
+  Style of an element, inherited by its children.
+*/
+typedef struct VZsvg_attr {
+  float xform[6];
+  NVGcolor color;
+  NVGcolor fill;
+  NVGcolor stroke;
+  float opacity;
+  float fill_opacity;
+  float stroke_opacity;
+  float stroke_width;
+  float miter_limit;
+  int line_cap;
+  int line_join;
+  bool has_fill;
+  bool has_stroke;
+  bool visible;
+} VZsvg_attr;
+
+typedef struct VZsvg_parser {
+  VZsvg *svg;
+  VZsvg_attr attrs[VZ_SVG_MAX_DEPTH];
+  int depth;
+  // depth of the element whose children aren't drawn, 0 when drawing
+  int skip_depth;
+  // open elements nested too deep, which are ignored
+  int overflow;
+  bool has_view_box;
+} VZsvg_parser;
+
+// the CSS named colors, sorted by name
+static const struct {
+  const char *name;
+  unsigned rgb;
+} vz_svg_colors[] = {
+  {"aliceblue", 0xf0f8ff}, {"antiquewhite", 0xfaebd7}, {"aqua", 0x00ffff}, {"aquamarine", 0x7fffd4},
+  {"azure", 0xf0ffff}, {"beige", 0xf5f5dc}, {"bisque", 0xffe4c4}, {"black", 0x000000},
+  {"blanchedalmond", 0xffebcd}, {"blue", 0x0000ff}, {"blueviolet", 0x8a2be2}, {"brown", 0xa52a2a},
+  {"burlywood", 0xdeb887}, {"cadetblue", 0x5f9ea0}, {"chartreuse", 0x7fff00},
+  {"chocolate", 0xd2691e}, {"coral", 0xff7f50}, {"cornflowerblue", 0x6495ed},
+  {"cornsilk", 0xfff8dc}, {"crimson", 0xdc143c}, {"cyan", 0x00ffff}, {"darkblue", 0x00008b},
+  {"darkcyan", 0x008b8b}, {"darkgoldenrod", 0xb8860b}, {"darkgray", 0xa9a9a9},
+  {"darkgreen", 0x006400}, {"darkgrey", 0xa9a9a9}, {"darkkhaki", 0xbdb76b},
+  {"darkmagenta", 0x8b008b}, {"darkolivegreen", 0x556b2f}, {"darkorange", 0xff8c00},
+  {"darkorchid", 0x9932cc}, {"darkred", 0x8b0000}, {"darksalmon", 0xe9967a},
+  {"darkseagreen", 0x8fbc8f}, {"darkslateblue", 0x483d8b}, {"darkslategray", 0x2f4f4f},
+  {"darkslategrey", 0x2f4f4f}, {"darkturquoise", 0x00ced1}, {"darkviolet", 0x9400d3},
+  {"deeppink", 0xff1493}, {"deepskyblue", 0x00bfff}, {"dimgray", 0x696969}, {"dimgrey", 0x696969},
+  {"dodgerblue", 0x1e90ff}, {"firebrick", 0xb22222}, {"floralwhite", 0xfffaf0},
+  {"forestgreen", 0x228b22}, {"fuchsia", 0xff00ff}, {"gainsboro", 0xdcdcdc},
+  {"ghostwhite", 0xf8f8ff}, {"gold", 0xffd700}, {"goldenrod", 0xdaa520}, {"gray", 0x808080},
+  {"green", 0x008000}, {"greenyellow", 0xadff2f}, {"grey", 0x808080}, {"honeydew", 0xf0fff0},
+  {"hotpink", 0xff69b4}, {"indianred", 0xcd5c5c}, {"indigo", 0x4b0082}, {"ivory", 0xfffff0},
+  {"khaki", 0xf0e68c}, {"lavender", 0xe6e6fa}, {"lavenderblush", 0xfff0f5}, {"lawngreen", 0x7cfc00},
+  {"lemonchiffon", 0xfffacd}, {"lightblue", 0xadd8e6}, {"lightcoral", 0xf08080},
+  {"lightcyan", 0xe0ffff}, {"lightgoldenrodyellow", 0xfafad2}, {"lightgray", 0xd3d3d3},
+  {"lightgreen", 0x90ee90}, {"lightgrey", 0xd3d3d3}, {"lightpink", 0xffb6c1},
+  {"lightsalmon", 0xffa07a}, {"lightseagreen", 0x20b2aa}, {"lightskyblue", 0x87cefa},
+  {"lightslategray", 0x778899}, {"lightslategrey", 0x778899}, {"lightsteelblue", 0xb0c4de},
+  {"lightyellow", 0xffffe0}, {"lime", 0x00ff00}, {"limegreen", 0x32cd32}, {"linen", 0xfaf0e6},
+  {"magenta", 0xff00ff}, {"maroon", 0x800000}, {"mediumaquamarine", 0x66cdaa},
+  {"mediumblue", 0x0000cd}, {"mediumorchid", 0xba55d3}, {"mediumpurple", 0x9370db},
+  {"mediumseagreen", 0x3cb371}, {"mediumslateblue", 0x7b68ee}, {"mediumspringgreen", 0x00fa9a},
+  {"mediumturquoise", 0x48d1cc}, {"mediumvioletred", 0xc71585}, {"midnightblue", 0x191970},
+  {"mintcream", 0xf5fffa}, {"mistyrose", 0xffe4e1}, {"moccasin", 0xffe4b5},
+  {"navajowhite", 0xffdead}, {"navy", 0x000080}, {"oldlace", 0xfdf5e6}, {"olive", 0x808000},
+  {"olivedrab", 0x6b8e23}, {"orange", 0xffa500}, {"orangered", 0xff4500}, {"orchid", 0xda70d6},
+  {"palegoldenrod", 0xeee8aa}, {"palegreen", 0x98fb98}, {"paleturquoise", 0xafeeee},
+  {"palevioletred", 0xdb7093}, {"papayawhip", 0xffefd5}, {"peachpuff", 0xffdab9},
+  {"peru", 0xcd853f}, {"pink", 0xffc0cb}, {"plum", 0xdda0dd}, {"powderblue", 0xb0e0e6},
+  {"purple", 0x800080}, {"rebeccapurple", 0x663399}, {"red", 0xff0000}, {"rosybrown", 0xbc8f8f},
+  {"royalblue", 0x4169e1}, {"saddlebrown", 0x8b4513}, {"salmon", 0xfa8072},
+  {"sandybrown", 0xf4a460}, {"seagreen", 0x2e8b57}, {"seashell", 0xfff5ee}, {"sienna", 0xa0522d},
+  {"silver", 0xc0c0c0}, {"skyblue", 0x87ceeb}, {"slateblue", 0x6a5acd}, {"slategray", 0x708090},
+  {"slategrey", 0x708090}, {"snow", 0xfffafa}, {"springgreen", 0x00ff7f}, {"steelblue", 0x4682b4},
+  {"tan", 0xd2b48c}, {"teal", 0x008080}, {"thistle", 0xd8bfd8}, {"tomato", 0xff6347},
+  {"turquoise", 0x40e0d0}, {"violet", 0xee82ee}, {"wheat", 0xf5deb3}, {"white", 0xffffff},
+  {"whitesmoke", 0xf5f5f5}, {"yellow", 0xffff00}, {"yellowgreen", 0x9acd32}
+};
+
+// elements whose children are definitions or text, not drawn in place
+static const char *vz_svg_skipped[] = {
+  "defs", "clipPath", "mask", "symbol", "pattern", "marker", "linearGradient",
+  "radialGradient", "text", "title", "desc", "metadata", "style", "script"
+};
+
+static const char* vz_svg_skip_space(const char *s) {
+  while(*s && (isspace((unsigned char)*s) || *s == ','))
+    ++s;
+  return s;
+}
+
+/*
+  Reads a number, skipping the spaces and commas before it. Returns NULL when
+  there is no number.
+*/
+static const char* vz_svg_number(const char *s, float *value) {
+  char *end;
+
+  s = vz_svg_skip_space(s);
+  if(!(isdigit((unsigned char)*s) || *s == '-' || *s == '+' || *s == '.'))
+    return NULL;
+  *value = strtof(s, &end);
+
+  return end == s ? NULL : end;
+}
+
+static float vz_svg_length(const char *s) {
+  float value = 0;
+  vz_svg_number(s, &value);
+  return value;
+}
+
+/*
+  Reads an arc flag, which needn't be separated from what follows it.
+*/
+static const char* vz_svg_flag(const char *s, float *value) {
+  s = vz_svg_skip_space(s);
+  if(*s != '0' && *s != '1')
+    return NULL;
+  *value = (float)(*s - '0');
+  return s + 1;
+}
+
+static bool vz_svg_named_color(const char *s, size_t len, unsigned *rgb) {
+  int lo = 0, hi = (int)(sizeof(vz_svg_colors) / sizeof(vz_svg_colors[0])) - 1, mid, cmp;
+
+  while(lo <= hi) {
+    mid = (lo + hi) / 2;
+    if((cmp = strncmp(s, vz_svg_colors[mid].name, len)) == 0)
+      cmp = vz_svg_colors[mid].name[len] == '\0' ? 0 : -1;
+    if(cmp == 0) {
+      *rgb = vz_svg_colors[mid].rgb;
+      return true;
+    }
+    if(cmp < 0) hi = mid - 1;
+    else lo = mid + 1;
+  }
+
+  return false;
+}
+
+/*
+  Reads a component of a color function, `scale` maps percentages to its
+  range. The alpha component may also be separated by a slash.
+*/
+static const char* vz_svg_color_arg(const char *s, float scale, float *value) {
+  s = vz_svg_skip_space(s);
+  if(*s == '/')
+    ++s;
+  if(!(s = vz_svg_number(s, value)))
+    return NULL;
+  if(*s == '%') {
+    *value *= scale / 100.f;
+    ++s;
+  }
+  else if(strncmp(s, "deg", 3) == 0)
+    s += 3;
+  return s;
+}
+
+/*
+  Parses the arguments of rgb(), rgba(), hsl() and hsla(), past the opening
+  parenthesis. The alpha component is optional in all of them.
+*/
+static bool vz_svg_color_function(const char *s, bool hsl, NVGcolor *color) {
+  float c[4] = {0, 0, 0, 1};
+
+  for(int i = 0; i < 4; ++i) {
+    const char *next = vz_svg_color_arg(s, i == 3 ? 1.f : hsl ? 1.f : 255.f, &c[i]);
+    if(!next) {
+      if(i < 3)
+        return false;
+      break;
+    }
+    s = next;
+  }
+  s = vz_svg_skip_space(s);
+  if(*s != ')')
+    return false;
+
+  c[3] = MIN(MAX(c[3], 0.f), 1.f);
+  if(hsl) {
+    // percentages of hsl() are read as fractions
+    *color = nvgHSLA(fmodf(c[0], 360.f) / 360.f, MIN(MAX(c[1], 0.f), 1.f), MIN(MAX(c[2], 0.f), 1.f),
+                     (unsigned char)(c[3] * 255.f + 0.5f));
+    return true;
+  }
+
+  for(int i = 0; i < 3; ++i)
+    c[i] = MIN(MAX(c[i], 0.f), 255.f) / 255.f;
+  *color = nvgRGBAf(c[0], c[1], c[2], c[3]);
+
+  return true;
+}
+
+/*
+  Parses a paint or a color. Leaves the color untouched and returns false
+  when it isn't valid, so that the inherited paint applies.
+*/
+static bool vz_svg_color(const char *s, const VZsvg_attr *attr, NVGcolor *color, bool *has_color) {
+  unsigned rgb, a = 0xff;
+  const char *end;
+  size_t len;
+
+  while(isspace((unsigned char)*s)) ++s;
+  for(len = strlen(s); len > 0 && isspace((unsigned char)s[len - 1]); --len);
+
+  // paint servers aren't imported, the fallback color applies
+  if(strncmp(s, "url(", 4) == 0) {
+    if(!(end = memchr(s, ')', len)))
+      return false;
+    for(++end; end < s + len && isspace((unsigned char)*end); ++end);
+    if(end == s + len) {
+      *has_color = false;
+      return true;
+    }
+    len -= (size_t)(end - s);
+    s = end;
+  }
+
+  if(len == 4 && strncmp(s, "none", 4) == 0) {
+    *has_color = false;
+    return true;
+  }
+  if(len == 12 && strncmp(s, "currentColor", 12) == 0) {
+    *color = attr->color;
+    *has_color = true;
+    return true;
+  }
+  if(len == 11 && strncmp(s, "transparent", 11) == 0) {
+    *color = nvgRGBA(0, 0, 0, 0);
+    *has_color = true;
+    return true;
+  }
+
+  if(strncmp(s, "rgb(", 4) == 0 || strncmp(s, "rgba(", 5) == 0 ||
+     strncmp(s, "hsl(", 4) == 0 || strncmp(s, "hsla(", 5) == 0) {
+    if(!vz_svg_color_function(strchr(s, '(') + 1, *s == 'h', color))
+      return false;
+    *has_color = true;
+    return true;
+  }
+
+  if(*s == '#') {
+    for(size_t i = 1; i < len; ++i)
+      if(!isxdigit((unsigned char)s[i]))
+        return false;
+    rgb = (unsigned)strtoul(s + 1, NULL, 16);
+    // #rgb, #rgba, #rrggbb and #rrggbbaa
+    if(len == 5 || len == 9) {
+      a = rgb & (len == 5 ? 0xf : 0xff);
+      a = len == 5 ? a * 0x11 : a;
+      rgb >>= len == 5 ? 4 : 8;
+    }
+    if(len == 4 || len == 5)
+      rgb = ((rgb & 0xf00) << 12 | (rgb & 0xf0) << 8 | (rgb & 0xf) << 4) * 0x11 / 0x10;
+    else if(len != 7 && len != 9)
+      return false;
+  }
+  else if(!vz_svg_named_color(s, len, &rgb))
+    return false;
+
+  *color = nvgRGBA((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff, a);
+  *has_color = true;
+
+  return true;
+}
+
+/*
+  Parses a list of transform functions into the transform they apply, the
+  rightmost first.
+*/
+static void vz_svg_transform(const char *s, float *xform) {
+  float args[6], t[6], t2[6];
+  const char *next;
+  int count;
+
+  nvgTransformIdentity(xform);
+
+  while(*(s = vz_svg_skip_space(s))) {
+    const char *name = s;
+    while(isalpha((unsigned char)*s)) ++s;
+    size_t len = (size_t)(s - name);
+    s = vz_svg_skip_space(s);
+    if(*s != '(')
+      return;
+    ++s;
+    for(count = 0; count < 6 && (next = vz_svg_number(s, &args[count])); ++count)
+      s = next;
+    s = vz_svg_skip_space(s);
+    if(*s != ')')
+      return;
+    ++s;
+
+    nvgTransformIdentity(t);
+    if(len == 6 && strncmp(name, "matrix", 6) == 0 && count == 6)
+      memcpy(t, args, sizeof(t));
+    else if(len == 9 && strncmp(name, "translate", 9) == 0 && count >= 1)
+      nvgTransformTranslate(t, args[0], count > 1 ? args[1] : 0);
+    else if(len == 5 && strncmp(name, "scale", 5) == 0 && count >= 1)
+      nvgTransformScale(t, args[0], count > 1 ? args[1] : args[0]);
+    else if(len == 6 && strncmp(name, "rotate", 6) == 0 && count >= 1) {
+      if(count == 3) {
+        nvgTransformTranslate(t, -args[1], -args[2]);
+        nvgTransformRotate(t2, nvgDegToRad(args[0]));
+        nvgTransformMultiply(t, t2);
+        nvgTransformTranslate(t2, args[1], args[2]);
+        nvgTransformMultiply(t, t2);
+      }
+      else nvgTransformRotate(t, nvgDegToRad(args[0]));
+    }
+    else if(len == 5 && strncmp(name, "skewX", 5) == 0 && count == 1)
+      nvgTransformSkewX(t, nvgDegToRad(args[0]));
+    else if(len == 5 && strncmp(name, "skewY", 5) == 0 && count == 1)
+      nvgTransformSkewY(t, nvgDegToRad(args[0]));
+
+    nvgTransformPremultiply(xform, t);
+  }
+}
+
+static int vz_svg_keyword(const char *s, const char **names, const int *values, int count, int fallback) {
+  while(isspace((unsigned char)*s)) ++s;
+  for(int i = 0; i < count; ++i)
+    if(strncmp(s, names[i], strlen(names[i])) == 0)
+      return values[i];
+  return fallback;
+}
+
+static void vz_svg_style_attr(VZsvg_attr *attr, const char *name, const char *value) {
+  static const char *caps[] = {"butt", "round", "square"};
+  static const int cap_values[] = {NVG_BUTT, NVG_ROUND, NVG_SQUARE};
+  static const char *joins[] = {"miter", "round", "bevel"};
+  static const int join_values[] = {NVG_MITER, NVG_ROUND, NVG_BEVEL};
+  float xform[6];
+
+  if(strcmp(name, "fill") == 0)
+    vz_svg_color(value, attr, &attr->fill, &attr->has_fill);
+  else if(strcmp(name, "stroke") == 0)
+    vz_svg_color(value, attr, &attr->stroke, &attr->has_stroke);
+  else if(strcmp(name, "color") == 0) {
+    bool has_color;
+    vz_svg_color(value, attr, &attr->color, &has_color);
+  }
+  else if(strcmp(name, "opacity") == 0)
+    attr->opacity *= MIN(MAX(vz_svg_length(value), 0.f), 1.f);
+  else if(strcmp(name, "fill-opacity") == 0)
+    attr->fill_opacity = MIN(MAX(vz_svg_length(value), 0.f), 1.f);
+  else if(strcmp(name, "stroke-opacity") == 0)
+    attr->stroke_opacity = MIN(MAX(vz_svg_length(value), 0.f), 1.f);
+  else if(strcmp(name, "stroke-width") == 0)
+    attr->stroke_width = vz_svg_length(value);
+  else if(strcmp(name, "stroke-miterlimit") == 0)
+    attr->miter_limit = vz_svg_length(value);
+  else if(strcmp(name, "stroke-linecap") == 0)
+    attr->line_cap = vz_svg_keyword(value, caps, cap_values, 3, attr->line_cap);
+  else if(strcmp(name, "stroke-linejoin") == 0)
+    attr->line_join = vz_svg_keyword(value, joins, join_values, 3, attr->line_join);
+  else if(strcmp(name, "display") == 0)
+    attr->visible = attr->visible && strstr(value, "none") == NULL;
+  else if(strcmp(name, "visibility") == 0)
+    attr->visible = strstr(value, "hidden") == NULL && strstr(value, "collapse") == NULL;
+  else if(strcmp(name, "transform") == 0) {
+    vz_svg_transform(value, xform);
+    nvgTransformPremultiply(attr->xform, xform);
+  }
+}
+
+/*
+  Applies the declarations of a style attribute, which take precedence over
+  presentation attributes.
+*/
+static void vz_svg_style(VZsvg_attr *attr, char *s) {
+  char *decl, *colon, *name, *end;
+
+  while(*s) {
+    decl = s;
+    while(*s && *s != ';') ++s;
+    if(*s) *s++ = '\0';
+    if(!(colon = strchr(decl, ':')))
+      continue;
+    *colon = '\0';
+    for(name = decl; isspace((unsigned char)*name); ++name);
+    for(end = colon; end > name && isspace((unsigned char)end[-1]); --end);
+    *end = '\0';
+    vz_svg_style_attr(attr, name, colon + 1);
+  }
+}
+
+static const char* vz_svg_attr(char **attrs, int count, const char *name) {
+  for(int i = 0; i < count; ++i)
+    if(strcmp(attrs[i * 2], name) == 0)
+      return attrs[i * 2 + 1];
+  return NULL;
+}
+
+static float vz_svg_attr_length(char **attrs, int count, const char *name) {
+  const char *value = vz_svg_attr(attrs, count, name);
+  return value ? vz_svg_length(value) : 0.f;
+}
+
+/*
+  Elliptical arc from the current point, split into curves of at most 90
+  degrees after converting it to center parameterization.
+*/
+static void vz_svg_arc(VZpath *path, float x1, float y1, const float *args) {
+  float rx = fabsf(args[0]), ry = fabsf(args[1]), rotx = args[2] / 180.0f * VZ_PI;
+  bool large = args[3] != 0, sweep = args[4] != 0;
+  float x2 = args[5], y2 = args[6];
+  float dx = x1 - x2, dy = y1 - y2, d, sa, sb, s;
+  float sinrx = sinf(rotx), cosrx = cosf(rotx);
+  float x1p, y1p, cxp, cyp, cx, cy, ux, uy, vx, vy, a1, da, hda, kappa;
+  float px = 0, py = 0, ptanx = 0, ptany = 0;
+  int ndivs;
+
+  if(sqrtf(dx*dx + dy*dy) < 1e-6f || rx < 1e-6f || ry < 1e-6f) {
+    vz_path_line_to(path, x2, y2);
+    return;
+  }
+
+  x1p = cosrx * dx / 2.0f + sinrx * dy / 2.0f;
+  y1p = -sinrx * dx / 2.0f + cosrx * dy / 2.0f;
+  d = (x1p*x1p) / (rx*rx) + (y1p*y1p) / (ry*ry);
+  if(d > 1) {
+    d = sqrtf(d);
+    rx *= d;
+    ry *= d;
+  }
+
+  sa = rx*rx*ry*ry - rx*rx*y1p*y1p - ry*ry*x1p*x1p;
+  sb = rx*rx*y1p*y1p + ry*ry*x1p*x1p;
+  if(sa < 0) sa = 0;
+  s = sb > 0 ? sqrtf(sa / sb) : 0;
+  if(large == sweep) s = -s;
+  cxp = s * rx * y1p / ry;
+  cyp = s * -ry * x1p / rx;
+  cx = (x1 + x2) / 2.0f + cosrx*cxp - sinrx*cyp;
+  cy = (y1 + y2) / 2.0f + sinrx*cxp + cosrx*cyp;
+
+  ux = (x1p - cxp) / rx;
+  uy = (y1p - cyp) / ry;
+  vx = (-x1p - cxp) / rx;
+  vy = (-y1p - cyp) / ry;
+  a1 = atan2f(uy, ux);
+  da = atan2f(ux*vy - uy*vx, ux*vx + uy*vy);
+  if(!sweep && da > 0) da -= 2 * VZ_PI;
+  else if(sweep && da < 0) da += 2 * VZ_PI;
+
+  ndivs = (int)(fabsf(da) / (VZ_PI * 0.5f) + 1.0f);
+  hda = (da / (float)ndivs) / 2.0f;
+  kappa = fabsf(4.0f / 3.0f * (1.0f - cosf(hda)) / sinf(hda));
+  if(da < 0) kappa = -kappa;
+
+  for(int i = 0; i <= ndivs; ++i) {
+    float a = a1 + da * ((float)i / (float)ndivs);
+    float ex = cosf(a) * rx, ey = sinf(a) * ry;
+    float tx = -sinf(a) * rx * kappa, ty = cosf(a) * ry * kappa;
+    float x = cx + cosrx*ex - sinrx*ey, y = cy + sinrx*ex + cosrx*ey;
+    float tanx = cosrx*tx - sinrx*ty, tany = sinrx*tx + cosrx*ty;
+    if(i > 0)
+      vz_path_bezier_to(path, px + ptanx, py + ptany, x - tanx, y - tany, x, y);
+    px = x; py = y; ptanx = tanx; ptany = tany;
+  }
+}
+
+static int vz_svg_arg_count(char cmd) {
+  switch(toupper((unsigned char)cmd)) {
+    case 'M': case 'L': case 'T': return 2;
+    case 'H': case 'V': return 1;
+    case 'C': return 6;
+    case 'S': case 'Q': return 4;
+    case 'A': return 7;
+    default: return 0;
+  }
+}
+
+/*
+  Appends the commands of path data, stopping at the first error like SVG
+  renderers do.
+*/
+static void vz_svg_path_data(VZpath *path, const char *s) {
+  float a[7], x = 0, y = 0, sx = 0, sy = 0, ctrl_x = 0, ctrl_y = 0, qx, qy;
+  char cmd = 0, last = 0, upper;
+  const char *next;
+  int n;
+
+  while(*(s = vz_svg_skip_space(s))) {
+    if(isalpha((unsigned char)*s)) {
+      cmd = *s++;
+      if(cmd == 'z' || cmd == 'Z') {
+        vz_path_close(path);
+        x = sx;
+        y = sy;
+        last = 'Z';
+        cmd = 0;
+        continue;
+      }
+    }
+    if(!(n = vz_svg_arg_count(cmd)))
+      return;
+
+    for(int i = 0; i < n; ++i) {
+      next = (toupper((unsigned char)cmd) == 'A' && (i == 3 || i == 4)) ? vz_svg_flag(s, &a[i]) : vz_svg_number(s, &a[i]);
+      if(!next)
+        return;
+      s = next;
+    }
+
+    // relative coordinates
+    if(islower((unsigned char)cmd)) {
+      switch(cmd) {
+        case 'h': a[0] += x; break;
+        case 'v': a[0] += y; break;
+        case 'a': a[5] += x; a[6] += y; break;
+        default:
+          for(int i = 0; i < n; i += 2) {
+            a[i] += x;
+            a[i + 1] += y;
+          }
+      }
+    }
+
+    upper = (char)toupper((unsigned char)cmd);
+    switch(upper) {
+      case 'M':
+        vz_path_move_to(path, a[0], a[1]);
+        sx = a[0];
+        sy = a[1];
+        // following coordinate pairs are lines
+        cmd = cmd == 'm' ? 'l' : 'L';
+        break;
+      case 'L':
+        vz_path_line_to(path, a[0], a[1]);
+        break;
+      case 'H':
+        vz_path_line_to(path, a[0], y);
+        a[1] = y;
+        break;
+      case 'V':
+        vz_path_line_to(path, x, a[0]);
+        a[1] = a[0];
+        a[0] = x;
+        break;
+      case 'C':
+        vz_path_bezier_to(path, a[0], a[1], a[2], a[3], a[4], a[5]);
+        ctrl_x = a[2]; ctrl_y = a[3];
+        a[0] = a[4]; a[1] = a[5];
+        break;
+      case 'S':
+        if(last != 'C' && last != 'S') { ctrl_x = x; ctrl_y = y; }
+        vz_path_bezier_to(path, 2*x - ctrl_x, 2*y - ctrl_y, a[0], a[1], a[2], a[3]);
+        ctrl_x = a[0]; ctrl_y = a[1];
+        a[0] = a[2]; a[1] = a[3];
+        break;
+      case 'Q':
+        vz_path_quad_to(path, a[0], a[1], a[2], a[3]);
+        ctrl_x = a[0]; ctrl_y = a[1];
+        a[0] = a[2]; a[1] = a[3];
+        break;
+      case 'T':
+        if(last != 'Q' && last != 'T') { ctrl_x = x; ctrl_y = y; }
+        qx = 2*x - ctrl_x;
+        qy = 2*y - ctrl_y;
+        vz_path_quad_to(path, qx, qy, a[0], a[1]);
+        ctrl_x = qx; ctrl_y = qy;
+        break;
+      case 'A':
+        vz_svg_arc(path, x, y, a);
+        a[0] = a[5]; a[1] = a[6];
+        break;
+    }
+
+    x = a[0];
+    y = a[1];
+    last = upper;
+  }
+}
+
+static void vz_svg_points(VZpath *path, const char *s, bool close) {
+  float x, y;
+  bool first = true;
+
+  while((s = vz_svg_number(s, &x)) && (s = vz_svg_number(s, &y))) {
+    if(first) vz_path_move_to(path, x, y);
+    else vz_path_line_to(path, x, y);
+    first = false;
+  }
+  if(close && !first)
+    vz_path_close(path);
+}
+
+/*
+  Rectangle with elliptical corners, which the rounded rectangles of NanoVG
+  don't have.
+*/
+static void vz_svg_rect(VZpath *path, float x, float y, float w, float h, float rx, float ry) {
+  const float k = 1 - VZ_KAPPA90;
+
+  rx = MIN(rx, w / 2);
+  ry = MIN(ry, h / 2);
+  if(rx < 1e-4f || ry < 1e-4f) {
+    vz_path_rect(path, x, y, w, h);
+    return;
+  }
+
+  vz_path_move_to(path, x + rx, y);
+  vz_path_line_to(path, x + w - rx, y);
+  vz_path_bezier_to(path, x + w - rx*k, y, x + w, y + ry*k, x + w, y + ry);
+  vz_path_line_to(path, x + w, y + h - ry);
+  vz_path_bezier_to(path, x + w, y + h - ry*k, x + w - rx*k, y + h, x + w - rx, y + h);
+  vz_path_line_to(path, x + rx, y + h);
+  vz_path_bezier_to(path, x + rx*k, y + h, x, y + h - ry*k, x, y + h - ry);
+  vz_path_line_to(path, x, y + ry);
+  vz_path_bezier_to(path, x, y + ry*k, x + rx*k, y, x + rx, y);
+  vz_path_close(path);
+}
+
+static void vz_svg_shape(VZsvg_parser *parser, const char *name, char **attrs, int count) {
+  VZsvg *svg = parser->svg;
+  VZsvg_attr *attr = &parser->attrs[parser->depth];
+  VZsvg_shape *shape;
+  VZpath *path;
+  const char *value;
+  float rx, ry, scale;
+
+  if(!(attr->visible && (attr->has_fill || attr->has_stroke)))
+    return;
+
+  if(svg->count == svg->size) {
+    svg->size = svg->size ? svg->size * 2 : 16;
+    svg->shapes = (VZsvg_shape*)enif_realloc(svg->shapes, svg->size * sizeof(VZsvg_shape));
+  }
+  shape = &svg->shapes[svg->count];
+  path = &shape->path;
+  vz_path_init(path);
+
+  if(strcmp(name, "path") == 0) {
+    if((value = vz_svg_attr(attrs, count, "d")))
+      vz_svg_path_data(path, value);
+  }
+  else if(strcmp(name, "rect") == 0) {
+    rx = vz_svg_attr_length(attrs, count, "rx");
+    ry = vz_svg_attr_length(attrs, count, "ry");
+    if(!vz_svg_attr(attrs, count, "rx")) rx = ry;
+    if(!vz_svg_attr(attrs, count, "ry")) ry = rx;
+    vz_svg_rect(path, vz_svg_attr_length(attrs, count, "x"), vz_svg_attr_length(attrs, count, "y"),
+                vz_svg_attr_length(attrs, count, "width"), vz_svg_attr_length(attrs, count, "height"), rx, ry);
+  }
+  else if(strcmp(name, "circle") == 0) {
+    rx = vz_svg_attr_length(attrs, count, "r");
+    if(rx > 0)
+      vz_path_ellipse(path, vz_svg_attr_length(attrs, count, "cx"), vz_svg_attr_length(attrs, count, "cy"), rx, rx);
+  }
+  else if(strcmp(name, "ellipse") == 0) {
+    rx = vz_svg_attr_length(attrs, count, "rx");
+    ry = vz_svg_attr_length(attrs, count, "ry");
+    if(rx > 0 && ry > 0)
+      vz_path_ellipse(path, vz_svg_attr_length(attrs, count, "cx"), vz_svg_attr_length(attrs, count, "cy"), rx, ry);
+  }
+  else if(strcmp(name, "line") == 0) {
+    vz_path_move_to(path, vz_svg_attr_length(attrs, count, "x1"), vz_svg_attr_length(attrs, count, "y1"));
+    vz_path_line_to(path, vz_svg_attr_length(attrs, count, "x2"), vz_svg_attr_length(attrs, count, "y2"));
+  }
+  else if(strcmp(name, "polyline") == 0 || strcmp(name, "polygon") == 0) {
+    if((value = vz_svg_attr(attrs, count, "points")))
+      vz_svg_points(path, value, name[4] == 'g');
+  }
+
+  if(path->commands.count == 0) {
+    vz_path_free(path);
+    return;
+  }
+
+  vz_path_wind_holes(path);
+  vz_path_transform(path, attr->xform);
+
+  // strokes are scaled like NanoVG scales them under a transform
+  scale = (sqrtf(attr->xform[0]*attr->xform[0] + attr->xform[1]*attr->xform[1]) +
+           sqrtf(attr->xform[2]*attr->xform[2] + attr->xform[3]*attr->xform[3])) * 0.5f;
+
+  shape->fill = attr->fill;
+  shape->fill.a *= attr->fill_opacity * attr->opacity;
+  shape->stroke = attr->stroke;
+  shape->stroke.a *= attr->stroke_opacity * attr->opacity;
+  shape->stroke_width = attr->stroke_width * scale;
+  shape->miter_limit = attr->miter_limit;
+  shape->line_cap = attr->line_cap;
+  shape->line_join = attr->line_join;
+  shape->has_fill = attr->has_fill;
+  shape->has_stroke = attr->has_stroke && shape->stroke_width > 0;
+  ++svg->count;
+}
+
+static void vz_svg_view_box(VZsvg_parser *parser, char **attrs, int count) {
+  VZsvg_attr *attr = &parser->attrs[parser->depth];
+  const char *value;
+  float box[4], w, h, t[6];
+  int i = 0;
+
+  if((value = vz_svg_attr(attrs, count, "viewBox")))
+    for(; i < 4 && (value = vz_svg_number(value, &box[i])); ++i);
+
+  // the outermost viewport sets the size of the document, nested ones map
+  // their view box to their viewport
+  if(parser->depth == 1 && !parser->has_view_box) {
+    if(i == 4 && box[2] > 0 && box[3] > 0)
+      memcpy(parser->svg->view_box, box, sizeof(box));
+    else {
+      parser->svg->view_box[2] = vz_svg_attr_length(attrs, count, "width");
+      parser->svg->view_box[3] = vz_svg_attr_length(attrs, count, "height");
+    }
+    parser->has_view_box = parser->svg->view_box[2] > 0 && parser->svg->view_box[3] > 0;
+    return;
+  }
+
+  nvgTransformTranslate(t, vz_svg_attr_length(attrs, count, "x"), vz_svg_attr_length(attrs, count, "y"));
+  nvgTransformPremultiply(attr->xform, t);
+  w = vz_svg_attr_length(attrs, count, "width");
+  h = vz_svg_attr_length(attrs, count, "height");
+  if(i == 4 && box[2] > 0 && box[3] > 0 && w > 0 && h > 0) {
+    nvgTransformScale(t, w / box[2], h / box[3]);
+    nvgTransformPremultiply(attr->xform, t);
+    nvgTransformTranslate(t, -box[0], -box[1]);
+    nvgTransformPremultiply(attr->xform, t);
+  }
+}
+
+static void vz_svg_end_element(VZsvg_parser *parser) {
+  if(parser->overflow > 0) {
+    --parser->overflow;
+    return;
+  }
+  if(parser->depth == 0)
+    return;
+  if(parser->skip_depth == parser->depth)
+    parser->skip_depth = 0;
+  --parser->depth;
+}
+
+static void vz_svg_element(VZsvg_parser *parser, const char *name, char **attrs, int count, bool empty) {
+  VZsvg_attr *attr;
+  const char *style;
+
+  // the end tag of an ignored element must not close its parent
+  if(parser->depth + 1 >= VZ_SVG_MAX_DEPTH) {
+    if(!empty)
+      ++parser->overflow;
+    return;
+  }
+
+  // an element's style is its parent's with its own attributes applied
+  parser->attrs[parser->depth + 1] = parser->attrs[parser->depth];
+  ++parser->depth;
+  attr = &parser->attrs[parser->depth];
+
+  for(int i = 0; i < count; ++i)
+    if(strcmp(attrs[i * 2], "style") != 0)
+      vz_svg_style_attr(attr, attrs[i * 2], attrs[i * 2 + 1]);
+  if((style = vz_svg_attr(attrs, count, "style")))
+    vz_svg_style(attr, (char*)style);
+
+  if(!parser->skip_depth) {
+    for(unsigned i = 0; i < sizeof(vz_svg_skipped) / sizeof(vz_svg_skipped[0]); ++i)
+      if(strcmp(name, vz_svg_skipped[i]) == 0)
+        parser->skip_depth = parser->depth;
+  }
+
+  if(!parser->skip_depth) {
+    if(strcmp(name, "svg") == 0)
+      vz_svg_view_box(parser, attrs, count);
+    else
+      vz_svg_shape(parser, name, attrs, count);
+  }
+
+  if(empty)
+    vz_svg_end_element(parser);
+}
+
+/*
+  Parses a start tag in place, `s` points past its `<`. Returns the position
+  after the tag.
+*/
+static char* vz_svg_tag(VZsvg_parser *parser, char *s) {
+  char *attrs[VZ_SVG_MAX_ATTRS * 2];
+  char *name = s, *attr_name, quote;
+  bool empty = false;
+  int count = 0;
+
+  while(*s && !isspace((unsigned char)*s) && *s != '>' && *s != '/') ++s;
+
+  while(*s) {
+    if(*s == '>') {
+      *s++ = '\0';
+      break;
+    }
+    if(*s == '/') {
+      empty = true;
+      *s++ = '\0';
+      continue;
+    }
+    if(isspace((unsigned char)*s)) {
+      *s++ = '\0';
+      continue;
+    }
+
+    // name="value" or name='value'
+    attr_name = s;
+    while(*s && !isspace((unsigned char)*s) && *s != '=' && *s != '>' && *s != '/') ++s;
+    if(*s != '=' && !isspace((unsigned char)*s))
+      continue;
+    if(*s != '=') {
+      *s++ = '\0';
+      while(isspace((unsigned char)*s)) ++s;
+      if(*s != '=')
+        continue;
+    }
+    *s++ = '\0';
+    while(isspace((unsigned char)*s)) ++s;
+    if(*s != '"' && *s != '\'')
+      continue;
+    quote = *s++;
+    if(count < VZ_SVG_MAX_ATTRS) {
+      attrs[count * 2] = attr_name;
+      attrs[count * 2 + 1] = s;
+      ++count;
+    }
+    while(*s && *s != quote) ++s;
+    if(*s) *s++ = '\0';
+  }
+
+  // names may be prefixed, svg:path
+  if(strchr(name, ':'))
+    name = strchr(name, ':') + 1;
+  vz_svg_element(parser, name, attrs, count, empty);
+
+  return s;
+}
+
+static char* vz_svg_skip_past(char *s, const char *end) {
+  char *found = strstr(s, end);
+  return found ? found + strlen(end) : s + strlen(s);
+}
+
+/*
+  Imports an SVG document, `data` is a nul terminated copy of it that is
+  modified while parsing. Returns false when the document has no size nor
+  shapes to derive it from.
+*/
+bool vz_svg_parse(VZsvg *svg, char *data, NVGcolor current_color) {
+  VZsvg_parser *parser = (VZsvg_parser*)enif_alloc(sizeof(VZsvg_parser));
+  VZsvg_attr *root = &parser->attrs[0];
+  float bounds[4], shape_bounds[4];
+  char *s = data;
+  bool found = false;
+
+  memset(svg, 0, sizeof(VZsvg));
+  memset(parser, 0, sizeof(VZsvg_parser));
+  parser->svg = svg;
+  nvgTransformIdentity(root->xform);
+  root->color = current_color;
+  root->fill = nvgRGBA(0, 0, 0, 255);
+  root->stroke = nvgRGBA(0, 0, 0, 255);
+  root->has_fill = true;
+  root->opacity = root->fill_opacity = root->stroke_opacity = 1.0f;
+  root->stroke_width = 1.0f;
+  root->miter_limit = 4.0f;
+  root->line_cap = NVG_BUTT;
+  root->line_join = NVG_MITER;
+  root->visible = true;
+
+  while((s = strchr(s, '<'))) {
+    ++s;
+    if(strncmp(s, "!--", 3) == 0)
+      s = vz_svg_skip_past(s, "-->");
+    else if(strncmp(s, "![CDATA[", 8) == 0)
+      s = vz_svg_skip_past(s, "]]>");
+    else if(*s == '?' || *s == '!')
+      s = vz_svg_skip_past(s, ">");
+    else if(*s == '/') {
+      vz_svg_end_element(parser);
+      s = vz_svg_skip_past(s, ">");
+    }
+    else s = vz_svg_tag(parser, s);
+  }
+
+  if(!parser->has_view_box) {
+    for(unsigned i = 0; i < svg->count; ++i) {
+      if(!vz_path_bounds(&svg->shapes[i].path, shape_bounds))
+        continue;
+      if(!found)
+        memcpy(bounds, shape_bounds, sizeof(bounds));
+      bounds[0] = MIN(bounds[0], shape_bounds[0]);
+      bounds[1] = MIN(bounds[1], shape_bounds[1]);
+      bounds[2] = MAX(bounds[2], shape_bounds[2]);
+      bounds[3] = MAX(bounds[3], shape_bounds[3]);
+      found = true;
+    }
+    if(found && bounds[2] > bounds[0] && bounds[3] > bounds[1]) {
+      svg->view_box[0] = bounds[0];
+      svg->view_box[1] = bounds[1];
+      svg->view_box[2] = bounds[2] - bounds[0];
+      svg->view_box[3] = bounds[3] - bounds[1];
+      parser->has_view_box = true;
+    }
+  }
+
+  found = parser->has_view_box;
+  enif_free(parser);
+
+  return found;
+}
+
+void vz_svg_free(VZsvg *svg) {
+  for(unsigned i = 0; i < svg->count; ++i)
+    vz_path_free(&svg->shapes[i].path);
+  if(svg->shapes)
+    enif_free(svg->shapes);
+  svg->shapes = NULL;
+  svg->count = svg->size = 0;
+}
+
+/*
+  Draws the shapes of a document in the space of its view box, changing the
+  fill and stroke style of the context.
+*/
+void vz_svg_draw(VZsvg *svg, NVGcontext *ctx, float pixel_ratio, float alpha) {
+  VZsvg_shape *shape;
+  NVGcolor color;
+
+  for(unsigned i = 0; i < svg->count; ++i) {
+    shape = &svg->shapes[i];
+    nvgBeginPath(ctx);
+    vz_path_draw(&shape->path, ctx, pixel_ratio);
+    if(shape->has_fill) {
+      color = shape->fill;
+      color.a *= alpha;
+      nvgFillColor(ctx, color);
+      nvgFill(ctx);
+    }
+    if(shape->has_stroke) {
+      color = shape->stroke;
+      color.a *= alpha;
+      nvgStrokeColor(ctx, color);
+      nvgStrokeWidth(ctx, shape->stroke_width);
+      nvgMiterLimit(ctx, shape->miter_limit);
+      nvgLineCap(ctx, shape->line_cap);
+      nvgLineJoin(ctx, shape->line_join);
+      nvgStroke(ctx);
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef VZ_SVG_H_INCLUDED
+#define VZ_SVG_H_INCLUDED
+
+#include "vz_paths.h"
+
+#include "nanovg.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+  SVG documents
+
+  An SVG document is imported once into retained paths, one per shape, with
+  the transforms of the shape and its groups applied to its points and its
+  style resolved to solid fill and stroke colors. Drawing a document draws its
+  paths with the flattening cache of retained paths, so documents that only
+  move aren't flattened again.
+
+  The importer covers the geometry of icons: `path`, `rect`, `circle`,
+  `ellipse`, `line`, `polyline` and `polygon` in nested `svg` and `g`
+  elements, presentation attributes and `style` declarations with solid
+  colors and opacities. Gradients, patterns, clipping, masks, text, `use`
+  and style sheets are not imported, shapes painted with them are drawn
+  without that paint.
+*/
+typedef struct VZsvg_shape {
+  VZpath path;
+  NVGcolor fill;
+  NVGcolor stroke;
+  float stroke_width;
+  float miter_limit;
+  int line_cap;
+  int line_join;
+  bool has_fill;
+  bool has_stroke;
+} VZsvg_shape;
+
+typedef struct VZsvg {
+  float view_box[4];
+  VZsvg_shape *shapes;
+  unsigned count;
+  unsigned size;
+} VZsvg;
+
+bool vz_svg_parse(VZsvg *svg, char *data, NVGcolor current_color);
+void vz_svg_free(VZsvg *svg);
+void vz_svg_draw(VZsvg *svg, NVGcontext *ctx, float pixel_ratio, float alpha);
+
+#endif
@@ -0,0 +1,771 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_textures.h"
+#include "vz_video.h"
+#include "vz_heatmap.h"
+#include "vz_streams.h"
+
+#include "GL/glew.h"
+#include "nanovg.h"
+#define NANOVG_GL2
+#include "nanovg_gl.h"
+
+#include <erl_nif.h>
+#include <string.h>
+
+
+void vz_textures_init(VZtexture_cache *cache) {
+  memset(cache, 0, sizeof(VZtexture_cache));
+}
+
+void vz_textures_free(VZtexture_cache *cache) {
+  enif_free(cache->slots);
+  enif_free(cache->free_slots);
+  cache->slots = NULL;
+  cache->free_slots = NULL;
+  cache->slot_count = cache->slot_size = cache->free_count = 0;
+}
+
+static void vz_texture_free_source(VZtexture *texture) {
+  if(texture->asset) {
+    if(texture->pinned)
+      vz_asset_unpin(texture->asset);
+    vz_asset_release(texture->asset);
+    texture->asset = NULL;
+    texture->pinned = false;
+  }
+  if(texture->source_env) {
+    enif_free_env(texture->source_env);
+    texture->source_env = NULL;
+  }
+  texture->pixels = NULL;
+}
+
+/*
+  Releases a reference to the GL texture of an asset, deleting it when no view
+  wraps it anymore. Called with a context in the share group current.
+*/
+static void vz_texture_release_asset_texture(VZasset *asset, VZasset_texture *asset_texture) {
+  VZasset_texture **t;
+  bool last;
+
+  enif_mutex_lock(asset->cache->lock);
+  if((last = --asset_texture->refs == 0)) {
+    for(t = &asset->textures; *t; t = &(*t)->next) {
+      if(*t == asset_texture) {
+        *t = asset_texture->next;
+        break;
+      }
+    }
+  }
+  enif_mutex_unlock(asset->cache->lock);
+
+  if(last) {
+    glDeleteTextures(1, &asset_texture->gl_texture);
+    enif_free(asset_texture);
+  }
+}
+
+static void vz_texture_delete_image(VZview *vz_view, VZtexture *texture) {
+  nvgDeleteImage(vz_view->ctx, texture->handle);
+  if(texture->asset_texture) {
+    vz_texture_release_asset_texture(texture->asset, texture->asset_texture);
+    texture->asset_texture = NULL;
+  }
+}
+
+/*
+  Deletes all textures of a view, called before its NanoVG context is deleted.
+*/
+void vz_textures_clear(VZview *vz_view) {
+  VZtexture_cache *cache = &vz_view->textures;
+  VZtexture *texture = cache->textures, *next;
+
+  while(texture) {
+    next = texture->next;
+    if(texture->video)
+      vz_video_free(vz_view, texture->video);
+    else if(texture->heatmap)
+      vz_heatmap_free(texture->heatmap);
+    else if(texture->handle)
+      vz_texture_delete_image(vz_view, texture);
+    if(texture->stream)
+      vz_stream_free(vz_view, texture->stream);
+    vz_texture_free_source(texture);
+    enif_free(texture);
+    texture = next;
+  }
+  cache->textures = NULL;
+  cache->bytes = 0;
+
+  for(unsigned i = 0; i < cache->slot_count; ++i)
+    cache->slots[i] = NULL;
+}
+
+/*
+  FNV-1a over 64 bit words, the tail is hashed byte by byte.
+*/
+uint64_t vz_texture_hash(const unsigned char *data, size_t size) {
+  uint64_t hash = 14695981039346656037ULL, word;
+  size_t i = 0;
+
+  for(; i + 8 <= size; i += 8) {
+    memcpy(&word, data + i, 8);
+    hash = (hash ^ word) * 1099511628211ULL;
+  }
+  for(; i < size; ++i)
+    hash = (hash ^ data[i]) * 1099511628211ULL;
+
+  return hash;
+}
+
+static int vz_texture_alloc_slot(VZtexture_cache *cache, VZtexture *texture) {
+  int id;
+
+  if(cache->free_count > 0)
+    id = cache->free_slots[--cache->free_count];
+  else {
+    // slot 0 is never used, an image pattern without image has image 0
+    if(cache->slot_count == 0)
+      cache->slot_count = 1;
+    if(cache->slot_count == cache->slot_size) {
+      cache->slot_size = cache->slot_size ? cache->slot_size * 2 : 64;
+      cache->slots = (VZtexture**)enif_realloc(cache->slots, cache->slot_size * sizeof(VZtexture*));
+      cache->free_slots = (int*)enif_realloc(cache->free_slots, cache->slot_size * sizeof(int));
+    }
+    id = (int)cache->slot_count++;
+  }
+
+  cache->slots[id] = texture;
+  ++texture->refs;
+
+  return id;
+}
+
+static void vz_texture_evict(VZview *vz_view, VZtexture *texture) {
+  if(texture->video) {
+    vz_video_free(vz_view, texture->video);
+    texture->video = NULL;
+  }
+  else if(texture->heatmap) {
+    vz_heatmap_free(texture->heatmap);
+    texture->heatmap = NULL;
+  }
+  else vz_texture_delete_image(vz_view, texture);
+  texture->handle = 0;
+  vz_view->textures.bytes -= texture->bytes;
+}
+
+/*
+  Evicts textures until `bytes` more fit in the budget. Textures drawn in the
+  current frame are still referenced by NanoVG and can't be evicted.
+*/
+static void vz_textures_make_room(VZview *vz_view, size_t bytes) {
+  VZtexture_cache *cache = &vz_view->textures;
+
+  if(!cache->budget)
+    return;
+
+  while(cache->bytes + bytes > cache->budget) {
+    VZtexture *lru = NULL;
+
+    for(VZtexture *texture = cache->textures; texture; texture = texture->next)
+      if(texture->handle && (texture->pinned || texture->pixels) && texture->last_used != vz_view->frames &&
+         (!lru || texture->last_used < lru->last_used))
+        lru = texture;
+
+    if(!lru) return;
+    vz_texture_evict(vz_view, lru);
+    ++cache->evictions;
+  }
+}
+
+/*
+  Uploads the levels following the first one of a mip chain built on the CPU.
+  NanoVG leaves texture 0 bound after creating an image, which is restored.
+*/
+static void vz_texture_upload_levels(VZview *vz_view, VZtexture *texture, const unsigned char *data) {
+  int width = texture->width, height = texture->height;
+
+  glBindTexture(GL_TEXTURE_2D, nvglImageHandleGL2(vz_view->ctx, texture->handle));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  for(int level = 1; level < texture->levels; ++level) {
+    data += (size_t)width * height * 4;
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->levels - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  texture->flags & NVG_IMAGE_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static bool vz_texture_upload(VZview *vz_view, VZtexture *texture, const unsigned char *data) {
+  int flags = texture->flags;
+
+  vz_textures_make_room(vz_view, texture->bytes);
+
+  if(texture->levels > 1)
+    flags &= ~NVG_IMAGE_GENERATE_MIPMAPS;
+
+  if((texture->handle = nvgCreateImageRGBA(vz_view->ctx, texture->width, texture->height, flags, data)) == 0)
+    return false;
+
+  if(texture->levels > 1)
+    vz_texture_upload_levels(vz_view, texture, data);
+
+  vz_view->textures.bytes += texture->bytes;
+  texture->last_used = vz_view->frames;
+
+  return true;
+}
+
+static VZtexture* vz_texture_new(VZview *vz_view, const unsigned char *data, int width, int height, int flags, int levels) {
+  VZtexture *texture = (VZtexture*)enif_alloc(sizeof(VZtexture));
+
+  memset(texture, 0, sizeof(VZtexture));
+  texture->width = width;
+  texture->height = height;
+  texture->flags = flags;
+  texture->levels = levels;
+  texture->bytes = (size_t)width * height * 4;
+  if(levels > 1 || (flags & NVG_IMAGE_GENERATE_MIPMAPS))
+    texture->bytes += texture->bytes / 3;
+
+  if(!vz_texture_upload(vz_view, texture, data)) {
+    enif_free(texture);
+    return NULL;
+  }
+
+  texture->next = vz_view->textures.textures;
+  vz_view->textures.textures = texture;
+
+  return texture;
+}
+
+/*
+  Uploads the pixels of an asset to a new GL texture, set up like NanoVG sets
+  up the textures it creates, so views can wrap it in an image of their own.
+*/
+static GLuint vz_texture_upload_asset(VZasset *asset, int flags) {
+  const unsigned char *data = asset->data;
+  int width = asset->width, height = asset->height;
+  bool mipmaps = asset->levels > 1 || (flags & NVG_IMAGE_GENERATE_MIPMAPS);
+  GLuint gl_texture;
+
+  glGenTextures(1, &gl_texture);
+  glBindTexture(GL_TEXTURE_2D, gl_texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  for(int level = 0; level < asset->levels; ++level) {
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    data += (size_t)width * height * 4;
+    width = MAX(width / 2, 1);
+    height = MAX(height / 2, 1);
+  }
+  if(asset->levels > 1)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, asset->levels - 1);
+  else if(mipmaps)
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+  if(mipmaps)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    flags & NVG_IMAGE_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
+  else
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, flags & NVG_IMAGE_NEAREST ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, flags & NVG_IMAGE_NEAREST ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, flags & NVG_IMAGE_REPEATX ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, flags & NVG_IMAGE_REPEATY ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  // other contexts only see the texture once the upload was flushed
+  glFlush();
+
+  return gl_texture;
+}
+
+static VZasset_texture* vz_texture_find_asset_texture(VZasset *asset, int flags) {
+  VZasset_texture *asset_texture;
+
+  for(asset_texture = asset->textures; asset_texture; asset_texture = asset_texture->next)
+    if(asset_texture->flags == flags)
+      break;
+  if(asset_texture)
+    ++asset_texture->refs;
+
+  return asset_texture;
+}
+
+/*
+  Returns a texture wrapping the GL texture of an asset in the share group,
+  which is uploaded by the first view that needs it. Two views uploading it at
+  the same time keep the first upload.
+*/
+static VZtexture* vz_texture_new_shared(VZview *vz_view, VZasset *asset, int flags) {
+  VZasset_texture *asset_texture;
+  VZtexture *texture;
+  GLuint uploaded = 0;
+  int handle;
+
+  enif_mutex_lock(asset->cache->lock);
+  asset_texture = vz_texture_find_asset_texture(asset, flags);
+  enif_mutex_unlock(asset->cache->lock);
+
+  if(!asset_texture) {
+    uploaded = vz_texture_upload_asset(asset, flags);
+
+    enif_mutex_lock(asset->cache->lock);
+    if(!(asset_texture = vz_texture_find_asset_texture(asset, flags))) {
+      asset_texture = (VZasset_texture*)enif_alloc(sizeof(VZasset_texture));
+      asset_texture->flags = flags;
+      asset_texture->gl_texture = uploaded;
+      asset_texture->refs = 1;
+      asset_texture->next = asset->textures;
+      asset->textures = asset_texture;
+      uploaded = 0;
+    }
+    enif_mutex_unlock(asset->cache->lock);
+
+    if(uploaded)
+      glDeleteTextures(1, &uploaded);
+  }
+
+  handle = nvglCreateImageFromHandleGL2(vz_view->ctx, asset_texture->gl_texture,
+                                        asset->width, asset->height, flags | NVG_IMAGE_NODELETE);
+  if(!handle) {
+    vz_texture_release_asset_texture(asset, asset_texture);
+    return NULL;
+  }
+
+  texture = (VZtexture*)enif_alloc(sizeof(VZtexture));
+  memset(texture, 0, sizeof(VZtexture));
+  texture->handle = handle;
+  texture->width = asset->width;
+  texture->height = asset->height;
+  texture->flags = flags;
+  texture->levels = asset->levels;
+  texture->bytes = (size_t)asset->width * asset->height * 4;
+  if(asset->levels > 1 || (flags & NVG_IMAGE_GENERATE_MIPMAPS))
+    texture->bytes += texture->bytes / 3;
+  texture->asset_texture = asset_texture;
+  texture->last_used = vz_view->frames;
+  vz_view->textures.bytes += texture->bytes;
+
+  texture->next = vz_view->textures.textures;
+  vz_view->textures.textures = texture;
+
+  return texture;
+}
+
+/*
+  Keeps the binary of an image updated with pixel data to upload it again
+  after it was evicted. Without a budget, textures are never evicted.
+*/
+static void vz_texture_retain(VZview *vz_view, VZtexture *texture, ErlNifEnv *env, const unsigned char *data) {
+  if(vz_view->textures.budget) {
+    texture->source_env = env;
+    texture->pixels = data;
+  }
+  else enif_free_env(env);
+}
+
+static void vz_texture_unref(VZview *vz_view, VZtexture *texture) {
+  VZtexture **t;
+
+  if(--texture->refs > 0)
+    return;
+
+  for(t = &vz_view->textures.textures; *t; t = &(*t)->next) {
+    if(*t == texture) {
+      *t = texture->next;
+      break;
+    }
+  }
+
+  if(texture->handle)
+    vz_texture_evict(vz_view, texture);
+  if(texture->stream)
+    vz_stream_free(vz_view, texture->stream);
+  vz_texture_free_source(texture);
+  enif_free(texture);
+}
+
+/*
+  Returns an image slot for a texture of a decoded file. Takes over the
+  pinned reference to the asset. Only a texture that may be evicted keeps the
+  pixels pinned, otherwise the asset is kept for its key. Views in the share
+  group wrap the texture of the asset instead of uploading one.
+*/
+int vz_texture_from_asset(VZview *vz_view, VZasset *asset, int flags) {
+  VZtexture *texture;
+
+  for(texture = vz_view->textures.textures; texture; texture = texture->next) {
+    if(texture->shared && texture->asset == asset && texture->flags == flags) {
+      vz_asset_unpin(asset);
+      vz_asset_release(asset);
+      return vz_texture_alloc_slot(&vz_view->textures, texture);
+    }
+  }
+
+  if(vz_view->share_context)
+    texture = vz_texture_new_shared(vz_view, asset, flags);
+  else
+    texture = vz_texture_new(vz_view, asset->data, asset->width, asset->height, flags, asset->levels);
+
+  if(!texture) {
+    vz_asset_unpin(asset);
+    vz_asset_release(asset);
+    return 0;
+  }
+  texture->asset = asset;
+  texture->shared = true;
+  if(vz_view->textures.budget && !texture->asset_texture)
+    texture->pinned = true;
+  else
+    vz_asset_unpin(asset);
+
+  return vz_texture_alloc_slot(&vz_view->textures, texture);
+}
+
+/*
+  Returns an image slot for a texture of pixel data. Takes over the
+  environment holding the binary. Shared textures always keep their binary,
+  a texture is only shared when the pixels are equal, not just their hash.
+*/
+int vz_texture_from_pixels(VZview *vz_view, ErlNifEnv *env, const unsigned char *data, int width, int height, int flags, uint64_t hash) {
+  VZtexture *texture;
+
+  for(texture = vz_view->textures.textures; texture; texture = texture->next) {
+    if(texture->shared && !texture->asset && texture->hash == hash &&
+       texture->width == width && texture->height == height && texture->flags == flags &&
+       texture->pixels && memcmp(texture->pixels, data, (size_t)width * height * 4) == 0) {
+      enif_free_env(env);
+      return vz_texture_alloc_slot(&vz_view->textures, texture);
+    }
+  }
+
+  if(!(texture = vz_texture_new(vz_view, data, width, height, flags, 1))) {
+    enif_free_env(env);
+    return 0;
+  }
+  texture->hash = hash;
+  texture->shared = true;
+  texture->source_env = env;
+  texture->pixels = data;
+
+  return vz_texture_alloc_slot(&vz_view->textures, texture);
+}
+
+/*
+  Returns an image slot for the texture of a video image, taking over the video.
+*/
+int vz_texture_from_video(VZview *vz_view, VZvideo *video) {
+  VZtexture *texture = (VZtexture*)enif_alloc(sizeof(VZtexture));
+
+  memset(texture, 0, sizeof(VZtexture));
+  texture->handle = vz_video_image(video);
+  texture->width = video->width;
+  texture->height = video->height;
+  texture->levels = 1;
+  texture->bytes = vz_video_bytes(video);
+  texture->video = video;
+  texture->last_used = vz_view->frames;
+  vz_view->textures.bytes += texture->bytes;
+
+  texture->next = vz_view->textures.textures;
+  vz_view->textures.textures = texture;
+
+  return vz_texture_alloc_slot(&vz_view->textures, texture);
+}
+
+/*
+  Returns an image slot for the texture of a heatmap, taking over the heatmap.
+*/
+int vz_texture_from_heatmap(VZview *vz_view, VZheatmap *heatmap) {
+  VZtexture *texture = (VZtexture*)enif_alloc(sizeof(VZtexture));
+
+  memset(texture, 0, sizeof(VZtexture));
+  texture->handle = vz_heatmap_image(heatmap);
+  texture->width = heatmap->cols;
+  texture->height = heatmap->rows;
+  texture->levels = 1;
+  texture->bytes = vz_heatmap_bytes(heatmap);
+  texture->heatmap = heatmap;
+  texture->last_used = vz_view->frames;
+  vz_view->textures.bytes += texture->bytes;
+
+  texture->next = vz_view->textures.textures;
+  vz_view->textures.textures = texture;
+
+  return vz_texture_alloc_slot(&vz_view->textures, texture);
+}
+
+/*
+  Returns an image slot for a new, blank texture that is updated through an
+  upload stream.
+*/
+int vz_texture_stream(VZview *vz_view, int width, int height, int flags) {
+  VZtexture *texture;
+  size_t size = (size_t)width * height * 4;
+
+  if(!(texture = vz_texture_new(vz_view, NULL, width, height, flags, 1)))
+    return 0;
+
+  if(!(texture->stream = vz_stream_create(size))) {
+    texture->refs = 1;
+    vz_texture_unref(vz_view, texture);
+    return 0;
+  }
+  texture->bytes += size * VZ_STREAM_SLOT_COUNT;
+  vz_view->textures.bytes += size * VZ_STREAM_SLOT_COUNT;
+
+  return vz_texture_alloc_slot(&vz_view->textures, texture);
+}
+
+struct VZstream* vz_texture_stream_of(VZtexture *texture) {
+  return texture->video ? texture->video->stream : texture->stream;
+}
+
+VZtexture* vz_texture_get(VZview *vz_view, int id) {
+  VZtexture_cache *cache = &vz_view->textures;
+
+  if(id <= 0 || (unsigned)id >= cache->slot_count)
+    return NULL;
+
+  return cache->slots[id];
+}
+
+static void vz_texture_drawn(VZview *vz_view, VZtexture *texture) {
+  int node = vz_view->drawing_node, layer = vz_view->layers.active;
+
+  if(node < 0) {
+    texture->untracked = true;
+    return;
+  }
+
+  for(unsigned i = 0; i < texture->drawer_count; ++i)
+    if(texture->drawers[i].node == node && texture->drawers[i].layer == layer)
+      return;
+
+  if(texture->drawer_count == VZ_TEXTURE_MAX_DRAWERS) {
+    texture->untracked = true;
+    return;
+  }
+
+  texture->drawers[texture->drawer_count].node = node;
+  texture->drawers[texture->drawer_count].layer = layer;
+  ++texture->drawer_count;
+}
+
+/*
+  Returns the NanoVG image handle of an image slot for drawing, uploading an
+  evicted texture again. Returns 0 when the image was deleted.
+*/
+int vz_texture_handle(VZview *vz_view, int id) {
+  VZtexture *texture = vz_texture_get(vz_view, id);
+  const unsigned char *source;
+
+  if(!texture)
+    return 0;
+
+  if(!texture->handle) {
+    source = texture->pinned ? texture->asset->data : texture->pixels;
+    if(!(source && vz_texture_upload(vz_view, texture, source)))
+      return 0;
+    ++vz_view->textures.reloads;
+  }
+
+  texture->last_used = vz_view->frames;
+  if(!texture->untracked)
+    vz_texture_drawn(vz_view, texture);
+
+  return texture->handle;
+}
+
+/*
+  Damages the nodes that drew an image whose contents are about to change, and
+  invalidates the layers they were cached in. Returns false when the whole view
+  has to be redrawn instead, because it isn't known where the image is shown.
+  Called with the view lock held.
+*/
+bool vz_texture_damage(VZview *vz_view, int id) {
+  VZtexture *texture = vz_texture_get(vz_view, id);
+  const VZtexture_drawer *drawer;
+
+  if(!texture)
+    return true;
+  if(texture->untracked || texture->drawer_count == 0)
+    return false;
+
+  for(unsigned i = 0; i < texture->drawer_count; ++i) {
+    drawer = &texture->drawers[i];
+    vz_node_store_damage(vz_view->nodes, drawer->node);
+    if(drawer->layer >= 0) {
+      vz_layers_invalidate(vz_view, drawer->layer);
+      vz_node_store_damage(vz_view->nodes, drawer->layer);
+    }
+  }
+
+  return true;
+}
+
+/*
+  Replaces the pixels of an image. A texture used by other images or views, or
+  with a mip chain that the pixels would leave stale, is copied first. An updated
+  texture isn't returned by lookups anymore. Takes over the environment holding
+  the binary.
+*/
+void vz_texture_update(VZview *vz_view, int id, ErlNifEnv *env, const unsigned char *data) {
+  VZtexture *texture = vz_texture_get(vz_view, id), *copy;
+
+  if(!texture || texture->video || texture->heatmap) {
+    enif_free_env(env);
+    return;
+  }
+
+  if(texture->stream)
+    vz_stream_recycle(texture->stream);
+
+  if(texture->refs > 1 || texture->levels > 1 || texture->asset_texture) {
+    if(!(copy = vz_texture_new(vz_view, data, texture->width, texture->height, texture->flags, 1))) {
+      enif_free_env(env);
+      return;
+    }
+    copy->refs = 1;
+    memcpy(copy->drawers, texture->drawers, sizeof(copy->drawers));
+    copy->drawer_count = texture->drawer_count;
+    copy->untracked = texture->untracked;
+    vz_texture_retain(vz_view, copy, env, data);
+    vz_view->textures.slots[id] = copy;
+    vz_texture_unref(vz_view, texture);
+    return;
+  }
+
+  if(texture->handle) {
+    nvgUpdateImage(vz_view->ctx, texture->handle, data);
+    texture->last_used = vz_view->frames;
+  }
+  texture->shared = false;
+  vz_texture_free_source(texture);
+  vz_texture_retain(vz_view, texture, env, data);
+}
+
+/*
+  Uploads a frame to a video image, returns false when the image isn't a video
+  image or the frame is too small.
+*/
+bool vz_texture_update_video(VZview *vz_view, int id, const unsigned char *data, size_t size) {
+  VZtexture *texture = vz_texture_get(vz_view, id);
+  VZvideo *video;
+
+  if(!(texture && (video = texture->video) &&
+       size >= vz_video_frame_size(video->format, video->width, video->height)))
+    return false;
+
+  vz_stream_recycle(video->stream);
+  vz_video_update(vz_view, video, data);
+  texture->last_used = vz_view->frames;
+
+  return true;
+}
+
+/*
+  Replaces a block of cells of a heatmap image, returns false when the image
+  isn't a heatmap or the block doesn't lie within its grid.
+*/
+bool vz_texture_update_heatmap(VZview *vz_view, int id, int col, int row, int cols, int rows, const unsigned char *values) {
+  VZtexture *texture = vz_texture_get(vz_view, id);
+  VZheatmap *heatmap;
+
+  if(!(texture && (heatmap = texture->heatmap) &&
+       col + cols <= heatmap->cols && row + rows <= heatmap->rows))
+    return false;
+
+  vz_heatmap_update(vz_view, heatmap, col, row, cols, rows, values);
+  texture->last_used = vz_view->frames;
+
+  return true;
+}
+
+bool vz_texture_heatmap_colormap(VZview *vz_view, int id, const unsigned char *colormap) {
+  VZtexture *texture = vz_texture_get(vz_view, id);
+
+  if(!(texture && texture->heatmap))
+    return false;
+
+  vz_heatmap_set_colormap(vz_view, texture->heatmap, colormap);
+  texture->last_used = vz_view->frames;
+
+  return true;
+}
+
+/*
+  Uploads the data copied to a slot of the upload stream of an image. The
+  stream is only compared, it was freed when the image's texture was deleted
+  since the slot was claimed.
+*/
+void vz_texture_update_stream(VZview *vz_view, int id, VZstream *stream, int slot) {
+  VZtexture *texture = vz_texture_get(vz_view, id);
+
+  if(!(texture && vz_texture_stream_of(texture) == stream))
+    return;
+
+  vz_stream_recycle(stream);
+  texture->last_used = vz_view->frames;
+
+  if(texture->video) {
+    vz_video_update_stream(vz_view, texture->video, slot);
+    return;
+  }
+
+  // an evicted texture is created again before the stream's buffer is bound,
+  // NanoVG would upload its pixels from the buffer
+  if(!texture->handle && vz_texture_upload(vz_view, texture, NULL))
+    ++vz_view->textures.reloads;
+
+  if(!vz_stream_bind(stream, slot))
+    return;
+
+  if(texture->handle) {
+    glBindTexture(GL_TEXTURE_2D, nvglImageHandleGL2(vz_view->ctx, texture->handle));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->width, texture->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    if(texture->flags & NVG_IMAGE_GENERATE_MIPMAPS)
+      glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  vz_stream_unbind(stream, slot);
+
+  texture->shared = false;
+  vz_texture_free_source(texture);
+}
+
+/*
+  Releases the texture of an image, the slot stays reserved until the image
+  resource is destroyed.
+*/
+void vz_texture_delete(VZview *vz_view, int id) {
+  VZtexture *texture = vz_texture_get(vz_view, id);
+
+  if(texture) {
+    vz_view->textures.slots[id] = NULL;
+    vz_texture_unref(vz_view, texture);
+  }
+}
+
+void vz_texture_release(VZview *vz_view, int id) {
+  VZtexture_cache *cache = &vz_view->textures;
+
+  if(id <= 0 || (unsigned)id >= cache->slot_count)
+    return;
+
+  vz_texture_delete(vz_view, id);
+  cache->free_slots[cache->free_count++] = id;
+}
@@ -0,0 +1,120 @@
+#ifndef VZ_TEXTURES_H_INCLUDED
+#define VZ_TEXTURES_H_INCLUDED
+
+#include <erl_nif.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct VZview;
+struct VZasset;
+struct VZasset_texture;
+struct VZvideo;
+struct VZheatmap;
+struct VZstream;
+
+#define VZ_TEXTURE_MAX_DRAWERS 16
+
+/*
+  A node that drew a texture, and the node of the layer it was drawn into, or
+  -1 when it was drawn to the window.
+*/
+typedef struct VZtexture_drawer {
+  int node;
+  int layer;
+} VZtexture_drawer;
+
+/*
+  Texture cache
+
+  Image resources refer to a texture of their view by slot id. Loading a
+  file that is already loaded with the same flags, or pixel data with the
+  same contents, size and flags, returns a new image for the existing
+  texture, which is deleted when the last image using it is destroyed.
+  Draw calls resolve the slot when they are executed, so the texture behind
+  an image can be replaced while they are queued.
+
+  Textures of pixel data keep the binary they came from while they are
+  shared, a lookup compares it when the hash matches. With a budget, all
+  textures keep their source: the decoded file or the binary. Without one,
+  textures of decoded files only keep the asset for its key, not its pixels. When the budget is exceeded, textures that weren't
+  drawn in the current frame are deleted least recently drawn first, and
+  uploaded again from their source the next time they are drawn.
+
+  Views in the GL share group don't upload textures of decoded files, they
+  wrap the texture of the asset in an image of their own, which isn't evicted
+  since other views draw it too. Updating such an image copies it first.
+
+  Textures of images loaded with `mipmaps: :cpu` upload the mip chain of their
+  asset instead of having the driver generate it. Textures of video images are
+  the framebuffer their frames are converted to, textures of heatmaps the
+  framebuffer their cells are colored in, neither is ever evicted.
+  Textures of streaming images and video images are updated through an upload
+  stream.
+
+  Textures remember the nodes that drew them, so that with partial redraws an
+  update only damages those nodes. A node that stopped drawing the texture is
+  still damaged, which only redraws more than needed. Textures drawn outside
+  of a node, or by more than VZ_TEXTURE_MAX_DRAWERS nodes, damage the whole
+  view.
+*/
+typedef struct VZtexture {
+  int handle;
+  int width;
+  int height;
+  int flags;
+  int levels;
+  unsigned refs;
+  bool shared;
+  bool pinned;
+  uint64_t hash;
+  size_t bytes;
+  unsigned long last_used;
+  struct VZasset *asset;
+  struct VZasset_texture *asset_texture;
+  struct VZvideo *video;
+  struct VZheatmap *heatmap;
+  struct VZstream *stream;
+  ErlNifEnv *source_env;
+  const unsigned char *pixels;
+  VZtexture_drawer drawers[VZ_TEXTURE_MAX_DRAWERS];
+  unsigned drawer_count;
+  bool untracked;
+  struct VZtexture *next;
+} VZtexture;
+
+typedef struct VZtexture_cache {
+  VZtexture *textures;
+  VZtexture **slots;
+  unsigned slot_count;
+  unsigned slot_size;
+  int *free_slots;
+  unsigned free_count;
+  size_t bytes;
+  size_t budget;
+  unsigned long evictions;
+  unsigned long reloads;
+} VZtexture_cache;
+
+void vz_textures_init(VZtexture_cache *cache);
+void vz_textures_free(VZtexture_cache *cache);
+void vz_textures_clear(struct VZview *vz_view);
+uint64_t vz_texture_hash(const unsigned char *data, size_t size);
+int vz_texture_from_asset(struct VZview *vz_view, struct VZasset *asset, int flags);
+int vz_texture_from_pixels(struct VZview *vz_view, ErlNifEnv *env, const unsigned char *data, int width, int height, int flags, uint64_t hash);
+VZtexture* vz_texture_get(struct VZview *vz_view, int id);
+int vz_texture_handle(struct VZview *vz_view, int id);
+int vz_texture_from_video(struct VZview *vz_view, struct VZvideo *video);
+int vz_texture_from_heatmap(struct VZview *vz_view, struct VZheatmap *heatmap);
+int vz_texture_stream(struct VZview *vz_view, int width, int height, int flags);
+struct VZstream* vz_texture_stream_of(VZtexture *texture);
+void vz_texture_update(struct VZview *vz_view, int id, ErlNifEnv *env, const unsigned char *data);
+bool vz_texture_update_video(struct VZview *vz_view, int id, const unsigned char *data, size_t size);
+bool vz_texture_update_heatmap(struct VZview *vz_view, int id, int col, int row, int cols, int rows, const unsigned char *values);
+bool vz_texture_heatmap_colormap(struct VZview *vz_view, int id, const unsigned char *colormap);
+void vz_texture_update_stream(struct VZview *vz_view, int id, struct VZstream *stream, int slot);
+bool vz_texture_damage(struct VZview *vz_view, int id);
+void vz_texture_delete(struct VZview *vz_view, int id);
+void vz_texture_release(struct VZview *vz_view, int id);
+
+#endif
@@ -0,0 +1,216 @@
+#include "vz_helpers.h"
+#include "vz_resources.h"
+#include "vz_video.h"
+#include "vz_gl.h"
+
+#include "nanovg.h"
+#include "nanovg_gl_utils.h"
+
+#include <erl_nif.h>
+#include <string.h>
+
+
+static const char *vz_video_vertex_shader =
+  "#version 110\n"
+  "attribute vec2 vertex;\n"
+  "varying vec2 tcoord;\n"
+  "void main() {\n"
+  // the framebuffer is drawn flipped, its first row is the last row of the frame
+  "  tcoord = vec2(vertex.x, 1.0 - vertex.y);\n"
+  "  gl_Position = vec4(vertex * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+static const char *vz_video_fragment_shader =
+  "#version 110\n"
+  "uniform sampler2D y_plane;\n"
+  "uniform sampler2D u_plane;\n"
+  "uniform sampler2D v_plane;\n"
+  "uniform int nv12;\n"
+  "uniform mat3 yuv_to_rgb;\n"
+  "varying vec2 tcoord;\n"
+  "void main() {\n"
+  "  vec3 yuv;\n"
+  "  yuv.x = (texture2D(y_plane, tcoord).r - 0.0625) * 1.164;\n"
+  "  if(nv12 == 1)\n"
+  "    yuv.yz = texture2D(u_plane, tcoord).ra - 0.5;\n"
+  "  else\n"
+  "    yuv.yz = vec2(texture2D(u_plane, tcoord).r, texture2D(v_plane, tcoord).r) - 0.5;\n"
+  "  gl_FragColor = vec4(clamp(yuv_to_rgb * yuv, 0.0, 1.0), 1.0);\n"
+  "}\n";
+
+// limited range YUV to RGB, column major
+static const float vz_bt601[9] = {1.f, 1.f, 1.f, 0.f, -0.391f, 2.018f, 1.596f, -0.813f, 0.f};
+static const float vz_bt709[9] = {1.f, 1.f, 1.f, 0.f, -0.213f, 2.112f, 1.793f, -0.533f, 0.f};
+
+/*
+  Compiles the conversion shader the first time a view creates a video image.
+*/
+static bool vz_video_shader_init(VZvideo_shader *shader) {
+  GLuint program;
+
+  if(shader->program)
+    return true;
+
+  if(!(program = vz_gl_program(vz_video_vertex_shader, vz_video_fragment_shader)))
+    return false;
+
+  shader->program = program;
+  shader->planes[0] = glGetUniformLocation(program, "y_plane");
+  shader->planes[1] = glGetUniformLocation(program, "u_plane");
+  shader->planes[2] = glGetUniformLocation(program, "v_plane");
+  shader->nv12 = glGetUniformLocation(program, "nv12");
+  shader->matrix = glGetUniformLocation(program, "yuv_to_rgb");
+
+  return true;
+}
+
+void vz_video_shader_free(VZvideo_shader *shader) {
+  if(shader->program)
+    glDeleteProgram(shader->program);
+  shader->program = 0;
+}
+
+static inline int vz_video_plane_count(const VZvideo *video) {
+  return video->format == VZ_VIDEO_NV12 ? 2 : 3;
+}
+
+static void vz_video_plane_size(const VZvideo *video, int plane, int *width, int *height) {
+  *width = plane ? (video->width + 1) / 2 : video->width;
+  *height = plane ? (video->height + 1) / 2 : video->height;
+}
+
+size_t vz_video_frame_size(enum VZvideo_format format, int width, int height) {
+  size_t chroma = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+  __UNUSED(format);
+
+  // I420 has two chroma planes, NV12 one with both chroma channels
+  return (size_t)width * height + chroma * 2;
+}
+
+VZvideo* vz_video_create(VZview *vz_view, enum VZvideo_format format, bool bt709, int width, int height, int flags) {
+  VZvideo *video;
+  VZgl_state state;
+  GLenum plane_format;
+  int w, h;
+
+  if(!vz_video_shader_init(&vz_view->video_shader))
+    return NULL;
+
+  video = (VZvideo*)enif_alloc(sizeof(VZvideo));
+  memset(video, 0, sizeof(VZvideo));
+  video->format = format;
+  video->bt709 = bt709;
+  video->width = width;
+  video->height = height;
+
+  vz_gl_state_save(&state);
+  video->fb = nvgluCreateFramebuffer(vz_view->ctx, width, height, flags & ~NVG_IMAGE_GENERATE_MIPMAPS);
+  vz_gl_state_restore(&state);
+  if(!video->fb) {
+    enif_free(video);
+    return NULL;
+  }
+
+  glGenTextures(vz_video_plane_count(video), video->planes);
+  for(int i = 0; i < vz_video_plane_count(video); ++i) {
+    vz_video_plane_size(video, i, &w, &h);
+    plane_format = i && format == VZ_VIDEO_NV12 ? GL_LUMINANCE_ALPHA : GL_LUMINANCE;
+    glBindTexture(GL_TEXTURE_2D, video->planes[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, plane_format, w, h, 0, plane_format, GL_UNSIGNED_BYTE, NULL);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  if(!(video->stream = vz_stream_create(vz_video_frame_size(format, width, height)))) {
+    vz_video_free(vz_view, video);
+    return NULL;
+  }
+
+  return video;
+}
+
+/*
+  Uploads the planes of a frame, from client memory or, when `frame` is NULL,
+  from the bound unpack buffer.
+*/
+static void vz_video_upload(VZvideo *video, const unsigned char *frame) {
+  size_t offset = 0;
+  GLenum plane_format;
+  int w, h;
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for(int i = 0; i < vz_video_plane_count(video); ++i) {
+    vz_video_plane_size(video, i, &w, &h);
+    plane_format = i && video->format == VZ_VIDEO_NV12 ? GL_LUMINANCE_ALPHA : GL_LUMINANCE;
+    glBindTexture(GL_TEXTURE_2D, video->planes[i]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, plane_format, GL_UNSIGNED_BYTE, frame + offset);
+    offset += (size_t)w * h * (plane_format == GL_LUMINANCE_ALPHA ? 2 : 1);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+static void vz_video_convert(VZview *vz_view, VZvideo *video) {
+  VZvideo_shader *shader = &vz_view->video_shader;
+
+  vz_gl_begin_pass(video->fb->fbo, video->width, video->height, shader->program);
+  for(int i = 0; i < 3; ++i) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, i < vz_video_plane_count(video) ? video->planes[i] : 0);
+    glUniform1i(shader->planes[i], i);
+  }
+  glUniform1i(shader->nv12, video->format == VZ_VIDEO_NV12);
+  glUniformMatrix3fv(shader->matrix, 1, GL_FALSE, video->bt709 ? vz_bt709 : vz_bt601);
+  vz_gl_draw_quad();
+  vz_gl_end_pass(3);
+}
+
+/*
+  Uploads a frame from client memory and converts it, called from a draw op,
+  so while NanoVG records the current frame.
+*/
+void vz_video_update(VZview *vz_view, VZvideo *video, const unsigned char *frame) {
+  VZgl_state state;
+
+  vz_gl_state_save(&state);
+  vz_video_upload(video, frame);
+  vz_video_convert(vz_view, video);
+  vz_gl_state_restore(&state);
+}
+
+/*
+  Uploads a frame copied to a slot of the video's stream and converts it.
+*/
+void vz_video_update_stream(VZview *vz_view, VZvideo *video, int slot) {
+  VZgl_state state;
+
+  if(!vz_stream_bind(video->stream, slot))
+    return;
+
+  vz_gl_state_save(&state);
+  vz_video_upload(video, NULL);
+  vz_stream_unbind(video->stream, slot);
+  vz_video_convert(vz_view, video);
+  vz_gl_state_restore(&state);
+}
+
+int vz_video_image(VZvideo *video) {
+  return video->fb->image;
+}
+
+size_t vz_video_bytes(VZvideo *video) {
+  // framebuffer with stencil buffer, planes and stream
+  size_t frame = vz_video_frame_size(video->format, video->width, video->height);
+
+  return (size_t)video->width * video->height * 5 + frame * (1 + VZ_STREAM_SLOT_COUNT);
+}
+
+void vz_video_free(VZview *vz_view, VZvideo *video) {
+  if(video->stream)
+    vz_stream_free(vz_view, video->stream);
+  glDeleteTextures(vz_video_plane_count(video), video->planes);
+  nvgluDeleteFramebuffer(video->fb);
+  enif_free(video);
+}
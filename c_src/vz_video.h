@@ -0,0 +1,53 @@
+#ifndef VZ_VIDEO_H_INCLUDED
+#define VZ_VIDEO_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct VZview;
+struct VZstream;
+struct NVGLUframebuffer;
+
+enum VZvideo_format {
+  VZ_VIDEO_I420,
+  VZ_VIDEO_NV12
+};
+
+/*
+  Video images
+
+  Frames of planar YUV video are uploaded as they are: the luma and chroma
+  planes go to textures of their own through an upload stream, so the driver
+  copies them while the previous frames are still being drawn.
+  A shader converts the planes to RGBA into a framebuffer, which is the
+  texture NanoVG draws, so video images can be used like any other image.
+  The conversion runs when a frame is uploaded, before NanoVG flushes the
+  frame it is drawn in.
+*/
+typedef struct VZvideo {
+  enum VZvideo_format format;
+  bool bt709;
+  int width;
+  int height;
+  unsigned planes[3];
+  struct VZstream *stream;
+  struct NVGLUframebuffer *fb;
+} VZvideo;
+
+typedef struct VZvideo_shader {
+  unsigned program;
+  int planes[3];
+  int nv12;
+  int matrix;
+} VZvideo_shader;
+
+size_t vz_video_frame_size(enum VZvideo_format format, int width, int height);
+VZvideo* vz_video_create(struct VZview *vz_view, enum VZvideo_format format, bool bt709, int width, int height, int flags);
+void vz_video_update(struct VZview *vz_view, VZvideo *video, const unsigned char *frame);
+void vz_video_update_stream(struct VZview *vz_view, VZvideo *video, int slot);
+int vz_video_image(VZvideo *video);
+size_t vz_video_bytes(VZvideo *video);
+void vz_video_free(struct VZview *vz_view, VZvideo *video);
+void vz_video_shader_free(VZvideo_shader *shader);
+
+#endif
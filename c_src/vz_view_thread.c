@@ -1,19 +1,38 @@
+#ifdef VZ_PLATFORM_X11
+#define _GNU_SOURCE
+#endif
+
 #include "vz_atoms.h"
 #include "vz_helpers.h"
 #include "vz_resources.h"
 #include "vz_events.h"
+#include "vz_view_thread.h"
+#include "vz_renderer.h"
 
 #include "pugl/pugl.h"
 #include "GL/glew.h"
+#ifdef VZ_PLATFORM_X11
+#include "GL/glxew.h"
+#endif
 #include "pugl/gl.h"
 #include "nanovg.h"
 #define NANOVG_GL2_IMPLEMENTATION
 #include "nanovg_gl.h"
+// framebuffer objects are provided by GLEW
+#define NANOVG_FBO_VALID 1
+#include "nanovg_gl_utils.h"
 
 #include <erl_nif.h>
 #include <time.h>
 #include <errno.h>
 
+#ifdef VZ_PLATFORM_X11
+#include <X11/extensions/Xrandr.h>
+#include <poll.h>
+#include <stdint.h>
+#include <unistd.h>
+#endif
+
 
 #if defined(VZ_PLATFORM_X11) || defined(VZ_PLATFORM_MACOS)
 static inline void set_next_time_point(struct timespec* ts, int frame_rate) {
@@ -68,39 +87,55 @@ static inline void sleep_until(ULARGE_INTEGER *ts) {
 #endif
 
 static inline void vz_begin_frame(VZview *vz_view) {
+  vz_damage_begin_frame(vz_view);
   glViewport(0, 0, vz_view->width, vz_view->height);
-  glClearColor(vz_view->bg.r, vz_view->bg.g, vz_view->bg.b, vz_view->bg.a);
-  glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+  // with partial redraws, the damaged region is cleared once it is known
+  if(!vz_view->damage.enabled) {
+    glClearColor(vz_view->bg.r, vz_view->bg.g, vz_view->bg.b, vz_view->bg.a);
+    glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+  }
 
   nvgBeginFrame(vz_view->ctx, vz_view->width, vz_view->height, vz_view->pixel_ratio);
+  vz_sdf_begin_frame(&vz_view->sdf);
+  vz_view->drawing_node = -1;
 }
 
 static inline void vz_end_frame(VZview *vz_view) {
   nvgEndFrame(vz_view->ctx);
+  vz_damage_end_frame(vz_view);
 }
 
 static inline void vz_send_update(VZview *vz_view) {
   enif_send(NULL, &vz_view->view_pid, NULL, ATOM_UPDATE);
 }
 
-static inline void vz_run(VZview *vz_view) {
-  vz_view->busy = true;
+static inline void vz_run_pending(VZview *vz_view) {
+  VZop_array *a = vz_view->op_array;
+  for(unsigned i = a->start_pos; i < a->end_pos; ++i) {
+    VZop op = a->array[i];
+    op.handler(vz_view, op.args);
+  }
+  a->start_pos = a->end_pos;
+}
+
+static inline void vz_free_ops(VZview *vz_view) {
   VZop_array *a = vz_view->op_array;
-  do {
-    enif_cond_wait(vz_view->execute_cv, vz_view->lock);
-    for(unsigned i = a->start_pos; i < a->end_pos; ++i) {
-      VZop op = a->array[i];
-      op.handler(vz_view, op.args);
-    }
-    a->start_pos = a->end_pos;
-  } while(vz_view->busy);
   for(unsigned i = 0; i < a->end_pos; ++i) {
     enif_free(a->array[i].args);
   }
   VZop_array_clear(a);
 }
 
-static inline void vz_send_events(VZview *vz_view) {
+static inline void vz_run(VZview *vz_view) {
+  vz_view->busy = true;
+  do {
+    enif_cond_wait(vz_view->execute_cv, vz_view->lock);
+    vz_run_pending(vz_view);
+  } while(vz_view->busy);
+  vz_free_ops(vz_view);
+}
+
+static void vz_send_events(VZview *vz_view) {
   VZev_array *a = vz_view->ev_array;
 
   if(a->end_pos > 0 || vz_view->force_send_events) {
@@ -112,35 +147,275 @@ static inline void vz_send_events(VZview *vz_view) {
   }
 }
 
-#if defined(VZ_PLATFORM_X11) || defined(VZ_PLATFORM_MACOS)
-static inline void vz_wait_for_frame(VZview *vz_view, PuglView *view, struct timespec *ts) {
+/*
+  Frames are paced by the frame rate or vsync in interval mode, and in auto
+  mode while a redraw is pending. Otherwise the thread waits for events.
+*/
+bool vz_timed_frames(VZview *vz_view) {
+  return vz_view->redraw_mode == VZ_INTERVAL || (vz_view->redraw_mode == VZ_AUTO && vz_view->redraw);
+}
+
+#if defined(VZ_PLATFORM_X11)
+static inline bool vz_time_point_passed(const struct timespec *ts) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec > ts->tv_sec || (now.tv_sec == ts->tv_sec && now.tv_nsec >= ts->tv_nsec);
+}
+
+/*
+  Blocks until there are X events, the view is woken up by vz_wake or the next
+  frame is due. Returns true when a new frame should be drawn.
+*/
+static inline bool vz_wait_for_frame(VZview *vz_view, PuglView *view, struct timespec *ts) {
+  struct pollfd fds[2];
+  struct timespec now, timeout, *timeout_ptr = NULL;
+  uint64_t value;
+  __UNUSED(view);
+
+  if(vz_view->shutdown || vz_view->suspend || (vz_view->redraw_mode == VZ_MANUAL && vz_view->redraw))
+    return false;
+
+  if(vz_timed_frames(vz_view)) {
+    // swapping buffers blocks until the next vertical blank
+    if(vz_view->vsync)
+      return true;
+
+    if(vz_time_point_passed(ts)) {
+      set_next_time_point(ts, vz_view->frame_rate);
+      return true;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timeout.tv_sec = ts->tv_sec - now.tv_sec;
+    timeout.tv_nsec = ts->tv_nsec - now.tv_nsec;
+    if(timeout.tv_nsec < 0) {
+      timeout.tv_sec -= 1;
+      timeout.tv_nsec += 1000000000;
+    }
+    timeout_ptr = &timeout;
+  }
+
+  // also flushes requests, events already read by Xlib would not wake up poll
+  if(XPending(vz_view->display) > 0)
+    return false;
+
+  fds[0].fd = ConnectionNumber(vz_view->display);
+  fds[0].events = POLLIN;
+  fds[1].fd = vz_view->wake_fd;
+  fds[1].events = POLLIN;
+
+  enif_mutex_unlock(vz_view->lock);
+  if(ppoll(fds, 2, timeout_ptr, NULL) > 0 && (fds[1].revents & POLLIN)) {
+    if(read(vz_view->wake_fd, &value, sizeof(value)) < 0) {
+      // EAGAIN, another wake-up was already consumed
+    }
+  }
+  enif_mutex_lock(vz_view->lock);
+
+  if(vz_timed_frames(vz_view) && !vz_view->vsync && vz_time_point_passed(ts)) {
+    set_next_time_point(ts, vz_view->frame_rate);
+    return true;
+  }
+
+  return false;
+}
+#else
+#if defined(VZ_PLATFORM_MACOS)
+static inline bool vz_wait_for_frame(VZview *vz_view, PuglView *view, struct timespec *ts) {
 #elif defined(VZ_PLATFORM_WINDOWS)
-static inline void vz_wait_for_frame(VZview *vz_view, PuglView *view, ULARGE_INTEGER *ts) {
+static inline bool vz_wait_for_frame(VZview *vz_view, PuglView *view, ULARGE_INTEGER *ts) {
 #endif
-  if(vz_view->redraw_mode == VZ_MANUAL) {
+  if(vz_view->shutdown || vz_view->suspend || (vz_view->redraw_mode == VZ_MANUAL && vz_view->redraw))
+    return false;
+
+  if(!vz_timed_frames(vz_view)) {
     enif_mutex_unlock(vz_view->lock);
     puglWaitForEvent(view);
     enif_mutex_lock(vz_view->lock);
+    return false;
   }
-  else {
+
+  if(!vz_view->vsync) {
     enif_mutex_unlock(vz_view->lock);
     sleep_until(ts);
     enif_mutex_lock(vz_view->lock);
     set_next_time_point(ts, vz_view->frame_rate);
   }
+
+  return true;
 }
+#endif
 
-void* vz_view_thread(void *p) {
+/*
+  Returns the CPU time in microseconds used by the calling thread.
+*/
+ErlNifTime vz_thread_cpu_time() {
 #if defined(VZ_PLATFORM_X11) || defined(VZ_PLATFORM_MACOS)
   struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (ErlNifTime)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 #elif defined(VZ_PLATFORM_WINDOWS)
-	ULARGE_INTEGER ts;
+  FILETIME creation, exit, kernel, user;
+  ULARGE_INTEGER k, u;
+  if(!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    return 0;
+  k.LowPart = kernel.dwLowDateTime;
+  k.HighPart = kernel.dwHighDateTime;
+  u.LowPart = user.dwLowDateTime;
+  u.HighPart = user.dwHighDateTime;
+  return (ErlNifTime)((k.QuadPart + u.QuadPart) / 10);
 #endif
+}
 
-  VZview *vz_view = (VZview*) p;
-  PuglView *view;
+#if defined(VZ_PLATFORM_X11)
+static double vz_mode_refresh_rate(const XRRModeInfo *mode) {
+  double v_total = mode->vTotal;
 
-  enif_mutex_lock(vz_view->lock);
+  if(mode->modeFlags & RR_DoubleScan)
+    v_total *= 2.0;
+  if(mode->modeFlags & RR_Interlace)
+    v_total /= 2.0;
+
+  if(mode->hTotal == 0 || v_total <= 0.0)
+    return 0.0;
+
+  return (double)mode->dotClock / ((double)mode->hTotal * v_total);
+}
+
+/*
+  Returns the refresh rate of the CRTC that shows the center of the window.
+*/
+static double vz_query_refresh_rate(VZview *vz_view) {
+  Display *display = vz_view->display;
+  Window window = (Window)puglGetNativeWindow(vz_view->view);
+  Window child;
+  XRRScreenResources *resources;
+  XRRCrtcInfo *crtc;
+  int event_base, error_base, x, y;
+  double rate = 0.0;
+
+  if(!XRRQueryExtension(display, &event_base, &error_base) ||
+     !XTranslateCoordinates(display, window, DefaultRootWindow(display),
+                            vz_view->width / 2, vz_view->height / 2, &x, &y, &child) ||
+     !(resources = XRRGetScreenResourcesCurrent(display, window)))
+    return 0.0;
+
+  for(int i = 0; i < resources->ncrtc && rate == 0.0; ++i) {
+    if(!(crtc = XRRGetCrtcInfo(display, resources, resources->crtcs[i])))
+      continue;
+
+    if(crtc->mode != None && x >= crtc->x && y >= crtc->y &&
+       x < crtc->x + (int)crtc->width && y < crtc->y + (int)crtc->height) {
+      for(int m = 0; m < resources->nmode; ++m) {
+        if(resources->modes[m].id == crtc->mode) {
+          rate = vz_mode_refresh_rate(&resources->modes[m]);
+          break;
+        }
+      }
+    }
+    XRRFreeCrtcInfo(crtc);
+  }
+
+  XRRFreeScreenResources(resources);
+
+  return rate;
+}
+#elif defined(VZ_PLATFORM_WINDOWS)
+static double vz_query_refresh_rate(VZview *vz_view) {
+  HMONITOR monitor = MonitorFromWindow((HWND)puglGetNativeWindow(vz_view->view), MONITOR_DEFAULTTONEAREST);
+  MONITORINFOEX info;
+  DEVMODE mode;
+
+  info.cbSize = sizeof(info);
+  mode.dmSize = sizeof(mode);
+  mode.dmDriverExtra = 0;
+
+  if(GetMonitorInfo(monitor, (MONITORINFO*)&info) &&
+     EnumDisplaySettings(info.szDevice, ENUM_CURRENT_SETTINGS, &mode) &&
+     mode.dmDisplayFrequency > 1)
+    return (double)mode.dmDisplayFrequency;
+
+  return 0.0;
+}
+#else
+static double vz_query_refresh_rate(VZview *vz_view) {
+  __UNUSED(vz_view);
+  return 0.0;
+}
+#endif
+
+/*
+  Queries the refresh rate of the display the window is on, which is the
+  frame rate in vsync mode. Called again when the window is moved or resized,
+  since it may have moved to another monitor.
+*/
+void vz_update_refresh_rate(VZview *vz_view) {
+  double rate;
+
+  if(!vz_view->view)
+    return;
+
+  if((rate = vz_query_refresh_rate(vz_view)) <= 0.0)
+    rate = VZ_DEFAULT_REFRESH_RATE;
+
+  vz_view->refresh_rate = rate;
+  if(vz_view->vsync)
+    vz_view->frame_rate = (int)(rate + 0.5);
+}
+
+/*
+  Keeps a moving average of the time between presented frames. Gaps that
+  are much longer than a frame are pauses in drawing, not frame times.
+*/
+static inline void vz_measure_frame(VZview *vz_view) {
+  ErlNifTime now = enif_monotonic_time(ERL_NIF_USEC);
+  double expected = 1000000.0 / (vz_view->vsync ? vz_view->refresh_rate : vz_view->frame_rate);
+  double interval = (double)(now - vz_view->last_frame_time);
+
+  if(vz_view->frames > 0 && interval < expected * 4.0) {
+    if(vz_view->frame_interval > 0.0)
+      vz_view->frame_interval = vz_view->frame_interval * 0.9 + interval * 0.1;
+    else
+      vz_view->frame_interval = interval;
+  }
+
+  vz_view->last_frame_time = now;
+  ++vz_view->frames;
+}
+
+/*
+  Wakes up the view thread when it is waiting for events. Must be called with
+  the view lock held, after changing the state the thread should act upon.
+*/
+void vz_wake(VZview *vz_view) {
+#if defined(VZ_PLATFORM_X11)
+  uint64_t value = 1;
+  if(write(vz_view->wake_fd, &value, sizeof(value)) < 0) {
+    // the counter can only overflow when the thread is not reading it anyway
+  }
+#elif defined(VZ_PLATFORM_WINDOWS)
+  if(vz_view->view)
+    PostMessage((HWND)puglGetNativeWindow(vz_view->view), WM_NULL, 0, 0);
+#endif
+}
+
+/*
+  Returns true when called from the thread that renders the view while it
+  holds the view lock, so the lock must not be taken again.
+*/
+bool vz_view_locked_by_self(VZview *vz_view) {
+  if(vz_view->renderer)
+    return vz_renderer_is_current(vz_view->renderer, vz_view);
+
+  return enif_thread_self() == vz_view->view_tid;
+}
+
+/*
+  Creates the window, GL context and NanoVG context of a view. Must be called
+  with the view lock held, on the thread that renders the view.
+*/
+bool vz_view_open(VZview *vz_view) {
+  PuglView *view;
 
   view = puglInit(NULL, NULL);
   puglSetHandle(view, vz_view);
@@ -151,30 +426,163 @@ void* vz_view_thread(void *p) {
   puglInitWindowParent(view, vz_view->parent);
   puglInitWindowSize(view, vz_view->width, vz_view->height);
   puglInitWindowClass(view, vz_view->id);
-  if (puglCreateWindow(view, vz_view->title)) {
-    view = NULL;
-    goto shutdown;
-  }
+  if (puglCreateWindow(view, vz_view->title))
+    return false;
+  vz_view->view = view;
 
   puglEnterContext(view);
-
+#ifdef VZ_PLATFORM_X11
+  vz_view->display = glXGetCurrentDisplay();
+#endif
+  vz_share_attach(vz_view);
 
   if(glewInit() ||
     !(vz_view->ctx = nvgCreateGL2(NVG_DEBUG | NVG_ANTIALIAS | NVG_STENCIL_STROKES))) {
-    goto shutdown;
-  }
-  if(vz_view->vsync) {
-    puglSetSwapInterval(view, 1);
-    vz_view->frame_rate = puglGetSwapInterval(view);
+    puglLeaveContext(view, false);
+    vz_view_close(vz_view);
+    return false;
   }
-  else
-    puglSetSwapInterval(view, 0);
+  vz_damage_setup(vz_view);
+  // views sharing a render thread are paced by the thread, swapping must not
+  // block it on the vertical blank of every window
+  puglSetSwapInterval(view, vz_view->vsync && !vz_view->renderer ? 1 : 0);
 
   puglLeaveContext(view, false);
   puglShowWindow(view);
-  vz_view->view = view;
+  vz_update_refresh_rate(vz_view);
+
+  return true;
+}
+
+void vz_view_close(VZview *vz_view) {
+  if(!vz_view->view)
+    return;
+
+  puglEnterContext(vz_view->view);
+  vz_share_bind(vz_view);
+  if(vz_view->ctx) {
+    vz_textures_clear(vz_view);
+    vz_video_shader_free(&vz_view->video_shader);
+    vz_heatmap_shader_free(&vz_view->heatmap_shader);
+    vz_sdf_free(&vz_view->sdf);
+    vz_layers_free(vz_view);
+    vz_damage_free(vz_view);
+    nvgDeleteGL2(vz_view->ctx);
+    vz_view->ctx = NULL;
+  }
+  vz_share_detach(vz_view);
+  puglLeaveContext(vz_view->view, false);
+  vz_asset_ref_release_all(&vz_view->font_assets);
+
+  puglDestroy(vz_view->view);
+  vz_view->view = NULL;
+}
+
+/*
+  Views on a shared render thread build their frames asynchronously, the
+  thread must never wait for a view process. A frame is begun and the process
+  is asked to build it, the ops it queues are run whenever the view is
+  serviced again, and the frame is ended and presented once the process is
+  ready. Ops that expect a reply and the ready signal wake up the thread.
+*/
+static void vz_frame_begin(VZview *vz_view) {
+  puglEnterContext(vz_view->view);
+  vz_share_bind(vz_view);
+  vz_measure_frame(vz_view);
+  vz_begin_frame(vz_view);
+  vz_run_pending(vz_view);
+  puglLeaveContext(vz_view->view, false);
+
+  vz_view->busy = true;
+  vz_view->building = true;
+  vz_send_update(vz_view);
+}
+
+/*
+  Returns true when the frame was ended.
+*/
+static bool vz_frame_continue(VZview *vz_view) {
+  VZop_array *a = vz_view->op_array;
+  bool ready = !vz_view->busy;
+
+  if(!ready && a->start_pos == a->end_pos)
+    return false;
+
+  puglEnterContext(vz_view->view);
+  vz_share_bind(vz_view);
+  vz_run_pending(vz_view);
+  if(ready) {
+    vz_end_frame(vz_view);
+    vz_layers_sweep(vz_view);
+    vz_free_ops(vz_view);
+    vz_view->building = false;
+  }
+  puglLeaveContext(vz_view->view, ready);
+
+  return ready;
+}
+
+/*
+  Abandons the frame being built when a shared view is shut down. The queued
+  ops are freed with the view.
+*/
+void vz_frame_abort(VZview *vz_view) {
+  vz_view->busy = false;
+  vz_view->building = false;
+}
+
+/*
+  Requests a redraw when a frame is due, then dispatches the window events,
+  which draws the frame, and sends the collected events to the view process.
+  On a shared render thread, the frame is begun or continued instead.
+*/
+void vz_view_step(VZview *vz_view, bool frame_due) {
+  bool redraw = (vz_view->redraw_mode == VZ_MANUAL && vz_view->redraw) || (frame_due && vz_timed_frames(vz_view));
+
+  if(vz_view->renderer) {
+    // resources released by the process stay valid until its frame has ended
+    if(vz_view->building && vz_frame_continue(vz_view))
+      vz_release_managed_resources(vz_view);
+
+    if(!vz_view->building && (redraw || vz_view->exposed)) {
+      vz_view->redraw = false;
+      vz_view->exposed = false;
+      vz_frame_begin(vz_view);
+    }
+
+    puglProcessEvents(vz_view->view);
+    vz_send_events(vz_view);
+    return;
+  }
+
+  if(redraw) {
+    vz_view->redraw = false;
+    puglPostRedisplay(vz_view->view);
+  }
+
+  puglProcessEvents(vz_view->view);
+  vz_send_events(vz_view);
+  vz_release_managed_resources(vz_view);
+}
+
+void* vz_view_thread(void *p) {
+#if defined(VZ_PLATFORM_X11) || defined(VZ_PLATFORM_MACOS)
+  struct timespec ts;
+#elif defined(VZ_PLATFORM_WINDOWS)
+	ULARGE_INTEGER ts;
+#endif
+
+  VZview *vz_view = (VZview*) p;
+  bool frame_due;
+
+  enif_mutex_lock(vz_view->lock);
+
+  if(!vz_view_open(vz_view))
+    goto shutdown;
+
   if(!vz_view->vsync)
     set_next_time_point(&ts, vz_view->frame_rate);
+  frame_due = true;
 
   enif_send(NULL, &vz_view->view_pid, NULL, ATOM_INITIALIZED);
 
@@ -184,22 +592,12 @@ void* vz_view_thread(void *p) {
       enif_cond_wait(vz_view->suspended_cv, vz_view->lock);
     }
 
-    puglProcessEvents(view);
-    vz_send_events(vz_view);
-
-    if (vz_view->redraw_mode == VZ_INTERVAL)
-      puglPostRedisplay(view);
-
-    vz_release_managed_resources(vz_view);
-    if(!vz_view->vsync) vz_wait_for_frame(vz_view, view, &ts);
+    vz_view_step(vz_view, frame_due);
+    vz_view->cpu_time = vz_thread_cpu_time();
+    frame_due = vz_wait_for_frame(vz_view, vz_view->view, &ts);
   }
 shutdown:
-  if(vz_view->ctx)
-    nvgDeleteGL2(vz_view->ctx);
-
-  if (view)
-    puglDestroy(view);
-
+  vz_view_close(vz_view);
 
   enif_mutex_unlock(vz_view->lock);
   enif_send(NULL, &vz_view->view_pid, NULL, ATOM_SHUTDOWN);
@@ -207,8 +605,20 @@ shutdown:
 }
 
 void vz_update(VZview *vz_view) {
+  // a shared view draws on the next service, or after the frame in progress
+  if(vz_view->renderer) {
+    vz_damage_invalidate(vz_view);
+    vz_view->exposed = true;
+    vz_wake(vz_view);
+    return;
+  }
+
+  // Pugl entered the context of the window
+  vz_share_bind(vz_view);
+  vz_measure_frame(vz_view);
   vz_begin_frame(vz_view);
   vz_send_update(vz_view);
   vz_run(vz_view);
   vz_end_frame(vz_view);
+  vz_layers_sweep(vz_view);
 }
@@ -3,5 +3,14 @@
 
 void* vz_view_thread(void *p);
 void vz_update(VZview *vz_view);
+void vz_wake(VZview *vz_view);
+void vz_update_refresh_rate(VZview *vz_view);
+bool vz_view_open(VZview *vz_view);
+void vz_view_close(VZview *vz_view);
+void vz_view_step(VZview *vz_view, bool frame_due);
+void vz_frame_abort(VZview *vz_view);
+bool vz_view_locked_by_self(VZview *vz_view);
+bool vz_timed_frames(VZview *vz_view);
+ErlNifTime vz_thread_cpu_time();
 
-#endif
\ No newline at end of file
+#endif
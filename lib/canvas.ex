@@ -194,6 +194,30 @@ defmodule Vizi.Canvas do
   """
   defdelegate stroke(ctx), to: NIF
 
+  @doc """
+  Fills a path created with `Vizi.Canvas.Path.new/1` with current fill style, replacing the
+  current path.
+  """
+  defdelegate fill_path(ctx, path), to: NIF
+
+  @doc """
+  Strokes a path created with `Vizi.Canvas.Path.new/1` with current stroke style, replacing the
+  current path.
+  """
+  defdelegate stroke_path(ctx, path), to: NIF
+
+  @doc """
+  Draws an SVG document loaded with `Vizi.Canvas.SVG.load/2` in a rectangle, its view box
+  fitted like `draw_image/7` fits images.
+
+  Options
+   * `:alpha` - the opacity of the document, defaults to `1.0`
+   * `:mode` - `:keep_aspect_ratio` (default) or `:fill`
+
+  The current path is replaced, the transform and styles are kept.
+  """
+  defdelegate draw_svg(ctx, x, y, width, height, svg, opts \\ []), to: NIF
+
   @doc """
   Draws text string at specified location.
   """
@@ -274,16 +298,31 @@ defmodule Vizi.Canvas do
   defdelegate reset_scissor(ctx), to: NIF
 
   @doc """
-  Convenience function that returns a color struct from red, green, blue and alpha values.
-  Expects values between 0 and 255.
+  Convenience function that returns a packed `0xRRGGBBAA` color from red, green, blue and
+  alpha values. Expects values between 0 and 255.
+
+  Up to Vizi 0.3 this returned a `Vizi.Canvas.Color` struct, since 0.4 it returns a packed
+  integer. All functions that take a color accept both forms, code that reads the components
+  of the result should call `Vizi.Canvas.Color.unpack/1` on it. See the changelog for
+  upgrading.
   """
+  @spec rgba(r :: number, g :: number, b :: number, a :: number) :: non_neg_integer
   def rgba(r, g, b, a \\ 255) do
-    %Vizi.Canvas.Color{
-      r: r / 255.0,
-      g: g / 255.0,
-      b: b / 255.0,
-      a: a / 255.0
-    }
+    Vizi.Canvas.Color.pack(r, g, b, a)
+  end
+
+  @doc """
+  Same as `rgba/4`, but packs the color at compile time when all values are number literals.
+  Being a macro, it needs `use Vizi.Canvas` or `require Vizi.Canvas` before it is called.
+  """
+  defmacro rgba_const(r, g, b, a \\ 255) do
+    if is_number(r) and is_number(g) and is_number(b) and is_number(a) do
+      Vizi.Canvas.Color.pack(r, g, b, a)
+    else
+      quote do
+        Vizi.Canvas.Color.pack(unquote(r), unquote(g), unquote(b), unquote(a))
+      end
+    end
   end
 
   @doc """
@@ -328,6 +367,13 @@ defmodule Vizi.Canvas do
   """
   defdelegate draw_image(ctx, x, y, width, height, image, opts \\ []), to: NIF
 
+  @doc """
+  Draws a heatmap image, see `Vizi.Canvas.Image.heatmap/5`, stretched over the rectangle.
+  Accepts the options of `draw_image/7`.
+  """
+  def heatmap(ctx, x, y, width, height, image, opts \\ []),
+    do: NIF.draw_image(ctx, x, y, width, height, image, [mode: :fill] ++ opts)
+
   @doc """
   Sets the miter limit of the stroke style.
   Miter limit controls when a sharp corner is beveled.
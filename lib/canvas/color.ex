@@ -3,15 +3,45 @@ defmodule Vizi.Canvas.Color do
 
   defstruct r: 0.0, g: 0.0, b: 0.0, a: 1.0
 
-  @type t :: %Vizi.Canvas.Color{r: float, g: float, b: float, a: float}
+  @typedoc """
+  A color is either packed in an integer as `0xRRGGBBAA`, or a color struct with
+  components between 0.0 and 1.0. Packed colors are cheaper to pass to the NIF functions.
+  """
+  @type t :: non_neg_integer | %Vizi.Canvas.Color{r: float, g: float, b: float, a: float}
+
+  @doc """
+  Packs red, green, blue and alpha values between 0 and 255 in a `0xRRGGBBAA` integer.
+  """
+  @spec pack(r :: number, g :: number, b :: number, a :: number) :: non_neg_integer
+  def pack(r, g, b, a \\ 255) do
+    clamp(r) * 0x1000000 + clamp(g) * 0x10000 + clamp(b) * 0x100 + clamp(a)
+  end
+
+  @doc """
+  Unpacks a `0xRRGGBBAA` integer to a color struct.
+  """
+  @spec unpack(color :: non_neg_integer) :: t
+  def unpack(color) do
+    %Vizi.Canvas.Color{
+      r: div(color, 0x1000000) / 255.0,
+      g: rem(div(color, 0x10000), 0x100) / 255.0,
+      b: rem(div(color, 0x100), 0x100) / 255.0,
+      a: rem(color, 0x100) / 255.0
+    }
+  end
 
   @doc """
   Linearly interpolates from color c1 to c2, and returns resulting color value.
+  Returns a packed color since Vizi 0.4, use `unpack/1` to read its components.
   """
   defdelegate lerp(c1, c2, u), to: NIF, as: :lerp_rgba
 
   @doc """
-  Returns color struct specified by hue, saturation, lightness and alpha.
+  Returns color specified by hue, saturation, lightness and alpha.
+  Returns a packed color since Vizi 0.4, use `unpack/1` to read its components.
   """
   defdelegate from_hsla(h, s, l, a \\ 1.0), to: NIF, as: :hsla
+
+  defp clamp(v) when is_integer(v), do: min(max(v, 0), 255)
+  defp clamp(v), do: v |> round() |> clamp()
 end
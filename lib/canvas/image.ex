@@ -11,6 +11,15 @@ defmodule Vizi.Canvas.Image do
     * `:premultiplied` Image data has premultiplied alpha.
     * `:nearest` Image interpolation is Nearest instead Linear
 
+  Images loaded from files or encoded data also accept load options in the flags:
+
+    * `max_size: {w, h}` Downscales the image with a box filter to fit in `w` x `h`, keeping
+      its aspect ratio. Images are never scaled up, a maximum of `0` means no limit.
+    * `mipmaps: :cpu` Builds the mip chain with a box filter when the image is loaded,
+      instead of having the driver generate it when it is uploaded.
+
+  Decoding, downscaling and building the mip chain happen in the calling process on a
+  dirty scheduler, the view only uploads the result.
   """
 
   alias Vizi.NIF
@@ -19,32 +28,164 @@ defmodule Vizi.Canvas.Image do
 
   @doc """
   Creates image by loading it from the disk from specified file name.
-  Returns handle to the image.
+  Returns handle to the image. A file is decoded only once for all views, for as long as
+  images created from it exist and it isn't modified. Loading a file that the view already
+  loaded with the same flags returns an image that shares its texture. Views also share
+  the texture of a file loaded with the same flags, it is uploaded by the first view that
+  loads it, on platforms where views can share GL textures.
+
+  The decoded pixels are released once they are uploaded, unless the view has a
+  `texture_budget` and may need to upload them again. Loading the file while no view
+  has a texture for it decodes it again.
   """
   def from_file(ctx, file_path, flags \\ []) do
-    NIF.image_from_file(ctx, file_path, flags)
+    {opts, flags} = Enum.split_with(flags, &is_tuple/1)
+    asset = NIF.image_load(file_path, opts)
+    NIF.image_from_asset(ctx, asset, flags)
     NIF.get_reply()
   end
 
   @doc """
   Creates image from specified image data.
-  Returns handle to the image.
+  Returns handle to the image. Image data with the same contents, size and flags as an
+  existing image of the view shares its texture.
   """
   def from_binary(ctx, data, w, h, flags \\ []) do
     NIF.image_from_binary(ctx, data, w, h, flags)
     NIF.get_reply()
   end
 
+  @doc """
+  Creates image from encoded image data, like the contents of a png or jpg file.
+  Returns handle to the image. Data with the same contents is decoded only once for all views,
+  like a file.
+  """
+  def from_encoded_binary(ctx, data, flags \\ []) do
+    {opts, flags} = Enum.split_with(flags, &is_tuple/1)
+    asset = NIF.image_load_binary(data, opts)
+    NIF.image_from_asset(ctx, asset, flags)
+    NIF.get_reply()
+  end
+
+  @doc """
+  Decodes encoded image data, like the contents of a png or jpg file, on a dirty scheduler.
+  Returns the pixels as RGBA binary in the form `{data, width, height}`.
+  Accepts the `max_size` load option.
+  """
+  def decode(data, opts \\ []), do: NIF.image_decode(data, opts)
+
   @doc """
   Loads a file from disk and returns it as a binary.
+  Accepts the `max_size` load option.
+  """
+  def file_to_binary(file_path, opts \\ []), do: NIF.image_file_to_binary(file_path, opts)
+
+  @doc """
+  Multiplies the color channels of RGBA image data by alpha.
+  Pixel conversions run on a dirty scheduler with the SIMD instructions of the CPU and
+  return new image data.
+  """
+  defdelegate premultiply(data), to: NIF, as: :image_premultiply
+
+  @doc """
+  Divides the color channels of premultiplied RGBA image data by alpha.
+  """
+  defdelegate unpremultiply(data), to: NIF, as: :image_unpremultiply
+
+  @doc """
+  Reorders the channels of four channel image data, channel `n` of the result is channel
+  `Enum.at(order, n)` of the source. For example `[2, 1, 0, 3]` converts between BGRA and RGBA.
+  """
+  defdelegate swizzle(data, order), to: NIF, as: :image_swizzle
+
+  @doc """
+  Converts RGB image data to opaque RGBA image data.
+  """
+  defdelegate rgb_to_rgba(data), to: NIF, as: :image_rgb_to_rgba
+
+  @doc """
+  Converts the color channels of RGBA image data to their luma, keeping alpha.
+  """
+  defdelegate grayscale(data), to: NIF, as: :image_grayscale
+
+  @doc """
+  Maps every channel of RGBA image data through a lookup table. The table is either a binary
+  of 256 bytes applied to the color channels, or of 1024 bytes holding a table per channel.
   """
-  defdelegate file_to_binary(file_path), to: NIF, as: :image_file_to_binary
+  defdelegate apply_lut(data, lut), to: NIF, as: :image_lut
+
+  @doc """
+  Creates a blank streaming image of the specified size, for images that are updated often
+  with `update_from_binary/3`, like animations rendered in Elixir.
+  Returns handle to the image.
+  """
+  def stream(ctx, w, h, flags \\ []) do
+    NIF.image_stream(ctx, w, h, flags)
+    NIF.get_reply()
+  end
 
   @doc """
   Updates image data specified by image handle.
+  An image that shares its texture with other images gets a texture of its own.
+  The data of streaming and video images is copied to GL memory in the calling process, on a
+  dirty scheduler, and uploaded while the view renders. When the view can't keep up, updates
+  fall back to uploading from the binary on the render thread.
   """
   defdelegate update_from_binary(ctx, image, data), to: NIF, as: :image_update_from_binary
 
+  @doc """
+  Creates a video image of the specified frame size, to be updated with `update_video/3`.
+  Returns handle to the image.
+  Besides image flags, the flags select the format of the frames and their color space:
+
+    * `:i420` Planar Y, U and V, the chroma planes at half the width and height (default).
+    * `:nv12` Planar Y followed by interleaved U and V at half the width and height.
+    * `:bt601` Limited range BT.601 colors (default).
+    * `:bt709` Limited range BT.709 colors.
+
+  Frames are converted to RGBA on the GPU.
+  """
+  def video(ctx, w, h, flags \\ []) do
+    NIF.image_video(ctx, w, h, flags)
+    NIF.get_reply()
+  end
+
+  @doc """
+  Uploads a frame to a video image, like `update_from_binary/3` for streaming images.
+  Frames that are too small for the image are ignored.
+  """
+  defdelegate update_video(ctx, image, data), to: NIF, as: :image_update_video
+
+  @doc """
+  Creates a heatmap image of `cols` by `rows` cells, all at the first color of the colormap,
+  to be updated with `update_heatmap/4` and drawn with `Vizi.Canvas.heatmap/7`.
+  Returns handle to the image.
+  The colormap is one of `:grayscale`, `:viridis` and `:inferno`, or a binary of 256 RGBA or
+  RGB colors. Cells are looked up in the colormap on the GPU, the image is one pixel per cell,
+  pass the `:nearest` flag to draw cells as sharp squares.
+  """
+  def heatmap(ctx, cols, rows, colormap, flags \\ []) do
+    NIF.image_heatmap(ctx, cols, rows, colormap, flags)
+    NIF.get_reply()
+  end
+
+  @doc """
+  Replaces the values of a block of cells of a heatmap image. Values are either a byte per cell,
+  indexing the colormap, or a native 32 bit float per cell, mapped from a range to the colormap.
+  Only the cells of the block are uploaded. Options:
+
+    * `{:origin, {col, row}}` The first cell of the block (default `{0, 0}`).
+    * `{:size, {cols, rows}}` The size of the block (default up to the last cell of the grid).
+    * `{:range, {min, max}}` The values mapped to the first and last color (default `{0.0, 1.0}`).
+  """
+  def update_heatmap(ctx, image, values, opts \\ []),
+    do: NIF.image_update_heatmap(ctx, image, values, opts)
+
+  @doc """
+  Replaces the colormap of a heatmap image, without uploading its cells again.
+  """
+  defdelegate heatmap_colormap(ctx, image, colormap), to: NIF, as: :image_heatmap_colormap
+
   @doc """
   Returns the dimensions of a created image int the form `{width, height}`.
   """
@@ -0,0 +1,38 @@
+defmodule Vizi.Canvas.Path do
+  @moduledoc """
+  Retained paths, built once and drawn any number of times by any view with
+  `Vizi.Canvas.fill_path/2` and `Vizi.Canvas.stroke_path/2`, like `Path2D` of HTML canvas.
+
+  A path is built from a list of commands in the form of the canvas functions they mirror,
+  without the context:
+
+      Path.new([
+        {:move_to, 0, 0},
+        {:line_to, 10, 0},
+        {:bezier_to, 15, 0, 20, 5, 20, 10},
+        {:quad_to, 20, 20, 10, 20},
+        {:arc_to, 0, 20, 0, 10, 5},
+        :close_path,
+        {:circle, 10, 10, 4},
+        {:path_winding, :hole}
+      ])
+
+  `:arc`, `:rect`, `:rounded_rect`, `:rounded_rect_varying` and `:ellipse` are accepted as well.
+
+  Paths can also be built from a binary of native 32 bit floats, each opcode followed by its
+  arguments: `0` move to (x, y), `1` line to (x, y), `2` bezier to (c1x, c1y, c2x, c2y, x, y),
+  `3` close path and `4` winding (`1` for counter clockwise, `2` for clockwise).
+
+  Curves are flattened when a path is drawn, the lines are kept as long as the path is drawn
+  with the same scale, rotation and skew, so paths that only move are not flattened again.
+  """
+
+  alias Vizi.NIF
+
+  @type t :: <<>>
+
+  @doc """
+  Creates a path from a list of commands or a binary of packed commands.
+  """
+  defdelegate new(commands), to: NIF, as: :path_new
+end
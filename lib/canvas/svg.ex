@@ -0,0 +1,38 @@
+defmodule Vizi.Canvas.SVG do
+  @moduledoc """
+  SVG documents imported into retained paths, drawn by any view with
+  `Vizi.Canvas.draw_svg/7`.
+
+  Documents are parsed once, off the render thread, into one path per shape with its
+  transforms applied and its style resolved to solid colors. Drawing a document only
+  flattens the curves of its paths when its scale, rotation or skew change.
+
+  The importer covers the geometry of icons and illustrations: `path`, `rect`, `circle`,
+  `ellipse`, `line`, `polyline` and `polygon` elements in nested `svg` and `g` elements,
+  with presentation attributes, `style` declarations, solid colors and opacities.
+  Gradients, patterns, clipping, masks, text, `use` elements and style sheets are not
+  imported, shapes painted with gradients or patterns are drawn without that paint.
+
+  Options
+   * `:current_color` - the color `currentColor` refers to, defaults to black
+  """
+
+  alias Vizi.NIF
+
+  @type t :: <<>>
+
+  @doc """
+  Imports an SVG file, on a dirty IO scheduler.
+  """
+  defdelegate load(file_path, opts \\ []), to: NIF, as: :svg_load
+
+  @doc """
+  Imports an SVG document from a binary, on a dirty CPU scheduler.
+  """
+  defdelegate from_binary(data, opts \\ []), to: NIF, as: :svg_load_binary
+
+  @doc """
+  Returns the size of the view box of a document as `{width, height}`.
+  """
+  defdelegate size(svg), to: NIF, as: :svg_size
+end
@@ -34,10 +34,25 @@ defmodule Vizi.Canvas.Text do
 
   @doc """
   Creates font by loading it from the disk from specified file name.
-  Returns handle to the font.
+  Returns handle to the font. A file is loaded once for all views that use it, views added later cost no font memory or reads.
+
+  Files on read-only file systems are memory mapped, the others are read into memory. A
+  mapped file must not be truncated or rewritten in place while the font exists, reading
+  the lost pages would crash the VM. Replace it by renaming a new file over it instead.
+
+  Options
+   * `:sdf` - when `true`, text in this font is drawn from signed distance fields: glyphs are
+     rasterized once and drawn at any size and scale without being rasterized again, which
+     suits text whose size or transform is animated. Text is drawn with the fill color,
+     gradients and fallback fonts don't apply. Creating a loaded font with `sdf: true`
+     makes it an SDF font.
+   * `:prewarm` - a string whose glyphs are rasterized when the font is created rather than
+     when they are first drawn, e.g. `"0123456789.,-"` for counters.
+   * `:sizes` - font sizes the `:prewarm` glyphs are rasterized at (default: `[16]`). SDF fonts
+     rasterize glyphs once for all sizes and ignore it.
   """
-  def create_font(ctx, file_path) do
-    NIF.create_font(ctx, file_path)
+  def create_font(ctx, file_path, opts \\ []) do
+    NIF.create_font(ctx, file_path, opts)
     NIF.get_reply()
   end
 
@@ -3,69 +3,148 @@ defmodule Vizi.Canvas.Transform do
   The functions in this module do not transform the view directly.
   They return a matrix that can be applied to the view by calling
   `Vizi.Canvas.transform/2`.
+
+  A matrix is a tuple with 6 floats `{sx, ky, kx, sy, tx, ty}`, see `Vizi.Canvas`.
+  All functions are implemented in Elixir and work on the process heap, use `compose/1`
+  to multiply a long list of transforms in a single call. All functions, `compose/1`
+  included, compute in double precision, the transform is only rounded to single
+  precision when it's applied to the view.
   """
 
   alias Vizi.NIF
 
-  @type t :: <<>>
+  @type t :: {float, float, float, float, float, float}
+
+  @compile {:inline,
+            identity: 0,
+            translate: 2,
+            scale: 2,
+            rotate: 1,
+            skew_x: 1,
+            skew_y: 1,
+            multiply: 2,
+            premultiply: 2,
+            point: 3}
 
   @doc """
   Sets the transform to the identity matrix.
   """
-  defdelegate identity(ctx), to: NIF, as: :transform_identity
+  @spec identity() :: t
+  def identity do
+    {1.0, 0.0, 0.0, 1.0, 0.0, 0.0}
+  end
+
+  @doc false
+  def identity(_ctx), do: identity()
 
   @doc """
   Sets the transform to a translation matrix.
   """
-  defdelegate translate(x, y), to: NIF, as: :transform_translate
+  @spec translate(x :: number, y :: number) :: t
+  def translate(x, y) do
+    {1.0, 0.0, 0.0, 1.0, x / 1, y / 1}
+  end
 
   @doc """
   Sets the transform to a scale matrix.
   """
-  defdelegate scale(x, y), to: NIF, as: :transform_scale
+  @spec scale(x :: number, y :: number) :: t
+  def scale(x, y) do
+    {x / 1, 0.0, 0.0, y / 1, 0.0, 0.0}
+  end
 
   @doc """
   Sets the transform to a rotate matrix. Angle is specified in radians.
   """
-  defdelegate rotate(angle), to: NIF, as: :transform_rotate
+  @spec rotate(angle :: number) :: t
+  def rotate(angle) do
+    cs = :math.cos(angle)
+    sn = :math.sin(angle)
+    {cs, sn, -sn, cs, 0.0, 0.0}
+  end
 
   @doc """
   Sets the transform to a skew-x matrix. Angle is specified in radians.
   """
-  defdelegate skew_x(angle), to: NIF, as: :transform_skew_x
+  @spec skew_x(angle :: number) :: t
+  def skew_x(angle) do
+    {1.0, 0.0, :math.tan(angle), 1.0, 0.0, 0.0}
+  end
 
   @doc """
   Sets the transform to a skew-y matrix. Angle is specified in radians.
   """
-  defdelegate skew_y(angle), to: NIF, as: :transform_skew_y
+  @spec skew_y(angle :: number) :: t
+  def skew_y(angle) do
+    {1.0, :math.tan(angle), 0.0, 1.0, 0.0, 0.0}
+  end
 
   @doc """
   Sets the transform to the result of multiplication of two transforms, of A = A*B.
   """
-  defdelegate multiply(a, b), to: NIF, as: :transform_multiply
+  @spec multiply(a :: t, b :: t) :: t
+  def multiply({t0, t1, t2, t3, t4, t5}, {s0, s1, s2, s3, s4, s5}) do
+    {t0 * s0 + t1 * s2, t0 * s1 + t1 * s3, t2 * s0 + t3 * s2, t2 * s1 + t3 * s3,
+     t4 * s0 + t5 * s2 + s4, t4 * s1 + t5 * s3 + s5}
+  end
 
   @doc """
   Sets the transform to the result of multiplication of two transforms, of A = B*A.
   """
-  defdelegate premultiply(a, b), to: NIF, as: :transform_premultiply
+  @spec premultiply(a :: t, b :: t) :: t
+  def premultiply(a, b) do
+    multiply(b, a)
+  end
+
+  @doc """
+  Multiplies a list of transforms from left to right in a single NIF call.
+
+  The result is the same as `Enum.reduce(list, identity(), &multiply(&2, &1))`.
+  """
+  @spec compose(list :: [t]) :: t
+  defdelegate compose(list), to: NIF, as: :transform_compose
 
   @doc """
   Returns the inverse of the given transform.
+
+  Like NanoVG, returns the identity matrix when the transform is not invertible,
+  that is when the absolute value of its determinant is below `1.0e-6`.
   """
-  defdelegate inverse(matrix), to: NIF, as: :transform_inverse
+  @spec inverse(matrix :: t) :: t
+  def inverse({t0, t1, t2, t3, t4, t5}) do
+    det = (t0 * t3 - t2 * t1) / 1
+
+    if abs(det) < 1.0e-6 do
+      identity()
+    else
+      invdet = 1.0 / det
+
+      {t3 * invdet, -t1 * invdet, -t2 * invdet, t0 * invdet, (t2 * t5 - t3 * t4) * invdet,
+       (t1 * t4 - t0 * t5) * invdet}
+    end
+  end
 
   @doc """
   Transform a point by given transform.
   """
-  defdelegate point(matrix, x, y), to: NIF, as: :transform_point
+  @spec point(matrix :: t, x :: number, y :: number) :: {float, float}
+  def point({t0, t1, t2, t3, t4, t5}, x, y) do
+    {x * t0 + y * t2 + t4, x * t1 + y * t3 + t5}
+  end
 
   @doc """
-  Converts a matrix resource to a list.
+  Converts a matrix to a list.
   """
-  defdelegate matrix_to_list(matrix), to: NIF
+  @spec matrix_to_list(matrix :: t) :: [float]
+  def matrix_to_list(matrix) do
+    Tuple.to_list(matrix)
+  end
 
   @doc """
-  Converts a list with at least 6 values to matrix resource.
+  Converts a list with at least 6 values to matrix.
   """
-  defdelegate list_to_matrix(list), to: NIF
+  @spec list_to_matrix(list :: [number]) :: t
+  def list_to_matrix([a, b, c, d, e, f | _]) do
+    {a / 1, b / 1, c / 1, d / 1, e / 1, f / 1}
+  end
 end
@@ -8,7 +8,7 @@ defmodule Vizi.NIF do
     |> Application.app_dir("priv")
     |> Path.join("vz_nif")
     |> String.to_charlist()
-    |> :erlang.load_nif(0)
+    |> :erlang.load_nif(Application.get_env(:vizi, :render_threads, 0))
   end
 
   def create_view(_opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
@@ -25,9 +25,31 @@ defmodule Vizi.NIF do
 
   def get_frame_rate(_ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
+  def get_stats(_ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
   def force_send_events(_ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
-  def setup_node(_node, _parent_xform, _ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+  def create_node(_ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def sync_node(_ctx, _node, _attrs), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def update_transforms(_ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def hit_test(_ctx, _x, _y), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def setup_node(_ctx, _node), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def damage_node(_ctx, _node), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def damage_subtrees(_ctx, _ids), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def layer_invalidate(_ctx, _node), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def layer_begin(_ctx, _node), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def layer_end(_ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def layer_draw(_ctx, _node), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
   def global_composite_operation(_ctx, _operation), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
@@ -106,6 +128,8 @@ defmodule Vizi.NIF do
 
   def transform_point(_matrix, _x, _y), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
+  def transform_compose(_list), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
   def matrix_to_list(_matrix), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
   def list_to_matrix(_list), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
@@ -114,15 +138,50 @@ defmodule Vizi.NIF do
 
   def rad_to_deg(_rad), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
-  def image_file_to_binary(_file_path), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+  def image_decode(_data, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_file_to_binary(_file_path, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_load(_file_path, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_load_binary(_data, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_from_asset(_ctx, _asset, _flags), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_premultiply(_data), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_unpremultiply(_data), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_swizzle(_data, _order), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
-  def image_from_file(_ctx, _file_path, _flags), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+  def image_rgb_to_rgba(_data), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_grayscale(_data), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_lut(_data, _lut), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_pixel_isa(), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
   def image_from_binary(_ctx, _data, _w, _h, _flags),
     do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
   def image_update_from_binary(_ctx, _image, _data), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
+  def image_stream(_ctx, _w, _h, _flags), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_video(_ctx, _w, _h, _flags), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_update_video(_ctx, _image, _data), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_heatmap(_ctx, _cols, _rows, _colormap, _flags),
+    do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_update_heatmap(_ctx, _image, _values, _opts),
+    do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def image_heatmap_colormap(_ctx, _image, _colormap),
+    do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
   def image_size(_ctx, _image), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
   def image_delete(_ctx, _image), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
@@ -189,7 +248,21 @@ defmodule Vizi.NIF do
 
   def stroke(_ctx), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
-  def create_font(_ctx, _file_path), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+  def path_new(_commands), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def fill_path(_ctx, _path), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def stroke_path(_ctx, _path), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def svg_load(_file_path, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def svg_load_binary(_data, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def svg_size(_svg), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def draw_svg(_ctx, _x, _y, _w, _h, _svg, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
+
+  def create_font(_ctx, _file_path, _opts), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
   def find_font(_ctx, _file_path), do: :erlang.nif_error(:vz_nif_lib_not_loaded)
 
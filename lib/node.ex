@@ -14,11 +14,15 @@ defmodule Vizi.Node do
             rotate: 0.0,
             alpha: 1.0,
             mod: nil,
+            cache: nil,
             params: %{},
             initialized: false,
             animations: [],
             updates: [],
-            xform: nil
+            id: nil,
+            ref: nil,
+            synced: nil,
+            content_key: nil
 
   @type t :: %Node{
           tags: [tag],
@@ -34,11 +38,15 @@ defmodule Vizi.Node do
           rotate: number,
           alpha: number,
           mod: module | nil,
+          cache: :layer | nil,
           params: params,
           initialized: boolean,
           animations: [tuple],
           updates: [task_fun],
-          xform: Vizi.Canvas.Transform.t() | nil
+          id: integer | nil,
+          ref: reference | nil,
+          synced: tuple | nil,
+          content_key: tuple | nil
         }
 
   @type tag :: term
@@ -64,6 +72,7 @@ defmodule Vizi.Node do
           | {:rotate, number}
           | {:alpha, number}
           | {:mod, module}
+          | {:cache, :layer | nil}
           | {:params, params}
 
   @typedoc "Options used by `create/3`"
@@ -98,6 +107,7 @@ defmodule Vizi.Node do
 
   @doc """
   Invoked after `Vizi.View.redraw/1` has been called when `redraw_mode` is `:manual`, or after agiven interval has passed when `redraw_mode` is `:interval`.
+  When `redraw_mode` is `:auto`, it is invoked at the given interval only while the view is changing.
 
   """
   @callback draw(params :: params, width :: number, height :: number, ctx :: Vizi.View.context()) ::
@@ -147,6 +157,10 @@ defmodule Vizi.Node do
   Creates a new node.
 
   The first argument is a module that has the Node behaviour implemented.
+
+  When the `:cache` option is set to `:layer`, the node and its descendants are rendered
+  to an offscreen layer, which is reused until the params, attributes or children of
+  any node in the subtree change. Content outside the node's bounds is clipped.
   """
   @spec new(mod :: module, opts :: options) :: t
   def new(mod, opts \\ []) do
@@ -163,6 +177,7 @@ defmodule Vizi.Node do
       skew_y: Keyword.get(opts, :skew_y, 0.0),
       rotate: Keyword.get(opts, :rotate, 0.0),
       alpha: Keyword.get(opts, :alpha, 1.0),
+      cache: Keyword.get(opts, :cache),
       mod: mod,
       params: %{}
     }
@@ -336,41 +351,150 @@ defmodule Vizi.Node do
     %Node{node | updates: node.updates ++ [fun]}
   end
 
+  @doc """
+  Marks a node as changed, so it's redrawn in the next frame even though its params, size,
+  alpha and children are the same. With `partial_redraw: true` or a cached layer, only
+  changes to those are detected, a node whose `draw/4` output depends on anything else
+  should be damaged whenever that changes.
+  """
+  @spec damage(node :: t) :: t
+  def damage(%Node{content_key: nil} = node), do: node
+  def damage(%Node{content_key: key} = node), do: %Node{node | content_key: {:damaged, key}}
+
   # Internals
 
   # Update handling
 
+  # Transforms are kept and computed natively. The tree is first walked to run
+  # updates and animations and to sync changed attributes, after which all
+  # world transforms are computed in a single pass before drawing. That pass
+  # also culls nodes outside the viewport, which are not drawn at all.
+  #
+  # Changes to the params, size, alpha and children of a node are detected
+  # while syncing. Changed nodes damage their bounds, which limits what is
+  # redrawn with partial redraws, and invalidate the layers of the nodes
+  # with a cached layer they are part of.
+
+  @root_id -1
+
+  # visibility flags returned by NIF.update_transforms/1
+  @culled 0
+  @children_visible 2
+  @visible 3
+  @layer_valid 7
+
   @doc false
-  def update(node, parent_xform, ctx) when is_map(node) do
-    %Node{
-      width: width,
-      height: height,
-      params: params,
-      mod: mod,
-      children: children,
-      xform: xform
-    } =
-      node =
+  def update(node, ctx) do
+    {node, _dirty, animating} = sync(node, @root_id, ctx)
+    visibility = NIF.update_transforms(ctx)
+    draw(node, visibility, ctx)
+    {node, animating}
+  end
+
+  defp sync(node, parent_id, ctx) do
+    {node, moved} =
       node
       |> maybe_init(ctx)
       |> maybe_execute_updates(ctx)
       |> step_animations()
+      |> maybe_sync(parent_id, ctx)
 
-    NIF.setup_node(ctx, parent_xform, node)
-    mod.draw(params, width, height, ctx)
-    children = update(children, xform, ctx)
+    {children, {children_dirty, children_animating}} = sync_children(node.children, node.id, ctx)
+    key = {node.params, node.width, node.height, node.alpha, Enum.map(children, & &1.id)}
+    changed = key != node.content_key
+
+    if changed do
+      damage(node.content_key, key, node.ref, ctx)
+    end
+
+    dirty = changed or children_dirty
+
+    if dirty and node.cache == :layer do
+      NIF.layer_invalidate(ctx, node.ref)
+    end
+
+    animating = children_animating or node.animations != []
+
+    {%Node{node | children: children, content_key: key}, dirty or moved, animating}
+  end
+
+  defp sync_children(children, parent_id, ctx) do
+    Enum.map_reduce(children, {false, false}, fn child, {dirty_acc, animating_acc} ->
+      {child, dirty, animating} = sync(child, parent_id, ctx)
+      {child, {dirty_acc or dirty, animating_acc or animating}}
+    end)
+  end
+
+  # New nodes are damaged natively once their bounds are known. Children that
+  # were removed or reordered are damaged with their whole subtree, nodes
+  # passed to damage/1 are damaged as if their content changed.
+  defp damage(nil, _key, _ref, _ctx), do: :ok
+
+  defp damage({:damaged, old_key}, key, ref, ctx), do: damage(old_key, key, ref, ctx)
+
+  defp damage({_, _, _, _, ids}, {_, _, _, _, ids}, ref, ctx) do
+    NIF.damage_node(ctx, ref)
+  end
+
+  defp damage({_, _, _, _, old_ids}, _key, ref, ctx) do
+    NIF.damage_node(ctx, ref)
+    NIF.damage_subtrees(ctx, old_ids)
+  end
+
+  defp maybe_sync(node, parent_id, ctx) do
+    attrs =
+      {parent_id, node.x, node.y, node.width, node.height, node.scale_x, node.scale_y,
+       node.skew_x, node.skew_y, node.rotate, node.alpha}
 
-    %Node{node | children: children}
+    if attrs == node.synced do
+      {node, false}
+    else
+      NIF.sync_node(ctx, node.ref, attrs)
+      {%Node{node | synced: attrs}, true}
+    end
   end
 
-  def update(els, parent_xform, ctx) do
-    Enum.map(els, &update(&1, parent_xform, ctx))
+  defp draw(%Node{id: id, children: children, cache: cache} = node, visibility, ctx) do
+    case :binary.at(visibility, id) do
+      @culled ->
+        :ok
+
+      @children_visible when cache == :layer ->
+        :ok
+
+      @children_visible ->
+        Enum.each(children, &draw(&1, visibility, ctx))
+
+      @visible when cache == :layer ->
+        NIF.layer_begin(ctx, node.ref)
+        draw_layer(node, ctx)
+        NIF.layer_end(ctx)
+        NIF.layer_draw(ctx, node.ref)
+
+      @visible ->
+        draw_node(node, ctx)
+        Enum.each(children, &draw(&1, visibility, ctx))
+
+      @layer_valid ->
+        NIF.layer_draw(ctx, node.ref)
+    end
+  end
+
+  defp draw_layer(node, ctx) do
+    draw_node(node, ctx)
+    Enum.each(node.children, &draw_layer(&1, ctx))
+  end
+
+  defp draw_node(%Node{width: width, height: height, params: params, mod: mod} = node, ctx) do
+    NIF.setup_node(ctx, node.ref)
+    mod.draw(params, width, height, ctx)
   end
 
   defp maybe_init(%Node{initialized: false} = node, ctx) do
     case node.mod.init(node, ctx) do
       {:ok, node} ->
-        %Node{node | xform: NIF.transform_identity(ctx), initialized: true}
+        {id, ref} = NIF.create_node(ctx)
+        %Node{node | id: id, ref: ref, initialized: true}
 
       bad_return ->
         raise "bad return value from #{inspect(node.mod)}.init/2: #{inspect(bad_return)}"
@@ -400,61 +524,88 @@ defmodule Vizi.Node do
 
   # Event handling
 
+  # Pointer events are hit tested natively once per event. The resulting map
+  # holds the node ids under the pointer with local coordinates, and their
+  # ancestors with nil, so subtrees without hits are skipped entirely.
+
+  @pointer_events ~w(button_press button_release key_press key_release motion scroll)a
+
   @doc false
-  def handle_events(events, %Node{} = node, ctx) do
-    {node, events} = Enum.reduce(events, {node, []}, &maybe_handle_event/2)
-    {children, events} = handle_events(Enum.reverse(events), node.children, ctx)
-    {%Node{node | children: children}, events}
+  def handle_events(events, %Node{} = root, ctx) do
+    events = Enum.map(events, &with_hits(&1, ctx))
+    {root, events} = dispatch(events, root)
+    {root, Enum.map(events, &without_hits/1)}
+  end
+
+  defp with_hits(%Events.Custom{} = ev, _ctx), do: ev
+
+  defp with_hits(%{type: type} = ev, ctx) when type in @pointer_events do
+    {:vz_hits, ev, NIF.hit_test(ctx, ev.abs_x, ev.abs_y)}
   end
 
-  def handle_events(events, els, ctx) when is_list(els) do
+  defp with_hits(ev, _ctx), do: ev
+
+  defp without_hits({:vz_hits, ev, _hits}), do: ev
+  defp without_hits(ev), do: ev
+
+  defp dispatch(events, %Node{id: id} = node) do
+    if Enum.any?(events, &wants_event?(&1, id)) do
+      {node, events} = Enum.reduce(events, {node, []}, &maybe_handle_event/2)
+      {children, events} = dispatch_children(Enum.reverse(events), node.children)
+      {%Node{node | children: children}, events}
+    else
+      {node, events}
+    end
+  end
+
+  defp dispatch_children(events, els) do
     {els, events} =
       Enum.reduce(els, {[], events}, fn node, {els, evs} ->
-        {new_el, new_evs} = handle_events(evs, node, ctx)
+        {new_el, new_evs} = dispatch(evs, node)
         {[new_el | els], new_evs}
       end)
 
     {Enum.reverse(els), events}
   end
 
+  defp wants_event?(%Events.Custom{}, _id), do: true
+  defp wants_event?({:vz_hits, _ev, hits}, id), do: Map.has_key?(hits, id)
+  defp wants_event?(_ev, _id), do: false
+
   defp maybe_handle_event(%Events.Custom{} = ev, {%Node{initialized: true} = node, acc}) do
-    handle_event(node, ev, acc)
+    handle_event(ev, ev, node, acc)
   end
 
-  defp maybe_handle_event(%{type: type} = ev, {%Node{initialized: true} = node, acc})
-       when type in ~w(button_press button_release key_press key_release motion scroll)a do
-    inv_xform = NIF.transform_inverse(node.xform)
-    {x, y} = NIF.transform_point(inv_xform, ev.abs_x, ev.abs_y)
+  defp maybe_handle_event({:vz_hits, ev, hits} = item, {%Node{initialized: true} = node, acc}) do
+    case Map.get(hits, node.id) do
+      {x, y} ->
+        handle_event(%{ev | x: x, y: y}, item, node, acc)
 
-    if touches?(node, x, y),
-      do: handle_event(%{ev | x: x, y: y}, node, acc),
-      else: {node, [ev | acc]}
+      nil ->
+        {node, [item | acc]}
+    end
   end
 
-  defp maybe_handle_event(ev, {node, acc}) do
-    {node, [ev | acc]}
+  defp maybe_handle_event(item, {node, acc}) do
+    {node, [item | acc]}
   end
 
-  defp handle_event(ev, node, acc) do
+  defp handle_event(ev, item, node, acc) do
     case node.mod.handle_event(ev, node) do
       :cont ->
-        {node, [ev | acc]}
+        {node, [item | acc]}
 
       {:done, new_el} ->
         {new_el, acc}
 
       {:cont, new_el} ->
-        {new_el, [ev | acc]}
+        {new_el, [item | acc]}
 
       :done ->
         {node, acc}
     end
   end
 
-  defp touches?(%Node{width: width, height: height}, x, y) do
-    x >= 0 and x <= width and y >= 0 and y <= height
-  end
-
   # Animations
 
   @doc false
@@ -227,6 +227,104 @@ defmodule T do
     ts2 = :os.timestamp()
     IO.puts("step: #{:timer.now_diff(ts2, ts1) / 1000}")
   end
+
+  def bm_transform do
+    alias Vizi.NIF
+    alias Vizi.Canvas.Transform
+
+    n = 1_000_000
+
+    ts1 = :os.timestamp()
+
+    Enum.each(1..n, fn x ->
+      NIF.transform_translate(x, x)
+      |> NIF.transform_multiply(NIF.transform_rotate(0.5))
+      |> NIF.transform_multiply(NIF.transform_scale(2, 2))
+      |> NIF.transform_inverse()
+      |> NIF.transform_point(10, 10)
+    end)
+
+    ts2 = :os.timestamp()
+
+    Enum.each(1..n, fn x ->
+      Transform.translate(x, x)
+      |> Transform.multiply(Transform.rotate(0.5))
+      |> Transform.multiply(Transform.scale(2, 2))
+      |> Transform.inverse()
+      |> Transform.point(10, 10)
+    end)
+
+    ts3 = :os.timestamp()
+
+    Enum.each(1..n, fn x ->
+      [Transform.translate(x, x), Transform.rotate(0.5), Transform.scale(2, 2)]
+      |> Transform.compose()
+      |> Transform.inverse()
+      |> Transform.point(10, 10)
+    end)
+
+    ts4 = :os.timestamp()
+    IO.puts("resource: #{:timer.now_diff(ts2, ts1) / 1000}")
+    IO.puts("tuple: #{:timer.now_diff(ts3, ts2) / 1000}")
+    IO.puts("tuple compose: #{:timer.now_diff(ts4, ts3) / 1000}")
+  end
+
+  def bm_idle(seconds \\ 10) do
+    {:ok, view} = Vizi.View.start(T.Idle, %{}, width: 400, height: 300, redraw_mode: :manual)
+    Process.sleep(1000)
+
+    %{cpu_time: cpu1, frames: frames1} = View.stats(view)
+    {runtime1, _} = :erlang.statistics(:runtime)
+    Process.sleep(seconds * 1000)
+    %{cpu_time: cpu2, frames: frames2} = View.stats(view)
+    {runtime2, _} = :erlang.statistics(:runtime)
+
+    View.shutdown(view)
+    IO.puts("view thread cpu: #{(cpu2 - cpu1) / 1000} ms, frames: #{frames2 - frames1}")
+    IO.puts("process cpu: #{runtime2 - runtime1} ms")
+  end
+
+  def bm_pixels(width \\ 1920, height \\ 1080, runs \\ 20) do
+    alias Vizi.Canvas.Image
+
+    pattern = for n <- 0..255, into: <<>>, do: <<n, 255 - n, div(n, 2), rem(n * 7, 256)>>
+    rgba = :binary.copy(pattern, div(width * height, 256))
+    rgb = for <<r, g, b, _a <- pattern>>, into: <<>>, do: <<r, g, b>>
+    rgb = :binary.copy(rgb, div(width * height, 256))
+    lut = for n <- 0..255, into: <<>>, do: <<255 - n>>
+
+    kernels = [
+      premultiply: {&Image.premultiply/1, rgba},
+      unpremultiply: {&Image.unpremultiply/1, rgba},
+      swizzle: {&Image.swizzle(&1, [2, 1, 0, 3]), rgba},
+      rgb_to_rgba: {&Image.rgb_to_rgba/1, rgb},
+      grayscale: {&Image.grayscale/1, rgba},
+      apply_lut: {&Image.apply_lut(&1, lut), rgba}
+    ]
+
+    IO.puts("kernels: #{Vizi.NIF.image_pixel_isa()}")
+
+    for {name, {fun, data}} <- kernels do
+      {time, _} = :timer.tc(fn -> Enum.each(1..runs, fn _ -> fun.(data) end) end)
+      IO.puts("#{name}: #{Float.round(byte_size(data) * runs / 1_048_576 / (time / 1_000_000), 1)} MB/s")
+    end
+
+    {time, _} =
+      :timer.tc(fn ->
+        for <<r, g, b, a <- rgba>>, into: <<>>, do: <<div(r * a, 255), div(g * a, 255), div(b * a, 255), a>>
+      end)
+
+    IO.puts("premultiply in elixir: #{Float.round(byte_size(rgba) / 1_048_576 / (time / 1_000_000), 1)} MB/s")
+  end
+
+  defmodule Idle do
+    @moduledoc false
+    use View
+
+    def init(view) do
+      {:ok, Root.new(width: view.width, height: view.height)}
+    end
+  end
 end
 
 defmodule BM do
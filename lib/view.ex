@@ -37,7 +37,7 @@ defmodule Vizi.View do
 
   @type context :: <<>>
 
-  @type redraw_mode :: :manual | :interval
+  @type redraw_mode :: :manual | :interval | :auto
 
   @type suspend_state :: :off | :requested | :on
 
@@ -156,6 +156,12 @@ defmodule Vizi.View do
           | {:frame_rate, integer}
           | {:background_color, Canvas.Color.t()}
           | {:pixel_ratio, float}
+          | {:layer_budget, non_neg_integer}
+          | {:texture_budget, non_neg_integer}
+          | {:glyph_atlas_size, pos_integer}
+          | {:glyph_atlas_max_size, pos_integer}
+          | {:partial_redraw, boolean}
+          | {:shared_renderer, boolean}
 
   @type options :: [GenServer.option() | option]
 
@@ -258,10 +264,16 @@ defmodule Vizi.View do
   * `:resizable` - make the view's windows resizable (default: `false`)
   * `:min_width` - the view's window minimum width if resizable is `true` (default: `0`)
   * `:min_height` - the view's window minimum height if resizable is `true` (default: `0`)
-  * `:redraw_mode` - can be either `:manual`, or `:interval` (default: `:interval`)
-  * `:frame_rate` - sets how many times per second the view will be redrawn when the redraw mode is `:interval` (default: `:vsync`)
+  * `:redraw_mode` - can be either `:manual`, `:interval` or `:auto`. In auto mode, frames are drawn at the frame rate while nodes are animating or after the view's root node changed, and no frames are drawn while nothing changes (default: `:interval`)
+  * `:frame_rate` - sets how many times per second the view will be redrawn when the redraw mode is `:interval` (default: `:vsync`). With `:vsync`, the frame rate is the refresh rate of the display showing the window
   * `:pixel_ratio` - device pixel ration allows to control the rendering on Hi-DPI devices (default: `1.0`)
   * `:background_color` - sets the view's background color (default: `rgba(0, 0, 0, 0)`)
+  * `:partial_redraw` - when true, only the parts of the view that changed since the last frame are cleared and redrawn. A node changes when its params, size, alpha, children or transform change, or when it is passed to `Vizi.Node.damage/1`. Updating the contents of an image, with `Vizi.Canvas.Image.update_from_binary/3`, `Vizi.Canvas.Image.update_video/3`, `Vizi.Canvas.Image.update_heatmap/4` or `Vizi.Canvas.Image.heatmap_colormap/3`, changes the nodes that drew it. An image that is drawn outside of a node, by more than 16 nodes or not drawn yet redraws the whole view (default: `false`)
+  * `:shared_renderer` - when true, the view doesn't get a render thread of its own, but shares one of a fixed pool of render threads with other views. Useful when running many small views. The pool size is set with `config :vizi, render_threads: n` and defaults to the number of schedulers (default: `false`)
+  * `:layer_budget` - maximum memory in megabytes used by nodes with `cache: :layer`, least recently used layers are evicted first (default: `64`)
+  * `:texture_budget` - maximum memory in megabytes used by image textures. When exceeded, the least recently drawn images are evicted and uploaded again from their file or binary when drawn. Textures of files shared with other views are not evicted. `0` means no limit (default: `0`)
+  * `:glyph_atlas_size` - initial width and height in pixels of the atlas glyphs of SDF fonts are kept in, at least `128` (default: `512`)
+  * `:glyph_atlas_max_size` - size in pixels the glyph atlas may grow to as glyphs are added. When it's full, the glyphs drawn the longest ago are evicted (default: `2048`)
   """
   @spec start(module, params, options) :: GenServer.on_start()
   def start(mod, params, opts \\ []) do
@@ -320,6 +332,30 @@ defmodule Vizi.View do
     GenServer.cast(get_server(server), :vz_shutdown)
   end
 
+  @doc """
+  Returns the number of frames drawn by a view, the CPU time in microseconds used by its render thread,
+  the refresh rate of the display showing the view, the measured time between frames in microseconds,
+  the memory used by image textures in bytes and how many times textures were evicted and reloaded,
+  the memory used by the glyph atlas of SDF fonts in bytes, the fraction of it occupied by glyphs and
+  how many times glyphs were rasterized and evicted.
+  """
+  @spec stats(server) :: %{
+          frames: non_neg_integer,
+          cpu_time: non_neg_integer,
+          refresh_rate: float,
+          frame_interval: float,
+          texture_bytes: non_neg_integer,
+          texture_evictions: non_neg_integer,
+          texture_reloads: non_neg_integer,
+          glyph_atlas_bytes: non_neg_integer,
+          glyph_atlas_occupancy: float,
+          glyph_rasterizations: non_neg_integer,
+          glyph_evictions: non_neg_integer
+        }
+  def stats(server) do
+    GenServer.call(get_server(server), :vz_stats)
+  end
+
   @doc false
   def suspend(server) do
     server = get_server(server)
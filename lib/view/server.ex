@@ -35,7 +35,7 @@ defmodule Vizi.View.Server do
       {:ok, ctx} ->
         wait_until_initialized(ctx)
 
-        xform = Canvas.Transform.identity(ctx)
+        xform = Canvas.Transform.identity()
         redraw_mode = Keyword.get(opts, :redraw_mode, :interval)
         frame_rate = NIF.get_frame_rate(ctx)
 
@@ -87,8 +87,14 @@ defmodule Vizi.View.Server do
     end
   end
 
+  def handle_call(:vz_stats, _from, view) do
+    {:reply, NIF.get_stats(view.context), view}
+  end
+
   def handle_call({:vz_view_call, request}, from, view) do
-    view.mod.handle_call(request, from, view)
+    request
+    |> view.mod.handle_call(from, view)
+    |> maybe_request_frame(view)
   end
 
   @doc false
@@ -116,6 +122,7 @@ defmodule Vizi.View.Server do
 
         case handle_init(view.mod, %View{view | params: view.init_params}) do
           {:ok, view} ->
+            if view.redraw_mode == :auto, do: NIF.redraw(view.context)
             {:noreply, %{view | suspend: :off}}
 
           :ignore ->
@@ -145,13 +152,20 @@ defmodule Vizi.View.Server do
   end
 
   def handle_cast({:vz_view_cast, request}, view) do
-    view.mod.handle_cast(request, view)
+    request
+    |> view.mod.handle_cast(view)
+    |> maybe_request_frame(view)
   end
 
   @doc false
   def handle_info(:vz_update, view) do
-    root = Node.update(view.root, view.identity_xform, view.context)
+    {root, animating} = Node.update(view.root, view.context)
     NIF.ready(view.context)
+
+    if animating and view.redraw_mode == :auto do
+      NIF.redraw(view.context)
+    end
+
     {:noreply, %{view | root: root}}
   end
 
@@ -164,12 +178,14 @@ defmodule Vizi.View.Server do
   end
 
   def handle_info({:vz_event, events}, view) when is_list(events) do
-    view = handle_events(view.custom_events ++ events, view)
-    {:noreply, view}
+    new_view = handle_events(view.custom_events ++ events, view)
+    maybe_request_frame({:noreply, new_view}, view)
   end
 
   def handle_info(msg, view) do
-    view.mod.handle_info(msg, view)
+    msg
+    |> view.mod.handle_info(view)
+    |> maybe_request_frame(view)
   end
 
   @doc false
@@ -190,6 +206,21 @@ defmodule Vizi.View.Server do
 
   # Internal functions
 
+  # In auto redraw mode, frames are only drawn while nodes are animating,
+  # or when a callback changed the root node.
+  defp maybe_request_frame(result, %View{redraw_mode: :auto, root: root, context: ctx})
+       when is_tuple(result) do
+    case Enum.find(Tuple.to_list(result), &match?(%View{}, &1)) do
+      %View{root: ^root} -> :ok
+      %View{} -> NIF.redraw(ctx)
+      nil -> :ok
+    end
+
+    result
+  end
+
+  defp maybe_request_frame(result, _view), do: result
+
   defp handle_init(mod, view) do
     case mod.init(view) do
       {:ok, root} ->
@@ -233,6 +264,8 @@ defmodule Vizi.View.Server do
   end
 
   defp handle_configure(ev, state) do
+    # the window may have moved to a display with another refresh rate
+    Process.put(:vz_frame_rate, NIF.get_frame_rate(state.context))
     %{state | identity_xform: ev.xform, width: ev.width, height: ev.height}
   end
 
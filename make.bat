@@ -1,5 +1,5 @@
 SETLOCAL ENABLEEXTENSIONS
 FOR /F "delims=" %%i IN ('erl -args_file get_erl_path.args') DO set erlang_path=%%i
-cl /Z7 -D VZ_PLATFORM_WINDOWS -D PUGL_HAVE_GL -D NANOVG_GLEW -D GLEW_STATIC -LD -MD -I%erlang_path% -Ic_src/pugl -Ic_src/nanovg/src -Ic_src/glew-2.1.0/include -Fe c_src/vz_nif.c c_src/vz_atoms.c c_src/vz_resources.c c_src/vz_events.c c_src/vz_view_thread.c c_src/pugl/pugl/pugl_win.cpp c_src/nanovg/src/nanovg.c winmm.lib glew32s.lib user32.lib gdi32.lib glu32.lib opengl32.lib kernel32.lib
+cl /Z7 -D VZ_PLATFORM_WINDOWS -D PUGL_HAVE_GL -D NANOVG_GLEW -D GLEW_STATIC -LD -MD -I%erlang_path% -Ic_src/pugl -Ic_src/nanovg/src -Ic_src/glew-2.1.0/include -Fe c_src/vz_nif.c c_src/vz_atoms.c c_src/vz_resources.c c_src/vz_events.c c_src/vz_view_thread.c c_src/vz_nodes.c c_src/vz_layers.c c_src/vz_damage.c c_src/vz_renderer.c c_src/vz_assets.c c_src/vz_textures.c c_src/vz_pixels.c c_src/vz_video.c c_src/vz_heatmap.c c_src/vz_gl.c c_src/vz_paths.c c_src/vz_svg.c c_src/vz_sdf.c c_src/vz_streams.c c_src/vz_share.c c_src/pugl/pugl/pugl_win.cpp c_src/nanovg/src/nanovg.c winmm.lib glew32s.lib user32.lib gdi32.lib glu32.lib opengl32.lib kernel32.lib
 mkdir priv\
 move /Y vz_nif.dll priv\
\ No newline at end of file
@@ -4,7 +4,7 @@ defmodule Vizi.Mixfile do
   def project do
     [
       app: :vizi,
-      version: "0.3.0",
+      version: "0.4.0",
       elixir: "~> 1.4",
       start_permanent: Mix.env() == :prod,
       deps: deps(),
@@ -18,7 +18,7 @@ defmodule Vizi.Mixfile do
       name: "Vizi",
       source_url: "https://github.com/zambal/vizi",
       homepage_url: "https://github.com/zambal/vizi",
-      docs: [extras: ["README.md"]]
+      docs: [extras: ["README.md", "CHANGELOG.md"]]
     ]
   end
 
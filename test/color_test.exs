@@ -0,0 +1,44 @@
+defmodule Vizi.Canvas.ColorTest do
+  use ExUnit.Case, async: true
+
+  use Vizi.Canvas
+
+  test "pack puts the channels in 0xRRGGBBAA order" do
+    assert Color.pack(0x12, 0x34, 0x56, 0x78) == 0x12345678
+    assert Color.pack(255, 0, 0) == 0xFF0000FF
+  end
+
+  test "pack rounds and clamps the channels" do
+    assert Color.pack(-10, 300, 127.6, 0.4) == 0x00FF8000
+  end
+
+  test "unpack is the inverse of pack" do
+    assert Color.unpack(0x00000000) == %Color{r: 0.0, g: 0.0, b: 0.0, a: 0.0}
+    assert Color.unpack(0xFFFFFFFF) == %Color{r: 1.0, g: 1.0, b: 1.0, a: 1.0}
+
+    for color <- [0x12345678, 0xFF8000C0, 0x01020304] do
+      %Color{r: r, g: g, b: b, a: a} = Color.unpack(color)
+      assert Color.pack(r * 255, g * 255, b * 255, a * 255) == color
+    end
+  end
+
+  test "rgba is a function returning a packed color" do
+    assert rgba(255, 128, 0) == 0xFF8000FF
+    assert apply(Vizi.Canvas, :rgba, [1, 2, 3, 4]) == 0x01020304
+    assert (&Vizi.Canvas.rgba/4).(1, 2, 3, 4) == 0x01020304
+  end
+
+  test "rgba_const packs literals at compile time and other values at runtime" do
+    expanded = Macro.expand(quote(do: Vizi.Canvas.rgba_const(255, 128, 0, 64)), __ENV__)
+    assert expanded == 0xFF800040
+
+    g = Enum.random([128])
+    assert rgba_const(255, g, 0, 64) == rgba(255, 128, 0, 64)
+    assert rgba_const(255, 128, 0) == rgba(255, 128, 0)
+  end
+
+  test "lerp returns packed colors" do
+    assert Color.lerp(0x000000FF, 0xFFFFFFFF, 0.0) == 0x000000FF
+    assert Color.lerp(0x000000FF, 0xFFFFFFFF, 1.0) == 0xFFFFFFFF
+  end
+end
@@ -0,0 +1,106 @@
+defmodule Vizi.Canvas.ImageTest do
+  use ExUnit.Case, async: true
+
+  alias Vizi.Canvas.Image
+
+  # an odd number of pixels, so both the SIMD kernels and their scalar tails run
+  @pixels 37
+
+  defp rgba_data do
+    :rand.seed(:exsss, {1, 2, 3})
+
+    opaque = <<10, 20, 30, 255>>
+    transparent = <<0, 0, 0, 0>>
+
+    random =
+      for _ <- 1..(@pixels - 2), into: <<>> do
+        a = :rand.uniform(256) - 1
+        <<:rand.uniform(256) - 1, :rand.uniform(256) - 1, :rand.uniform(256) - 1, a>>
+      end
+
+    opaque <> transparent <> random
+  end
+
+  defp div255(x) do
+    x = x + 128
+    Bitwise.bsr(x + Bitwise.bsr(x, 8), 8)
+  end
+
+  defp map_pixels(data, fun) do
+    for <<r, g, b, a <- data>>, into: <<>>, do: fun.(r, g, b, a)
+  end
+
+  test "premultiply multiplies the color channels by alpha" do
+    data = rgba_data()
+
+    expected =
+      map_pixels(data, fn r, g, b, a ->
+        <<div255(r * a), div255(g * a), div255(b * a), a>>
+      end)
+
+    assert Image.premultiply(data) == expected
+  end
+
+  test "unpremultiply divides the color channels by alpha" do
+    data = Image.premultiply(rgba_data())
+    result = Image.unpremultiply(data)
+
+    for {<<r, g, b, a>>, <<ur, ug, ub, ua>>} <- Enum.zip(chunks(data), chunks(result)) do
+      assert ua == a
+
+      for {c, u} <- [{r, ur}, {g, ug}, {b, ub}] do
+        expected = if a == 0, do: 0, else: min(round(c * 255 / a), 255)
+        assert abs(u - expected) <= 1
+      end
+    end
+
+    # opaque pixels are unchanged
+    assert binary_part(result, 0, 4) == <<10, 20, 30, 255>>
+  end
+
+  test "swizzle reorders the channels" do
+    data = rgba_data()
+    expected = map_pixels(data, fn r, g, b, a -> <<b, g, r, a>> end)
+    assert Image.swizzle(data, [2, 1, 0, 3]) == expected
+    assert Image.swizzle(Image.swizzle(data, [2, 1, 0, 3]), [2, 1, 0, 3]) == data
+  end
+
+  test "rgb_to_rgba adds an opaque alpha channel" do
+    rgb = for <<r, g, b, _a <- rgba_data()>>, into: <<>>, do: <<r, g, b>>
+    expected = for <<r, g, b <- rgb>>, into: <<>>, do: <<r, g, b, 255>>
+    assert Image.rgb_to_rgba(rgb) == expected
+  end
+
+  test "grayscale replaces the color channels by their BT.601 luma" do
+    data = rgba_data()
+
+    expected =
+      map_pixels(data, fn r, g, b, a ->
+        y = Bitwise.bsr(r * 77 + g * 150 + b * 29 + 128, 8)
+        <<y, y, y, a>>
+      end)
+
+    assert Image.grayscale(data) == expected
+  end
+
+  test "apply_lut maps the color channels, or every channel with a table per channel" do
+    data = rgba_data()
+    invert = for i <- 0..255, into: <<>>, do: <<255 - i>>
+    identity = for i <- 0..255, into: <<>>, do: <<i>>
+
+    expected = map_pixels(data, fn r, g, b, a -> <<255 - r, 255 - g, 255 - b, a>> end)
+    assert Image.apply_lut(data, invert) == expected
+
+    expected = map_pixels(data, fn r, g, b, a -> <<r, 255 - g, b, 255 - a>> end)
+    assert Image.apply_lut(data, identity <> invert <> identity <> invert) == expected
+  end
+
+  test "conversions reject data that isn't a whole number of pixels" do
+    assert_raise ArgumentError, fn -> Image.premultiply(<<1, 2, 3>>) end
+    assert_raise ArgumentError, fn -> Image.rgb_to_rgba(<<1, 2, 3, 4>>) end
+    assert_raise ArgumentError, fn -> Image.swizzle(<<1, 2, 3, 4>>, [0, 1, 2, 4]) end
+    assert_raise ArgumentError, fn -> Image.apply_lut(<<1, 2, 3, 4>>, <<0>>) end
+  end
+
+  defp chunks(data), do: for(<<pixel::binary-size(4) <- data>>, do: pixel)
+end
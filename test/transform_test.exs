@@ -0,0 +1,100 @@
+defmodule Vizi.Canvas.TransformTest do
+  use ExUnit.Case, async: true
+
+  alias Vizi.Canvas.Transform
+  alias Vizi.NIF
+
+  @transforms [
+    Transform.translate(10, -20),
+    Transform.rotate(0.3),
+    Transform.scale(2.5, 0.5),
+    Transform.skew_x(0.1),
+    Transform.skew_y(-0.2),
+    {1.1, 0.2, -0.3, 0.9, 7.0, 3.0}
+  ]
+
+  defp assert_matrix(a, b, delta) do
+    Enum.zip(Tuple.to_list(a), Tuple.to_list(b))
+    |> Enum.each(fn {x, y} -> assert_in_delta x, y, delta end)
+  end
+
+  defp nif_matrix(list) do
+    list |> Transform.matrix_to_list() |> NIF.list_to_matrix()
+  end
+
+  test "compose gives exactly the result of multiplying in Elixir" do
+    expected = Enum.reduce(@transforms, Transform.identity(), &Transform.multiply(&2, &1))
+    assert Transform.compose(@transforms) === expected
+  end
+
+  test "compose of an empty list is the identity" do
+    assert Transform.compose([]) === Transform.identity()
+  end
+
+  test "compose accepts integer components" do
+    assert Transform.compose([{1, 0, 0, 1, 5, 6}]) === {1.0, 0.0, 0.0, 1.0, 5.0, 6.0}
+  end
+
+  test "matrix constructors match NanoVG" do
+    pairs = [
+      {Transform.translate(10, -20), NIF.transform_translate(10, -20)},
+      {Transform.rotate(0.3), NIF.transform_rotate(0.3)},
+      {Transform.scale(2.5, 0.5), NIF.transform_scale(2.5, 0.5)},
+      {Transform.skew_x(0.1), NIF.transform_skew_x(0.1)},
+      {Transform.skew_y(-0.2), NIF.transform_skew_y(-0.2)}
+    ]
+
+    for {tuple, matrix} <- pairs do
+      assert_matrix(tuple, List.to_tuple(NIF.matrix_to_list(matrix)), 1.0e-6)
+    end
+  end
+
+  test "multiply, premultiply, inverse and point match NanoVG" do
+    [a, b | _] = Enum.drop(@transforms, 1)
+    na = nif_matrix(a)
+    nb = nif_matrix(b)
+
+    assert_matrix(
+      Transform.multiply(a, b),
+      List.to_tuple(NIF.matrix_to_list(NIF.transform_multiply(na, nb))),
+      1.0e-5
+    )
+
+    assert_matrix(
+      Transform.premultiply(a, b),
+      List.to_tuple(NIF.matrix_to_list(NIF.transform_premultiply(na, nb))),
+      1.0e-5
+    )
+
+    assert_matrix(
+      Transform.inverse(a),
+      List.to_tuple(NIF.matrix_to_list(NIF.transform_inverse(na))),
+      1.0e-5
+    )
+
+    {x, y} = Transform.point(a, 3, 4)
+    {nx, ny} = NIF.transform_point(na, 3, 4)
+    assert_in_delta x, nx, 1.0e-4
+    assert_in_delta y, ny, 1.0e-4
+  end
+
+  test "inverse undoes a transform" do
+    t = Transform.compose(@transforms)
+    assert_matrix(Transform.multiply(t, Transform.inverse(t)), Transform.identity(), 1.0e-9)
+  end
+
+  test "inverse of a singular transform is the identity, like NanoVG" do
+    singular = [
+      {0.0, 0.0, 0.0, 0.0, 1.0, 2.0},
+      {1, 2, 2, 4, 0, 0},
+      {1.0e-4, 0.0, 0.0, 1.0e-4, 0.0, 0.0}
+    ]
+
+    for matrix <- singular do
+      assert Transform.inverse(matrix) === Transform.identity()
+
+      assert NIF.matrix_to_list(NIF.transform_inverse(nif_matrix(matrix))) ==
+               Transform.matrix_to_list(Transform.identity())
+    end
+  end
+end
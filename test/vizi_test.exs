@@ -1,8 +1,7 @@
-defmodule VZTest do
+defmodule ViziTest do
   use ExUnit.Case
-  doctest Nanoview
 
-  test "greets the world" do
-    true
+  test "the NIF library is loaded" do
+    assert_in_delta Vizi.Canvas.deg_to_rad(180), :math.pi(), 1.0e-6
   end
 end